@@ -355,12 +355,9 @@ int main(int argc, const char **argv) {
 				VK_ATTACHMENT_STORE_OP_DONT_CARE,
 				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
 				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
-			VkAttachmentDescription{ 0, depth_format, VK_SAMPLE_COUNT_1_BIT,
-				VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-				VK_ATTACHMENT_STORE_OP_DONT_CARE,
-				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL }
+			vcc::render_pass::transient_attachment_description(depth_format,
+				VK_SAMPLE_COUNT_1_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
 		},
 		{
 			vcc::render_pass::subpass_description_type{
@@ -465,14 +462,10 @@ int main(int argc, const char **argv) {
 		command_buffers.clear();
 
 		std::shared_ptr<vcc::image::image_type> depth_image =
-			std::make_shared<vcc::image::image_type>(vcc::image::create(
-				std::ref(device), 0, VK_IMAGE_TYPE_2D, depth_format,
-				{ extent.width, extent.height, 1 }, 1, 1,
-				VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
-				VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-				VK_SHARING_MODE_EXCLUSIVE, {}, VK_IMAGE_LAYOUT_UNDEFINED));
-		vcc::memory::bind(std::ref(device), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			*depth_image);
+			std::make_shared<vcc::image::image_type>(
+				vcc::image::create_transient_attachment(std::ref(device),
+					depth_format, extent, VK_SAMPLE_COUNT_1_BIT,
+					VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT));
 
 		vcc::command_buffer::command_buffer_type command_buffer(std::move(
 			vcc::command_buffer::allocate(std::ref(device), std::ref(cmd_pool),
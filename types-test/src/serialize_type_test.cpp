@@ -311,3 +311,23 @@ TEST(SerializeTypeTest, GroupedInterleavedStd140ArrayLayout1) {
 	ASSERT_TRUE(std::equal(&output[0] + 40, &output[0] + 43, compare9));
 	ASSERT_TRUE(std::equal(&output[0] + 44, &output[0] + 47, compare10));
 }
+
+TEST(SerializeTypeTest, DirtyRange) {
+	type::t_array<float> array1({ 1, 2, 3 });
+	type::t_array<float2> array2{{ {1, 2}, {2, 3}, {3, 4} }};
+	type::t_array<float3> array3{{ {1, 2, 3}, {4, 5, 6}, {7, 8, 9} }};
+	type::serialize_type serialized(type::make_serialize(type::linear,
+		std::ref(array1), std::ref(array2), std::ref(array3)));
+	ASSERT_EQ(std::make_pair(std::size_t(0), type::size(serialized)),
+		type::dirty_range(serialized));
+	float output[3 + 2 * 3 + 3 * 3];
+	type::flush(serialized, output);
+	ASSERT_EQ(std::make_pair(std::size_t(0), std::size_t(0)),
+		type::dirty_range(serialized));
+	type::write(array2)[1] = float2{ 5, 6 };
+	ASSERT_EQ(std::make_pair(sizeof(float) * 3, sizeof(float) * (3 + 6)),
+		type::dirty_range(serialized));
+	type::write(array3)[0] = float3{ 1, 1, 1 };
+	ASSERT_EQ(std::make_pair(sizeof(float) * 3, type::size(serialized)),
+		type::dirty_range(serialized));
+}
@@ -70,6 +70,15 @@ TEST(ArrayTypeTest, Revision) {
 	ASSERT_EQ(2, type::internal::get_revision(array));
 }
 
+TEST(ArrayTypeTest, ReadKeepsRevision) {
+	type::t_array<float> array({1, 2, 3});
+	type::read(array);
+	ASSERT_EQ(1, type::internal::get_revision(array));
+	type::write(array);
+	type::read(array);
+	ASSERT_EQ(2, type::internal::get_revision(array));
+}
+
 TEST(ArrayTypeTest, Mutate) {
 	type::t_array<float> array({1, 2, 3});
 	{
@@ -16,6 +16,7 @@
 #ifndef TYPE_SERIALIZE_H_
 #define TYPE_SERIALIZE_H_
 
+#include <utility>
 #include <type/memory.h>
 #include <type/view.h>
 
@@ -118,6 +119,8 @@ class serialize_type {
 	friend std::size_t size(const serialize_type &serialize);
 	friend void flush(const serialize_type &serialize, void *output);
 	friend bool dirty(const serialize_type &serialize);
+	friend std::pair<std::size_t, std::size_t> dirty_range(
+		const serialize_type &serialize);
 	friend memory_layout layout(const serialize_type &serialize);
 private:
 	typedef std::vector<std::unique_ptr<internal::adapter>> adapter_container_type;
@@ -152,6 +155,9 @@ public:
 
 void flush(const serialize_type &serialize, void *output);
 bool dirty(const serialize_type &serialize);
+// Returns the [begin, end) byte range covering all content that flush
+// would write, or an empty range if nothing is dirty.
+std::pair<std::size_t, std::size_t> dirty_range(const serialize_type &serialize);
 std::size_t size(const serialize_type &serialize);
 memory_layout layout(const serialize_type &serialize);
 
@@ -178,6 +178,9 @@ public:
 
 namespace internal {
 
+// Holds the lock of a storage while reading it. Reading leaves the revision
+// alone, only writable_storage_type bumps it, so views and input_buffers
+// are not made dirty by reads.
 template<typename T, bool Mutable, bool IsArray>
 class readable_storage_type {
 protected:
@@ -211,12 +214,6 @@ public:
 		copy.array = nullptr;
 		return *this;
 	}
-	~readable_storage_type() {
-		if (array) {
-			++internal::get_revision(*array);
-		}
-	}
-
 	const_iterator begin() const {
 		return internal::get_container(*array).cbegin();
 	}
@@ -93,6 +93,19 @@ bool dirty(const serialize_type &serialize) {
 	}) != serialize.adapters.end();
 }
 
+std::pair<std::size_t, std::size_t> dirty_range(const serialize_type &serialize) {
+	std::size_t begin(serialize.size), end(0);
+	for (const std::unique_ptr<internal::adapter> &adapter : serialize.adapters) {
+		if (adapter->count && adapter->dirty()) {
+			begin = std::min(begin, adapter->offset);
+			end = std::max(end, adapter->offset
+				+ (adapter->count - 1) * adapter->stride + adapter->element_size);
+		}
+	}
+	return begin < end ? std::make_pair(begin, end)
+		: std::make_pair(std::size_t(0), std::size_t(0));
+}
+
 std::size_t size(const serialize_type &serialize) {
 	return serialize.size;
 }
@@ -14,10 +14,13 @@
 * limitations under the License.
 */
 #include <cassert>
+#include <cstring>
 #include <gli/gli.hpp>
 #include <sstream>
 #include <vcc/command.h>
+#include <vcc/fence.h>
 #include <vcc/image.h>
+#include <vcc/internal/flush_batch.h>
 #include <vcc/internal/loader.h>
 #include <vcc/memory.h>
 #include <vcc/queue.h>
@@ -40,14 +43,6 @@ VkImageType convert_type(gli::target target);
 VkExtent3D convert_extent(const gli::extent3d &extent);
 VkFormat convert_format(gli::format format);
 
-// Note: technically, we could end up with a remainder,
-// but for example BC1 is required to have dimensions in multiples of ifs block size.
-glm::ivec3 compressed_extent(const gli::texture &texture) {
-	const glm::ivec3 block_extent(gli::block_extent(texture.format()));
-	const gli::extent3d extent(texture.extent());
-	return glm::ivec3(extent / block_extent);
-}
-
 image::image_type gli_loader_type::load(
 	const type::supplier<vcc::queue::queue_type> &queue,
 	VkImageCreateFlags flags,
@@ -85,75 +80,69 @@ image::image_type gli_loader_type::load(
 		usage, sharingMode, queueFamilyIndices, VK_IMAGE_LAYOUT_UNDEFINED));
 	memory::bind(device, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image);
 
-	command_pool::command_pool_type command_pool(command_pool::create(
-		device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, queue::get_family_index(*queue)));
-	command_buffer::command_buffer_type command_buffer(std::move(command_buffer::allocate(
-		device, std::ref(command_pool), VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1).front()));
-	image::image_type staging_image(image::create(device, 0, VK_IMAGE_TYPE_2D,
-		format, VkExtent3D{ extent.width, extent.height, 1 }, 1, 1,
-		VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_LINEAR,
-		VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE,
-		{ queue::get_family_index(*queue) }, VK_IMAGE_LAYOUT_UNDEFINED));
-	memory::bind(device, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, staging_image);
+	// Every slice is staged in one buffer and copied by a single submit.
+	// bufferOffset must be a multiple of 4 and of the texel block size.
+	const VkDeviceSize block_size(gli::block_size(texture.format()));
+	const VkDeviceSize alignment(block_size % 4 == 0 ? block_size
+		: block_size % 2 == 0 ? block_size * 2 : block_size * 4);
+	std::vector<VkBufferImageCopy> regions;
+	std::vector<const void *> sources;
+	VkDeviceSize staging_size(0);
 	for (std::size_t layer = 0; layer < texture.layers(); ++layer) {
 		for (std::size_t face = 0; face < texture.faces(); ++face) {
 			for (std::size_t level = 0; level < texture.levels(); ++level) {
-				for (uint32_t z = 0; z < extent.depth; ++z) {
-					const std::size_t layer_index(layer * texture.faces()
-						+ face);
-					const glm::ivec3 extent(glm::ivec3(texture.extent(level)));
-					const glm::ivec3 copy_extent(
-						gli::is_compressed(texture.format())
-						? compressed_extent(texture) : extent);
-					const std::size_t block_size(gli::block_size(texture.format()));
-					copy_to_linear_image(format, aspect_mask,
-						VkExtent2D{ uint32_t(copy_extent.x), uint32_t(copy_extent.y) },
-						texture.data(layer, face, level), block_size,
-						block_size * copy_extent.x, staging_image);
-
-					command_buffer::compile(command_buffer,
-						VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, VK_FALSE, 0, 0,
-						command::pipeline_barrier(
-							VK_PIPELINE_STAGE_HOST_BIT,
-							VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-							{},{},
-							{
-								command::image_memory_barrier{
-									VK_ACCESS_HOST_WRITE_BIT,
-									VK_ACCESS_TRANSFER_READ_BIT,
-									VK_IMAGE_LAYOUT_UNDEFINED,
-									VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-									VK_QUEUE_FAMILY_IGNORED,
-									VK_QUEUE_FAMILY_IGNORED,
-									std::ref(staging_image),
-									{ aspect_mask, 0, 1, 0, 1 } },
-								command::image_memory_barrier{
-									0, VK_ACCESS_TRANSFER_READ_BIT,
-									VK_IMAGE_LAYOUT_GENERAL,
-									VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-									VK_QUEUE_FAMILY_IGNORED,
-									VK_QUEUE_FAMILY_IGNORED,
-									std::ref(image),
-									{ aspect_mask, uint32_t(level), 1,
-									uint32_t(layer_index), 1 } }
-							}),
-						command::copy_image{ std::ref(staging_image),
-						VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-						std::ref(image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-						{ VkImageCopy{
-							{ aspect_mask, 0, 0, 1 },
-							{ 0, 0, 0 },
-							{ aspect_mask, uint32_t(level),
-								uint32_t(layer_index), 1 },
-							{ 0, 0, int32_t(z) },
-							{ uint32_t(extent.x), uint32_t(extent.y), 1 }
-					} } });
-					queue::submit(*queue, {}, { std::ref(command_buffer) },
-						{});
-				}
+				const std::size_t layer_index(layer * texture.faces() + face);
+				// The slices of all depths of the level are contiguous.
+				const glm::ivec3 level_extent(glm::ivec3(texture.extent(level)));
+				staging_size = (staging_size + alignment - 1) / alignment
+					* alignment;
+				regions.push_back(VkBufferImageCopy{ staging_size, 0, 0,
+					{ aspect_mask, uint32_t(level), uint32_t(layer_index), 1 },
+					{ 0, 0, 0 },
+					{ uint32_t(level_extent.x), uint32_t(level_extent.y),
+						uint32_t(level_extent.z) } });
+				sources.push_back(texture.data(layer, face, level));
+				staging_size += texture.size(level);
 			}
 		}
 	}
+	buffer::buffer_type staging_buffer(buffer::create(device, 0, staging_size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE, {}));
+	const type::supplier<memory::memory_type> staging_memory(memory::bind(
+		device, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			| VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging_buffer));
+	{
+		const memory::map_type map(memory::map(staging_memory));
+		for (std::size_t i = 0; i < regions.size(); ++i) {
+			const std::size_t level(i % texture.levels());
+			std::memcpy((uint8_t *) map.data + regions[i].bufferOffset,
+				sources[i], texture.size(level));
+		}
+	}
+
+	// The host writes are made visible by the submit. One barrier for all
+	// levels and layers, the copies write disjoint regions.
+	fence::fence_type fence(fence::create(device));
+	{
+		std::unique_lock<std::recursive_mutex> flush_lock(
+			vcc::internal::lock_flush(*queue));
+		command_buffer::command_buffer_type &command_buffer(
+			vcc::internal::acquire_transient(*queue));
+		command_buffer::compile(command_buffer,
+			VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, VK_FALSE, 0, 0,
+			command::transition_layout{ std::ref(image),
+				{ aspect_mask, 0, VK_REMAINING_MIP_LEVELS, 0,
+					VK_REMAINING_ARRAY_LAYERS },
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT },
+			command::copy_buffer_to_image(std::ref(staging_buffer),
+				std::ref(image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				regions));
+		queue::submit(*queue, {}, { std::ref(command_buffer) }, {}, fence);
+	}
+	// The staging buffer is only referenced, it must outlive the copy.
+	fence::wait(*device, { std::ref(fence) }, true,
+		std::chrono::nanoseconds::max());
 	return std::move(image);
 }
 
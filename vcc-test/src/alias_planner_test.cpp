@@ -0,0 +1,200 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <vcc/internal/alias_planner.h>
+#include <vcc/internal/graph_planner.h>
+
+namespace {
+
+using vcc::internal::alias_plan_type;
+using vcc::internal::alias_request_type;
+using vcc::internal::graph_pass_type;
+using vcc::internal::graph_plan_type;
+using vcc::internal::graph_resource_type;
+using vcc::internal::graph_usage_type;
+
+const VkDeviceSize megabyte = 1024 * 1024;
+
+graph_usage_type write(std::size_t resource) {
+	return graph_usage_type{ resource,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+}
+
+graph_usage_type read(std::size_t resource) {
+	return graph_usage_type{ resource, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+}
+
+graph_resource_type transient() {
+	return graph_resource_type{ true, VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_UNDEFINED, false };
+}
+
+// A deferred renderer: G-buffer, lighting, SSAO, a bloom chain and the
+// composition into the swapchain image.
+struct deferred_type {
+	enum {
+		albedo, normal, depth, ssao, hdr, bloom0, bloom1, bloom2, swapchain,
+		count
+	};
+
+	deferred_type() : resources(count, transient()) {
+		resources[swapchain] = graph_resource_type{ true,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, true };
+		passes = {
+			graph_pass_type{ { write(albedo), write(normal), write(depth) } },
+			graph_pass_type{ { read(normal), read(depth), write(ssao) } },
+			graph_pass_type{ { read(albedo), read(normal), read(depth),
+				read(ssao), write(hdr) } },
+			graph_pass_type{ { read(hdr), write(bloom0) } },
+			graph_pass_type{ { read(bloom0), write(bloom1) } },
+			graph_pass_type{ { read(bloom1), write(bloom2) } },
+			graph_pass_type{ { read(hdr), read(bloom2), write(swapchain) } } };
+		sizes = { 8 * megabyte, 8 * megabyte, 8 * megabyte, 2 * megabyte,
+			16 * megabyte, 4 * megabyte, megabyte, megabyte / 4 };
+	}
+
+	std::vector<alias_request_type> requests(const graph_plan_type &plan)
+			const {
+		std::vector<alias_request_type> requests;
+		for (std::size_t i = 0; i < sizes.size(); ++i) {
+			requests.push_back(alias_request_type{ sizes[i], 65536, 0,
+				plan.lifetimes[i].used, plan.lifetimes[i].first,
+				plan.lifetimes[i].last });
+		}
+		return requests;
+	}
+
+	std::vector<graph_resource_type> resources;
+	std::vector<graph_pass_type> passes;
+	std::vector<VkDeviceSize> sizes;
+};
+
+void expect_valid(const std::vector<alias_request_type> &requests,
+		const alias_plan_type &plan) {
+	for (std::size_t i = 0; i < requests.size(); ++i) {
+		const alias_request_type &a(requests[i]);
+		EXPECT_EQ(0u, plan.offsets[i] % a.alignment);
+		EXPECT_LE(plan.offsets[i] + a.size, plan.heap_sizes[a.heap]);
+		for (std::size_t j = i + 1; j < requests.size(); ++j) {
+			const alias_request_type &b(requests[j]);
+			const bool lifetimes(a.used && b.used && a.first <= b.last
+				&& b.first <= a.last);
+			const bool memory(plan.offsets[i] < plan.offsets[j] + b.size
+				&& plan.offsets[j] < plan.offsets[i] + a.size);
+			EXPECT_FALSE(a.heap == b.heap && lifetimes && memory)
+				<< i << " and " << j << " are used at once in the same memory";
+		}
+	}
+}
+
+}  // anonymous namespace
+
+TEST(AliasPlannerTest, Lifetimes) {
+	const deferred_type deferred;
+	const graph_plan_type plan(vcc::internal::plan_graph(deferred.resources,
+		deferred.passes));
+	ASSERT_EQ(7u, plan.steps.size());
+	EXPECT_EQ(0u, plan.lifetimes[deferred_type::albedo].first);
+	EXPECT_EQ(2u, plan.lifetimes[deferred_type::albedo].last);
+	EXPECT_EQ(1u, plan.lifetimes[deferred_type::ssao].first);
+	EXPECT_EQ(2u, plan.lifetimes[deferred_type::ssao].last);
+	EXPECT_EQ(2u, plan.lifetimes[deferred_type::hdr].first);
+	EXPECT_EQ(6u, plan.lifetimes[deferred_type::hdr].last);
+	EXPECT_EQ(3u, plan.lifetimes[deferred_type::bloom0].first);
+	EXPECT_EQ(4u, plan.lifetimes[deferred_type::bloom0].last);
+}
+
+TEST(AliasPlannerTest, PeakMemory) {
+	const deferred_type deferred;
+	const graph_plan_type plan(vcc::internal::plan_graph(deferred.resources,
+		deferred.passes));
+	const std::vector<alias_request_type> requests(deferred.requests(plan));
+	const alias_plan_type aliasing(vcc::internal::plan_aliasing(requests));
+	expect_valid(requests, aliasing);
+
+	VkDeviceSize dedicated(0);
+	for (VkDeviceSize size : deferred.sizes) {
+		dedicated += size;
+	}
+	ASSERT_EQ(1u, aliasing.heap_sizes.size());
+	// The G-buffer, SSAO and HDR targets live at once in the lighting pass,
+	// the bloom chain reuses the memory of the G-buffer.
+	EXPECT_EQ(42 * megabyte, aliasing.heap_sizes[0]);
+	EXPECT_LT(aliasing.heap_sizes[0], dedicated);
+	EXPECT_FALSE(aliasing.aliased[deferred_type::bloom0].empty());
+	EXPECT_TRUE(aliasing.aliased[deferred_type::hdr].empty());
+}
+
+// The first use of an aliasing resource waits for the last use of the
+// resource it replaces, and discards its contents.
+TEST(AliasPlannerTest, AliasingBarrier) {
+	deferred_type deferred;
+	const graph_plan_type lifetimes(vcc::internal::plan_graph(
+		deferred.resources, deferred.passes));
+	const alias_plan_type aliasing(vcc::internal::plan_aliasing(
+		deferred.requests(lifetimes)));
+	for (std::size_t i = 0; i < aliasing.aliased.size(); ++i) {
+		deferred.resources[i].aliased = aliasing.aliased[i];
+	}
+	const graph_plan_type plan(vcc::internal::plan_graph(deferred.resources,
+		deferred.passes));
+	const vcc::internal::graph_barrier_type &barrier(plan.steps[3].barrier);
+	// Read by the lighting pass.
+	EXPECT_TRUE(barrier.src_stages & VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+	bool found(false);
+	for (const vcc::internal::graph_memory_barrier_type &memory_barrier
+			: barrier.barriers) {
+		if (memory_barrier.resource == deferred_type::bloom0) {
+			found = true;
+			EXPECT_EQ(VK_IMAGE_LAYOUT_UNDEFINED, memory_barrier.old_layout);
+			EXPECT_EQ(0u, memory_barrier.src_access);
+		}
+	}
+	EXPECT_TRUE(found);
+}
+
+TEST(AliasPlannerTest, OverlappingLifetimes) {
+	const std::vector<alias_request_type> requests{
+		alias_request_type{ 100, 16, 0, true, 0, 1 },
+		alias_request_type{ 100, 16, 0, true, 1, 2 },
+		alias_request_type{ 100, 16, 0, true, 2, 3 } };
+	const alias_plan_type plan(vcc::internal::plan_aliasing(requests));
+	expect_valid(requests, plan);
+	EXPECT_EQ(0u, plan.offsets[0]);
+	EXPECT_EQ(112u, plan.offsets[1]);
+	EXPECT_EQ(0u, plan.offsets[2]);
+	EXPECT_EQ(212u, plan.heap_sizes[0]);
+	EXPECT_EQ(std::vector<std::size_t>({ 0 }), plan.aliased[2]);
+}
+
+TEST(AliasPlannerTest, HeapsAndUnused) {
+	const std::vector<alias_request_type> requests{
+		alias_request_type{ 100, 1, 0, true, 0, 0 },
+		alias_request_type{ 100, 1, 2, true, 1, 1 },
+		alias_request_type{ 100, 1, 0, false, 0, 0 } };
+	const alias_plan_type plan(vcc::internal::plan_aliasing(requests));
+	ASSERT_EQ(3u, plan.heap_sizes.size());
+	EXPECT_EQ(100u, plan.heap_sizes[0]);
+	EXPECT_EQ(0u, plan.heap_sizes[1]);
+	EXPECT_EQ(100u, plan.heap_sizes[2]);
+	EXPECT_EQ(0u, plan.offsets[2]);
+	for (const std::vector<std::size_t> &aliased : plan.aliased) {
+		EXPECT_TRUE(aliased.empty());
+	}
+}
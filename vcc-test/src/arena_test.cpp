@@ -0,0 +1,115 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <array>
+#include <gtest/gtest.h>
+#include <vcc/internal/hook.h>
+
+namespace {
+
+// Appends its id to a log when destroyed.
+struct logged_type {
+	logged_type(std::vector<int> &log, int id) : log(log), id(id) {}
+	~logged_type() {
+		log.push_back(id);
+	}
+	std::vector<int> &log;
+	int id;
+};
+
+}  // anonymous namespace
+
+TEST(ArenaTest, DestroysInReverseOrder) {
+	std::vector<int> log;
+	vcc::internal::arena_type arena;
+	for (int i = 0; i < 3; ++i) {
+		arena.create<logged_type>(log, i);
+	}
+	ASSERT_TRUE(log.empty());
+	arena.clear();
+	ASSERT_EQ(std::vector<int>({ 2, 1, 0 }), log);
+}
+
+TEST(ArenaTest, ChunksReusedAfterClear) {
+	vcc::internal::arena_type arena(1024);
+	for (int i = 0; i < 10000; ++i) {
+		ASSERT_EQ(i, *arena.create<int>(i));
+	}
+	const std::size_t chunks(arena.chunk_count());
+	ASSERT_LT(chunks, 10000u / 16);
+	arena.clear();
+	for (int i = 0; i < 10000; ++i) {
+		arena.create<int>(i);
+	}
+	ASSERT_EQ(chunks, arena.chunk_count());
+}
+
+TEST(ArenaTest, LargerThanChunk) {
+	vcc::internal::arena_type arena(16);
+	std::array<char, 100> *const large(
+		arena.create<std::array<char, 100>>());
+	large->fill(1);
+	ASSERT_EQ(1, *arena.create<int>(1));
+}
+
+TEST(ArenaTest, MoveTransfersOwnership) {
+	std::vector<int> log;
+	vcc::internal::arena_type arena;
+	arena.create<logged_type>(log, 0);
+	vcc::internal::arena_type moved(std::move(arena));
+	arena.clear();
+	ASSERT_TRUE(log.empty());
+	moved = vcc::internal::arena_type();
+	ASSERT_EQ(std::vector<int>({ 0 }), log);
+}
+
+TEST(ArenaTest, ReferenceContainer) {
+	const std::shared_ptr<int> value(std::make_shared<int>(0));
+	vcc::internal::reference_container_type references;
+	for (int i = 0; i < 100; ++i) {
+		references.add(value, value);
+	}
+	ASSERT_EQ(201, value.use_count());
+	references.clear();
+	ASSERT_EQ(1, value.use_count());
+	references.add(value);
+	{
+		vcc::internal::reference_container_type replaced;
+		replaced = std::move(references);
+		ASSERT_EQ(2, value.use_count());
+	}
+	ASSERT_EQ(1, value.use_count());
+}
+
+TEST(ArenaTest, HookContainer) {
+	std::vector<int> calls;
+	vcc::internal::hook_container_type<int> hooks;
+	const std::shared_ptr<int> captured(std::make_shared<int>(2));
+	hooks.add([&calls](int value) { calls.push_back(value); });
+	hooks.add([&calls, captured](int value) {
+		calls.push_back(value * *captured);
+	});
+	hooks(3);
+	ASSERT_EQ(std::vector<int>({ 3, 6 }), calls);
+
+	vcc::internal::hook_container_type<int> moved(std::move(hooks));
+	hooks(1);
+	moved(1);
+	ASSERT_EQ(std::vector<int>({ 3, 6, 1, 2 }), calls);
+	moved.clear();
+	ASSERT_EQ(1, captured.use_count());
+	moved(1);
+	ASSERT_EQ(4u, calls.size());
+}
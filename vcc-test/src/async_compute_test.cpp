@@ -0,0 +1,233 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <map>
+#include <vcc/internal/ownership_planner.h>
+#include <vcc/internal/queue_families.h>
+
+namespace {
+
+using vcc::internal::no_queue_family;
+using vcc::internal::ownership_planner_type;
+using vcc::internal::queue_families_type;
+using vcc::internal::select_queue_families;
+
+VkQueueFamilyProperties family(VkQueueFlags flags, uint32_t count = 1) {
+	VkQueueFamilyProperties properties = {};
+	properties.queueFlags = flags;
+	properties.queueCount = count;
+	return properties;
+}
+
+const VkQueueFlags graphics(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT
+	| VK_QUEUE_TRANSFER_BIT);
+const VkQueueFlags compute(VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT);
+
+/*
+ * Queue family ownership of exclusive resources as the validation layers
+ * see it: a release on the owning family must be followed by the matching
+ * acquire on the other before the resource is used there. Executes the
+ * transfers planned by the ownership_planner_type as async_compute does.
+ */
+struct mock_device_type {
+	typedef vcc::internal::ownership_transfer_type<int> transfer_type;
+
+	struct resource_type {
+		uint32_t owner, released_to;
+	};
+
+	mock_device_type(uint32_t graphics_family, uint32_t compute_family)
+		: planner(graphics_family, compute_family), barriers(0),
+		  waiting_barriers(0) {
+		chained[graphics_family] = chained[compute_family] = true;
+	}
+
+	void release(int key, uint32_t src, uint32_t dst) {
+		resource_type &resource(resource_of(key));
+		EXPECT_EQ(src, resource.owner);
+		resource.released_to = dst;
+		++barriers;
+	}
+
+	void acquire(int key, uint32_t dst) {
+		resource_type &resource(resource_of(key));
+		EXPECT_EQ(dst, resource.released_to);
+		resource.owner = dst;
+		resource.released_to = no_queue_family;
+		++barriers;
+	}
+
+	// Work submitted to family after the last transfer to it.
+	void use(int key, uint32_t family) {
+		EXPECT_EQ(family, resource_of(key).owner);
+		EXPECT_TRUE(chained[family]);
+	}
+
+	// The release batch, the semaphore, then the batch waiting for it.
+	void execute(const transfer_type &transfer) {
+		const uint32_t src(transfer.to_compute
+			? planner.get_graphics_family() : planner.get_compute_family());
+		const uint32_t dst(transfer.to_compute
+			? planner.get_compute_family() : planner.get_graphics_family());
+		EXPECT_EQ(!transfer.keys.empty(), transfer.release.record);
+		if (transfer.release.record) {
+			EXPECT_TRUE(transfer.release.release);
+			EXPECT_EQ(src, transfer.release.src_family);
+			EXPECT_EQ(dst, transfer.release.dst_family);
+			for (int key : transfer.keys) {
+				release(key, transfer.release.src_family,
+					transfer.release.dst_family);
+			}
+		}
+		// The semaphore wait only orders the waiting batch, the batches
+		// after it are ordered by a barrier from the wait stages making
+		// the writes visible.
+		chained[dst] = false;
+		const vcc::internal::ownership_barrier_type &barrier(
+			transfer.acquire);
+		EXPECT_TRUE(barrier.record);
+		EXPECT_FALSE(barrier.release);
+		EXPECT_EQ(src, barrier.src_family);
+		EXPECT_EQ(dst, barrier.dst_family);
+		++waiting_barriers;
+		chained[dst] = (barrier.src_stages
+				& vcc::internal::ownership_wait_stages)
+					== vcc::internal::ownership_wait_stages
+			&& barrier.dst_stages == VK_PIPELINE_STAGE_ALL_COMMANDS_BIT
+			&& (barrier.memory_src_access & VK_ACCESS_MEMORY_WRITE_BIT)
+			&& (barrier.memory_dst_access & VK_ACCESS_MEMORY_READ_BIT);
+		for (int key : transfer.keys) {
+			acquire(key, barrier.dst_family);
+		}
+	}
+
+	void dispatch(const std::vector<int> &keys) {
+		execute(planner.dispatch(keys));
+		planner.submitted();
+		for (int key : keys) {
+			use(key, planner.get_compute_family());
+		}
+	}
+
+	bool join() {
+		transfer_type transfer;
+		if (!planner.join(transfer)) {
+			return false;
+		}
+		EXPECT_FALSE(transfer.to_compute);
+		execute(transfer);
+		return true;
+	}
+
+	resource_type &resource_of(int key) {
+		return resources.insert(std::make_pair(key, resource_type{
+			planner.get_graphics_family(), no_queue_family })).first->second;
+	}
+
+	ownership_planner_type<int> planner;
+	std::map<int, resource_type> resources;
+	// Whether the work submitted to a family is ordered after the last
+	// semaphore it waited for.
+	std::map<uint32_t, bool> chained;
+	std::size_t barriers, waiting_barriers;
+};
+
+}  // anonymous namespace
+
+// A desktop GPU with a dedicated compute and a transfer only family.
+TEST(QueueFamiliesTest, Dedicated) {
+	const queue_families_type families(select_queue_families({
+		family(graphics, 16), family(VK_QUEUE_TRANSFER_BIT, 2),
+		family(compute, 8) }));
+	EXPECT_EQ(0u, families.graphics);
+	EXPECT_EQ(2u, families.compute);
+	EXPECT_EQ(1u, families.transfer);
+	EXPECT_EQ(std::vector<uint32_t>({ 0, 2, 1 }),
+		vcc::internal::distinct_families(families));
+}
+
+// Without a transfer only family, transfers go to the compute family.
+TEST(QueueFamiliesTest, TransferOnCompute) {
+	const queue_families_type families(select_queue_families({
+		family(graphics), family(compute) }));
+	EXPECT_EQ(1u, families.compute);
+	EXPECT_EQ(1u, families.transfer);
+}
+
+// A single family does everything.
+TEST(QueueFamiliesTest, Single) {
+	const queue_families_type families(select_queue_families({
+		family(graphics) }));
+	EXPECT_EQ(0u, families.graphics);
+	EXPECT_EQ(0u, families.compute);
+	EXPECT_EQ(0u, families.transfer);
+	EXPECT_EQ(std::vector<uint32_t>({ 0 }),
+		vcc::internal::distinct_families(families));
+}
+
+// Graphics families need not report VK_QUEUE_TRANSFER_BIT, families without
+// queues are skipped, and a compute family found first is not graphics.
+TEST(QueueFamiliesTest, ImplicitTransferAndEmptyFamilies) {
+	const queue_families_type families(select_queue_families({
+		family(VK_QUEUE_COMPUTE_BIT, 0), family(compute),
+		family(VK_QUEUE_TRANSFER_BIT, 0),
+		family(VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT) }));
+	EXPECT_EQ(3u, families.graphics);
+	EXPECT_EQ(1u, families.compute);
+	EXPECT_EQ(1u, families.transfer);
+}
+
+TEST(QueueFamiliesTest, NoGraphics) {
+	const queue_families_type families(select_queue_families({
+		family(VK_QUEUE_TRANSFER_BIT), family(compute) }));
+	EXPECT_EQ(no_queue_family, families.graphics);
+	EXPECT_EQ(1u, families.compute);
+	EXPECT_EQ(0u, families.transfer);
+}
+
+// Resources go to the compute family once however many dispatches use
+// them, and all come back on join.
+TEST(OwnershipPlannerTest, Transfers) {
+	mock_device_type device(0, 2);
+	EXPECT_TRUE(device.planner.transfers());
+	EXPECT_FALSE(device.join());
+	for (int frame = 0; frame < 3; ++frame) {
+		device.dispatch({ 1, 2 });
+		device.dispatch({ 2, 3, 3 });
+		EXPECT_TRUE(device.join());
+		for (int key = 1; key <= 3; ++key) {
+			device.use(key, 0);
+		}
+		EXPECT_FALSE(device.join());
+	}
+	// A release and an acquire each way per resource and frame.
+	EXPECT_EQ(3u * 3u * 4u, device.barriers);
+	// Two dispatches and a join per frame.
+	EXPECT_EQ(3u * 3u, device.waiting_barriers);
+}
+
+// Queues of the same family transfer no ownership, the batches waiting for
+// the semaphores still record a barrier chaining the work after them.
+TEST(OwnershipPlannerTest, SameFamily) {
+	mock_device_type device(0, 0);
+	EXPECT_FALSE(device.planner.transfers());
+	device.dispatch({ 1, 2 });
+	EXPECT_TRUE(device.join());
+	device.use(1, 0);
+	EXPECT_EQ(0u, device.barriers);
+	EXPECT_EQ(2u, device.waiting_barriers);
+	EXPECT_FALSE(device.join());
+}
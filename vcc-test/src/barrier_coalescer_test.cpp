@@ -0,0 +1,267 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <functional>
+#include <string>
+#include <vcc/internal/barrier_coalescer.h>
+
+namespace {
+
+using vcc::internal::barrier_batch_type;
+using vcc::internal::barrier_coalescer_type;
+
+VkImage image_handle(std::size_t i) {
+	return VkImage(i + 1);
+}
+
+VkBuffer buffer_handle(std::size_t i) {
+	return VkBuffer(i + 1);
+}
+
+VkImageMemoryBarrier image_barrier(VkImage image, VkAccessFlags src_access,
+		VkAccessFlags dst_access, VkImageLayout old_layout,
+		VkImageLayout new_layout) {
+	return VkImageMemoryBarrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, NULL,
+		src_access, dst_access, old_layout, new_layout, VK_QUEUE_FAMILY_IGNORED,
+		VK_QUEUE_FAMILY_IGNORED, image,
+		{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 } };
+}
+
+// Records the command stream as it would reach the command buffer, one
+// entry per vkCmdPipelineBarrier and per other command.
+struct stream_type {
+	void barrier(VkPipelineStageFlags src_stages,
+			VkPipelineStageFlags dst_stages,
+			const std::vector<VkMemoryBarrier> &memory_barriers,
+			const std::vector<VkBufferMemoryBarrier> &buffer_barriers,
+			const std::vector<VkImageMemoryBarrier> &image_barriers) {
+		barrier_batch_type &barrier(coalescer.next());
+		barrier.src_stages = src_stages;
+		barrier.dst_stages = dst_stages;
+		barrier.memory_barriers = memory_barriers;
+		barrier.buffer_barriers = buffer_barriers;
+		barrier.image_barriers = image_barriers;
+		coalescer.add(recorder());
+	}
+
+	void image_transition(VkPipelineStageFlags src_stages,
+			VkPipelineStageFlags dst_stages,
+			const VkImageMemoryBarrier &image_barrier) {
+		barrier(src_stages, dst_stages, {}, {}, { image_barrier });
+	}
+
+	void other() {
+		coalescer.flush(recorder());
+		commands.push_back("other");
+	}
+
+	void end() {
+		coalescer.flush(recorder());
+	}
+
+	std::function<void(const barrier_batch_type &)> recorder() {
+		return [this](const barrier_batch_type &barrier) {
+			recorded.push_back(barrier);
+			commands.push_back("barrier");
+		};
+	}
+
+	barrier_coalescer_type coalescer;
+	std::vector<barrier_batch_type> recorded;
+	std::vector<std::string> commands;
+};
+
+}  // anonymous namespace
+
+// The swapchain images transitioned one after the other by a resize.
+TEST(BarrierCoalescerTest, MergesImageTransitions) {
+	stream_type stream;
+	for (std::size_t i = 0; i < 3; ++i) {
+		stream.image_transition(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, image_barrier(image_handle(i), 0,
+				VK_ACCESS_MEMORY_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_PRESENT_SRC_KHR));
+	}
+	EXPECT_TRUE(stream.commands.empty());
+	stream.end();
+	ASSERT_EQ(std::vector<std::string>({ "barrier" }), stream.commands);
+	ASSERT_EQ(3u, stream.recorded[0].image_barriers.size());
+	for (std::size_t i = 0; i < 3; ++i) {
+		EXPECT_EQ(image_handle(i), stream.recorded[0].image_barriers[i].image);
+	}
+}
+
+// Equal source stages are enough, the destination stages are merged.
+TEST(BarrierCoalescerTest, UnionOfStages) {
+	stream_type stream;
+	stream.image_transition(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, image_barrier(image_handle(0),
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+	stream.image_transition(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, image_barrier(image_handle(1),
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL));
+	stream.end();
+	ASSERT_EQ(1u, stream.recorded.size());
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_TRANSFER_BIT),
+		stream.recorded[0].src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+		| VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT), stream.recorded[0].dst_stages);
+}
+
+TEST(BarrierCoalescerTest, DifferentStagesNotMerged) {
+	stream_type stream;
+	stream.image_transition(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, image_barrier(image_handle(0),
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+	stream.image_transition(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, image_barrier(image_handle(1),
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+	stream.end();
+	EXPECT_EQ(2u, stream.recorded.size());
+}
+
+// Two transitions of the same image must stay in order.
+TEST(BarrierCoalescerTest, SameImageNotMerged) {
+	stream_type stream;
+	stream.image_transition(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, image_barrier(image_handle(0),
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+	stream.image_transition(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, image_barrier(image_handle(0),
+			VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+	stream.end();
+	ASSERT_EQ(2u, stream.recorded.size());
+	EXPECT_EQ(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		stream.recorded[0].image_barriers[0].oldLayout);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		stream.recorded[1].image_barriers[0].oldLayout);
+}
+
+TEST(BarrierCoalescerTest, SameBufferNotMerged) {
+	const VkBufferMemoryBarrier buffer_barrier{
+		VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, NULL,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+		VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, buffer_handle(0), 0,
+		VK_WHOLE_SIZE };
+	stream_type stream;
+	stream.barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, {}, { buffer_barrier }, {});
+	stream.barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, {}, { buffer_barrier }, {});
+	stream.end();
+	EXPECT_EQ(2u, stream.recorded.size());
+}
+
+// Same layout and no access change: nothing to record at all.
+TEST(BarrierCoalescerTest, DropsNoOps) {
+	stream_type stream;
+	stream.image_transition(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, image_barrier(image_handle(0), 0, 0,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL));
+	stream.barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, {}, {}, {});
+	stream.end();
+	EXPECT_TRUE(stream.commands.empty());
+
+	// The no-op entry is dropped, the others kept.
+	stream.barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, {}, {}, {
+			image_barrier(image_handle(0), 0, 0, VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_LAYOUT_GENERAL),
+			image_barrier(image_handle(1), VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) });
+	stream.end();
+	ASSERT_EQ(1u, stream.recorded.size());
+	ASSERT_EQ(1u, stream.recorded[0].image_barriers.size());
+	EXPECT_EQ(image_handle(1), stream.recorded[0].image_barriers[0].image);
+}
+
+// An execution dependency alone still orders the stages.
+TEST(BarrierCoalescerTest, KeepsExecutionDependencies) {
+	stream_type stream;
+	stream.barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, {}, {}, {});
+	stream.end();
+	EXPECT_EQ(1u, stream.recorded.size());
+}
+
+// Global memory barriers where the second waits on the first form a chain
+// that one barrier can not express.
+TEST(BarrierCoalescerTest, ChainedMemoryBarriersNotMerged) {
+	const VkMemoryBarrier transfer_to_compute{
+		VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT };
+	const VkMemoryBarrier compute_to_fragment{
+		VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT };
+	stream_type stream;
+	stream.barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { transfer_to_compute }, {}, {});
+	stream.barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, { compute_to_fragment }, {}, {});
+	stream.end();
+	EXPECT_EQ(2u, stream.recorded.size());
+}
+
+// Any other command records the pending barrier before itself.
+TEST(BarrierCoalescerTest, FlushedByOtherCommands) {
+	stream_type stream;
+	const VkImageMemoryBarrier barrier(image_barrier(image_handle(0),
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+	stream.image_transition(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, barrier);
+	stream.other();
+	stream.image_transition(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, image_barrier(image_handle(1),
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+	stream.other();
+	stream.end();
+	EXPECT_EQ(std::vector<std::string>({ "barrier", "other", "barrier",
+		"other" }), stream.commands);
+}
+
+// A barrier recorded last is held back until the recording ends, every
+// end of a recording must flush it.
+TEST(BarrierCoalescerTest, LastBarrierRecordedAtEnd) {
+	stream_type stream;
+	stream.other();
+	stream.barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, {}, { VkBufferMemoryBarrier{
+			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, NULL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			buffer_handle(0), 0, VK_WHOLE_SIZE } }, {});
+	EXPECT_EQ(std::vector<std::string>({ "other" }), stream.commands);
+	stream.end();
+	EXPECT_EQ(std::vector<std::string>({ "other", "barrier" }),
+		stream.commands);
+}
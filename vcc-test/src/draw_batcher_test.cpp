@@ -0,0 +1,223 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <string>
+#include <vcc/internal/draw_batcher.h>
+
+namespace {
+
+// A command as executed by the mock device, draws are identified by their
+// firstIndex.
+typedef std::vector<std::string> executed_type;
+
+std::string draw_name(const VkDrawIndexedIndirectCommand &draw) {
+	return "draw " + std::to_string(draw.firstIndex);
+}
+
+// Records like command::internal::cmd does, and executes the recorded
+// commands like a device would, expanding indirect draws from the buffer
+// written by the batcher.
+struct mock_device_type {
+	void draw_indexed(uint32_t first_index, uint32_t first_instance = 0) {
+		const VkDrawIndexedIndirectCommand draw{ 3, 1, first_index, 0,
+			first_instance };
+		if (batcher.batching()) {
+			batcher.add(draw);
+		} else {
+			record(draw_name(draw));
+		}
+	}
+
+	void other(const std::string &name) {
+		flush();
+		record(name);
+	}
+
+	void flush() {
+		if (!batcher.empty()) {
+			batcher.flush([this](const VkDrawIndexedIndirectCommand &draw) {
+				record(draw_name(draw));
+			}, [this](std::size_t first, std::size_t count) {
+				indirect.push_back(std::make_pair(first, count));
+				recorded.push_back("indirect");
+			});
+		}
+	}
+
+	void record(const std::string &name) {
+		recorded.push_back(name);
+	}
+
+	void begin(std::size_t capacity, bool indirect, std::size_t max_run,
+			bool first_instance = true) {
+		batcher.begin(&buffer, capacity, indirect, max_run, first_instance);
+	}
+
+	// Writes the commands to the indirect buffer like draw_batch::batch.
+	void end() {
+		flush();
+		const std::vector<VkDrawIndexedIndirectCommand> &written(
+			batcher.written());
+		buffer.resize(std::max(buffer.size(),
+			batcher.base() + written.size()));
+		std::copy(written.begin(), written.end(),
+			buffer.begin() + batcher.base());
+		batcher.end();
+	}
+
+	executed_type execute() const {
+		executed_type executed;
+		std::size_t next_indirect(0);
+		for (const std::string &command : recorded) {
+			if (command != "indirect") {
+				executed.push_back(command);
+				continue;
+			}
+			const std::pair<std::size_t, std::size_t> &run(
+				indirect[next_indirect++]);
+			for (std::size_t i = 0; i < run.second; ++i) {
+				executed.push_back(draw_name(buffer[run.first + i]));
+			}
+		}
+		return executed;
+	}
+
+	vcc::internal::draw_batcher_type batcher;
+	std::vector<VkDrawIndexedIndirectCommand> buffer;
+	executed_type recorded;
+	std::vector<std::pair<std::size_t, std::size_t>> indirect;
+};
+
+// Records the same stream with and without batching.
+executed_type record_stream(mock_device_type &device) {
+	device.other("bind");
+	for (uint32_t i = 0; i < 4; ++i) {
+		device.draw_indexed(i);
+	}
+	device.other("push_constants");
+	device.draw_indexed(4);
+	device.other("push_constants");
+	for (uint32_t i = 5; i < 8; ++i) {
+		device.draw_indexed(i);
+	}
+	device.flush();
+	return executed_type{ "bind", "draw 0", "draw 1", "draw 2", "draw 3",
+		"push_constants", "draw 4", "push_constants", "draw 5", "draw 6",
+		"draw 7" };
+}
+
+}  // anonymous namespace
+
+TEST(DrawBatcherTest, RunsMerged) {
+	mock_device_type device;
+	device.begin(64, true, 64);
+	const executed_type expected(record_stream(device));
+	device.end();
+	ASSERT_EQ(executed_type({ "bind", "indirect", "push_constants", "draw 4",
+		"push_constants", "indirect" }), device.recorded);
+	ASSERT_EQ(expected, device.execute());
+	ASSERT_EQ(7u, device.batcher.written().size());
+}
+
+TEST(DrawBatcherTest, NotBatching) {
+	mock_device_type device;
+	const executed_type expected(record_stream(device));
+	ASSERT_EQ(expected, device.recorded);
+	ASSERT_EQ(expected, device.execute());
+}
+
+TEST(DrawBatcherTest, WithoutMultiDrawIndirect) {
+	mock_device_type device;
+	device.begin(64, false, 1);
+	const executed_type expected(record_stream(device));
+	ASSERT_EQ(expected, device.recorded);
+	ASSERT_TRUE(device.batcher.written().empty());
+}
+
+TEST(DrawBatcherTest, Capacity) {
+	mock_device_type device;
+	device.begin(5, true, 64);
+	const executed_type expected(record_stream(device));
+	device.end();
+	// The second run only partly fits.
+	ASSERT_EQ(executed_type({ "bind", "indirect", "push_constants", "draw 4",
+		"push_constants", "draw 5", "draw 6", "draw 7" }), device.recorded);
+	ASSERT_EQ(expected, device.execute());
+	ASSERT_EQ(4u, device.batcher.written().size());
+}
+
+TEST(DrawBatcherTest, MaxRun) {
+	mock_device_type device;
+	device.begin(64, true, 3);
+	const executed_type expected(record_stream(device));
+	device.end();
+	ASSERT_EQ(executed_type({ "bind", "indirect", "draw 3", "push_constants",
+		"draw 4", "push_constants", "indirect" }), device.recorded);
+	ASSERT_EQ(expected, device.execute());
+}
+
+TEST(DrawBatcherTest, BeginResets) {
+	mock_device_type device;
+	device.begin(64, true, 64);
+	record_stream(device);
+	device.end();
+	device.begin(64, true, 64);
+	ASSERT_TRUE(device.batcher.written().empty());
+	ASSERT_TRUE(device.batcher.empty());
+	// Appends to the commands of the first batch.
+	ASSERT_EQ(7u, device.batcher.base());
+}
+
+// Without drawIndirectFirstInstance, draws with a firstInstance split the
+// runs and are recorded on their own.
+TEST(DrawBatcherTest, FirstInstanceWithoutFeature) {
+	mock_device_type device;
+	device.begin(64, true, 64, false);
+	for (uint32_t i = 0; i < 5; ++i) {
+		device.draw_indexed(i, i == 2 ? 1 : 0);
+	}
+	device.end();
+	ASSERT_EQ(executed_type({ "indirect", "draw 2", "indirect" }),
+		device.recorded);
+	ASSERT_EQ(executed_type({ "draw 0", "draw 1", "draw 2", "draw 3",
+		"draw 4" }), device.execute());
+}
+
+// A second batch into the same buffer within a recording keeps the
+// commands the draws of the first one read.
+TEST(DrawBatcherTest, BatchesAppend) {
+	mock_device_type device;
+	device.begin(64, true, 64);
+	device.draw_indexed(0);
+	device.draw_indexed(1);
+	device.end();
+	device.other("bind");
+	device.begin(64, true, 64);
+	device.draw_indexed(2);
+	device.draw_indexed(3);
+	device.draw_indexed(4);
+	device.end();
+	ASSERT_EQ(executed_type({ "indirect", "bind", "indirect" }),
+		device.recorded);
+	ASSERT_EQ(executed_type({ "draw 0", "draw 1", "bind", "draw 2",
+		"draw 3", "draw 4" }), device.execute());
+	// The capacity is shared by both batches.
+	device.begin(6, true, 64);
+	device.draw_indexed(5);
+	device.draw_indexed(6);
+	device.end();
+	ASSERT_EQ("draw 6", device.recorded.back());
+}
@@ -0,0 +1,101 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define NOMINMAX
+#include <cstring>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vcc/command.h>
+#include <vcc/command_pool.h>
+#include <vcc/device.h>
+#include <vcc/enumerate.h>
+#include <vcc/instance.h>
+#include <vcc/internal/flush_batch.h>
+#include <vcc/memory.h>
+#include <vcc/physical_device.h>
+#include <vcc/queue.h>
+#include <vcc/staging_buffer.h>
+
+// The barrier flushed at the end of the flush command buffer is the last
+// command recorded into it, held back by the barrier coalescer until the
+// recording ends. The copy of the submitted command buffer must see the
+// upload it makes visible.
+TEST(FlushBatchIntegrationTest, BarrierRecordedLast) {
+	vcc::instance::instance_type instance(vcc::instance::create({}, {}));
+	const VkPhysicalDevice physical_device(
+		vcc::physical_device::enumerate(instance).front());
+	vcc::device::device_type device(vcc::device::create(physical_device,
+		{ vcc::device::queue_create_info_type{
+			vcc::physical_device::get_queue_family_properties_with_flag(
+				vcc::physical_device::queue_famility_properties(
+					physical_device),
+				VK_QUEUE_TRANSFER_BIT),
+				{ 0 } }
+		}, {}, {}, {}));
+	vcc::queue::queue_type queue(vcc::queue::get_queue(
+		std::ref(device), VK_QUEUE_TRANSFER_BIT));
+
+	const std::size_t num_elements(256);
+	const VkDeviceSize size(num_elements * sizeof(uint32_t));
+	std::vector<uint32_t> input(num_elements);
+	std::iota(input.begin(), input.end(), 1u);
+
+	vcc::buffer::buffer_type device_buffer(vcc::buffer::create(
+		std::ref(device), 0, size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_SHARING_MODE_EXCLUSIVE, {}));
+	const type::supplier<vcc::memory::memory_type> device_memory(
+		vcc::memory::bind(std::ref(device),
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, device_buffer));
+	vcc::buffer::buffer_type output_buffer(vcc::buffer::create(
+		std::ref(device), 0, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_SHARING_MODE_EXCLUSIVE, {}));
+	const type::supplier<vcc::memory::memory_type> output_memory(
+		vcc::memory::bind(std::ref(device),
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+				| VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, output_buffer));
+
+	vcc::staging_buffer::staging_buffer_type staging_buffer(
+		vcc::staging_buffer::create(std::ref(device), size));
+
+	vcc::command_pool::command_pool_type cmd_pool(vcc::command_pool::create(
+		std::ref(device), 0, vcc::queue::get_family_index(queue)));
+	vcc::command_buffer::command_buffer_type command_buffer(std::move(
+		vcc::command_buffer::allocate(std::ref(device),
+			std::ref(cmd_pool), VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1).front()));
+	vcc::command_buffer::compile(command_buffer, 0, VK_FALSE, 0, 0,
+		vcc::command::copy_buffer(std::ref(device_buffer),
+			std::ref(output_buffer), { VkBufferCopy{ 0, 0, size } }),
+		vcc::command::pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT, 0, {}, {
+				vcc::command::buffer_memory_barrier(
+					VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT,
+					VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+					std::ref(output_buffer))
+			}, {}));
+
+	{
+		std::unique_lock<std::recursive_mutex> flush_lock(
+			vcc::internal::lock_flush(queue));
+		vcc::staging_buffer::upload(queue, staging_buffer, input.data(), size,
+			device_buffer, 0);
+		vcc::queue::submit(queue, {}, { std::ref(command_buffer) }, {});
+	}
+	EXPECT_TRUE(vcc::internal::wait_flush(queue));
+	vcc::queue::wait_idle(queue);
+
+	vcc::memory::map_type map(vcc::memory::map(output_memory));
+	EXPECT_EQ(0, std::memcmp(map.data, input.data(), std::size_t(size)));
+}
@@ -0,0 +1,151 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vcc/internal/frame_pacer.h>
+
+namespace {
+
+using vcc::internal::frame_pacer_type;
+
+/*
+ * A window render loop against a mock swapchain handing out its images in
+ * turn and a mock GPU finishing one frame every gpu_period CPU frames.
+ * Waiting on a slot blocks, letting the GPU catch up with its frame.
+ */
+struct mock_loop_type {
+	mock_loop_type(uint32_t frames, uint32_t images, uint32_t gpu_period)
+		: pacer(frames), images(images), gpu_period(gpu_period),
+		  slot_frames(frames, 0), image_frames(images, 0), frame(0),
+		  completed(0), waits(0), stalls(0), max_in_flight(0) {}
+
+	void wait(uint32_t slot) {
+		++waits;
+		if (completed < slot_frames[slot]) {
+			++stalls;
+			completed = slot_frames[slot];
+		}
+	}
+
+	void run(uint32_t count) {
+		for (uint32_t i = 0; i < count; ++i) {
+			++frame;
+			if (frame % gpu_period == 0) {
+				completed = std::min(completed + 1, frame - 1);
+			}
+			const uint32_t slot(pacer.begin([this](uint32_t slot) {
+				wait(slot);
+			}));
+			const uint32_t image(acquire());
+			pacer.acquired(slot, image, [this](uint32_t slot) { wait(slot); });
+			// The image is not rendered to by an unfinished frame.
+			EXPECT_LE(image_frames[image], completed);
+			image_frames[image] = frame;
+			slot_frames[slot] = frame;
+			pacer.submit(slot);
+			max_in_flight = std::max(max_in_flight, frame - completed);
+		}
+	}
+
+	virtual uint32_t acquire() {
+		return frame % images;
+	}
+
+	frame_pacer_type pacer;
+	const uint32_t images, gpu_period;
+	std::vector<uint32_t> slot_frames, image_frames;
+	uint32_t frame, completed;
+	uint32_t waits, stalls, max_in_flight;
+};
+
+}  // anonymous namespace
+
+// A GPU slower than the CPU: the CPU runs at most frames ahead and only
+// blocks when reusing a slot.
+TEST(FramePacerTest, SlowGpu) {
+	mock_loop_type loop(2, 3, 2);
+	loop.run(100);
+	EXPECT_LE(loop.max_in_flight, 2u);
+	EXPECT_GT(loop.stalls, 0u);
+	// One wait per reused slot, none for the images.
+	EXPECT_EQ(98u, loop.waits);
+}
+
+// A GPU keeping up never blocks the CPU, waits find the fence signaled.
+TEST(FramePacerTest, FastGpu) {
+	mock_loop_type loop(3, 3, 1);
+	loop.run(100);
+	EXPECT_EQ(0u, loop.stalls);
+	EXPECT_LE(loop.max_in_flight, 3u);
+}
+
+TEST(FramePacerTest, SlotsInTurn) {
+	frame_pacer_type pacer(3);
+	std::vector<uint32_t> waited;
+	const auto wait([&waited](uint32_t slot) { waited.push_back(slot); });
+	for (uint32_t i = 0; i < 3; ++i) {
+		EXPECT_EQ(i, pacer.begin(wait));
+	}
+	EXPECT_TRUE(waited.empty());
+	pacer.submit(0);
+	pacer.submit(2);
+	EXPECT_EQ(0u, pacer.begin(wait));
+	EXPECT_EQ(1u, pacer.begin(wait));
+	EXPECT_EQ(2u, pacer.begin(wait));
+	EXPECT_EQ(std::vector<uint32_t>({ 0, 2 }), waited);
+}
+
+// More frames in flight than images: the frame acquiring an image waits for
+// the older frame rendering into it, even though its own slot is free.
+TEST(FramePacerTest, ImageInFlight) {
+	struct few_images_type : mock_loop_type {
+		few_images_type() : mock_loop_type(3, 2, 4) {}
+	} loop;
+	loop.run(50);
+	EXPECT_LE(loop.max_in_flight, 2u);
+	EXPECT_GT(loop.waits, 0u);
+}
+
+// Images acquired out of order, as a mailbox swapchain may.
+TEST(FramePacerTest, OutOfOrderImages) {
+	struct out_of_order_type : mock_loop_type {
+		out_of_order_type() : mock_loop_type(2, 3, 3) {}
+		uint32_t acquire() override {
+			static const uint32_t order[] = { 0, 1, 1, 2, 0, 0, 2, 1 };
+			return order[frame % 8];
+		}
+	} loop;
+	loop.run(80);
+	EXPECT_LE(loop.max_in_flight, 2u);
+}
+
+// Recreating the swapchain waits on all frames once, after which the new
+// images and the slots are free.
+TEST(FramePacerTest, Idle) {
+	frame_pacer_type pacer(2);
+	std::vector<uint32_t> waited;
+	const auto wait([&waited](uint32_t slot) { waited.push_back(slot); });
+	for (uint32_t image = 0; image < 2; ++image) {
+		const uint32_t slot(pacer.begin(wait));
+		pacer.acquired(slot, image, wait);
+		pacer.submit(slot);
+	}
+	pacer.idle(wait);
+	EXPECT_EQ(std::vector<uint32_t>({ 0, 1 }), waited);
+	const uint32_t slot(pacer.begin(wait));
+	pacer.acquired(slot, 1, wait);
+	EXPECT_EQ(2u, waited.size());
+}
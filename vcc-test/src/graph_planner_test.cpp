@@ -0,0 +1,253 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <vcc/internal/graph_planner.h>
+
+namespace {
+
+using vcc::internal::graph_barrier_type;
+using vcc::internal::graph_memory_barrier_type;
+using vcc::internal::graph_pass_type;
+using vcc::internal::graph_plan_type;
+using vcc::internal::graph_resource_type;
+using vcc::internal::graph_usage_type;
+
+const VkPipelineStageFlags fragment_tests =
+	VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+	| VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+graph_resource_type image(VkImageLayout initial_layout,
+		VkImageLayout final_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+		bool output = false) {
+	return graph_resource_type{ true, initial_layout, final_layout, output };
+}
+
+graph_resource_type buffer(bool output = false) {
+	return graph_resource_type{ false, VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_UNDEFINED, output };
+}
+
+graph_usage_type color_attachment(std::size_t resource) {
+	return graph_usage_type{ resource,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+}
+
+graph_usage_type depth_attachment(std::size_t resource) {
+	return graph_usage_type{ resource, fragment_tests,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+}
+
+graph_usage_type sampled(std::size_t resource,
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) {
+	return graph_usage_type{ resource, stages, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+}
+
+graph_usage_type storage_write(std::size_t resource) {
+	return graph_usage_type{ resource, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+}
+
+graph_usage_type vertex_read(std::size_t resource) {
+	return graph_usage_type{ resource, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+}
+
+void expect_barrier(const graph_memory_barrier_type &expected,
+		const graph_memory_barrier_type &barrier) {
+	EXPECT_EQ(expected.resource, barrier.resource);
+	EXPECT_EQ(expected.src_access, barrier.src_access);
+	EXPECT_EQ(expected.dst_access, barrier.dst_access);
+	EXPECT_EQ(expected.old_layout, barrier.old_layout);
+	EXPECT_EQ(expected.new_layout, barrier.new_layout);
+}
+
+std::vector<std::size_t> passes(const graph_plan_type &plan) {
+	std::vector<std::size_t> passes;
+	for (const vcc::internal::graph_step_type &step : plan.steps) {
+		passes.push_back(step.pass);
+	}
+	return passes;
+}
+
+}  // anonymous namespace
+
+// A shadow map rendered, then sampled by the pass rendering the swapchain
+// image which is presented.
+TEST(GraphPlannerTest, ShadowMap) {
+	const std::vector<graph_resource_type> resources{
+		image(VK_IMAGE_LAYOUT_UNDEFINED),
+		image(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, true),
+		image(VK_IMAGE_LAYOUT_UNDEFINED) };
+	const std::vector<graph_pass_type> graph_passes{
+		graph_pass_type{ { depth_attachment(0) } },
+		graph_pass_type{ { sampled(0), color_attachment(1),
+			depth_attachment(2) } } };
+	const graph_plan_type plan(vcc::internal::plan_graph(resources,
+		graph_passes));
+	ASSERT_EQ(std::vector<std::size_t>({ 0, 1 }), passes(plan));
+
+	const graph_barrier_type &shadow(plan.steps[0].barrier);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+		shadow.src_stages);
+	EXPECT_EQ(fragment_tests, shadow.dst_stages);
+	ASSERT_EQ(1u, shadow.barriers.size());
+	expect_barrier(graph_memory_barrier_type{ 0, 0,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL }, shadow.barriers[0]);
+
+	// All three transitions in one batch.
+	const graph_barrier_type &main(plan.steps[1].barrier);
+	EXPECT_EQ(VkPipelineStageFlags(fragment_tests
+		| VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT), main.src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+		| VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | fragment_tests),
+		main.dst_stages);
+	ASSERT_EQ(3u, main.barriers.size());
+	expect_barrier(graph_memory_barrier_type{ 0,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }, main.barriers[0]);
+	expect_barrier(graph_memory_barrier_type{ 1, 0,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL }, main.barriers[1]);
+
+	ASSERT_EQ(1u, plan.final_barrier.barriers.size());
+	EXPECT_EQ(VkPipelineStageFlags(
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT),
+		plan.final_barrier.src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+		plan.final_barrier.dst_stages);
+	expect_barrier(graph_memory_barrier_type{ 1,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR }, plan.final_barrier.barriers[0]);
+}
+
+// Passes whose results are never used by an output are culled, including
+// the passes feeding them.
+TEST(GraphPlannerTest, Culling) {
+	const std::vector<graph_resource_type> resources{
+		image(VK_IMAGE_LAYOUT_UNDEFINED),
+		image(VK_IMAGE_LAYOUT_UNDEFINED),
+		image(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, true) };
+	const std::vector<graph_pass_type> graph_passes{
+		graph_pass_type{ { color_attachment(0) } },
+		graph_pass_type{ { sampled(0), color_attachment(1) } },
+		graph_pass_type{ { color_attachment(2) } },
+		// Writes nothing, always kept.
+		graph_pass_type{ {} } };
+	const graph_plan_type plan(vcc::internal::plan_graph(resources,
+		graph_passes));
+	ASSERT_EQ(std::vector<std::size_t>({ 2, 3 }), passes(plan));
+	EXPECT_TRUE(plan.steps[1].barrier.empty());
+}
+
+// A write overwriting a resource makes earlier writers unnecessary.
+TEST(GraphPlannerTest, OverwriteCullsEarlierWriter) {
+	const std::vector<graph_resource_type> resources{
+		image(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, true) };
+	const std::vector<graph_pass_type> graph_passes{
+		graph_pass_type{ { color_attachment(0) } },
+		graph_pass_type{ { color_attachment(0) } } };
+	ASSERT_EQ(std::vector<std::size_t>({ 1 }),
+		passes(vcc::internal::plan_graph(resources, graph_passes)));
+}
+
+// A buffer written by compute and read as vertices, twice, and then
+// written again.
+TEST(GraphPlannerTest, BufferReadAfterWrite) {
+	const std::vector<graph_resource_type> resources{ buffer(true) };
+	const std::vector<graph_pass_type> graph_passes{
+		graph_pass_type{ { storage_write(0) } },
+		graph_pass_type{ { vertex_read(0) } },
+		graph_pass_type{ { vertex_read(0) } },
+		graph_pass_type{ { storage_write(0) } } };
+	const graph_plan_type plan(vcc::internal::plan_graph(resources,
+		graph_passes));
+	ASSERT_EQ(std::vector<std::size_t>({ 0, 1, 2, 3 }), passes(plan));
+	EXPECT_TRUE(plan.steps[0].barrier.empty());
+
+	const graph_barrier_type &read(plan.steps[1].barrier);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT),
+		read.src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT),
+		read.dst_stages);
+	ASSERT_EQ(1u, read.barriers.size());
+	expect_barrier(graph_memory_barrier_type{ 0, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_UNDEFINED }, read.barriers[0]);
+
+	// Already visible to the vertex input.
+	EXPECT_TRUE(plan.steps[2].barrier.empty());
+
+	// Write after read, only an execution dependency.
+	const graph_barrier_type &write(plan.steps[3].barrier);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT),
+		write.src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT),
+		write.dst_stages);
+	EXPECT_TRUE(write.barriers.empty());
+	EXPECT_TRUE(plan.final_barrier.empty());
+}
+
+// An image sampled in the fragment shader, then in the vertex shader which
+// needs its own barrier but no transition.
+TEST(GraphPlannerTest, ReadByOtherStages) {
+	const std::vector<graph_resource_type> resources{
+		image(VK_IMAGE_LAYOUT_UNDEFINED),
+		image(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, true) };
+	const std::vector<graph_pass_type> graph_passes{
+		graph_pass_type{ { storage_write(0) } },
+		graph_pass_type{ { sampled(0), color_attachment(1) } },
+		graph_pass_type{ { sampled(0, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT),
+			graph_usage_type{ 1, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+				VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+				| VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL } } } };
+	const graph_plan_type plan(vcc::internal::plan_graph(resources,
+		graph_passes));
+	ASSERT_EQ(std::vector<std::size_t>({ 0, 1, 2 }), passes(plan));
+
+	const graph_barrier_type &vertex(plan.steps[2].barrier);
+	ASSERT_EQ(2u, vertex.barriers.size());
+	// Chained to the transition before the fragment shader.
+	expect_barrier(graph_memory_barrier_type{ 0, 0, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }, vertex.barriers[0]);
+	expect_barrier(graph_memory_barrier_type{ 1,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+		| VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL }, vertex.barriers[1]);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+		| VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT), vertex.src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+		| VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT), vertex.dst_stages);
+}
+
+TEST(GraphPlannerTest, TwoLayoutsInOnePass) {
+	const std::vector<graph_resource_type> resources{
+		image(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, true) };
+	const std::vector<graph_pass_type> graph_passes{
+		graph_pass_type{ { sampled(0), color_attachment(0) } } };
+	ASSERT_THROW(vcc::internal::plan_graph(resources, graph_passes),
+		vcc::vcc_exception);
+}
@@ -0,0 +1,208 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <vcc/internal/layout_tracker.h>
+
+namespace {
+
+using vcc::internal::layout_tracker_type;
+using vcc::internal::layout_transition_type;
+using vcc::internal::subresource_state_type;
+
+typedef std::vector<layout_transition_type> transitions_type;
+
+const subresource_state_type transfer_dst{
+	VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	VK_ACCESS_TRANSFER_WRITE_BIT };
+const subresource_state_type transfer_src{
+	VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+	VK_ACCESS_TRANSFER_READ_BIT };
+const subresource_state_type sampled{
+	VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+
+transitions_type transition(layout_tracker_type &tracker,
+		uint32_t base_level, uint32_t level_count, uint32_t base_layer,
+		uint32_t layer_count, const subresource_state_type &target) {
+	transitions_type transitions;
+	tracker.transition(base_level, level_count, base_layer, layer_count,
+		target, [&transitions](const layout_transition_type &transition) {
+		transitions.push_back(transition);
+	});
+	return transitions;
+}
+
+void expect_transition(uint32_t base_level, uint32_t level_count,
+		uint32_t base_layer, uint32_t layer_count, VkImageLayout old_layout,
+		const layout_transition_type &transition) {
+	EXPECT_EQ(base_level, transition.base_level);
+	EXPECT_EQ(level_count, transition.level_count);
+	EXPECT_EQ(base_layer, transition.base_layer);
+	EXPECT_EQ(layer_count, transition.layer_count);
+	EXPECT_EQ(old_layout, transition.old_layout);
+}
+
+}  // anonymous namespace
+
+// A cube map with a full mip chain transitions in one barrier.
+TEST(LayoutTrackerTest, WholeImageMerged) {
+	layout_tracker_type tracker(10, 6, VK_IMAGE_LAYOUT_UNDEFINED);
+	const transitions_type transitions(transition(tracker, 0,
+		VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS, transfer_dst));
+	ASSERT_EQ(1u, transitions.size());
+	expect_transition(0, 10, 0, 6, VK_IMAGE_LAYOUT_UNDEFINED, transitions[0]);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		tracker.get(9, 5).layout);
+}
+
+// Reading the same layout again needs no barrier, unless it was written.
+TEST(LayoutTrackerTest, OnlyNeeded) {
+	layout_tracker_type tracker(4, 2, VK_IMAGE_LAYOUT_UNDEFINED);
+	transition(tracker, 0, 4, 0, 2, sampled);
+	EXPECT_TRUE(transition(tracker, 0, 4, 0, 2, sampled).empty());
+	EXPECT_TRUE(transition(tracker, 1, 2, 1, 1, sampled).empty());
+
+	transition(tracker, 0, 4, 0, 2, transfer_dst);
+	// Write after write in the same layout.
+	const transitions_type transitions(transition(tracker, 0, 4, 0, 2,
+		transfer_dst));
+	ASSERT_EQ(1u, transitions.size());
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_TRANSFER_WRITE_BIT),
+		transitions[0].src_access);
+}
+
+// Mipmap generation: each level is read as the source of the next one,
+// leaving levels in different layouts.
+TEST(LayoutTrackerTest, MipChain) {
+	layout_tracker_type tracker(5, 3, VK_IMAGE_LAYOUT_UNDEFINED);
+	transition(tracker, 0, 5, 0, 3, transfer_dst);
+	for (uint32_t level = 0; level < 4; ++level) {
+		const transitions_type transitions(transition(tracker, level, 1, 0, 3,
+			transfer_src));
+		ASSERT_EQ(1u, transitions.size());
+		expect_transition(level, 1, 0, 3,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, transitions[0]);
+	}
+	// Levels 0-3 from TRANSFER_SRC, level 4 from TRANSFER_DST.
+	const transitions_type transitions(transition(tracker, 0, 5, 0, 3,
+		sampled));
+	ASSERT_EQ(2u, transitions.size());
+	expect_transition(0, 4, 0, 3, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		transitions[0]);
+	expect_transition(4, 1, 0, 3, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		transitions[1]);
+}
+
+// Layers in different states split the rectangles, identical runs on
+// adjacent levels merge again.
+TEST(LayoutTrackerTest, LayerRuns) {
+	layout_tracker_type tracker(3, 6, VK_IMAGE_LAYOUT_UNDEFINED);
+	tracker.set(0, 3, 2, 2, sampled);
+	const transitions_type transitions(transition(tracker, 0, 3, 0, 6,
+		transfer_dst));
+	ASSERT_EQ(3u, transitions.size());
+	expect_transition(0, 3, 0, 2, VK_IMAGE_LAYOUT_UNDEFINED, transitions[0]);
+	expect_transition(0, 3, 2, 2, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		transitions[1]);
+	expect_transition(0, 3, 4, 2, VK_IMAGE_LAYOUT_UNDEFINED, transitions[2]);
+}
+
+// Subresources already in the target layout and only read are skipped
+// without splitting the others more than needed.
+TEST(LayoutTrackerTest, SkipsSubresources) {
+	layout_tracker_type tracker(4, 4, VK_IMAGE_LAYOUT_UNDEFINED);
+	tracker.set(1, 1, 0, 4, sampled);
+	tracker.set(3, 1, 1, 2, sampled);
+	const transitions_type transitions(transition(tracker, 0, 4, 0, 4,
+		sampled));
+	ASSERT_EQ(4u, transitions.size());
+	expect_transition(0, 1, 0, 4, VK_IMAGE_LAYOUT_UNDEFINED, transitions[0]);
+	expect_transition(2, 1, 0, 4, VK_IMAGE_LAYOUT_UNDEFINED, transitions[1]);
+	expect_transition(3, 1, 0, 1, VK_IMAGE_LAYOUT_UNDEFINED, transitions[2]);
+	expect_transition(3, 1, 3, 1, VK_IMAGE_LAYOUT_UNDEFINED, transitions[3]);
+	for (uint32_t level = 0; level < 4; ++level) {
+		for (uint32_t layer = 0; layer < 4; ++layer) {
+			EXPECT_EQ(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+				tracker.get(level, layer).layout);
+		}
+	}
+}
+
+// Reads at other stages need the write made visible to them, and the next
+// write waits for every read.
+TEST(LayoutTrackerTest, ReadersAccumulate) {
+	const subresource_state_type compute{
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+	const subresource_state_type storage{ VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT };
+	layout_tracker_type tracker(1, 1, VK_IMAGE_LAYOUT_UNDEFINED);
+	transition(tracker, 0, 1, 0, 1, storage);
+	transitions_type transitions(transition(tracker, 0, 1, 0, 1, sampled));
+	ASSERT_EQ(1u, transitions.size());
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT),
+		transitions[0].src_stages);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_SHADER_WRITE_BIT),
+		transitions[0].src_access);
+
+	// Chained through the fragment shader that saw the transition.
+	transitions = transition(tracker, 0, 1, 0, 1, compute);
+	ASSERT_EQ(1u, transitions.size());
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT),
+		transitions[0].src_stages);
+	EXPECT_TRUE(transition(tracker, 0, 1, 0, 1, compute).empty());
+	EXPECT_TRUE(transition(tracker, 0, 1, 0, 1, sampled).empty());
+
+	transitions = transition(tracker, 0, 1, 0, 1, storage);
+	ASSERT_EQ(1u, transitions.size());
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+		| VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT), transitions[0].src_stages);
+	EXPECT_EQ(0u, transitions[0].src_access);
+}
+
+// A write in the same layout, as by a render pass, is made visible to
+// each stage reading it.
+TEST(LayoutTrackerTest, WriteVisibleToEachReader) {
+	const subresource_state_type general_read{ VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+	const subresource_state_type compute_read{ VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+	layout_tracker_type tracker(1, 1, VK_IMAGE_LAYOUT_UNDEFINED);
+	tracker.set(0, 1, 0, 1, subresource_state_type{ VK_IMAGE_LAYOUT_GENERAL,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT });
+	for (const subresource_state_type &reader
+			: { general_read, compute_read }) {
+		const transitions_type transitions(transition(tracker, 0, 1, 0, 1,
+			reader));
+		ASSERT_EQ(1u, transitions.size());
+		EXPECT_EQ(
+			VkPipelineStageFlags(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT),
+			transitions[0].src_stages);
+		EXPECT_EQ(VkAccessFlags(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT),
+			transitions[0].src_access);
+	}
+	EXPECT_TRUE(transition(tracker, 0, 1, 0, 1, general_read).empty());
+}
+
+TEST(LayoutTrackerTest, RangeClamped) {
+	layout_tracker_type tracker(2, 2, VK_IMAGE_LAYOUT_UNDEFINED);
+	const transitions_type transitions(transition(tracker, 1,
+		VK_REMAINING_MIP_LEVELS, 1, 10, transfer_src));
+	ASSERT_EQ(1u, transitions.size());
+	expect_transition(1, 1, 1, 1, VK_IMAGE_LAYOUT_UNDEFINED, transitions[0]);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_UNDEFINED, tracker.get(0, 0).layout);
+}
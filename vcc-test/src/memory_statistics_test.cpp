@@ -0,0 +1,116 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <memory>
+#include <vcc/internal/memory_statistics.h>
+
+namespace {
+
+// Stands in for vkAllocateMemory and vkFreeMemory, accounting allocations
+// the way memory_type does.
+struct mock_allocator_type {
+	struct allocation_type {
+		allocation_type(mock_allocator_type &allocator, uint32_t type,
+				uint64_t size)
+			: allocator(allocator), type(type), size(size) {
+			allocator.statistics.allocated(type, size);
+		}
+		~allocation_type() {
+			allocator.statistics.freed(type, size);
+		}
+		mock_allocator_type &allocator;
+		uint32_t type;
+		uint64_t size;
+	};
+
+	// Two heaps, types 0 and 1 in heap 0 and type 2 in heap 1.
+	mock_allocator_type() : statistics({ 1000, 100 }, { 0, 0, 1 }) {}
+
+	std::unique_ptr<allocation_type> allocate(uint32_t type, uint64_t size) {
+		return std::unique_ptr<allocation_type>(
+			new allocation_type(*this, type, size));
+	}
+
+	vcc::internal::memory_statistics_type statistics;
+};
+
+}  // anonymous namespace
+
+TEST(MemoryStatisticsTest, LiveAndPeak) {
+	mock_allocator_type allocator;
+	auto a(allocator.allocate(0, 100));
+	auto b(allocator.allocate(1, 200));
+	auto c(allocator.allocate(2, 50));
+	vcc::internal::memory_snapshot_type snapshot(allocator.statistics.get());
+	ASSERT_EQ(300, snapshot.heaps[0].live_bytes);
+	ASSERT_EQ(2, snapshot.heaps[0].live_allocations);
+	ASSERT_EQ(50, snapshot.heaps[1].live_bytes);
+	ASSERT_EQ(200, snapshot.types[1].live_bytes);
+	b.reset();
+	snapshot = allocator.statistics.get();
+	ASSERT_EQ(100, snapshot.heaps[0].live_bytes);
+	ASSERT_EQ(300, snapshot.heaps[0].peak_bytes);
+	ASSERT_EQ(1, snapshot.heaps[0].live_allocations);
+	ASSERT_EQ(2, snapshot.heaps[0].peak_allocations);
+	ASSERT_EQ(0, snapshot.types[1].live_bytes);
+	ASSERT_EQ(200, snapshot.types[1].peak_bytes);
+	ASSERT_EQ(1, snapshot.types[1].total_allocations);
+}
+
+TEST(MemoryStatisticsTest, SizeHistogram) {
+	mock_allocator_type allocator;
+	auto a(allocator.allocate(0, 1));
+	auto b(allocator.allocate(0, 64));
+	auto c(allocator.allocate(0, 100));
+	auto d(allocator.allocate(0, 127));
+	const vcc::internal::memory_snapshot_type snapshot(
+		allocator.statistics.get());
+	ASSERT_EQ(1, snapshot.size_histogram[0]);
+	ASSERT_EQ(3, snapshot.size_histogram[6]);
+	ASSERT_EQ(0, snapshot.size_histogram[7]);
+}
+
+TEST(MemoryStatisticsTest, BudgetCallback) {
+	mock_allocator_type allocator;
+	std::vector<uint32_t> heaps;
+	allocator.statistics.set_budget(0.5,
+		[&heaps](uint32_t heap, uint64_t live_bytes, uint64_t size) {
+		heaps.push_back(heap);
+	});
+	auto a(allocator.allocate(0, 400));
+	ASSERT_TRUE(heaps.empty());
+	auto b(allocator.allocate(1, 200));
+	ASSERT_EQ(std::vector<uint32_t>{ 0 }, heaps);
+	// Still above the budget, no new notification.
+	auto c(allocator.allocate(0, 10));
+	ASSERT_EQ(1, heaps.size());
+	b.reset();
+	c.reset();
+	auto d(allocator.allocate(1, 200));
+	ASSERT_EQ(2, heaps.size());
+	auto e(allocator.allocate(2, 60));
+	ASSERT_EQ((std::vector<uint32_t>{ 0, 0, 1 }), heaps);
+}
+
+TEST(MemoryStatisticsTest, BudgetDisabled) {
+	mock_allocator_type allocator;
+	int calls(0);
+	allocator.statistics.set_budget(0.5,
+		[&calls](uint32_t, uint64_t, uint64_t) { ++calls; });
+	allocator.statistics.set_budget(0, nullptr);
+	auto a(allocator.allocate(0, 1000));
+	ASSERT_EQ(0, calls);
+}
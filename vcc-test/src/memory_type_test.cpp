@@ -0,0 +1,78 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <vcc/internal/memory_type.h>
+
+namespace {
+
+VkPhysicalDeviceMemoryProperties memory_properties(
+		std::initializer_list<VkMemoryPropertyFlags> types) {
+	VkPhysicalDeviceMemoryProperties properties = {};
+	for (VkMemoryPropertyFlags flags : types) {
+		properties.memoryTypes[properties.memoryTypeCount++] =
+			VkMemoryType{ flags, 0 };
+	}
+	properties.memoryHeapCount = 1;
+	return properties;
+}
+
+const VkMemoryPropertyFlags device_local(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+const VkMemoryPropertyFlags lazily_allocated(
+	VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		| VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+const VkMemoryPropertyFlags host_visible(
+	VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+}  // anonymous namespace
+
+TEST(MemoryTypeTest, PrefersLazilyAllocated) {
+	// Typical of tiled GPUs.
+	const VkPhysicalDeviceMemoryProperties properties(memory_properties(
+		{ device_local, host_visible | device_local, lazily_allocated }));
+	uint32_t index;
+	ASSERT_TRUE(vcc::internal::find_memory_type(properties, ~0u,
+		device_local, lazily_allocated, index));
+	ASSERT_EQ(2, index);
+}
+
+TEST(MemoryTypeTest, FallsBackToRequired) {
+	const VkPhysicalDeviceMemoryProperties properties(memory_properties(
+		{ host_visible, device_local, device_local }));
+	uint32_t index;
+	ASSERT_TRUE(vcc::internal::find_memory_type(properties, ~0u,
+		device_local, lazily_allocated, index));
+	ASSERT_EQ(1, index);
+}
+
+TEST(MemoryTypeTest, RespectsTypeBits) {
+	const VkPhysicalDeviceMemoryProperties properties(memory_properties(
+		{ device_local, lazily_allocated, device_local }));
+	uint32_t index;
+	// The image does not support the lazily allocated type.
+	ASSERT_TRUE(vcc::internal::find_memory_type(properties, 0x4u,
+		device_local, lazily_allocated, index));
+	ASSERT_EQ(2, index);
+	ASSERT_FALSE(vcc::internal::find_memory_type(properties, 0x8u,
+		device_local, device_local, index));
+}
+
+TEST(MemoryTypeTest, NoneRequired) {
+	const VkPhysicalDeviceMemoryProperties properties(memory_properties(
+		{ host_visible, host_visible }));
+	uint32_t index;
+	ASSERT_FALSE(vcc::internal::find_memory_type(properties, ~0u,
+		device_local, lazily_allocated, index));
+}
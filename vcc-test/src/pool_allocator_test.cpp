@@ -0,0 +1,210 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <vcc/internal/pool_allocator.h>
+
+typedef vcc::internal::pool_allocator_type pool_allocator_type;
+typedef pool_allocator_type::id_type id_type;
+
+namespace {
+
+// Device memory of the pool, one string per block. Moves are executed as
+// memcpy as the copy commands would, all reading the memory as it was
+// before any of them since they are not ordered.
+struct mock_device_type {
+	explicit mock_device_type(pool_allocator_type::size_type block_size)
+		: allocator(block_size), block_size(block_size) {}
+
+	id_type allocate(pool_allocator_type::size_type size, char fill) {
+		id_type id;
+		if (!allocator.allocate(size, 16, id)) {
+			const std::size_t block(allocator.add_block());
+			if (memory.size() <= block) {
+				memory.resize(block + 1);
+			}
+			memory[block].assign(std::size_t(block_size), 0);
+			EXPECT_TRUE(allocator.allocate(size, 16, id));
+		}
+		const pool_allocator_type::allocation_type &allocation(
+			allocator.get(id));
+		memory[allocation.block].replace(std::size_t(allocation.offset),
+			std::size_t(size), std::size_t(size), fill);
+		return id;
+	}
+
+	void execute(const std::vector<pool_allocator_type::move_type> &moves) {
+		const std::vector<std::string> before(memory);
+		for (const pool_allocator_type::move_type &move : moves) {
+			std::memcpy(&memory[move.dst.block][std::size_t(move.dst.offset)],
+				&before[move.src.block][std::size_t(move.src.offset)],
+				std::size_t(move.src.size));
+		}
+	}
+
+	std::string read(id_type id) const {
+		const pool_allocator_type::allocation_type &allocation(
+			allocator.get(id));
+		return memory[allocation.block].substr(std::size_t(allocation.offset),
+			std::size_t(allocation.size));
+	}
+
+	pool_allocator_type allocator;
+	pool_allocator_type::size_type block_size;
+	std::vector<std::string> memory;
+};
+
+}  // anonymous namespace
+
+TEST(PoolAllocatorTest, FirstFitAndCoalesce) {
+	pool_allocator_type allocator(256);
+	ASSERT_EQ(0, allocator.add_block());
+	id_type a, b, c, d;
+	ASSERT_TRUE(allocator.allocate(100, 16, a));
+	ASSERT_TRUE(allocator.allocate(50, 16, b));
+	ASSERT_TRUE(allocator.allocate(50, 16, c));
+	ASSERT_EQ(112, allocator.get(b).offset);
+	ASSERT_EQ(176, allocator.get(c).offset);
+	ASSERT_FALSE(allocator.allocate(64, 16, d));
+	allocator.free(a);
+	allocator.free(b);
+	// The freed ranges merge into one.
+	ASSERT_TRUE(allocator.allocate(160, 16, d));
+	ASSERT_EQ(0, allocator.get(d).offset);
+	ASSERT_EQ(210, allocator.used(0));
+}
+
+TEST(PoolAllocatorTest, CompactsSparseBlocks) {
+	mock_device_type device(256);
+	std::vector<id_type> ids;
+	for (char i = 0; i < 12; ++i) {
+		ids.push_back(device.allocate(64, 'a' + i));
+	}
+	ASSERT_EQ(3, device.allocator.block_count());
+	// Leave one allocation in block 0 and three in block 2.
+	for (int i : { 1, 2, 3, 5, 6, 8 }) {
+		device.allocator.free(ids[i]);
+	}
+	const std::vector<pool_allocator_type::move_type> moves(
+		device.allocator.defragment(1024, 1));
+	device.execute(moves);
+	ASSERT_EQ(1, moves.size());
+	ASSERT_EQ(ids[0], moves[0].id);
+	ASSERT_EQ(0, moves[0].src.block);
+	ASSERT_EQ(2, moves[0].dst.block);
+	ASSERT_TRUE(device.allocator.empty(0));
+	ASSERT_FALSE(device.allocator.empty(2));
+	const char expected[] = { 'a', 'e', 'h', 'j', 'k', 'l' };
+	const int remaining[] = { 0, 4, 7, 9, 10, 11 };
+	for (int i = 0; i < 6; ++i) {
+		ASSERT_EQ(std::string(64, expected[i]), device.read(ids[remaining[i]]));
+	}
+}
+
+TEST(PoolAllocatorTest, Budget) {
+	mock_device_type device(256);
+	std::vector<id_type> ids;
+	for (char i = 0; i < 8; ++i) {
+		ids.push_back(device.allocate(64, 'a' + i));
+	}
+	device.allocator.free(ids[2]);
+	device.allocator.free(ids[3]);
+	device.allocator.free(ids[4]);
+	device.allocator.free(ids[5]);
+	device.allocator.free(ids[6]);
+	// Block 0 holds 128 bytes and block 1 holds 64, block 1 is drained into 0.
+	std::vector<pool_allocator_type::move_type> moves(
+		device.allocator.defragment(32, 1));
+	ASSERT_TRUE(moves.empty());
+	moves = device.allocator.defragment(64, 1);
+	device.execute(moves);
+	ASSERT_EQ(1, moves.size());
+	ASSERT_EQ(1, moves[0].src.block);
+	ASSERT_TRUE(device.allocator.empty(1));
+	ASSERT_EQ(std::string(64, 'h'), device.read(ids[7]));
+}
+
+// An allocation moved into a block drained later in the same pass stays
+// there, moving it again would copy from a destination not yet written.
+TEST(PoolAllocatorTest, MovedOnce) {
+	mock_device_type device(256);
+	const id_type a(device.allocate(48, 'a'));
+	const id_type x_filler(device.allocate(208, 'x'));
+	const id_type b(device.allocate(16, 'b'));
+	const id_type c(device.allocate(16, 'c'));
+	const id_type d(device.allocate(32, 'd'));
+	const id_type y_filler(device.allocate(192, 'y'));
+	const id_type e(device.allocate(224, 'e'));
+	const id_type z_filler(device.allocate(32, 'z'));
+	ASSERT_EQ(3, device.allocator.block_count());
+	device.allocator.free(x_filler);
+	device.allocator.free(y_filler);
+	device.allocator.free(z_filler);
+	// a does not fit in block 2 and moves to block 1, which is then
+	// drained into block 2 as far as it fits.
+	const std::vector<pool_allocator_type::move_type> moves(
+		device.allocator.defragment(1024, 1));
+	device.execute(moves);
+	ASSERT_EQ(3, moves.size());
+	for (std::size_t i = 0; i < moves.size(); ++i) {
+		for (std::size_t j = i + 1; j < moves.size(); ++j) {
+			ASSERT_NE(moves[i].id, moves[j].id);
+		}
+	}
+	ASSERT_EQ(1, device.allocator.get(a).block);
+	ASSERT_EQ(2, device.allocator.get(b).block);
+	ASSERT_EQ(2, device.allocator.get(c).block);
+	ASSERT_TRUE(device.allocator.empty(0));
+	ASSERT_EQ(std::string(48, 'a'), device.read(a));
+	ASSERT_EQ(std::string(16, 'b'), device.read(b));
+	ASSERT_EQ(std::string(16, 'c'), device.read(c));
+	ASSERT_EQ(std::string(32, 'd'), device.read(d));
+	ASSERT_EQ(std::string(224, 'e'), device.read(e));
+}
+
+TEST(PoolAllocatorTest, SourceReservedUntilRelease) {
+	mock_device_type device(128);
+	const id_type a(device.allocate(64, 'a'));
+	const id_type b(device.allocate(64, 'b'));
+	const id_type c(device.allocate(32, 'c'));
+	device.allocator.free(b);
+	const std::vector<pool_allocator_type::move_type> moves(
+		device.allocator.defragment(1024, 5));
+	ASSERT_EQ(1, moves.size());
+	ASSERT_EQ(c, moves[0].id);
+	ASSERT_EQ(0, device.allocator.used(1));
+	// The copy has not executed yet, the source must not be reused.
+	id_type d;
+	ASSERT_FALSE(device.allocator.allocate(128, 16, d));
+	device.allocator.release(4);
+	ASSERT_FALSE(device.allocator.allocate(128, 16, d));
+	device.allocator.release(5);
+	ASSERT_TRUE(device.allocator.allocate(128, 16, d));
+	ASSERT_EQ(1, device.allocator.get(d).block);
+	ASSERT_EQ(0, device.allocator.get(a).block);
+}
+
+TEST(PoolAllocatorTest, RemoveBlock) {
+	pool_allocator_type allocator(64);
+	ASSERT_EQ(0, allocator.add_block());
+	ASSERT_EQ(1, allocator.add_block());
+	allocator.remove_block(0);
+	id_type a;
+	ASSERT_TRUE(allocator.allocate(64, 1, a));
+	ASSERT_EQ(1, allocator.get(a).block);
+	ASSERT_EQ(0, allocator.add_block());
+}
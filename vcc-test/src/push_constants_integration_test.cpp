@@ -0,0 +1,144 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define NOMINMAX
+#include <cstring>
+#include <gtest/gtest.h>
+#include <type/types.h>
+#include <vcc/command.h>
+#include <vcc/command_pool.h>
+#include <vcc/descriptor_pool.h>
+#include <vcc/descriptor_set.h>
+#include <vcc/device.h>
+#include <vcc/enumerate.h>
+#include <vcc/instance.h>
+#include <vcc/physical_device.h>
+#include <vcc/pipeline_layout.h>
+#include <vcc/queue.h>
+
+namespace {
+
+struct fixture_type {
+	fixture_type()
+		: instance(vcc::instance::create({}, {})),
+		  physical_device(vcc::physical_device::enumerate(instance).front()),
+		  device(vcc::device::create(physical_device,
+			{ vcc::device::queue_create_info_type{
+				vcc::physical_device::get_queue_family_properties_with_flag(
+					vcc::physical_device::queue_famility_properties(
+						physical_device),
+					VK_QUEUE_GRAPHICS_BIT),
+					{ 0 } }
+			}, {}, {}, {})),
+		  queue(vcc::queue::get_queue(std::ref(device),
+			VK_QUEUE_GRAPHICS_BIT)),
+		  desc_layout(vcc::descriptor_set_layout::create(std::ref(device),
+			{ vcc::descriptor_set_layout::descriptor_set_layout_binding{ 0,
+				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+				VK_SHADER_STAGE_VERTEX_BIT, {} } })),
+		  desc_pool(vcc::descriptor_pool::create(std::ref(device), 0, 1,
+			{ { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 } })),
+		  desc_set(std::move(vcc::descriptor_set::create(std::ref(device),
+			std::ref(desc_pool), { std::ref(desc_layout) }).front())),
+		  cmd_pool(vcc::command_pool::create(std::ref(device), 0,
+			vcc::queue::get_family_index(queue))) {}
+
+	vcc::command_buffer::command_buffer_type allocate() {
+		return std::move(vcc::command_buffer::allocate(std::ref(device),
+			std::ref(cmd_pool), VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1).front());
+	}
+
+	vcc::instance::instance_type instance;
+	VkPhysicalDevice physical_device;
+	vcc::device::device_type device;
+	vcc::queue::queue_type queue;
+	vcc::descriptor_set_layout::descriptor_set_layout_type desc_layout;
+	vcc::descriptor_pool::descriptor_pool_type desc_pool;
+	vcc::descriptor_set::descriptor_set_type desc_set;
+	vcc::command_pool::command_pool_type cmd_pool;
+};
+
+vcc::command::draw_indexed draw(uint32_t first_index) {
+	return vcc::command::draw_indexed{ 3, 1, first_index, 0, 0 };
+}
+
+}  // anonymous namespace
+
+// A bind repeating the descriptor sets and push constants already recorded
+// does not touch the command buffer, the run of batched draws goes on.
+// Changed push constants are pushed after the draws preceding them.
+TEST(PushConstantsIntegrationTest, UnchangedBindKeepsDrawRun) {
+	fixture_type fixture;
+	type::float_type scale(1.f);
+	vcc::pipeline_layout::pipeline_layout_type pipeline_layout(
+		vcc::pipeline_layout::create(std::ref(fixture.device),
+			{ std::ref(fixture.desc_layout) },
+			{ VkPushConstantRange{ VK_SHADER_STAGE_VERTEX_BIT, 0,
+				sizeof(float) } },
+			type::linear_std430, std::ref(scale)));
+	const vcc::command::bind_descriptor_sets bind{
+		VK_PIPELINE_BIND_POINT_GRAPHICS, std::ref(pipeline_layout), 0,
+		{ std::ref(fixture.desc_set) }, {} };
+
+	vcc::command_buffer::command_buffer_type command_buffer(
+		fixture.allocate());
+	vcc::command_buffer::begin_type begin(vcc::command_buffer::begin(
+		std::ref(command_buffer), 0, VK_FALSE, 0, 0));
+	vcc::command::internal::cmd_args args{ command_buffer };
+	vcc::command::internal::cmd(args, bind);
+	const int target(0);
+	args.batcher.begin(&target, 16, true, 16, true);
+	vcc::command::internal::cmd(args, draw(0));
+	vcc::command::internal::cmd(args, bind);
+	EXPECT_FALSE(args.batcher.empty());
+	vcc::command::internal::cmd(args, draw(3));
+	type::write(scale)[0] = 2.f;
+	vcc::command::internal::cmd(args, bind);
+	EXPECT_TRUE(args.batcher.empty());
+	args.batcher.end();
+}
+
+// The content pushed keeps the constants flushed earlier, only the changed
+// ones are serialized again.
+TEST(PushConstantsIntegrationTest, ContentKeepsUnchangedConstants) {
+	fixture_type fixture;
+	type::float_type first(1.f), second(2.f);
+	vcc::pipeline_layout::pipeline_layout_type pipeline_layout(
+		vcc::pipeline_layout::create(std::ref(fixture.device),
+			{ std::ref(fixture.desc_layout) },
+			{ VkPushConstantRange{ VK_SHADER_STAGE_VERTEX_BIT, 0,
+				2 * sizeof(float) } },
+			type::linear_std430, std::ref(first), std::ref(second)));
+	const vcc::command::bind_descriptor_sets bind{
+		VK_PIPELINE_BIND_POINT_GRAPHICS, std::ref(pipeline_layout), 0,
+		{ std::ref(fixture.desc_set) }, {} };
+	const std::unique_ptr<vcc::pipeline_layout::internal::push_constants_state_type>
+		&state(vcc::pipeline_layout::internal::get_push_constants(
+			pipeline_layout));
+
+	vcc::command_buffer::command_buffer_type first_buffer(fixture.allocate());
+	vcc::command_buffer::compile(first_buffer, 0, VK_FALSE, 0, 0, bind);
+	float content[2];
+	std::memcpy(content, state->content.data(), sizeof(content));
+	EXPECT_EQ(1.f, content[0]);
+	EXPECT_EQ(2.f, content[1]);
+
+	type::write(first)[0] = 3.f;
+	vcc::command_buffer::command_buffer_type second_buffer(fixture.allocate());
+	vcc::command_buffer::compile(second_buffer, 0, VK_FALSE, 0, 0, bind);
+	std::memcpy(content, state->content.data(), sizeof(content));
+	EXPECT_EQ(3.f, content[0]);
+	EXPECT_EQ(2.f, content[1]);
+}
@@ -0,0 +1,160 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <chrono>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <thread>
+#include <vcc/internal/queue_pool.h>
+#include <vector>
+
+namespace {
+
+using vcc::internal::queue_pool_type;
+
+typedef std::chrono::steady_clock clock_type;
+
+// A VkQueue behind its mutex, as queue::submit locks it, with a driver
+// spending cost in every vkQueueSubmit.
+struct mock_queue_type {
+	explicit mock_queue_type(clock_type::duration cost)
+		: cost(cost), submits(0), contended(0) {}
+	mock_queue_type(mock_queue_type &&copy)
+		: cost(copy.cost), submits(0), contended(0) {}
+
+	void submit() {
+		std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+		const bool waited(!lock);
+		if (waited) {
+			lock.lock();
+			++contended;
+		}
+		const clock_type::time_point end(clock_type::now() + cost);
+		while (clock_type::now() < end) {}
+		++submits;
+	}
+
+	const clock_type::duration cost;
+	std::mutex mutex;
+	std::size_t submits, contended;
+};
+
+std::vector<mock_queue_type> make_queues(std::size_t count,
+		clock_type::duration cost) {
+	std::vector<mock_queue_type> queues;
+	queues.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		queues.emplace_back(cost);
+	}
+	return queues;
+}
+
+// Threads submitting submits each to the queue chosen by pick, returns the
+// time taken.
+template<typename PickT>
+clock_type::duration run(std::size_t threads, std::size_t submits,
+		PickT pick) {
+	const clock_type::time_point begin(clock_type::now());
+	std::vector<std::thread> workers;
+	for (std::size_t thread = 0; thread < threads; ++thread) {
+		workers.emplace_back([thread, submits, &pick]() {
+			for (std::size_t i = 0; i < submits; ++i) {
+				pick(thread).submit();
+			}
+		});
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	return clock_type::now() - begin;
+}
+
+std::size_t total(queue_pool_type<mock_queue_type> &pool,
+		std::size_t mock_queue_type::*counter) {
+	std::size_t sum(0);
+	for (std::size_t i = 0; i < pool.size(); ++i) {
+		sum += pool.at(i).*counter;
+	}
+	return sum;
+}
+
+}  // anonymous namespace
+
+TEST(QueuePoolTest, RoundRobin) {
+	queue_pool_type<mock_queue_type> pool(make_queues(3, clock_type::duration(0)));
+	for (int i = 0; i < 9; ++i) {
+		pool.round_robin().submit();
+	}
+	for (std::size_t i = 0; i < pool.size(); ++i) {
+		EXPECT_EQ(3u, pool.at(i).submits);
+	}
+}
+
+TEST(QueuePoolTest, Affinity) {
+	queue_pool_type<mock_queue_type> pool(make_queues(4, clock_type::duration(0)));
+	EXPECT_EQ(&pool.at(1), &pool.affinity(1));
+	EXPECT_EQ(&pool.at(1), &pool.affinity(5));
+	mock_queue_type *main(&pool.thread_affinity());
+	EXPECT_EQ(main, &pool.thread_affinity());
+	mock_queue_type *other(nullptr);
+	std::thread([&pool, &other]() {
+		other = &pool.thread_affinity();
+		EXPECT_EQ(other, &pool.thread_affinity());
+	}).join();
+	EXPECT_NE(nullptr, other);
+}
+
+// Four threads submitting to one queue wait on its mutex, with a queue each
+// they never do.
+TEST(QueuePoolTest, Contention) {
+	const std::size_t threads(4), submits(2000);
+	const clock_type::duration cost(std::chrono::microseconds(5));
+
+	queue_pool_type<mock_queue_type> single(make_queues(1, cost));
+	const clock_type::duration single_time(run(threads, submits,
+		[&single](std::size_t) -> mock_queue_type & {
+			return single.round_robin();
+		}));
+	EXPECT_EQ(threads * submits, total(single, &mock_queue_type::submits));
+
+	queue_pool_type<mock_queue_type> pool(make_queues(threads, cost));
+	const clock_type::duration pool_time(run(threads, submits,
+		[&pool](std::size_t thread) -> mock_queue_type & {
+			return pool.affinity(thread);
+		}));
+	EXPECT_EQ(threads * submits, total(pool, &mock_queue_type::submits));
+	EXPECT_EQ(0u, total(pool, &mock_queue_type::contended));
+
+	queue_pool_type<mock_queue_type> round_robin(make_queues(threads, cost));
+	const clock_type::duration round_robin_time(run(threads, submits,
+		[&round_robin](std::size_t) -> mock_queue_type & {
+			return round_robin.round_robin();
+		}));
+	EXPECT_EQ(threads * submits,
+		total(round_robin, &mock_queue_type::submits));
+
+	typedef std::chrono::microseconds us;
+	std::printf("%u threads, %u submits of %u us each: one queue %u us "
+		"(%u contended), %u queues by affinity %u us, round robin %u us "
+		"(%u contended)\n", unsigned(threads), unsigned(submits),
+		unsigned(std::chrono::duration_cast<us>(cost).count()),
+		unsigned(std::chrono::duration_cast<us>(single_time).count()),
+		unsigned(total(single, &mock_queue_type::contended)),
+		unsigned(threads),
+		unsigned(std::chrono::duration_cast<us>(pool_time).count()),
+		unsigned(std::chrono::duration_cast<us>(round_robin_time).count()),
+		unsigned(total(round_robin, &mock_queue_type::contended)));
+}
@@ -0,0 +1,119 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <vcc/internal/radix_sort.h>
+#include <vcc/internal/state_tracker.h>
+
+namespace {
+
+typedef std::vector<vcc::internal::sort_item_type> items_type;
+
+// Keys shaped like draw_list::sort_key, a few pipelines and materials and
+// a random depth.
+items_type random_draws(std::size_t count, uint32_t pipelines) {
+	std::mt19937_64 random(1);
+	items_type items;
+	items.reserve(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		const uint64_t pipeline(random() % pipelines), material(random() % 64),
+			depth(random() & 0xffff);
+		items.push_back(vcc::internal::sort_item_type{
+			pipeline << 48 | material << 32 | depth, uint32_t(i) });
+	}
+	return items;
+}
+
+void expect_stable_sorted(const items_type &sorted, items_type items) {
+	std::stable_sort(items.begin(), items.end(),
+		[](const vcc::internal::sort_item_type &a,
+			const vcc::internal::sort_item_type &b) {
+		return a.key < b.key;
+	});
+	ASSERT_EQ(items.size(), sorted.size());
+	for (std::size_t i = 0; i < items.size(); ++i) {
+		ASSERT_EQ(items[i].key, sorted[i].key);
+		ASSERT_EQ(items[i].index, sorted[i].index);
+	}
+}
+
+std::size_t pipeline_binds(const items_type &items) {
+	vcc::internal::state_tracker_type state;
+	std::size_t binds(0);
+	for (const vcc::internal::sort_item_type &item : items) {
+		if (state.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS,
+				item.key >> 48)) {
+			++binds;
+		}
+	}
+	return binds;
+}
+
+}  // anonymous namespace
+
+TEST(RadixSortTest, Empty) {
+	items_type items, scratch;
+	vcc::internal::radix_sort(items, scratch);
+	ASSERT_TRUE(items.empty());
+}
+
+TEST(RadixSortTest, FullKeys) {
+	std::mt19937_64 random(2);
+	items_type items;
+	for (uint32_t i = 0; i < 1000; ++i) {
+		items.push_back(vcc::internal::sort_item_type{ random(), i });
+	}
+	items_type sorted(items), scratch;
+	vcc::internal::radix_sort(sorted, scratch);
+	expect_stable_sorted(sorted, items);
+}
+
+TEST(RadixSortTest, Stable) {
+	items_type items;
+	for (uint32_t i = 0; i < 1000; ++i) {
+		items.push_back(vcc::internal::sort_item_type{ (i * 7) % 3, i });
+	}
+	items_type sorted(items), scratch;
+	vcc::internal::radix_sort(sorted, scratch);
+	expect_stable_sorted(sorted, items);
+}
+
+TEST(RadixSortTest, HundredThousandDraws) {
+	const items_type items(random_draws(100000, 16));
+	items_type sorted(items), scratch;
+	vcc::internal::radix_sort(sorted, scratch);
+	expect_stable_sorted(sorted, items);
+}
+
+TEST(RadixSortTest, Parallel) {
+	const items_type items(random_draws(100000, 16));
+	vcc::internal::thread_pool_type thread_pool(3);
+	items_type sorted(items), scratch;
+	vcc::internal::radix_sort(sorted, scratch, &thread_pool);
+	expect_stable_sorted(sorted, items);
+	// Sorting again reuses the scratch memory.
+	vcc::internal::radix_sort(sorted, scratch, &thread_pool);
+	expect_stable_sorted(sorted, items);
+}
+
+TEST(RadixSortTest, PipelineBinds) {
+	items_type items(random_draws(10000, 16));
+	ASSERT_GT(pipeline_binds(items), 9000u);
+	items_type scratch;
+	vcc::internal::radix_sort(items, scratch);
+	ASSERT_EQ(16u, pipeline_binds(items));
+}
@@ -0,0 +1,79 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <vcc/internal/recycler.h>
+
+namespace {
+
+// Stands in for a command pool, counting creations and resets.
+struct mock_pool_type {
+	int id, resets;
+};
+
+struct mock_queue_type {
+	mock_queue_type() : tag(1), completed(0), created(0) {}
+
+	mock_pool_type &acquire() {
+		bool recycled;
+		mock_pool_type *pool(pools.get(tag, completed, recycled));
+		if (!pool) {
+			return pools.add(mock_pool_type{ created++, 0 }, tag);
+		}
+		if (recycled) {
+			++pool->resets;
+		}
+		return *pool;
+	}
+
+	vcc::internal::recycler_type<mock_pool_type> pools;
+	uint64_t tag, completed;
+	int created;
+};
+
+}  // anonymous namespace
+
+TEST(RecyclerTest, SharedWithinTag) {
+	mock_queue_type queue;
+	mock_pool_type &first(queue.acquire());
+	mock_pool_type &second(queue.acquire());
+	ASSERT_EQ(&first, &second);
+	ASSERT_EQ(1, queue.created);
+}
+
+TEST(RecyclerTest, SteadyState) {
+	mock_queue_type queue;
+	// Two submits in flight, the GPU is one submit behind.
+	for (int frame = 0; frame < 100; ++frame) {
+		queue.acquire();
+		++queue.tag;
+		queue.completed = queue.tag > 2 ? queue.tag - 2 : 0;
+	}
+	ASSERT_EQ(2, queue.created);
+	ASSERT_EQ(2, queue.pools.size());
+}
+
+TEST(RecyclerTest, NotRecycledBeforeCompleted) {
+	mock_queue_type queue;
+	const int first(queue.acquire().id);
+	++queue.tag;
+	ASSERT_NE(first, queue.acquire().id);
+	++queue.tag;
+	queue.completed = 1;
+	mock_pool_type &recycled(queue.acquire());
+	ASSERT_EQ(first, recycled.id);
+	ASSERT_EQ(1, recycled.resets);
+	ASSERT_EQ(2, queue.created);
+}
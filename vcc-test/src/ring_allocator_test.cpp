@@ -0,0 +1,99 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <vcc/internal/ring_allocator.h>
+
+typedef vcc::internal::ring_allocator_type::size_type size_type;
+
+TEST(RingAllocatorTest, Sequential) {
+	vcc::internal::ring_allocator_type ring(256);
+	size_type offset;
+	ASSERT_TRUE(ring.allocate(10, 16, offset));
+	ASSERT_EQ(0, offset);
+	ASSERT_TRUE(ring.allocate(10, 16, offset));
+	ASSERT_EQ(16, offset);
+	ASSERT_TRUE(ring.allocate(32, 4, offset));
+	ASSERT_EQ(28, offset);
+	ASSERT_EQ(60, ring.used());
+}
+
+TEST(RingAllocatorTest, TooLarge) {
+	vcc::internal::ring_allocator_type ring(64);
+	size_type offset;
+	ASSERT_FALSE(ring.allocate(65, 1, offset));
+	ASSERT_TRUE(ring.allocate(64, 1, offset));
+	ASSERT_EQ(0, offset);
+}
+
+TEST(RingAllocatorTest, WrapAround) {
+	vcc::internal::ring_allocator_type ring(100);
+	size_type offset;
+	ASSERT_TRUE(ring.allocate(40, 1, offset));
+	ring.commit(0);
+	ASSERT_TRUE(ring.allocate(40, 1, offset));
+	ring.commit(1);
+	ASSERT_EQ(40, offset);
+	ring.release(0);
+	// 20 bytes remain at the end, the allocation restarts at the beginning.
+	ASSERT_TRUE(ring.allocate(30, 1, offset));
+	ring.commit(2);
+	ASSERT_EQ(0, offset);
+	ASSERT_EQ(90, ring.used());
+	// Wrapped allocations may not overrun the oldest live allocation.
+	ASSERT_FALSE(ring.allocate(20, 1, offset));
+	ASSERT_TRUE(ring.allocate(10, 1, offset));
+	ASSERT_EQ(30, offset);
+	ring.commit(3);
+	ring.release(1);
+	// Once the tail passed the wrap point, the end is available again.
+	ASSERT_TRUE(ring.allocate(60, 1, offset));
+	ASSERT_EQ(40, offset);
+}
+
+TEST(RingAllocatorTest, BackPressure) {
+	vcc::internal::ring_allocator_type ring(64);
+	size_type offset;
+	for (int i = 0; i < 4; ++i) {
+		ASSERT_TRUE(ring.allocate(16, 16, offset));
+		ASSERT_EQ(i * 16, offset);
+		ring.commit(i);
+	}
+	ASSERT_FALSE(ring.allocate(16, 16, offset));
+	// Releasing the oldest submission makes room at the beginning.
+	ring.release(0);
+	ASSERT_TRUE(ring.allocate(16, 16, offset));
+	ASSERT_EQ(0, offset);
+	ring.commit(4);
+	ASSERT_FALSE(ring.allocate(32, 16, offset));
+	ring.release(2);
+	ASSERT_TRUE(ring.allocate(32, 16, offset));
+	ASSERT_EQ(16, offset);
+}
+
+TEST(RingAllocatorTest, UncommittedNotReleased) {
+	vcc::internal::ring_allocator_type ring(64);
+	size_type offset;
+	ASSERT_TRUE(ring.allocate(32, 1, offset));
+	ring.commit(0);
+	ASSERT_TRUE(ring.allocate(32, 1, offset));
+	ring.release(10);
+	ASSERT_FALSE(ring.empty());
+	ASSERT_EQ(32, ring.used());
+	ring.commit(11);
+	ring.release(11);
+	ASSERT_TRUE(ring.empty());
+	ASSERT_EQ(0, ring.used());
+}
@@ -0,0 +1,174 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <string>
+#include <vcc/internal/state_tracker.h>
+
+namespace {
+
+// Stands in for a command buffer, filtering commands like
+// command::internal::cmd and keeping the ones recorded.
+struct mock_command_buffer_type {
+	void bind_pipeline(VkPipelineBindPoint bind_point, uint64_t pipeline) {
+		if (state.bind_pipeline(bind_point, pipeline)) {
+			recorded.push_back("pipeline " + std::to_string(pipeline));
+		}
+	}
+
+	void bind_descriptor_sets(uint64_t layout, uint32_t first_set,
+			const std::vector<uint64_t> &sets,
+			const std::vector<uint32_t> &dynamic_offsets = {}) {
+		if (state.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+				first_set, sets, dynamic_offsets)) {
+			recorded.push_back("sets " + std::to_string(first_set));
+		}
+	}
+
+	void bind_vertex_buffers(uint32_t first_binding,
+			const std::vector<uint64_t> &buffers,
+			const std::vector<VkDeviceSize> &offsets) {
+		if (state.bind_vertex_buffers(first_binding, buffers, offsets)) {
+			recorded.push_back("vertex " + std::to_string(first_binding));
+		}
+	}
+
+	void bind_index_buffer(uint64_t buffer, VkDeviceSize offset) {
+		if (state.bind_index_buffer(buffer, offset, VK_INDEX_TYPE_UINT16)) {
+			recorded.push_back("index " + std::to_string(buffer));
+		}
+	}
+
+	void set_viewport(float width) {
+		if (state.set_viewport(0, { VkViewport{ 0, 0, width, 1, 0, 1 } })) {
+			recorded.push_back("viewport");
+		}
+	}
+
+	void set_stencil_reference(VkStencilFaceFlags face_mask,
+			uint32_t reference) {
+		if (state.set_stencil_reference(face_mask, reference)) {
+			recorded.push_back("stencil " + std::to_string(reference));
+		}
+	}
+
+	void push_constants(uint64_t layout, uint64_t revision) {
+		if (state.push_constants(layout, revision)) {
+			recorded.push_back("push " + std::to_string(revision));
+		}
+	}
+
+	void draw() {
+		recorded.push_back("draw");
+	}
+
+	vcc::internal::state_tracker_type state;
+	std::vector<std::string> recorded;
+};
+
+typedef std::vector<std::string> stream_type;
+
+}  // anonymous namespace
+
+TEST(StateTrackerTest, DrawListSkipsRepeatedBinds) {
+	mock_command_buffer_type buffer;
+	for (int i = 0; i < 3; ++i) {
+		buffer.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, 1);
+		buffer.bind_descriptor_sets(10, 0, { 100 });
+		buffer.bind_vertex_buffers(0, { 20 }, { 0 });
+		buffer.bind_index_buffer(30, 0);
+		buffer.draw();
+	}
+	ASSERT_EQ(stream_type({ "pipeline 1", "sets 0", "vertex 0", "index 30",
+		"draw", "draw", "draw" }), buffer.recorded);
+}
+
+TEST(StateTrackerTest, ChangedStateRecorded) {
+	mock_command_buffer_type buffer;
+	buffer.bind_vertex_buffers(0, { 20, 21 }, { 0, 0 });
+	buffer.bind_vertex_buffers(1, { 21 }, { 0 });
+	buffer.bind_vertex_buffers(1, { 21 }, { 64 });
+	buffer.bind_index_buffer(30, 0);
+	buffer.bind_index_buffer(30, 16);
+	buffer.bind_index_buffer(31, 16);
+	ASSERT_EQ(stream_type({ "vertex 0", "vertex 1", "index 30", "index 30",
+		"index 31" }), buffer.recorded);
+}
+
+TEST(StateTrackerTest, DescriptorSetsPerIndex) {
+	mock_command_buffer_type buffer;
+	buffer.bind_descriptor_sets(10, 0, { 100, 101 });
+	buffer.bind_descriptor_sets(10, 1, { 101 });
+	buffer.bind_descriptor_sets(10, 1, { 102 });
+	buffer.bind_descriptor_sets(10, 0, { 100 });
+	// Another layout, compatibility unknown.
+	buffer.bind_descriptor_sets(11, 0, { 100 });
+	ASSERT_EQ(stream_type({ "sets 0", "sets 1", "sets 0" }), buffer.recorded);
+}
+
+TEST(StateTrackerTest, DynamicOffsetsMatchedPerCall) {
+	mock_command_buffer_type buffer;
+	buffer.bind_descriptor_sets(10, 0, { 100 }, { 0 });
+	buffer.bind_descriptor_sets(10, 0, { 100 }, { 0 });
+	buffer.bind_descriptor_sets(10, 0, { 100 }, { 256 });
+	buffer.bind_descriptor_sets(10, 0, { 100, 101 }, { 256 });
+	ASSERT_EQ(stream_type({ "sets 0", "sets 0", "sets 0" }), buffer.recorded);
+}
+
+TEST(StateTrackerTest, PipelineForgetsDynamicState) {
+	mock_command_buffer_type buffer;
+	buffer.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, 1);
+	buffer.set_viewport(640);
+	buffer.set_viewport(640);
+	buffer.set_stencil_reference(
+		VK_STENCIL_FACE_FRONT_BIT | VK_STENCIL_FACE_BACK_BIT, 1);
+	buffer.set_stencil_reference(VK_STENCIL_FACE_FRONT_BIT, 1);
+	// Compute pipelines leave the graphics state alone.
+	buffer.bind_pipeline(VK_PIPELINE_BIND_POINT_COMPUTE, 2);
+	buffer.set_viewport(640);
+	buffer.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, 3);
+	buffer.set_viewport(640);
+	buffer.set_stencil_reference(VK_STENCIL_FACE_BACK_BIT, 1);
+	ASSERT_EQ(stream_type({ "pipeline 1", "viewport", "stencil 1",
+		"pipeline 2", "pipeline 3", "viewport", "stencil 1" }),
+		buffer.recorded);
+}
+
+TEST(StateTrackerTest, Invalidate) {
+	mock_command_buffer_type buffer;
+	buffer.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, 1);
+	buffer.bind_descriptor_sets(10, 0, { 100 });
+	buffer.bind_index_buffer(30, 0);
+	buffer.state.invalidate();
+	buffer.bind_pipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, 1);
+	buffer.bind_descriptor_sets(10, 0, { 100 });
+	buffer.bind_index_buffer(30, 0);
+	ASSERT_EQ(stream_type({ "pipeline 1", "sets 0", "index 30",
+		"pipeline 1", "sets 0", "index 30" }), buffer.recorded);
+}
+
+TEST(StateTrackerTest, PushConstantsByRevision) {
+	mock_command_buffer_type buffer;
+	buffer.push_constants(10, 1);
+	buffer.push_constants(10, 1);
+	buffer.push_constants(10, 2);
+	// Another layout pushes its own content.
+	buffer.push_constants(11, 2);
+	buffer.push_constants(10, 2);
+	buffer.state.forget_push_constants();
+	buffer.push_constants(10, 2);
+	ASSERT_EQ(stream_type({ "push 1", "push 2", "push 2", "push 2",
+		"push 2" }), buffer.recorded);
+}
@@ -0,0 +1,151 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <mutex>
+#include <vcc/internal/submit_packer.h>
+
+namespace {
+
+using vcc::internal::submit_packer_type;
+
+VkSemaphore semaphore_handle(std::size_t i) {
+	return VkSemaphore(i + 1);
+}
+
+VkCommandBuffer command_buffer_handle(std::size_t i) {
+	return VkCommandBuffer(i + 1);
+}
+
+// Stands in for vkQueueSubmit, counting the calls and the command buffers
+// submitted under the lock of the queue.
+struct mock_queue_type {
+	mock_queue_type() : calls(0), command_buffers(0) {}
+
+	void submit(const std::vector<VkSubmitInfo> &infos) {
+		std::lock_guard<std::mutex> lock(mutex);
+		++calls;
+		for (const VkSubmitInfo &info : infos) {
+			command_buffers += info.commandBufferCount;
+		}
+	}
+
+	std::mutex mutex;
+	std::size_t calls, command_buffers;
+};
+
+// The submits of one frame of window::draw: pre-draw, draw and post-draw,
+// the draw waiting on the acquired image and the post-draw on the draw.
+void add_frame(submit_packer_type &packer) {
+	packer.begin();
+	packer.command_buffer(command_buffer_handle(0));
+	packer.begin();
+	packer.wait(semaphore_handle(0),
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	packer.command_buffer(command_buffer_handle(1));
+	packer.command_buffer(command_buffer_handle(2));
+	packer.signal(semaphore_handle(1));
+	packer.begin();
+	packer.wait(semaphore_handle(1), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	packer.command_buffer(command_buffer_handle(3));
+}
+
+}  // anonymous namespace
+
+TEST(SubmitPackerTest, Pack) {
+	submit_packer_type packer;
+	EXPECT_TRUE(packer.empty());
+	add_frame(packer);
+	const std::vector<VkSubmitInfo> &infos(packer.pack());
+	ASSERT_EQ(3u, infos.size());
+
+	EXPECT_EQ(0u, infos[0].waitSemaphoreCount);
+	EXPECT_EQ(NULL, infos[0].pWaitSemaphores);
+	EXPECT_EQ(NULL, infos[0].pWaitDstStageMask);
+	ASSERT_EQ(1u, infos[0].commandBufferCount);
+	EXPECT_EQ(command_buffer_handle(0), infos[0].pCommandBuffers[0]);
+	EXPECT_EQ(0u, infos[0].signalSemaphoreCount);
+	EXPECT_EQ(NULL, infos[0].pSignalSemaphores);
+
+	ASSERT_EQ(1u, infos[1].waitSemaphoreCount);
+	EXPECT_EQ(semaphore_handle(0), infos[1].pWaitSemaphores[0]);
+	EXPECT_EQ(VkPipelineStageFlags(
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT),
+		infos[1].pWaitDstStageMask[0]);
+	ASSERT_EQ(2u, infos[1].commandBufferCount);
+	EXPECT_EQ(command_buffer_handle(1), infos[1].pCommandBuffers[0]);
+	EXPECT_EQ(command_buffer_handle(2), infos[1].pCommandBuffers[1]);
+	ASSERT_EQ(1u, infos[1].signalSemaphoreCount);
+	EXPECT_EQ(semaphore_handle(1), infos[1].pSignalSemaphores[0]);
+
+	ASSERT_EQ(1u, infos[2].waitSemaphoreCount);
+	EXPECT_EQ(semaphore_handle(1), infos[2].pWaitSemaphores[0]);
+	ASSERT_EQ(1u, infos[2].commandBufferCount);
+	EXPECT_EQ(command_buffer_handle(3), infos[2].pCommandBuffers[0]);
+	EXPECT_EQ(0u, infos[2].signalSemaphoreCount);
+}
+
+// A submit with only semaphores, and one empty.
+TEST(SubmitPackerTest, EmptySubmits) {
+	submit_packer_type packer;
+	packer.begin();
+	packer.begin();
+	packer.signal(semaphore_handle(0));
+	const std::vector<VkSubmitInfo> &infos(packer.pack());
+	ASSERT_EQ(2u, infos.size());
+	EXPECT_EQ(0u, infos[0].commandBufferCount);
+	EXPECT_EQ(NULL, infos[0].pCommandBuffers);
+	EXPECT_EQ(0u, infos[0].signalSemaphoreCount);
+	EXPECT_EQ(0u, infos[1].commandBufferCount);
+	ASSERT_EQ(1u, infos[1].signalSemaphoreCount);
+	EXPECT_EQ(semaphore_handle(0), infos[1].pSignalSemaphores[0]);
+}
+
+// A packer reused every frame keeps its storage.
+TEST(SubmitPackerTest, ReusesStorage) {
+	submit_packer_type packer;
+	add_frame(packer);
+	const VkSubmitInfo *const data(packer.pack().data());
+	const VkCommandBuffer *const command_buffers(
+		packer.pack()[0].pCommandBuffers);
+	for (int frame = 0; frame < 100; ++frame) {
+		packer.clear();
+		EXPECT_TRUE(packer.empty());
+		add_frame(packer);
+		const std::vector<VkSubmitInfo> &infos(packer.pack());
+		EXPECT_EQ(data, infos.data());
+		EXPECT_EQ(command_buffers, infos[0].pCommandBuffers);
+	}
+}
+
+// The submits of many frames reach the mocked queue in one call per frame
+// instead of one per submit.
+TEST(SubmitPackerTest, OneSubmitPerFrame) {
+	const int frames(1000);
+	mock_queue_type separate, batched;
+	submit_packer_type packer;
+	for (int frame = 0; frame < frames; ++frame) {
+		packer.clear();
+		add_frame(packer);
+		const std::vector<VkSubmitInfo> &infos(packer.pack());
+		for (const VkSubmitInfo &info : infos) {
+			separate.submit(std::vector<VkSubmitInfo>(1, info));
+		}
+		batched.submit(infos);
+	}
+	EXPECT_EQ(3u * frames, separate.calls);
+	EXPECT_EQ(std::size_t(frames), batched.calls);
+	EXPECT_EQ(separate.command_buffers, batched.command_buffers);
+}
@@ -0,0 +1,191 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vcc/internal/mpsc_queue.h>
+#include <vcc/internal/submit_worker.h>
+#include <vector>
+
+namespace {
+
+using vcc::internal::mpsc_queue_type;
+using vcc::internal::submit_worker_type;
+
+typedef std::chrono::steady_clock clock_type;
+
+// A driver taking delay in every vkQueueSubmit, checking that it is never
+// entered by two threads at once.
+struct slow_queue_type {
+	explicit slow_queue_type(clock_type::duration delay) : delay(delay),
+		inside(false), overlapped(false), submits(0) {}
+
+	VkResult submit(std::size_t producer, std::size_t index) {
+		if (inside.exchange(true)) {
+			overlapped = true;
+		}
+		std::this_thread::sleep_for(delay);
+		order.push_back(std::make_pair(producer, index));
+		++submits;
+		inside = false;
+		return VK_SUCCESS;
+	}
+
+	const clock_type::duration delay;
+	std::atomic<bool> inside, overlapped;
+	std::atomic<std::size_t> submits;
+	// Only written by the submitting thread.
+	std::vector<std::pair<std::size_t, std::size_t>> order;
+};
+
+}  // anonymous namespace
+
+TEST(MpscQueueTest, SingleThread) {
+	mpsc_queue_type<int> queue;
+	int value(0);
+	EXPECT_TRUE(queue.empty());
+	EXPECT_FALSE(queue.pop(value));
+	for (int i = 0; i < 3; ++i) {
+		queue.push(int(i));
+	}
+	EXPECT_FALSE(queue.empty());
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_TRUE(queue.pop(value));
+		EXPECT_EQ(i, value);
+	}
+	EXPECT_FALSE(queue.pop(value));
+	// Values left are destroyed with the queue.
+	queue.push(3);
+}
+
+// Values of each producer are popped in the order pushed, none lost.
+TEST(MpscQueueTest, Producers) {
+	const std::size_t producers(4), count(20000);
+	mpsc_queue_type<std::pair<std::size_t, std::size_t>> queue;
+	std::vector<std::thread> threads;
+	for (std::size_t producer = 0; producer < producers; ++producer) {
+		threads.emplace_back([&queue, producer, count]() {
+			for (std::size_t i = 0; i < count; ++i) {
+				queue.push(std::make_pair(producer, i));
+			}
+		});
+	}
+	std::vector<std::size_t> next(producers, 0);
+	std::size_t popped(0);
+	std::pair<std::size_t, std::size_t> value;
+	while (popped < producers * count) {
+		if (queue.pop(value)) {
+			ASSERT_EQ(next[value.first], value.second);
+			++next[value.first];
+			++popped;
+		}
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	EXPECT_TRUE(queue.empty());
+}
+
+// Producers return right away while the driver blocks, the submits are run
+// one at a time in the order of each producer.
+TEST(SubmitWorkerTest, Latency) {
+	const std::size_t submits(10);
+	slow_queue_type driver(std::chrono::milliseconds(20));
+	std::vector<std::future<VkResult>> futures;
+	clock_type::duration enqueue_time(0);
+	{
+		submit_worker_type worker;
+		for (std::size_t i = 0; i < submits; ++i) {
+			const clock_type::time_point begin(clock_type::now());
+			futures.push_back(worker.enqueue([&driver, i]() {
+				return driver.submit(0, i);
+			}));
+			enqueue_time += clock_type::now() - begin;
+		}
+		// All ten enqueued in less time than one submit takes.
+		EXPECT_LT(enqueue_time, driver.delay);
+		EXPECT_EQ(VK_SUCCESS, futures.back().get());
+		EXPECT_EQ(submits, driver.submits.load());
+	}
+	for (std::size_t i = 0; i < submits; ++i) {
+		EXPECT_EQ(i, driver.order[i].second);
+	}
+}
+
+TEST(SubmitWorkerTest, Throughput) {
+	const std::size_t producers(4), submits(250);
+	slow_queue_type driver(std::chrono::microseconds(20));
+	{
+		submit_worker_type worker;
+		std::vector<std::thread> threads;
+		for (std::size_t producer = 0; producer < producers; ++producer) {
+			threads.emplace_back([&worker, &driver, producer, submits]() {
+				std::future<VkResult> last;
+				for (std::size_t i = 0; i < submits; ++i) {
+					last = worker.enqueue([&driver, producer, i]() {
+						return driver.submit(producer, i);
+					});
+				}
+				last.wait();
+			});
+		}
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+	}
+	EXPECT_EQ(producers * submits, driver.submits.load());
+	EXPECT_FALSE(driver.overlapped.load());
+	std::vector<std::size_t> next(producers, 0);
+	for (const std::pair<std::size_t, std::size_t> &submit : driver.order) {
+		EXPECT_EQ(next[submit.first]++, submit.second);
+	}
+}
+
+// Tasks enqueued before the worker is destroyed still run, and errors
+// reach the future.
+TEST(SubmitWorkerTest, DrainAndErrors) {
+	std::atomic<int> run(0);
+	std::future<VkResult> error, result;
+	{
+		submit_worker_type worker;
+		for (int i = 0; i < 100; ++i) {
+			worker.enqueue([&run]() {
+				++run;
+				return VK_SUCCESS;
+			});
+		}
+		error = worker.enqueue([]() -> VkResult {
+			throw std::runtime_error("device lost");
+		});
+		result = worker.enqueue([]() { return VK_ERROR_DEVICE_LOST; });
+	}
+	EXPECT_EQ(100, run.load());
+	EXPECT_THROW(error.get(), std::runtime_error);
+	EXPECT_EQ(VK_ERROR_DEVICE_LOST, result.get());
+}
+
+// The worker sleeps when idle and wakes for every task.
+TEST(SubmitWorkerTest, WakesFromIdle) {
+	submit_worker_type worker;
+	for (int i = 0; i < 50; ++i) {
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+		EXPECT_EQ(VK_SUCCESS, worker.enqueue([]() {
+			return VK_SUCCESS;
+		}).get());
+	}
+}
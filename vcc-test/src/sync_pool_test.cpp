@@ -0,0 +1,121 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <set>
+#include <vcc/internal/sync_pool.h>
+
+namespace {
+
+using vcc::internal::sync_pool_type;
+
+typedef sync_pool_type<int>::tag_type tag_type;
+
+// Counts the vkCreate* and vkResetFences calls of a pool, handles are
+// integers.
+struct mock_device_type {
+	mock_device_type() : creates(0), resets(0), reset_objects(0) {}
+
+	int acquire(sync_pool_type<int> &pool, tag_type completed) {
+		int handle;
+		if (!pool.acquire(completed, handle, [this](std::vector<int> &handles) {
+			++resets;
+			reset_objects += handles.size();
+			for (int handle : handles) {
+				EXPECT_TRUE(live.count(handle));
+			}
+		})) {
+			handle = int(++creates);
+			live.insert(handle);
+		}
+		return handle;
+	}
+
+	std::size_t creates, resets, reset_objects;
+	std::set<int> live;
+};
+
+}  // anonymous namespace
+
+// The frame loop of window::draw on a GPU two frames behind: a semaphore
+// per frame for the acquired image, waited on by the post-draw submit.
+TEST(SyncPoolTest, SemaphoresSteadyState) {
+	const tag_type frames_in_flight(2);
+	sync_pool_type<int> semaphores;
+	mock_device_type device;
+	for (tag_type frame = 1; frame <= 100; ++frame) {
+		const tag_type completed(frame > frames_in_flight
+			? frame - frames_in_flight : 0);
+		const int semaphore(device.acquire(semaphores, completed));
+		semaphores.release(int(semaphore), frame);
+		if (frame == 10) {
+			device.creates = 0;
+		}
+	}
+	// No vkCreateSemaphore once warmed up.
+	EXPECT_EQ(0u, device.creates);
+	// The semaphore of frame N is reused by frame N + 2.
+	EXPECT_EQ(frames_in_flight, semaphores.size());
+}
+
+// A semaphore is not handed out while its submit may still wait on it.
+TEST(SyncPoolTest, NotReusedBeforeCompleted) {
+	sync_pool_type<int> semaphores;
+	mock_device_type device;
+	const int first(device.acquire(semaphores, 0));
+	semaphores.release(int(first), 5);
+	EXPECT_NE(first, device.acquire(semaphores, 4));
+	EXPECT_EQ(first, device.acquire(semaphores, 5));
+	EXPECT_EQ(2u, device.creates);
+}
+
+// Fences of the flush batch: one per submit, given back once signaled and
+// reset all at once when no reset fence is left.
+TEST(SyncPoolTest, FencesResetInBatches) {
+	sync_pool_type<int> fences;
+	mock_device_type device;
+	std::vector<int> in_flight;
+	for (int frame = 0; frame < 100; ++frame) {
+		in_flight.push_back(device.acquire(fences, 0));
+		if (in_flight.size() == 4) {
+			// A blocking flush retires all of them.
+			for (int fence : in_flight) {
+				fences.release(int(fence));
+			}
+			in_flight.clear();
+		}
+	}
+	EXPECT_EQ(4u, device.creates);
+	// One vkResetFences per four fences handed out again.
+	EXPECT_EQ(24u, device.resets);
+	EXPECT_EQ(96u, device.reset_objects);
+}
+
+// Ready fences are handed out before resetting those given back since.
+TEST(SyncPoolTest, ReadyFirst) {
+	sync_pool_type<int> fences;
+	mock_device_type device;
+	const int a(device.acquire(fences, 0)), b(device.acquire(fences, 0));
+	fences.release(int(a));
+	fences.release(int(b));
+	device.acquire(fences, 0);
+	EXPECT_EQ(1u, device.resets);
+	fences.release(int(a));
+	device.acquire(fences, 0);
+	EXPECT_EQ(1u, device.resets);
+	device.acquire(fences, 0);
+	EXPECT_EQ(2u, device.resets);
+	EXPECT_EQ(2u, device.creates);
+}
@@ -0,0 +1,66 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vcc/internal/thread_pool.h>
+
+TEST(ThreadPoolTest, PartitionRange) {
+	typedef std::pair<std::size_t, std::size_t> range_type;
+	ASSERT_EQ(range_type(0, 4), vcc::internal::partition_range(10, 3, 0));
+	ASSERT_EQ(range_type(4, 7), vcc::internal::partition_range(10, 3, 1));
+	ASSERT_EQ(range_type(7, 10), vcc::internal::partition_range(10, 3, 2));
+	ASSERT_EQ(range_type(1, 2), vcc::internal::partition_range(2, 4, 1));
+	ASSERT_EQ(range_type(2, 2), vcc::internal::partition_range(2, 4, 3));
+}
+
+TEST(ThreadPoolTest, EveryIndexOnce) {
+	vcc::internal::thread_pool_type pool(3);
+	ASSERT_EQ(4, pool.size());
+	for (int iteration = 0; iteration < 200; ++iteration) {
+		std::vector<std::atomic<int>> calls(37);
+		for (std::atomic<int> &call : calls) {
+			call = 0;
+		}
+		pool.parallel_for(calls.size(), [&calls](std::size_t i) {
+			++calls[i];
+		});
+		for (const std::atomic<int> &call : calls) {
+			ASSERT_EQ(1, call);
+		}
+	}
+}
+
+TEST(ThreadPoolTest, NoWorkers) {
+	vcc::internal::thread_pool_type pool(0);
+	int sum(0);
+	pool.parallel_for(5, [&sum](std::size_t i) { sum += int(i); });
+	ASSERT_EQ(10, sum);
+}
+
+TEST(ThreadPoolTest, Exception) {
+	vcc::internal::thread_pool_type pool(2);
+	std::atomic<int> calls(0);
+	ASSERT_THROW(pool.parallel_for(8, [&calls](std::size_t i) {
+		++calls;
+		if (i == 3) {
+			throw std::runtime_error("failed");
+		}
+	}), std::runtime_error);
+	ASSERT_EQ(8, calls);
+	pool.parallel_for(2, [&calls](std::size_t) { ++calls; });
+	ASSERT_EQ(10, calls);
+}
@@ -0,0 +1,74 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define NOMINMAX
+#include <gtest/gtest.h>
+#include <vcc/command.h>
+#include <vcc/command_pool.h>
+#include <vcc/device.h>
+#include <vcc/enumerate.h>
+#include <vcc/image.h>
+#include <vcc/instance.h>
+#include <vcc/memory.h>
+#include <vcc/physical_device.h>
+#include <vcc/queue.h>
+
+// A reusable command buffer would replay barriers built from the layouts
+// tracked when it was recorded, inferred transitions are refused there and
+// leave the tracked layouts untouched.
+TEST(TransitionLayoutIntegrationTest, OneTimeSubmitOnly) {
+	vcc::instance::instance_type instance(vcc::instance::create({}, {}));
+	const VkPhysicalDevice physical_device(
+		vcc::physical_device::enumerate(instance).front());
+	vcc::device::device_type device(vcc::device::create(physical_device,
+		{ vcc::device::queue_create_info_type{
+			vcc::physical_device::get_queue_family_properties_with_flag(
+				vcc::physical_device::queue_famility_properties(
+					physical_device),
+				VK_QUEUE_GRAPHICS_BIT),
+				{ 0 } }
+		}, {}, {}, {}));
+	vcc::queue::queue_type queue(vcc::queue::get_queue(
+		std::ref(device), VK_QUEUE_GRAPHICS_BIT));
+
+	vcc::image::image_type image(vcc::image::create(std::ref(device), 0,
+		VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, VkExtent3D{ 16, 16, 1 },
+		1, 1, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE, {},
+		VK_IMAGE_LAYOUT_UNDEFINED));
+	const type::supplier<vcc::memory::memory_type> memory(
+		vcc::memory::bind(std::ref(device),
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image));
+
+	vcc::command_pool::command_pool_type cmd_pool(vcc::command_pool::create(
+		std::ref(device), 0, vcc::queue::get_family_index(queue)));
+	vcc::command_buffer::command_buffer_type command_buffer(std::move(
+		vcc::command_buffer::allocate(std::ref(device),
+			std::ref(cmd_pool), VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1).front()));
+	const vcc::command::transition_layout transition{ std::ref(image),
+		{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT };
+
+	EXPECT_THROW(vcc::command_buffer::compile(command_buffer, 0, VK_FALSE, 0,
+		0, transition), vcc::vcc_exception);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_UNDEFINED, vcc::image::get_layout(image, 0, 0));
+
+	vcc::command_buffer::compile(command_buffer,
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, VK_FALSE, 0, 0,
+		transition);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		vcc::image::get_layout(image, 0, 0));
+}
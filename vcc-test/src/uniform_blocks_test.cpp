@@ -0,0 +1,172 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <cstring>
+#include <deque>
+#include <gtest/gtest.h>
+#include <string>
+#include <vcc/internal/uniform_blocks.h>
+
+typedef vcc::internal::uniform_blocks_type::tag_type tag_type;
+
+namespace {
+
+// The flush batch of a queue, completing a submit only once latency newer
+// submits were made unless waited on. track() is the tag of the next
+// submit, as within queue::submit.
+struct mock_queue_type {
+	explicit mock_queue_type(std::size_t latency) : latency(latency),
+		tag(1), completed_tag(0), waits(0) {}
+
+	tag_type completed() {
+		return completed_tag;
+	}
+
+	bool wait() {
+		if (in_flight.empty()) {
+			return false;
+		}
+		++waits;
+		complete();
+		return true;
+	}
+
+	tag_type track() {
+		return tag;
+	}
+
+	void submit(std::size_t version) {
+		in_flight.push_back(std::make_pair(tag++, version));
+		while (in_flight.size() > latency) {
+			complete();
+		}
+	}
+
+	bool reading(std::size_t version) const {
+		for (const std::pair<tag_type, std::size_t> &submission : in_flight) {
+			if (submission.second == version) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::size_t latency;
+	tag_type tag, completed_tag;
+	std::size_t waits;
+	std::deque<std::pair<tag_type, std::size_t>> in_flight;
+
+private:
+	void complete() {
+		completed_tag = in_flight.front().first;
+		in_flight.pop_front();
+	}
+};
+
+// The mapped buffer, one copy per frame.
+struct mock_memory_type {
+	mock_memory_type(const mock_queue_type &queue, std::size_t frames)
+		: queue(queue), copies(frames), writes(0) {}
+
+	void operator()(std::size_t version, const char *content,
+			std::size_t size) {
+		EXPECT_FALSE(queue.reading(version));
+		copies[version].assign(content, size);
+		++writes;
+	}
+
+	const mock_queue_type &queue;
+	std::vector<std::string> copies;
+	std::size_t writes;
+};
+
+// Changes the first block every frame when changing, as flush of
+// uniform_arena does, and submits the frame.
+void run_frames(vcc::internal::uniform_blocks_type &blocks,
+		mock_queue_type &queue, mock_memory_type &memory, std::size_t frames,
+		bool changing) {
+	for (std::size_t frame = 0; frame < frames; ++frame) {
+		if (changing) {
+			std::memcpy(blocks.content(), &frame, sizeof(frame));
+		}
+		blocks.flush(queue, uint32_t(frame), changing, std::ref(memory));
+		const std::size_t version(frame % blocks.frames());
+		std::size_t written;
+		std::memcpy(&written, memory.copies[version].data(), sizeof(written));
+		if (changing) {
+			ASSERT_EQ(frame, written);
+		}
+		queue.submit(version);
+	}
+}
+
+}  // anonymous namespace
+
+TEST(UniformBlocksTest, Layout) {
+	vcc::internal::uniform_blocks_type blocks(256, 64, 32, 2);
+	ASSERT_EQ(0u, blocks.add(16));
+	ASSERT_EQ(32u, blocks.add(40));
+	ASSERT_THROW(blocks.add(65), vcc::vcc_exception);
+	ASSERT_EQ(96u, blocks.add(64));
+	ASSERT_EQ(160u, blocks.add(8));
+	ASSERT_EQ(192u, blocks.add(8));
+	// The descriptor range would pass the end.
+	ASSERT_THROW(blocks.add(8), vcc::vcc_exception);
+}
+
+TEST(UniformBlocksTest, EveryFrameWrittenOnce) {
+	vcc::internal::uniform_blocks_type blocks(256, 64, 32, 3);
+	blocks.add(sizeof(std::size_t));
+	mock_queue_type queue(2);
+	mock_memory_type memory(queue, blocks.frames());
+	run_frames(blocks, queue, memory, 1, true);
+	run_frames(blocks, queue, memory, 10, false);
+	ASSERT_EQ(3u, memory.writes);
+	ASSERT_EQ(memory.copies[0], memory.copies[2]);
+}
+
+TEST(UniformBlocksTest, EnoughFramesNeverWait) {
+	vcc::internal::uniform_blocks_type blocks(256, 64, 32, 3);
+	blocks.add(sizeof(std::size_t));
+	mock_queue_type queue(2);
+	mock_memory_type memory(queue, blocks.frames());
+	run_frames(blocks, queue, memory, 100, true);
+	ASSERT_EQ(0u, queue.waits);
+	ASSERT_EQ(100u, memory.writes);
+}
+
+TEST(UniformBlocksTest, SlowQueueWaitsWithoutRace) {
+	vcc::internal::uniform_blocks_type blocks(256, 64, 32, 2);
+	blocks.add(sizeof(std::size_t));
+	mock_queue_type queue(4);
+	mock_memory_type memory(queue, blocks.frames());
+	run_frames(blocks, queue, memory, 100, true);
+	ASSERT_LT(0u, queue.waits);
+}
+
+// The copy is tagged with the submit reading it, rewriting it waits for
+// that submit only and not for the unrelated ones after it.
+TEST(UniformBlocksTest, TaggedWithReadingSubmit) {
+	vcc::internal::uniform_blocks_type blocks(256, 64, 32, 2);
+	blocks.add(sizeof(std::size_t));
+	mock_queue_type queue(8);
+	mock_memory_type memory(queue, blocks.frames());
+	run_frames(blocks, queue, memory, 2, true);
+	// Unrelated submits, not reading the arena.
+	queue.submit(2);
+	queue.submit(2);
+	run_frames(blocks, queue, memory, 1, true);
+	ASSERT_EQ(1u, queue.waits);
+}
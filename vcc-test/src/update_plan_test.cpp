@@ -0,0 +1,162 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <string>
+#include <vcc/internal/update_plan.h>
+#include <vector>
+
+namespace {
+
+// A command recorded by input_buffer::flush for an inline update.
+struct command_type {
+	std::string name;
+	VkPipelineStageFlags src_stages, dst_stages;
+	VkAccessFlags src_access, dst_access;
+	uint64_t offset, size;
+	std::string data;
+};
+
+// Records like the recorder of input_buffer::flush, keeping the commands
+// of the flush command buffer and the barrier added to its end.
+struct mock_recorder_type {
+	void barrier(VkPipelineStageFlags src_stages,
+			VkPipelineStageFlags dst_stages, VkAccessFlags src_access,
+			VkAccessFlags dst_access, uint64_t offset, uint64_t size) {
+		recorded.push_back(command_type{ "barrier", src_stages, dst_stages,
+			src_access, dst_access, offset, size, std::string() });
+	}
+
+	void update(uint64_t offset, uint64_t size, const char *data) {
+		recorded.push_back(command_type{ "update", 0, 0, 0, 0, offset, size,
+			std::string(data, std::size_t(size)) });
+	}
+
+	void flush_barrier(VkPipelineStageFlags src_stages,
+			VkAccessFlags src_access, VkAccessFlags dst_access) {
+		end.push_back(command_type{ "flush_barrier", src_stages, 0,
+			src_access, dst_access, 0, 0, std::string() });
+	}
+
+	std::vector<command_type> recorded, end;
+};
+
+// Flushes the dirty range of content like input_buffer::flush on a queue,
+// returns false if it is not recorded inline.
+bool flush(mock_recorder_type &recorder, const std::string &content,
+		uint64_t begin, uint64_t end) {
+	const vcc::internal::update_plan_type plan(vcc::internal::plan_update(
+		begin, end, content.size(), 65536));
+	if (plan.inline_update) {
+		vcc::internal::record_update(recorder, plan, content.data());
+	}
+	return plan.inline_update;
+}
+
+}  // anonymous namespace
+
+TEST(UpdatePlanTest, SmallRangeIsInline) {
+	// One mat4 in the middle of a uniform block.
+	const vcc::internal::update_plan_type plan(
+		vcc::internal::plan_update(64, 128, 256, 65536));
+	ASSERT_TRUE(plan.inline_update);
+	ASSERT_EQ(64, plan.offset);
+	ASSERT_EQ(64, plan.size);
+}
+
+TEST(UpdatePlanTest, WidenedToFourBytes) {
+	const vcc::internal::update_plan_type plan(
+		vcc::internal::plan_update(6, 9, 16, 65536));
+	ASSERT_TRUE(plan.inline_update);
+	ASSERT_EQ(4, plan.offset);
+	ASSERT_EQ(8, plan.size);
+}
+
+TEST(UpdatePlanTest, AboveThresholdIsMapped) {
+	const vcc::internal::update_plan_type plan(
+		vcc::internal::plan_update(8, 200, 256, 128));
+	ASSERT_FALSE(plan.inline_update);
+	ASSERT_EQ(8, plan.offset);
+	ASSERT_EQ(192, plan.size);
+}
+
+TEST(UpdatePlanTest, DisabledByZeroThreshold) {
+	ASSERT_FALSE(vcc::internal::plan_update(0, 4, 4, 0).inline_update);
+}
+
+TEST(UpdatePlanTest, LimitedByCommand) {
+	ASSERT_TRUE(vcc::internal::plan_update(0, 65536, 1 << 20, 1 << 20)
+		.inline_update);
+	ASSERT_FALSE(vcc::internal::plan_update(0, 65540, 1 << 20, 1 << 20)
+		.inline_update);
+}
+
+TEST(UpdatePlanTest, UnalignedEndOfBuffer) {
+	// Widening past the end of the buffer is not allowed.
+	ASSERT_FALSE(vcc::internal::plan_update(4, 6, 6, 65536).inline_update);
+}
+
+TEST(UpdatePlanTest, InlineUpdateCommands) {
+	const std::string content("0123456789abcdef");
+	mock_recorder_type recorder;
+	ASSERT_TRUE(flush(recorder, content, 6, 9));
+	ASSERT_EQ(2u, recorder.recorded.size());
+	// Earlier submits may still read or write the range.
+	const command_type &barrier(recorder.recorded[0]);
+	EXPECT_EQ("barrier", barrier.name);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT),
+		barrier.src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_TRANSFER_BIT),
+		barrier.dst_stages);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_MEMORY_WRITE_BIT), barrier.src_access);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_TRANSFER_WRITE_BIT),
+		barrier.dst_access);
+	EXPECT_EQ(4u, barrier.offset);
+	EXPECT_EQ(8u, barrier.size);
+	// Widened to 4 bytes, the content around the dirty range is written
+	// as it is.
+	const command_type &update(recorder.recorded[1]);
+	EXPECT_EQ("update", update.name);
+	EXPECT_EQ(4u, update.offset);
+	EXPECT_EQ(8u, update.size);
+	EXPECT_EQ("456789ab", update.data);
+	// The update is made visible at the end of the flush.
+	ASSERT_EQ(1u, recorder.end.size());
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_TRANSFER_BIT),
+		recorder.end[0].src_stages);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_TRANSFER_WRITE_BIT),
+		recorder.end[0].src_access);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_MEMORY_READ_BIT),
+		recorder.end[0].dst_access);
+}
+
+TEST(UpdatePlanTest, InlineUpdateAtEndOfBuffer) {
+	const std::string content("0123456789abcdef");
+	mock_recorder_type recorder;
+	ASSERT_TRUE(flush(recorder, content, 13, 16));
+	ASSERT_EQ(2u, recorder.recorded.size());
+	EXPECT_EQ(12u, recorder.recorded[0].offset);
+	EXPECT_EQ(4u, recorder.recorded[0].size);
+	EXPECT_EQ("cdef", recorder.recorded[1].data);
+}
+
+TEST(UpdatePlanTest, MappedUpdateRecordsNothing) {
+	const std::string content("0123456789");
+	mock_recorder_type recorder;
+	// Widening would pass the end of the buffer.
+	ASSERT_FALSE(flush(recorder, content, 8, 10));
+	EXPECT_TRUE(recorder.recorded.empty());
+	EXPECT_TRUE(recorder.end.empty());
+}
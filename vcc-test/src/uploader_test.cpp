@@ -0,0 +1,265 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <atomic>
+#include <gtest/gtest.h>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vcc/internal/upload_batch.h>
+#include <vector>
+
+namespace {
+
+using vcc::internal::barrier_half_type;
+using vcc::internal::upload_barriers;
+using vcc::internal::upload_barriers_type;
+
+const uint32_t transfer_family(2), graphics_family(0);
+
+// The fields of the two halves of an ownership transfer the specification
+// requires to be identical.
+void expect_pair(const barrier_half_type &release,
+		const barrier_half_type &acquire) {
+	EXPECT_EQ(release.src_family, acquire.src_family);
+	EXPECT_EQ(release.dst_family, acquire.dst_family);
+	EXPECT_EQ(release.old_layout, acquire.old_layout);
+	EXPECT_EQ(release.new_layout, acquire.new_layout);
+}
+
+}  // anonymous namespace
+
+TEST(UploadBarriersTest, OtherFamily) {
+	const upload_barriers_type barriers(upload_barriers(
+		vcc::internal::upload_other_family, transfer_family, graphics_family,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT));
+	EXPECT_TRUE(barriers.acquire_needed);
+	expect_pair(barriers.release, barriers.acquire);
+	EXPECT_EQ(transfer_family, barriers.release.src_family);
+	EXPECT_EQ(graphics_family, barriers.release.dst_family);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, barriers.release.old_layout);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		barriers.release.new_layout);
+
+	// The release makes the copy available, its destination is ignored.
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_TRANSFER_BIT),
+		barriers.release.src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+		barriers.release.dst_stages);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_TRANSFER_WRITE_BIT),
+		barriers.release.src_access);
+	EXPECT_EQ(0u, barriers.release.dst_access);
+
+	// The acquire makes it visible, from the stages waiting on the
+	// semaphore so that later batches are chained after the wait.
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT),
+		barriers.acquire.src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT),
+		barriers.acquire.dst_stages);
+	EXPECT_EQ(0u, barriers.acquire.src_access);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_SHADER_READ_BIT),
+		barriers.acquire.dst_access);
+}
+
+TEST(UploadBarriersTest, Buffer) {
+	const upload_barriers_type barriers(upload_barriers(
+		vcc::internal::upload_other_family, transfer_family, graphics_family,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT));
+	EXPECT_TRUE(barriers.acquire_needed);
+	expect_pair(barriers.release, barriers.acquire);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_UNDEFINED, barriers.release.old_layout);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_UNDEFINED, barriers.release.new_layout);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT),
+		barriers.acquire.dst_access);
+}
+
+TEST(UploadBarriersTest, SameFamily) {
+	const upload_barriers_type barriers(upload_barriers(
+		vcc::internal::upload_same_family, graphics_family, graphics_family,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT));
+	EXPECT_EQ(uint32_t(VK_QUEUE_FAMILY_IGNORED), barriers.release.src_family);
+	EXPECT_EQ(uint32_t(VK_QUEUE_FAMILY_IGNORED), barriers.release.dst_family);
+	// The release transitions the layout.
+	EXPECT_EQ(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, barriers.release.old_layout);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		barriers.release.new_layout);
+	EXPECT_EQ(0u, barriers.release.dst_access);
+
+	// The waiting batch still records a barrier, chaining the later batches
+	// after the semaphore wait and making the copy visible to them.
+	EXPECT_TRUE(barriers.acquire_needed);
+	EXPECT_EQ(uint32_t(VK_QUEUE_FAMILY_IGNORED), barriers.acquire.src_family);
+	EXPECT_EQ(uint32_t(VK_QUEUE_FAMILY_IGNORED), barriers.acquire.dst_family);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		barriers.acquire.old_layout);
+	EXPECT_EQ(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		barriers.acquire.new_layout);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT),
+		barriers.acquire.src_stages);
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT),
+		barriers.acquire.dst_stages);
+	EXPECT_EQ(0u, barriers.acquire.src_access);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_SHADER_READ_BIT),
+		barriers.acquire.dst_access);
+}
+
+TEST(UploadBarriersTest, SameQueue) {
+	const upload_barriers_type barriers(upload_barriers(
+		vcc::internal::upload_same_queue, graphics_family, graphics_family,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT));
+	EXPECT_FALSE(barriers.acquire_needed);
+	EXPECT_EQ(uint32_t(VK_QUEUE_FAMILY_IGNORED), barriers.release.src_family);
+	// Without a semaphore the one barrier makes the copy visible.
+	EXPECT_EQ(VkPipelineStageFlags(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT),
+		barriers.release.dst_stages);
+	EXPECT_EQ(VkAccessFlags(VK_ACCESS_SHADER_READ_BIT),
+		barriers.release.dst_access);
+}
+
+TEST(UploadBatchTest, Take) {
+	vcc::internal::upload_batch_type<int> batch;
+	std::vector<int> taken;
+	EXPECT_FALSE(batch.take(taken));
+	batch.add(1);
+	batch.add(2);
+	EXPECT_FALSE(batch.empty());
+	EXPECT_TRUE(batch.take(taken));
+	EXPECT_EQ((std::vector<int>{ 1, 2 }), taken);
+	EXPECT_TRUE(batch.empty());
+	EXPECT_FALSE(batch.take(taken));
+	EXPECT_TRUE(taken.empty());
+}
+
+namespace {
+
+struct mock_acquire_type {
+	int resource;
+	barrier_half_type acquire;
+};
+
+// The transfer queue: releases are recorded into the flush commands, under
+// the flush lock, and a submit signals its semaphore.
+struct mock_transfer_queue_type {
+	std::recursive_mutex flush_mutex;
+	std::vector<std::pair<int, barrier_half_type>> flush_commands;
+	// The releases of each signaled semaphore.
+	std::map<uint64_t, std::vector<std::pair<int, barrier_half_type>>>
+		signaled;
+	uint64_t next_semaphore = 1;
+
+	uint64_t submit() {
+		const uint64_t semaphore(next_semaphore++);
+		signaled[semaphore].swap(flush_commands);
+		flush_commands.clear();
+		return semaphore;
+	}
+};
+
+// The graphics queue checks that every acquire waits on the semaphore of
+// the submit holding its release.
+struct mock_graphics_queue_type {
+	std::map<int, uint64_t> acquired;
+	std::size_t mismatches = 0;
+
+	void submit(const mock_transfer_queue_type &transfer, uint64_t semaphore,
+			const std::vector<mock_acquire_type> &acquires) {
+		const auto &releases(transfer.signaled.at(semaphore));
+		for (const mock_acquire_type &acquire : acquires) {
+			bool found(false);
+			for (const auto &release : releases) {
+				if (release.first == acquire.resource) {
+					found = true;
+					expect_pair(release.second, acquire.acquire);
+				}
+			}
+			if (!found) {
+				++mismatches;
+			}
+			acquired[acquire.resource] = semaphore;
+		}
+	}
+};
+
+}  // anonymous namespace
+
+// Threads upload while another submits, as uploader::upload and
+// uploader::submit do, every acquire must match a release of the transfer
+// submit it waits for.
+TEST(UploadBatchTest, Stress) {
+	const int threads(4), uploads(2000);
+	mock_transfer_queue_type transfer;
+	mock_graphics_queue_type graphics;
+	vcc::internal::upload_batch_type<mock_acquire_type> batch;
+	std::atomic<int> running(threads);
+
+	const auto submit([&]() {
+		std::vector<mock_acquire_type> acquires;
+		uint64_t semaphore;
+		{
+			std::lock_guard<std::recursive_mutex> lock(transfer.flush_mutex);
+			if (!batch.take(acquires)) {
+				return;
+			}
+			semaphore = transfer.submit();
+		}
+		graphics.submit(transfer, semaphore, acquires);
+	});
+
+	std::vector<std::thread> workers;
+	for (int thread = 0; thread < threads; ++thread) {
+		workers.emplace_back([&, thread]() {
+			for (int i = 0; i < uploads; ++i) {
+				const int resource(thread * uploads + i);
+				const upload_barriers_type barriers(upload_barriers(
+					vcc::internal::upload_other_family, transfer_family,
+					graphics_family, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					i % 2 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+						: VK_IMAGE_LAYOUT_GENERAL,
+					VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+					VK_ACCESS_SHADER_READ_BIT));
+				std::lock_guard<std::recursive_mutex> lock(
+					transfer.flush_mutex);
+				transfer.flush_commands.emplace_back(resource,
+					barriers.release);
+				batch.add(mock_acquire_type{ resource, barriers.acquire });
+			}
+			--running;
+		});
+	}
+	std::thread submitter([&]() {
+		while (running) {
+			submit();
+			std::this_thread::yield();
+		}
+		submit();
+	});
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+	submitter.join();
+
+	EXPECT_EQ(0u, graphics.mismatches);
+	EXPECT_EQ(std::size_t(threads * uploads), graphics.acquired.size());
+	EXPECT_TRUE(transfer.flush_commands.empty());
+	EXPECT_TRUE(batch.empty());
+}
@@ -0,0 +1,123 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <deque>
+#include <gtest/gtest.h>
+#include <vcc/internal/version_tracker.h>
+
+typedef vcc::internal::version_tracker_type::tag_type tag_type;
+
+namespace {
+
+// Completes a submission only once latency newer submissions were made,
+// unless explicitly waited on.
+struct mock_queue_type {
+	explicit mock_queue_type(std::size_t latency) : latency(latency),
+		tag(0), completed(0), waits(0) {}
+
+	tag_type submit(std::size_t version) {
+		in_flight.push_back(std::make_pair(++tag, version));
+		while (in_flight.size() > latency) {
+			complete();
+		}
+		return tag;
+	}
+
+	void wait() {
+		++waits;
+		complete();
+	}
+
+	bool reading(std::size_t version) const {
+		for (const std::pair<tag_type, std::size_t> &submission : in_flight) {
+			if (submission.second == version) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::size_t latency;
+	tag_type tag, completed;
+	std::size_t waits;
+	std::deque<std::pair<tag_type, std::size_t>> in_flight;
+
+private:
+	void complete() {
+		completed = in_flight.front().first;
+		in_flight.pop_front();
+	}
+};
+
+// Writes new content every frame the way input_buffer::flush does and
+// checks that no version is written while a submission reads it.
+void run_frames(vcc::internal::version_tracker_type &versions,
+		mock_queue_type &queue, std::size_t frames) {
+	for (std::size_t frame = 0; frame < frames; ++frame) {
+		const std::size_t version(frame % versions.size());
+		versions.update();
+		ASSERT_TRUE(versions.stale(version));
+		while (versions.busy(version, queue.completed)) {
+			queue.wait();
+		}
+		ASSERT_FALSE(queue.reading(version));
+		versions.write(version);
+		ASSERT_FALSE(versions.stale(version));
+		versions.use(version, queue.submit(version));
+	}
+}
+
+}  // anonymous namespace
+
+TEST(VersionTrackerTest, Stale) {
+	vcc::internal::version_tracker_type versions(2);
+	ASSERT_TRUE(versions.stale(0));
+	ASSERT_TRUE(versions.stale(1));
+	versions.write(0);
+	ASSERT_FALSE(versions.stale(0));
+	ASSERT_TRUE(versions.stale(1));
+	versions.update();
+	ASSERT_TRUE(versions.stale(0));
+}
+
+TEST(VersionTrackerTest, Busy) {
+	vcc::internal::version_tracker_type versions(2);
+	ASSERT_FALSE(versions.busy(0, 0));
+	versions.use(0, 5);
+	ASSERT_TRUE(versions.busy(0, 4));
+	ASSERT_FALSE(versions.busy(0, 5));
+	ASSERT_FALSE(versions.busy(1, 0));
+}
+
+TEST(VersionTrackerTest, EnoughFramesNeverWait) {
+	vcc::internal::version_tracker_type versions(3);
+	mock_queue_type queue(2);
+	run_frames(versions, queue, 100);
+	ASSERT_EQ(0, queue.waits);
+}
+
+TEST(VersionTrackerTest, SlowQueueWaitsWithoutRace) {
+	vcc::internal::version_tracker_type versions(2);
+	mock_queue_type queue(4);
+	run_frames(versions, queue, 100);
+	ASSERT_LT(0, queue.waits);
+}
+
+TEST(VersionTrackerTest, SingleVersionWaitsEveryFrame) {
+	vcc::internal::version_tracker_type versions(1);
+	mock_queue_type queue(3);
+	run_frames(versions, queue, 10);
+	ASSERT_EQ(9, queue.waits);
+}
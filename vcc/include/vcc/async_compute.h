@@ -0,0 +1,114 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef ASYNC_COMPUTE_H_
+#define ASYNC_COMPUTE_H_
+
+#include <mutex>
+#include <vcc/buffer.h>
+#include <vcc/command.h>
+#include <vcc/image.h>
+#include <vcc/internal/ownership_planner.h>
+#include <vcc/queue.h>
+
+namespace vcc {
+namespace async_compute {
+
+// A buffer written or read by both queues. The access masks are those of
+// the use on each queue, made visible by the ownership transfers.
+struct shared_buffer_type {
+	type::supplier<buffer::buffer_type> buffer;
+	VkAccessFlags graphics_access, compute_access;
+};
+
+// An image shared by both queues, kept in layout by the transfers.
+struct shared_image_type {
+	type::supplier<image::image_type> image;
+	VkImageSubresourceRange range;
+	VkImageLayout layout;
+	VkAccessFlags graphics_access, compute_access;
+};
+
+struct shared_resources_type {
+	std::vector<shared_buffer_type> buffers;
+	std::vector<shared_image_type> images;
+};
+
+/*
+ * Runs compute work on a queue of its own, overlapping with the work of the
+ * graphics queue:
+ *   async_compute::dispatch(scheduler, resources, { std::ref(simulate) });
+ *   // Graphics work not using particles.
+ *   async_compute::join(scheduler);
+ *   // Graphics work reading particles.
+ * A dispatch waits for the graphics work submitted before it, through a
+ * semaphore, and join makes the graphics work submitted after it wait for
+ * all dispatches since the last join. Exclusive resources used by both are
+ * transferred between the queue families with release and acquire barriers.
+ * Both queues may be the same, dispatch then submits in order.
+ */
+struct scheduler_type {
+	friend VCC_LIBRARY scheduler_type create(
+		const type::supplier<queue::queue_type> &graphics_queue,
+		const type::supplier<queue::queue_type> &compute_queue);
+	friend VCC_LIBRARY void dispatch(scheduler_type &scheduler,
+		const shared_resources_type &resources,
+		const std::vector<type::supplier<command_buffer::command_buffer_type>> &command_buffers);
+	friend VCC_LIBRARY void join(scheduler_type &scheduler);
+
+	scheduler_type() = default;
+	scheduler_type(scheduler_type &&) = default;
+	scheduler_type(const scheduler_type &) = delete;
+	scheduler_type &operator=(scheduler_type &&) = default;
+	scheduler_type &operator=(const scheduler_type &) = delete;
+
+private:
+	struct data_type {
+		type::supplier<queue::queue_type> graphics_queue, compute_queue;
+		// Semaphores waited on by the compute and the graphics queue,
+		// recycled with the flush tags of the waiting queue.
+		semaphore::pool_type compute_semaphores, graphics_semaphores;
+		internal::ownership_planner_type<const void *> planner;
+		// The resources dispatched since the last join, by key.
+		std::vector<shared_buffer_type> buffers;
+		std::vector<shared_image_type> images;
+		std::mutex mutex;
+	};
+
+	std::unique_ptr<data_type> data;
+};
+
+// Both queues must be of the same device. get_queue_families of
+// physical_device finds a dedicated compute family, if any.
+VCC_LIBRARY scheduler_type create(
+	const type::supplier<queue::queue_type> &graphics_queue,
+	const type::supplier<queue::queue_type> &compute_queue);
+
+// Submits the command buffers to the compute queue once the graphics work
+// submitted so far has completed, resources being transferred to the
+// compute family first.
+VCC_LIBRARY void dispatch(scheduler_type &scheduler,
+	const shared_resources_type &resources,
+	const std::vector<type::supplier<command_buffer::command_buffer_type>> &command_buffers);
+
+// Graphics work submitted after join waits for all dispatches before it,
+// resources being transferred back to the graphics family. Does nothing if
+// there was no dispatch since the last join. The CPU never waits.
+VCC_LIBRARY void join(scheduler_type &scheduler);
+
+}  // namespace async_compute
+}  // namespace vcc
+
+#endif /* ASYNC_COMPUTE_H_ */
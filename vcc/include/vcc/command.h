@@ -21,6 +21,9 @@
 #include <vcc/descriptor_set.h>
 #include <vcc/event.h>
 #include <vcc/input_buffer.h>
+#include <vcc/internal/barrier_coalescer.h>
+#include <vcc/internal/draw_batcher.h>
+#include <vcc/internal/state_tracker.h>
 #include <vcc/pipeline.h>
 #include <vcc/query_pool.h>
 
@@ -98,12 +101,14 @@ struct bind_index_data_buffer_type {
 	type::supplier<input_buffer::input_buffer_type> buffer;
 	VkDeviceSize offset;
 	VkIndexType indexType;
+	// Selects the version of a buffered input_buffer.
+	uint32_t frame;
 };
 
 inline bind_index_data_buffer_type bind_index_data_buffer(
 	const type::supplier<input_buffer::input_buffer_type> &buffer,
-	VkDeviceSize offset, VkIndexType indexType) {
-	return bind_index_data_buffer_type{ buffer, offset, indexType };
+	VkDeviceSize offset, VkIndexType indexType, uint32_t frame = 0) {
+	return bind_index_data_buffer_type{ buffer, offset, indexType, frame };
 }
 
 struct bind_vertex_buffers_type {
@@ -122,13 +127,16 @@ struct bind_vertex_data_buffers_type {
 	uint32_t first_binding;
 	std::vector<type::supplier<input_buffer::input_buffer_type>> buffers;
 	std::vector<VkDeviceSize> offsets;
+	// Selects the version of buffered input_buffers.
+	uint32_t frame;
 };
 
 inline bind_vertex_data_buffers_type bind_vertex_buffers(
 	uint32_t first_binding,
 	const std::vector<type::supplier<input_buffer::input_buffer_type>> &buffers,
-	const std::vector<VkDeviceSize> &offsets) {
-	return bind_vertex_data_buffers_type{ first_binding, buffers, offsets };
+	const std::vector<VkDeviceSize> &offsets, uint32_t frame = 0) {
+	return bind_vertex_data_buffers_type{ first_binding, buffers, offsets,
+		frame };
 }
 
 struct draw {
@@ -416,6 +424,23 @@ struct pipeline_barrier {
 	std::vector<image_memory_barrier> image_memory_barriers;
 };
 
+// Transitions the levels and layers of the range not yet in layout, from
+// the layouts tracked by the image, see image::transition_layout. The
+// transitions needed are merged across adjacent subresources into one
+// vkCmdPipelineBarrier, nothing is recorded if none are.
+// stageMask and accessMask are those of the next use of the range.
+// The old layouts are those left by the commands recorded before, so the
+// command buffer must be begun with
+// VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, vcc_exception is thrown
+// otherwise.
+struct transition_layout {
+	type::supplier<image::image_type> image;
+	VkImageSubresourceRange subresourceRange;
+	VkImageLayout layout;
+	VkPipelineStageFlags stageMask;
+	VkAccessFlags accessMask;
+};
+
 struct begin_query {
 	type::supplier<query_pool::query_pool_type> queryPool;
 	uint32_t entry;
@@ -492,6 +517,18 @@ struct execute_commands {
 	std::vector<type::supplier<command_buffer::command_buffer_type>> commandBuffers;
 };
 
+namespace internal {
+
+struct cmd_args;
+
+}  // namespace internal
+
+// Records the commands issued by a function, for command lists only known
+// at runtime, see parallel_recorder::record.
+struct record_type {
+	std::function<void(internal::cmd_args &)> function;
+};
+
 VCC_LIBRARY VkClearValue clear_color(const VkClearColorValue & color);
 
 VCC_LIBRARY VkClearValue clear_depth_stencil(
@@ -504,7 +541,22 @@ struct cmd_args {
 	vcc::internal::hook_container_type<queue::queue_type&>
 		pre_execute_callbacks;
 	vcc::internal::reference_container_type references;
-};
+	// Binds and dynamic state already recorded are skipped.
+	vcc::internal::state_tracker_type state;
+	// Adjacent pipeline barriers are merged into one.
+	vcc::internal::barrier_coalescer_type barriers;
+	// Collects the draw_indexed recorded within draw_batch::batch, written
+	// to the indirect commands of batch_buffer.
+	vcc::internal::draw_batcher_type batcher;
+	type::supplier<input_buffer::input_buffer_type> batch_buffer;
+	// The flags the command buffer was begun with.
+	VkCommandBufferUsageFlags usage;
+};
+
+// Returns the command buffer being recorded, after recording the barrier
+// pending in the coalescer and the draws pending in the batcher. Commands
+// get the command buffer through this just before recording into it.
+VCC_LIBRARY VkCommandBuffer get_command_buffer(cmd_args &args);
 
 VCC_LIBRARY void cmd(cmd_args &, const bind_pipeline &);
 VCC_LIBRARY void cmd(cmd_args &, const set_viewport &);
@@ -540,6 +592,7 @@ VCC_LIBRARY void cmd(cmd_args &, const set_event &);
 VCC_LIBRARY void cmd(cmd_args &, const reset_event &);
 VCC_LIBRARY void cmd(cmd_args &, const wait_events &);
 VCC_LIBRARY void cmd(cmd_args &, const pipeline_barrier &);
+VCC_LIBRARY void cmd(cmd_args &, const transition_layout &);
 VCC_LIBRARY void cmd(cmd_args &, const begin_query &);
 VCC_LIBRARY void cmd(cmd_args &, const end_query &);
 VCC_LIBRARY void cmd(cmd_args &, const reset_query_pool &);
@@ -548,6 +601,7 @@ VCC_LIBRARY void cmd(cmd_args &, const copy_query_pool_results &);
 VCC_LIBRARY void cmd(cmd_args &, const push_constants_type &);
 VCC_LIBRARY void cmd(cmd_args &, const next_subpass &);
 VCC_LIBRARY void cmd(cmd_args &, const execute_commands &);
+VCC_LIBRARY void cmd(cmd_args &, const record_type &);
 VCC_LIBRARY void cmd(cmd_args &, const bind_index_data_buffer_type&);
 VCC_LIBRARY void cmd(cmd_args &, const bind_vertex_data_buffers_type&);
 VCC_LIBRARY void cmd(cmd_args &, const draw_indirect_data_type&);
@@ -556,6 +610,12 @@ VCC_LIBRARY void cmd(cmd_args &, const dispatch_indirect_data_type&);
 VCC_LIBRARY void cmd(cmd_args &, const copy_data_buffer_type&);
 VCC_LIBRARY void cmd(cmd_args &, const copy_data_buffer_to_image_type&);
 
+// Records the final layouts of the attachments in their images, at the end
+// of a render pass.
+VCC_LIBRARY void end_attachment_layouts(
+	const render_pass::render_pass_type &render_pass,
+	const framebuffer::framebuffer_type &framebuffer);
+
 // Need C++14 to do auto argument lambdas.
 struct call_cmd_type {
 	cmd_args &args;
@@ -575,18 +635,32 @@ void cmd(cmd_args &args, render_pass_type<CommandsT...> &&render_pass) {
 	info.renderArea = render_pass.renderArea;
 	info.clearValueCount = (uint32_t)render_pass.clearValues.size();
 	info.pClearValues = render_pass.clearValues.data();
-	VKTRACE(vkCmdBeginRenderPass(
-		vcc::internal::get_instance(args.buffer.get()), &info,
+	VKTRACE(vkCmdBeginRenderPass(get_command_buffer(args), &info,
 		render_pass.contents));
 	util::tuple_foreach(call_cmd_type{ args }, render_pass.commands);
-	VKTRACE(vkCmdEndRenderPass(
-		vcc::internal::get_instance(args.buffer.get())));
+	VKTRACE(vkCmdEndRenderPass(get_command_buffer(args)));
+	end_attachment_layouts(*render_pass.renderPass, *render_pass.framebuffer);
 	args.references.add(render_pass.renderPass);
 	args.references.add(render_pass.framebuffer);
 }
 
 }  // namespace internal
 
+/*
+ * Records commands into the command buffer of a record_type function, see
+ * parallel_recorder::record and render_graph::add_pass.
+ */
+struct recording_type {
+	template<typename... CommandsT>
+	void operator()(CommandsT&&... commands) {
+		// int array guarantees order of execution with older GCC compilers.
+		const int dummy[] = { 0, (internal::cmd(args,
+			std::forward<CommandsT>(commands)), 0)... };
+	}
+
+	internal::cmd_args &args;
+};
+
 }  // namespace command
 
 namespace command_buffer {
@@ -603,10 +677,19 @@ void compile(command_buffer_type &command_buffer,
 	begin_type begin_instance(begin(std::ref(command_buffer), flags,
 		render_pass, subpass, framebuffer, occlusionQueryEnable,
 		queryFlags, pipelineStatistics));
-	command::internal::cmd_args args = { command_buffer };
+	// The previous recording is reset by begin, its hooks and references are
+	// released and their memory reused.
+	command::internal::cmd_args args = { command_buffer,
+		std::move(command_buffer.pre_execute_hook),
+		std::move(command_buffer.references) };
+	args.pre_execute_callbacks.clear();
+	args.references.clear();
+	args.usage = flags;
 	args.references.add(render_pass, framebuffer);
 	// int array guarantees order of execution with older GCC compilers.
 	const int dummy[] = { (command::internal::cmd(args, std::forward<CommandsT>(commands)), 0)... };
+	// Records the barrier still pending.
+	command::internal::get_command_buffer(args);
 	command_buffer.references = std::move(args.references);
 	command_buffer.pre_execute_hook = std::move(args.pre_execute_callbacks);
 }
@@ -619,9 +702,18 @@ void compile(command_buffer_type &command_buffer,
 		CommandsT&&... commands) {
 	begin_type begin_instance(begin(std::ref(command_buffer), flags,
 		occlusionQueryEnable, queryFlags, pipelineStatistics));
-	command::internal::cmd_args args = { command_buffer };
+	// The previous recording is reset by begin, its hooks and references are
+	// released and their memory reused.
+	command::internal::cmd_args args = { command_buffer,
+		std::move(command_buffer.pre_execute_hook),
+		std::move(command_buffer.references) };
+	args.pre_execute_callbacks.clear();
+	args.references.clear();
+	args.usage = flags;
 	// int array guarantees order of execution with older GCC compilers.
 	const int dummy[] = { (command::internal::cmd(args, std::forward<CommandsT>(commands)), 0)... };
+	// Records the barrier still pending.
+	command::internal::get_command_buffer(args);
 	command_buffer.references = std::move(args.references);
 	command_buffer.pre_execute_hook = std::move(args.pre_execute_callbacks);
 }
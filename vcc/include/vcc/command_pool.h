@@ -44,6 +44,11 @@ VCC_LIBRARY command_pool_type create(
 	const type::supplier<device::device_type> &device,
 	VkCommandPoolCreateFlags flags, uint32_t queueFamilyIndex);
 
+// Returns all command buffers allocated from the pool to the initial state.
+// None of them may be pending execution.
+VCC_LIBRARY void reset(command_pool_type &command_pool,
+	VkCommandPoolResetFlags flags);
+
 }  // namespace command_pool
 }  // namespace vcc
 
@@ -17,6 +17,7 @@
 #define DESCRIPTOR_SET_H_
 
 #include <algorithm>
+#include <unordered_map>
 #include <vcc/buffer.h>
 #include <vcc/buffer_view.h>
 #include <vcc/device.h>
@@ -45,7 +46,9 @@ struct descriptor_set_type
 		: internal::movable_allocated_with_pool_parent2<VkDescriptorSet,
 			device::device_type, descriptor_pool::descriptor_pool_type,
 			vkFreeDescriptorSets>(std::forward<descriptor_set_type>(copy)),
-		  pre_execute_callbacks(std::move(copy.pre_execute_callbacks)) {}
+		  pre_execute_callbacks(std::move(copy.pre_execute_callbacks)),
+		  references(std::move(copy.references)),
+		  buffer_writes(std::move(copy.buffer_writes)) {}
 	descriptor_set_type &operator=(const descriptor_set_type&) = delete;
 	descriptor_set_type(VkDescriptorSet instance,
 		const type::supplier<descriptor_pool::descriptor_pool_type> &pool,
@@ -59,6 +62,16 @@ struct descriptor_set_type
 	internal::reference_map_type<std::pair<uint32_t, uint32_t>,
 		util::hash_pair<uint32_t, uint32_t>> references;
 
+	// The buffer descriptors as written, to detect buffers whose VkBuffer
+	// was replaced, see memory_pool::defragment.
+	struct buffer_write_type {
+		VkDescriptorType descriptor_type;
+		type::supplier<buffer::buffer_type> buffer;
+		VkBuffer instance;
+		VkDeviceSize offset, range;
+	};
+	std::unordered_map<std::pair<uint32_t, uint32_t>, buffer_write_type,
+		util::hash_pair<uint32_t, uint32_t>> buffer_writes;
 };
 
 VCC_LIBRARY std::vector<descriptor_set_type> create(
@@ -95,13 +108,19 @@ inline buffer_info_type buffer_info(
 struct buffer_info_data_type {
 	type::supplier<input_buffer::input_buffer_type> buffer;
 	VkDeviceSize offset, range;
+	// Selects the version of a buffered input_buffer.
+	uint32_t frame;
 };
 
 VCC_LIBRARY buffer_info_data_type buffer_info(
 	const type::supplier<input_buffer::input_buffer_type> &buffer,
-	VkDeviceSize offset, VkDeviceSize range);
+	VkDeviceSize offset, VkDeviceSize range, uint32_t frame = 0);
 VCC_LIBRARY buffer_info_data_type buffer_info(
 	const type::supplier<input_buffer::input_buffer_type> &buffer);
+// Describes the version of the given frame, see input_buffer::create_buffered.
+VCC_LIBRARY buffer_info_data_type buffer_info(
+	const type::supplier<input_buffer::input_buffer_type> &buffer,
+	uint32_t frame);
 
 struct write_image {
 	descriptor_set_type &dst_set;
@@ -224,6 +243,13 @@ void update(device::device_type &device, const ArgsT &... args) {
 		(uint32_t)storage.copy_sets.size(), storage.copy_sets.data()));
 }
 
+// Rewrites the buffer descriptors of the set whose buffer was given a new
+// VkBuffer since written, for example by memory_pool::defragment.
+// Returns true if any descriptor was rewritten, command buffers binding the
+// set must then be recorded again.
+VCC_LIBRARY bool refresh(device::device_type &device,
+	descriptor_set_type &set);
+
 }  // namespace descriptor_set
 }  // namespace vcc
 
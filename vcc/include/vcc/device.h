@@ -16,6 +16,7 @@
 #ifndef DEVICE_H_
 #define DEVICE_H_
 
+#include <vcc/internal/memory_statistics.h>
 #include <vcc/internal/raii.h>
 #include <vcc/util.h>
 
@@ -35,6 +36,10 @@ struct device_type
 		const std::set<std::string> &extensions,
 		const VkPhysicalDeviceFeatures &features);
 	friend VkPhysicalDevice get_physical_device(const device_type &device);
+	friend const std::shared_ptr<internal::memory_statistics_type> &
+		get_memory_statistics(const device_type &device);
+	friend const VkPhysicalDeviceFeatures &get_enabled_features(
+		const device_type &device);
 
 	device_type() = default;
 	device_type(const device_type&) = delete;
@@ -43,11 +48,19 @@ struct device_type
 	device_type &operator=(device_type&&copy) = default;
 
 private:
-	device_type(VkDevice device, VkPhysicalDevice physical_device)
+	device_type(VkDevice device, VkPhysicalDevice physical_device,
+		const std::shared_ptr<internal::memory_statistics_type> &memory_statistics,
+		const VkPhysicalDeviceFeatures &enabled_features)
 		: internal::movable_destructible<VkDevice, vkDestroyDevice>(device),
-		  physical_device(physical_device) {}
+		  physical_device(physical_device),
+		  memory_statistics(memory_statistics),
+		  enabled_features(enabled_features) {}
 
 	internal::handle_type<VkPhysicalDevice> physical_device;
+	// Shared with the memory allocated from this device.
+	std::shared_ptr<internal::memory_statistics_type> memory_statistics;
+	// As given to create.
+	VkPhysicalDeviceFeatures enabled_features = {};
 };
 
 VCC_LIBRARY device_type create(VkPhysicalDevice physical_device,
@@ -62,6 +75,17 @@ inline VkPhysicalDevice get_physical_device(const device_type &device) {
 	return device.physical_device;
 }
 
+inline const std::shared_ptr<internal::memory_statistics_type> &
+		get_memory_statistics(const device_type &device) {
+	return device.memory_statistics;
+}
+
+// The features enabled when the device was created.
+inline const VkPhysicalDeviceFeatures &get_enabled_features(
+		const device_type &device) {
+	return device.enabled_features;
+}
+
 }  // namespace device
 }  // namespace vcc
 
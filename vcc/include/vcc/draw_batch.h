@@ -0,0 +1,118 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef DRAW_BATCH_H_
+#define DRAW_BATCH_H_
+
+#include <type/storage.h>
+#include <vcc/command.h>
+
+namespace vcc {
+namespace draw_batch {
+
+struct draw_batch_type;
+
+namespace internal {
+
+VCC_LIBRARY void begin(command::internal::cmd_args &args,
+	draw_batch_type &batch, uint32_t frame);
+VCC_LIBRARY void end(command::internal::cmd_args &args,
+	draw_batch_type &batch, uint32_t frame);
+
+}  // namespace internal
+
+/*
+ * Merges runs of draw_indexed recorded without any other command in
+ * between, typically draws sharing the pipeline, descriptor sets and vertex
+ * buffers whose repeated binds are skipped, into one
+ * vkCmdDrawIndexedIndirect per run.
+ * The parameters of the draws are written to an indirect buffer holding
+ * max_draws commands per frame, draws beyond that are recorded as usual.
+ * Without the multiDrawIndirect feature enabled on the device, every draw
+ * is recorded as usual, and so are draws with a firstInstance without the
+ * drawIndirectFirstInstance feature. Batching the same frame again within
+ * one recording appends to its indirect commands.
+ *
+ * A batch must not be used by two recordings of the same frame at once,
+ * including on different threads.
+ */
+struct draw_batch_type {
+	friend VCC_LIBRARY draw_batch_type create(
+		const type::supplier<device::device_type> &device,
+		uint32_t max_draws, uint32_t frames);
+	friend VCC_LIBRARY void internal::begin(
+		command::internal::cmd_args &args, draw_batch_type &batch,
+		uint32_t frame);
+	friend VCC_LIBRARY void internal::end(
+		command::internal::cmd_args &args, draw_batch_type &batch,
+		uint32_t frame);
+
+	draw_batch_type() = default;
+	draw_batch_type(const draw_batch_type &) = delete;
+	draw_batch_type(draw_batch_type &&) = default;
+	draw_batch_type &operator=(const draw_batch_type &) = delete;
+	draw_batch_type &operator=(draw_batch_type &&) = default;
+
+private:
+	typedef type::t_array<VkDrawIndexedIndirectCommand> commands_type;
+
+	struct frame_type {
+		std::shared_ptr<commands_type> commands;
+		std::shared_ptr<input_buffer::input_buffer_type> buffer;
+	};
+
+	draw_batch_type(uint32_t max_draws, uint32_t max_draw_indirect_count,
+		bool first_instance, std::vector<frame_type> &&frames)
+		: max_draws(max_draws),
+		  max_draw_indirect_count(max_draw_indirect_count),
+		  first_instance(first_instance),
+		  frames(std::forward<std::vector<frame_type>>(frames)) {}
+
+	uint32_t max_draws = 0, max_draw_indirect_count = 0;
+	// drawIndirectFirstInstance is enabled.
+	bool first_instance = false;
+	// Empty without multiDrawIndirect.
+	std::vector<frame_type> frames;
+};
+
+// Creates a batch of max_draws indirect commands for each of frames
+// command buffers in flight, in host visible memory.
+VCC_LIBRARY draw_batch_type create(
+	const type::supplier<device::device_type> &device, uint32_t max_draws,
+	uint32_t frames);
+
+// Returns a command recording the given commands with their draw_indexed
+// batched into the indirect buffer of the frame. The indirect commands
+// are uploaded before the command buffer is submitted.
+template<typename... CommandsT>
+command::record_type batch(const type::supplier<draw_batch_type> &batch,
+		uint32_t frame, CommandsT&&... commands) {
+	const std::shared_ptr<std::tuple<typename std::decay<CommandsT>::type...>>
+		tuple(std::make_shared<
+			std::tuple<typename std::decay<CommandsT>::type...>>(
+				std::forward<CommandsT>(commands)...));
+	return command::record_type{
+		[batch, frame, tuple](command::internal::cmd_args &args) {
+			internal::begin(args, *batch, frame);
+			util::tuple_foreach(command::internal::call_cmd_type{ args },
+				*tuple);
+			internal::end(args, *batch, frame);
+		} };
+}
+
+}  // namespace draw_batch
+}  // namespace vcc
+
+#endif /* DRAW_BATCH_H_ */
@@ -0,0 +1,124 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef DRAW_LIST_H_
+#define DRAW_LIST_H_
+
+#include <algorithm>
+#include <vcc/command.h>
+#include <vcc/internal/radix_sort.h>
+
+namespace vcc {
+namespace draw_list {
+
+// Packs the state of a draw into a sort key, most significant first.
+// The ids are assigned by the application, draws sorted by key bind every
+// pipeline once and keep draws sharing descriptor sets and vertex buffers
+// together, ordered by depth last.
+inline uint64_t sort_key(uint16_t pipeline, uint16_t descriptor_sets,
+		uint16_t vertex_buffers, uint16_t depth) {
+	return uint64_t(pipeline) << 48 | uint64_t(descriptor_sets) << 32
+		| uint64_t(vertex_buffers) << 16 | depth;
+}
+
+// Quantizes depth in [near_depth, far_depth] for sort_key, nearest first.
+// Transparent draws ordered back to front use 0xffff minus the result.
+inline uint16_t depth_key(float depth, float near_depth, float far_depth) {
+	const float normalized((depth - near_depth) / (far_depth - near_depth));
+	return uint16_t(std::min(std::max(normalized, 0.f), 1.f) * 0xffff);
+}
+
+/*
+ * Draws added in any order and recorded ordered by their sort keys.
+ * Each draw is the tuple of commands CommandsT, for example a bind_pipeline,
+ * bind_descriptor_sets, bind_vertex_buffers and draw_indexed. Recorded in
+ * order, binds repeated by consecutive draws are skipped by the command
+ * buffer's state tracking.
+ *
+ * A list is meant to be cleared and filled again every frame, its memory
+ * is reused.
+ */
+template<typename... CommandsT>
+struct draw_list_type {
+	template<typename... T>
+	friend void add(draw_list_type<T...> &list, uint64_t key, T... commands);
+	template<typename... T>
+	friend void clear(draw_list_type<T...> &list);
+	template<typename... T>
+	friend std::size_t size(const draw_list_type<T...> &list);
+	template<typename... T>
+	friend void sort(draw_list_type<T...> &list);
+	template<typename... T>
+	friend command::record_type record(draw_list_type<T...> &list);
+
+	// threads is the number of threads sorting, including the caller.
+	explicit draw_list_type(std::size_t threads = 1)
+		: thread_pool(threads > 1
+			? new vcc::internal::thread_pool_type(threads - 1) : nullptr) {}
+	draw_list_type(const draw_list_type &) = delete;
+	draw_list_type(draw_list_type &&) = default;
+	draw_list_type &operator=(const draw_list_type &) = delete;
+	draw_list_type &operator=(draw_list_type &&) = default;
+
+private:
+	std::vector<vcc::internal::sort_item_type> items, scratch;
+	// Indexed by the items, in order of addition.
+	std::vector<std::tuple<CommandsT...>> draws;
+	std::unique_ptr<vcc::internal::thread_pool_type> thread_pool;
+};
+
+template<typename... CommandsT>
+void add(draw_list_type<CommandsT...> &list, uint64_t key,
+		CommandsT... commands) {
+	list.items.push_back(vcc::internal::sort_item_type{ key,
+		uint32_t(list.draws.size()) });
+	list.draws.emplace_back(std::move(commands)...);
+}
+
+template<typename... CommandsT>
+void clear(draw_list_type<CommandsT...> &list) {
+	list.items.clear();
+	list.draws.clear();
+}
+
+template<typename... CommandsT>
+std::size_t size(const draw_list_type<CommandsT...> &list) {
+	return list.items.size();
+}
+
+// Orders the draws by key, draws with equal keys stay in order of addition.
+template<typename... CommandsT>
+void sort(draw_list_type<CommandsT...> &list) {
+	vcc::internal::radix_sort(list.items, list.scratch,
+		list.thread_pool.get());
+}
+
+// Returns a command recording the draws in their current order, usually
+// after sort. The list must not change until the command is recorded.
+template<typename... CommandsT>
+command::record_type record(draw_list_type<CommandsT...> &list) {
+	return command::record_type{
+		[&list](command::internal::cmd_args &args) {
+			for (const vcc::internal::sort_item_type &item : list.items) {
+				util::tuple_foreach(command::internal::call_cmd_type{ args },
+					list.draws[item.index]);
+			}
+		} };
+}
+
+}  // namespace draw_list
+}  // namespace vcc
+
+#endif /* DRAW_LIST_H_ */
@@ -17,8 +17,9 @@
 #define FENCE_H_
 
 #include <chrono>
+#include <memory>
 #include <vcc/device.h>
-#include <vcc/fence.h>
+#include <vcc/internal/sync_pool.h>
 
 namespace vcc {
 namespace fence {
@@ -54,6 +55,49 @@ VCC_LIBRARY VkResult wait(device::device_type &device,
 VCC_LIBRARY void reset(device::device_type &device,
 	const std::vector<type::supplier<fence_type>> &fences);
 
+/*
+ * Fences of a device handed out unsignaled and given back once signaled, or
+ * never submitted, instead of being destroyed. Those given back are reset
+ * with a single vkResetFences when the pool runs out of reset fences.
+ */
+struct pool_type {
+	friend VCC_LIBRARY pool_type create_pool(
+		const type::supplier<device::device_type> &device);
+	friend VCC_LIBRARY fence_type acquire(pool_type &pool);
+	friend VCC_LIBRARY void release(pool_type &pool, fence_type &&fence);
+	friend VCC_LIBRARY uint64_t get_created_count(const pool_type &pool);
+
+	pool_type() = default;
+	pool_type(pool_type &&) = default;
+	pool_type(const pool_type &) = delete;
+	pool_type &operator=(pool_type &&) = default;
+	pool_type &operator=(const pool_type &) = delete;
+
+	explicit operator bool() const {
+		return !!data;
+	}
+
+private:
+	struct data_type {
+		type::supplier<device::device_type> device;
+		std::mutex mutex;
+		internal::sync_pool_type<fence_type> fences;
+		uint64_t created;
+	};
+
+	std::unique_ptr<data_type> data;
+};
+
+VCC_LIBRARY pool_type create_pool(
+	const type::supplier<device::device_type> &device);
+
+// Returns an unsignaled fence, created if the pool has none.
+VCC_LIBRARY fence_type acquire(pool_type &pool);
+VCC_LIBRARY void release(pool_type &pool, fence_type &&fence);
+
+// Number of fences created by acquire.
+VCC_LIBRARY uint64_t get_created_count(const pool_type &pool);
+
 }  // namespace fence
 }  // namespace vcc
 
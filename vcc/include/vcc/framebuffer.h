@@ -31,6 +31,8 @@ struct framebuffer_type
 		const type::supplier<render_pass::render_pass_type> &render_pass,
 		const std::vector<type::supplier<image_view::image_view_type>> &image_views,
 		VkExtent2D extent, uint32_t layers);
+	friend const std::vector<type::supplier<image_view::image_view_type>>
+		&get_image_views(const framebuffer_type &framebuffer);
 
 	framebuffer_type() = default;
 	framebuffer_type(framebuffer_type &&) = default;
@@ -50,6 +52,11 @@ private:
 	std::vector<type::supplier<image_view::image_view_type>> image_views;
 };
 
+inline const std::vector<type::supplier<image_view::image_view_type>>
+		&get_image_views(const framebuffer_type &framebuffer) {
+	return framebuffer.image_views;
+}
+
 VCC_LIBRARY framebuffer_type create(
 	const type::supplier<device::device_type> &device,
 	const type::supplier<render_pass::render_pass_type> &render_pass,
@@ -16,7 +16,9 @@
 #ifndef IMAGE_H_
 #define IMAGE_H_
 
+#include <mutex>
 #include <vcc/device.h>
+#include <vcc/internal/layout_tracker.h>
 
 namespace vcc {
 namespace image {
@@ -52,6 +54,15 @@ struct image_type
 	friend VkFormat get_format(const image_type &image);
 	friend uint32_t get_mip_levels(const image_type &image);
 	friend uint32_t get_array_layers(const image_type &image);
+	friend VCC_LIBRARY void set_layout(image_type &image,
+		const VkImageSubresourceRange &range, VkImageLayout layout,
+		VkPipelineStageFlags stages, VkAccessFlags access);
+	friend VCC_LIBRARY VkImageLayout get_layout(const image_type &image,
+		uint32_t level, uint32_t layer);
+	friend VCC_LIBRARY std::vector<vcc::internal::layout_transition_type>
+		transition_layout(image_type &image,
+			const VkImageSubresourceRange &range, VkImageLayout layout,
+			VkPipelineStageFlags stages, VkAccessFlags access);
 
 	image_type() = default;
 	image_type(const image_type&) = delete;
@@ -62,16 +73,27 @@ struct image_type
 private:
 	image_type(VkImage instance, const type::supplier<device::device_type> &parent,
 		bool destructible, VkImageType type, VkFormat format, uint32_t mipLevels,
-		uint32_t arrayLayers)
+		uint32_t arrayLayers, VkImageLayout initialLayout)
 		:  internal::movable_conditional_destructible_with_parent_and_memory<
 			VkImage, device::device_type, memory::memory_type, vkDestroyImage>(
 			instance, parent, destructible),
 		  type(type), format(format), mipLevels(mipLevels),
-		  arrayLayers(arrayLayers) {}
+		  arrayLayers(arrayLayers),
+		  layouts(new layouts_type(mipLevels, arrayLayers, initialLayout)) {}
+
+	// Recorded from several threads at once, see parallel_recorder.
+	struct layouts_type {
+		layouts_type(uint32_t levels, uint32_t layers, VkImageLayout layout)
+			: tracker(levels, layers, layout) {}
+
+		std::mutex mutex;
+		vcc::internal::layout_tracker_type tracker;
+	};
 
 	VkImageType type;
 	VkFormat format;
 	uint32_t mipLevels, arrayLayers;
+	std::unique_ptr<layouts_type> layouts;
 };
 
 VCC_LIBRARY image_type create(
@@ -82,6 +104,20 @@ VCC_LIBRARY image_type create(
 	VkSharingMode sharingMode, const std::vector<uint32_t> &queueFamilyIndices,
 	VkImageLayout initialLayout);
 
+// Creates a 2D attachment whose content is not needed outside the render
+// pass, such as a depth buffer or a multisampled color target resolved in
+// the pass, and binds it to memory.
+// The image is created with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT in
+// lazily allocated memory when the device has such a memory type, tiled
+// GPUs then never back it with memory, otherwise in device local memory.
+// usage must only contain attachment usages, the attachment should be
+// cleared or not loaded and not stored, see
+// render_pass::transient_attachment_description.
+VCC_LIBRARY image_type create_transient_attachment(
+	const type::supplier<device::device_type> &device, VkFormat format,
+	const VkExtent2D &extent, VkSampleCountFlagBits samples,
+	VkImageUsageFlags usage);
+
 inline VkImageType get_type(const image_type &image) {
 	return image.type;
 }
@@ -98,6 +134,36 @@ inline uint32_t get_array_layers(const image_type &image) {
 	return image.arrayLayers;
 }
 
+/*
+ * Every level and layer of an image remembers its layout and the stages
+ * and access last using it, as left by the barriers and render passes
+ * recorded so far. Command buffers are assumed to execute in the order they
+ * are recorded in. Aspects are not tracked separately.
+ * This does not hold for command buffers recorded once and submitted many
+ * times, e.g. one per swapchain image: a barrier inferred from the tracked
+ * layouts would name the old layout of the first submit on every later one,
+ * a validation error and undefined contents. command::transition_layout is
+ * therefore only accepted in one time submit command buffers. Reusable
+ * command buffers use explicit pipeline barriers; recording them still
+ * updates the tracked state, as if they executed at that point.
+ */
+
+// Records the state left by a barrier or render pass.
+VCC_LIBRARY void set_layout(image_type &image,
+	const VkImageSubresourceRange &range, VkImageLayout layout,
+	VkPipelineStageFlags stages, VkAccessFlags access);
+
+VCC_LIBRARY VkImageLayout get_layout(const image_type &image, uint32_t level,
+	uint32_t layer);
+
+// Returns the transitions needed before using the range in layout with the
+// given stages and access, merged across adjacent levels and layers, and
+// records the new state. See command::transition_layout.
+VCC_LIBRARY std::vector<vcc::internal::layout_transition_type>
+	transition_layout(image_type &image, const VkImageSubresourceRange &range,
+		VkImageLayout layout, VkPipelineStageFlags stages,
+		VkAccessFlags access);
+
 VCC_LIBRARY VkSubresourceLayout get_subresource_layout(image_type &image,
 	const VkImageSubresource &subresource);
 
@@ -34,6 +34,10 @@ struct image_view_type
 	friend VCC_LIBRARY image_view_type create(
 		const type::supplier<image::image_type> &image,
 		const VkImageSubresourceRange &subresourceRange);
+	friend const type::supplier<image::image_type> &get_image(
+		const image_view_type &image_view);
+	friend const VkImageSubresourceRange &get_subresource_range(
+		const image_view_type &image_view);
 
 	image_view_type() = default;
 	image_view_type(const image_view_type &) = delete;
@@ -44,13 +48,25 @@ struct image_view_type
 private:
 	image_view_type(VkImageView instance,
 		const type::supplier<device::device_type> &parent,
-		const type::supplier<image::image_type> &image)
+		const type::supplier<image::image_type> &image,
+		const VkImageSubresourceRange &subresourceRange)
 		: internal::movable_destructible_with_parent<VkImageView,
 		device::device_type, vkDestroyImageView>(instance, parent),
-		image(image) {}
+		image(image), subresourceRange(subresourceRange) {}
 	type::supplier<image::image_type> image;
+	VkImageSubresourceRange subresourceRange;
 };
 
+inline const type::supplier<image::image_type> &get_image(
+		const image_view_type &image_view) {
+	return image_view.image;
+}
+
+inline const VkImageSubresourceRange &get_subresource_range(
+		const image_view_type &image_view) {
+	return image_view.subresourceRange;
+}
+
 VCC_LIBRARY image_view_type create(
 	const type::supplier<image::image_type> &image,
 	VkImageViewType viewType, VkFormat format,
@@ -16,8 +16,10 @@
 #ifndef INPUT_BUFFER_H_
 #define INPUT_BUFFER_H_
 
+#include <string>
 #include <type/serialize.h>
 #include <vcc/buffer.h>
+#include <vcc/internal/version_tracker.h>
 
 namespace vcc {
 
@@ -45,6 +47,16 @@ auto get_serialize(T &value)->decltype(value.serialize)& {
 	return value.serialize;
 }
 
+template<typename T>
+auto get_shadow(T &value)->decltype(value.shadow)& {
+	return value.shadow;
+}
+
+template<typename T>
+auto get_versions(const T &value)->const decltype(value.versions)& {
+	return value.versions;
+}
+
 template<typename T>
 auto get_buffer(const T &value)->const decltype(value.buffer)& {
 	return value.buffer;
@@ -55,6 +67,12 @@ auto get_serialize(const T &value)->const decltype(value.serialize)& {
 	return value.serialize;
 }
 
+// Distance between the versions of a buffered input_buffer of the given
+// size, aligned to the offset requirements of the usage.
+VCC_LIBRARY VkDeviceSize frame_stride(
+	const type::supplier<device::device_type> &device,
+	VkBufferUsageFlags usage, VkDeviceSize size);
+
 }  // namespace internal
 
 /**
@@ -75,9 +93,30 @@ class input_buffer_type {
 		VkSharingMode sharingMode,
 		const std::vector<uint32_t> &queueFamilyIndices,
 		StorageType... storages);
+	template<typename... StorageType>
+	friend input_buffer_type create_staged(type::memory_layout layout,
+		const type::supplier<device::device_type> &device,
+		VkBufferCreateFlags flags,
+		VkBufferUsageFlags usage,
+		VkSharingMode sharingMode,
+		const std::vector<uint32_t> &queueFamilyIndices,
+		StorageType... storages);
+	template<typename... StorageType>
+	friend input_buffer_type create_buffered(uint32_t frames,
+		type::memory_layout layout,
+		const type::supplier<device::device_type> &device,
+		VkBufferCreateFlags flags,
+		VkBufferUsageFlags usage,
+		VkSharingMode sharingMode,
+		const std::vector<uint32_t> &queueFamilyIndices,
+		StorageType... storages);
 	friend VCC_LIBRARY bool flush(input_buffer_type &buffer);
 	friend VCC_LIBRARY bool flush(queue::queue_type &queue,
-		input_buffer_type &buffer);
+		input_buffer_type &buffer, uint32_t frame);
+	friend VCC_LIBRARY VkDeviceSize frame_offset(
+		const input_buffer_type &buffer, uint32_t frame);
+	friend VCC_LIBRARY void set_update_threshold(input_buffer_type &buffer,
+		VkDeviceSize threshold);
 	template<typename U>
 	friend auto internal::get_mutex(const U &value)->decltype(value.mutex)&;
 	template<typename U>
@@ -85,6 +124,10 @@ class input_buffer_type {
 	template<typename U>
 	friend auto internal::get_serialize(U &value)->decltype(value.serialize)&;
 	template<typename U>
+	friend auto internal::get_shadow(U &value)->decltype(value.shadow)&;
+	template<typename U>
+	friend auto internal::get_versions(const U &value)->const decltype(value.versions)&;
+	template<typename U>
 	friend auto internal::get_buffer(const U &value)->const decltype(value.buffer)&;
 	template<typename U>
 	friend auto internal::get_serialize(const U &value)->const decltype(value.serialize)&;
@@ -94,7 +137,12 @@ public:
 	input_buffer_type(input_buffer_type &&copy) {
 		std::unique_lock<std::mutex> lock(copy.mutex);
 		serialize = std::move(copy.serialize);
+		stride = copy.stride;
 		buffer = std::move(copy.buffer);
+		versions = std::move(copy.versions);
+		shadow = std::move(copy.shadow);
+		update_threshold = copy.update_threshold;
+		staged = copy.staged;
 	}
 	input_buffer_type &operator=(const input_buffer_type&) = delete;
 	input_buffer_type &operator=(input_buffer_type &&copy) {
@@ -102,13 +150,19 @@ public:
 		std::unique_lock<std::mutex> lock(mutex, std::adopt_lock);
 		std::unique_lock<std::mutex> copy_lock(copy.mutex, std::adopt_lock);
 		serialize = std::move(copy.serialize);
+		stride = copy.stride;
 		buffer = std::move(copy.buffer);
+		versions = std::move(copy.versions);
+		shadow = std::move(copy.shadow);
+		update_threshold = copy.update_threshold;
+		staged = copy.staged;
 		return *this;
 	}
 
 private:
 	template<typename... StorageType>
-	input_buffer_type(type::memory_layout layout,
+	input_buffer_type(bool staged, uint32_t frames,
+		type::memory_layout layout,
 		const type::supplier<device::device_type> &device,
 		VkBufferCreateFlags flags,
 		VkBufferUsageFlags usage,
@@ -117,12 +171,31 @@ private:
 		StorageType... storages)
 		: serialize(type::make_serialize(layout,
 			std::forward<StorageType>(storages)...)),
+		  stride(frames > 1
+			  ? internal::frame_stride(device, usage, type::size(serialize))
+			  : type::size(serialize)),
 		  buffer(std::forward<buffer::buffer_type>(
-			  buffer::create(device, flags, type::size(serialize), usage,
-				  sharingMode, queueFamilyIndices))) {}
+			  buffer::create(device, flags, stride * frames, usage,
+				  sharingMode, queueFamilyIndices))),
+		  versions(frames),
+		  shadow(frames > 1 ? type::size(serialize) : 0, '\0'),
+		  update_threshold(staged ? 65536 : 0),
+		  staged(staged) {}
 
 	type::serialize_type serialize;
+	// Distance between the versions in the buffer.
+	VkDeviceSize stride = 0;
 	buffer::buffer_type buffer;
+	// One version per frame in flight, see create_buffered.
+	vcc::internal::version_tracker_type versions;
+	// The latest content of buffered, staged or inline updated
+	// input_buffers, copied into the buffer as it is used.
+	std::string shadow;
+	// Dirty ranges up to this size are recorded with vkCmdUpdateBuffer.
+	VkDeviceSize update_threshold = 0;
+	// Content is uploaded through the staging buffer of the queue instead of
+	// mapping the memory of the buffer.
+	bool staged = false;
 	mutable std::mutex mutex;
 };
 
@@ -138,16 +211,84 @@ input_buffer_type create(type::memory_layout layout,
 		VkSharingMode sharingMode,
 		const std::vector<uint32_t> &queueFamilyIndices,
 		StorageType... storages) {
-	return input_buffer_type(layout, device, flags, usage, sharingMode, queueFamilyIndices,
+	return input_buffer_type(false, 1, layout, device, flags, usage, sharingMode,
+			queueFamilyIndices, std::forward<StorageType>(storages)...);
+}
+
+/*
+ * Creates a buffer_type containing the given data, meant to be bound to
+ * device local memory.
+ * The content is uploaded through the staging buffer of the queue the buffer
+ * is flushed on, see queue::set_staging_buffer.
+ * Notice: The buffer must be bound to memory before usage.
+ */
+template<typename... StorageType>
+input_buffer_type create_staged(type::memory_layout layout,
+		const type::supplier<device::device_type> &device,
+		VkBufferCreateFlags flags,
+		VkBufferUsageFlags usage,
+		VkSharingMode sharingMode,
+		const std::vector<uint32_t> &queueFamilyIndices,
+		StorageType... storages) {
+	return input_buffer_type(true, 1, layout, device, flags,
+			usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sharingMode,
+			queueFamilyIndices, std::forward<StorageType>(storages)...);
+}
+
+/*
+ * Creates a buffer_type holding one version of the given data per frame in
+ * flight, for content rewritten every frame while the GPU may still read
+ * the previous frames.
+ * Commands and descriptor writes select the version with their frame
+ * argument, typically the index given to the draw callback of window::run
+ * when one command buffer is compiled per swapchain image.
+ * A version is only written once the submit that last read it on the same
+ * queue has finished, so with as many frames as command buffers in flight
+ * a flush never blocks.
+ * Notice: The buffer must be bound to host visible memory before usage.
+ */
+template<typename... StorageType>
+input_buffer_type create_buffered(uint32_t frames,
+		type::memory_layout layout,
+		const type::supplier<device::device_type> &device,
+		VkBufferCreateFlags flags,
+		VkBufferUsageFlags usage,
+		VkSharingMode sharingMode,
+		const std::vector<uint32_t> &queueFamilyIndices,
+		StorageType... storages) {
+	if (!frames) {
+		throw vcc_exception("Buffered input_buffer needs at least one frame");
+	}
+	return input_buffer_type(false, frames, layout, device, flags, usage,
+			sharingMode, queueFamilyIndices,
 			std::forward<StorageType>(storages)...);
 }
 
 // Flushes content of the buffer to the GPU if there is data with an old revision.
+// Not valid for staged or buffered input_buffers, which must be flushed on a queue.
 VCC_LIBRARY bool flush(input_buffer_type &buffer);
 
 // Flushes content of the buffer to the GPU if there is data with an old revision.
-// A memory barrier is pushed on the queue.
-VCC_LIBRARY bool flush(queue::queue_type &queue, input_buffer_type &buffer);
+// Staged content is copied by the next submit on the queue, never blocks
+// unless the staging buffer is full.
+// For buffered input_buffers, the version of the given frame is written.
+VCC_LIBRARY bool flush(queue::queue_type &queue, input_buffer_type &buffer,
+	uint32_t frame = 0);
+
+// Dirty ranges of up to threshold bytes are recorded inline into the next
+// submit with vkCmdUpdateBuffer when flushed on a queue, instead of going
+// through mapped memory or the staging buffer. The threshold is capped at
+// 65536 bytes, 0 disables inline updates. Defaults to 65536 for staged
+// input_buffers and 0 otherwise.
+// The buffer must have been created with VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+// Has no effect on buffered input_buffers.
+VCC_LIBRARY void set_update_threshold(input_buffer_type &buffer,
+	VkDeviceSize threshold);
+
+// Offset of the version of the given frame within the buffer, for example
+// as dynamic offset of a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC.
+VCC_LIBRARY VkDeviceSize frame_offset(const input_buffer_type &buffer,
+	uint32_t frame);
 
 }  // namespace input_buffer
 }  // namespace vcc
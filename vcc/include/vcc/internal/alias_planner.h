@@ -0,0 +1,138 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_ALIAS_PLANNER_H_
+#define _VCC_INTERNAL_ALIAS_PLANNER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+// A transient resource, used by the steps [first, last] of a graph_plan_type.
+struct alias_request_type {
+	VkDeviceSize size, alignment;
+	// Resources only alias others of the same heap, typically the memory
+	// type index.
+	uint32_t heap;
+	bool used;
+	std::size_t first, last;
+};
+
+struct alias_plan_type {
+	// Offset of each request in the memory of its heap.
+	std::vector<VkDeviceSize> offsets;
+	// Size of the memory of each heap, indexed by heap.
+	std::vector<VkDeviceSize> heap_sizes;
+	// For each request, the requests whose memory it reuses. Their last
+	// use must complete before its first use.
+	std::vector<std::vector<std::size_t>> aliased;
+};
+
+namespace alias_planner {
+
+inline bool lifetimes_overlap(const alias_request_type &a,
+		const alias_request_type &b) {
+	return a.used && b.used && a.first <= b.last && b.first <= a.last;
+}
+
+inline VkDeviceSize align(VkDeviceSize offset, VkDeviceSize alignment) {
+	return alignment > 1
+		? (offset + alignment - 1) / alignment * alignment : offset;
+}
+
+}  // namespace alias_planner
+
+/*
+ * Places transient resources in as little memory as possible, resources
+ * used by overlapping ranges of steps never share memory.
+ * Resources are placed largest first, each at the lowest aligned offset
+ * not overlapping the memory of a resource placed before it whose lifetime
+ * overlaps. Unused resources are placed at offset 0 and alias nothing.
+ */
+inline alias_plan_type plan_aliasing(
+		const std::vector<alias_request_type> &requests) {
+	alias_plan_type plan;
+	plan.offsets.resize(requests.size());
+	plan.aliased.resize(requests.size());
+	std::vector<std::size_t> order;
+	order.reserve(requests.size());
+	for (std::size_t i = 0; i < requests.size(); ++i) {
+		const alias_request_type &request(requests[i]);
+		if (request.heap >= plan.heap_sizes.size()) {
+			plan.heap_sizes.resize(request.heap + 1);
+		}
+		if (request.used) {
+			order.push_back(i);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[&requests](std::size_t a, std::size_t b) {
+		return requests[a].size > requests[b].size;
+	});
+
+	typedef std::pair<VkDeviceSize, VkDeviceSize> range_type;
+	std::vector<std::size_t> placed;
+	std::vector<range_type> conflicts;
+	for (std::size_t index : order) {
+		const alias_request_type &request(requests[index]);
+		conflicts.clear();
+		for (std::size_t other : placed) {
+			if (requests[other].heap == request.heap
+					&& alias_planner::lifetimes_overlap(request,
+						requests[other])) {
+				conflicts.push_back(range_type(plan.offsets[other],
+					plan.offsets[other] + requests[other].size));
+			}
+		}
+		std::sort(conflicts.begin(), conflicts.end());
+		VkDeviceSize offset(0);
+		for (const range_type &conflict : conflicts) {
+			offset = alias_planner::align(offset, request.alignment);
+			if (offset + request.size <= conflict.first) {
+				break;
+			}
+			offset = std::max(offset, conflict.second);
+		}
+		offset = alias_planner::align(offset, request.alignment);
+		plan.offsets[index] = offset;
+		plan.heap_sizes[request.heap] = std::max(plan.heap_sizes[request.heap],
+			offset + request.size);
+		placed.push_back(index);
+	}
+
+	for (std::size_t i : placed) {
+		for (std::size_t j : placed) {
+			const alias_request_type &a(requests[i]), &b(requests[j]);
+			if (a.heap == b.heap && a.last < b.first
+					&& plan.offsets[i] < plan.offsets[j] + b.size
+					&& plan.offsets[j] < plan.offsets[i] + a.size) {
+				plan.aliased[j].push_back(i);
+			}
+		}
+	}
+	for (std::vector<std::size_t> &aliased : plan.aliased) {
+		std::sort(aliased.begin(), aliased.end());
+	}
+	return plan;
+}
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_ALIAS_PLANNER_H_
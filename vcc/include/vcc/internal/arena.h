@@ -0,0 +1,147 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_ARENA_H_
+#define _VCC_INTERNAL_ARENA_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Constructs objects in large chunks of memory instead of one heap
+ * allocation each. The objects are destroyed together, in reverse order of
+ * creation, by clear or the destructor.
+ * clear keeps the chunks, an arena filled to the same size again does not
+ * allocate at all.
+ */
+class arena_type {
+public:
+	explicit arena_type(std::size_t chunk_size = 4096)
+		: chunk_size(chunk_size), current(0), offset(0), last(nullptr) {}
+	arena_type(const arena_type &) = delete;
+	arena_type(arena_type &&copy)
+		: chunk_size(copy.chunk_size), chunks(std::move(copy.chunks)),
+		  current(copy.current), offset(copy.offset), last(copy.last) {
+		copy.chunks.clear();
+		copy.current = 0;
+		copy.offset = 0;
+		copy.last = nullptr;
+	}
+	arena_type &operator=(const arena_type &) = delete;
+	arena_type &operator=(arena_type &&copy) {
+		if (this != &copy) {
+			clear();
+			chunk_size = copy.chunk_size;
+			chunks = std::move(copy.chunks);
+			current = copy.current;
+			offset = copy.offset;
+			last = copy.last;
+			copy.chunks.clear();
+			copy.current = 0;
+			copy.offset = 0;
+			copy.last = nullptr;
+		}
+		return *this;
+	}
+	~arena_type() {
+		clear();
+	}
+
+	template<typename T, typename... ArgsT>
+	T *create(ArgsT&&... args) {
+		static_assert(alignof(holder_type<T>) <= alignof(std::max_align_t),
+			"Over-aligned types are not supported");
+		holder_type<T> *const holder(new (allocate(sizeof(holder_type<T>),
+			alignof(holder_type<T>))) holder_type<T>(
+				std::forward<ArgsT>(args)...));
+		holder->previous = last;
+		last = holder;
+		return &holder->value;
+	}
+
+	void clear() {
+		while (last) {
+			node_type *const previous(last->previous);
+			last->~node_type();
+			last = previous;
+		}
+		current = 0;
+		offset = 0;
+	}
+
+	// Number of heap allocations held by the arena.
+	std::size_t chunk_count() const {
+		return chunks.size();
+	}
+
+private:
+	struct node_type {
+		virtual ~node_type() {}
+		node_type *previous;
+	};
+
+	template<typename T>
+	struct holder_type : public node_type {
+		template<typename... ArgsT>
+		explicit holder_type(ArgsT&&... args)
+			: value(std::forward<ArgsT>(args)...) {}
+		T value;
+	};
+
+	struct chunk_type {
+		std::unique_ptr<char[]> data;
+		std::size_t size;
+	};
+
+	// new char[] is aligned for any fundamental type, alignment never
+	// exceeds that.
+	void *allocate(std::size_t size, std::size_t alignment) {
+		for (;;) {
+			if (current < chunks.size()) {
+				const std::size_t aligned((offset + alignment - 1)
+					& ~(alignment - 1));
+				if (aligned + size <= chunks[current].size) {
+					offset = aligned + size;
+					return chunks[current].data.get() + aligned;
+				}
+				++current;
+				offset = 0;
+			} else {
+				const std::size_t chunk(std::max(chunk_size, size));
+				chunks.push_back(chunk_type{
+					std::unique_ptr<char[]>(new char[chunk]), chunk });
+			}
+		}
+	}
+
+	std::size_t chunk_size;
+	std::vector<chunk_type> chunks;
+	// Chunk and offset of the next allocation.
+	std::size_t current, offset;
+	// Most recently created object, linked to the ones before it.
+	node_type *last;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_ARENA_H_
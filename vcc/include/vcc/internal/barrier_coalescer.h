@@ -0,0 +1,194 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_BARRIER_COALESCER_H_
+#define _VCC_INTERNAL_BARRIER_COALESCER_H_
+
+#include <algorithm>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+// The arguments of one vkCmdPipelineBarrier.
+struct barrier_batch_type {
+	barrier_batch_type() : src_stages(0), dst_stages(0), dependency_flags(0) {}
+
+	void clear() {
+		src_stages = dst_stages = 0;
+		dependency_flags = 0;
+		memory_barriers.clear();
+		buffer_barriers.clear();
+		image_barriers.clear();
+	}
+
+	VkPipelineStageFlags src_stages, dst_stages;
+	VkDependencyFlags dependency_flags;
+	std::vector<VkMemoryBarrier> memory_barriers;
+	std::vector<VkBufferMemoryBarrier> buffer_barriers;
+	std::vector<VkImageMemoryBarrier> image_barriers;
+};
+
+namespace barrier_coalescer {
+
+// Stages that are the union of other stages.
+const VkPipelineStageFlags all_stages = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT
+	| VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+inline bool stages_overlap(VkPipelineStageFlags a, VkPipelineStageFlags b) {
+	return (a & b) || (a & all_stages) || (b & all_stages);
+}
+
+inline bool no_op(const VkMemoryBarrier &barrier) {
+	return !barrier.srcAccessMask && !barrier.dstAccessMask;
+}
+
+inline bool no_op(const VkBufferMemoryBarrier &barrier) {
+	return !barrier.srcAccessMask && !barrier.dstAccessMask
+		&& barrier.srcQueueFamilyIndex == barrier.dstQueueFamilyIndex;
+}
+
+inline bool no_op(const VkImageMemoryBarrier &barrier) {
+	return !barrier.srcAccessMask && !barrier.dstAccessMask
+		&& barrier.oldLayout == barrier.newLayout
+		&& barrier.srcQueueFamilyIndex == barrier.dstQueueFamilyIndex;
+}
+
+template<typename BarrierT>
+void drop_no_ops(std::vector<BarrierT> &barriers) {
+	barriers.erase(std::remove_if(barriers.begin(), barriers.end(),
+		[](const BarrierT &barrier) { return no_op(barrier); }),
+		barriers.end());
+}
+
+// True if a and b name the same buffer or image, in which case their
+// barriers must stay ordered.
+template<typename BarrierT, typename HandleT>
+bool shares(const std::vector<BarrierT> &a, const std::vector<BarrierT> &b,
+		HandleT BarrierT::*handle) {
+	for (const BarrierT &x : a) {
+		for (const BarrierT &y : b) {
+			if (x.*handle == y.*handle) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+}  // namespace barrier_coalescer
+
+/*
+ * Holds back the last pipeline barrier recorded so that the next one can
+ * be merged into the same vkCmdPipelineBarrier when nothing was recorded in
+ * between. Barriers are merged when:
+ * - Their dependency flags are equal, and their source or destination
+ *   stages are, so the union of the stages adds little synchronization.
+ * - They do not name the same buffer or image, whose transitions would be
+ *   unordered within one barrier.
+ * - The second does not chain on the first, its source stages overlapping
+ *   the destination stages of the first, when either has global memory
+ *   barriers.
+ * Memory barriers without access, layout or queue family changes are
+ * dropped, they add nothing to the stage masks. A barrier left without
+ * memory barriers from TOP_OF_PIPE or to BOTTOM_OF_PIPE is dropped.
+ */
+class barrier_coalescer_type {
+public:
+	barrier_coalescer_type() : pending_valid(false) {}
+
+	bool empty() const {
+		return !pending_valid;
+	}
+
+	// Returns the barrier to fill in and pass to add.
+	barrier_batch_type &next() {
+		scratch.clear();
+		return scratch;
+	}
+
+	// Adds the barrier returned by next, calls record(barrier_batch_type)
+	// with the pending barrier first if they can not be merged.
+	template<typename RecordT>
+	void add(RecordT record) {
+		barrier_coalescer::drop_no_ops(scratch.memory_barriers);
+		barrier_coalescer::drop_no_ops(scratch.buffer_barriers);
+		barrier_coalescer::drop_no_ops(scratch.image_barriers);
+		if (no_op(scratch)) {
+			return;
+		}
+		if (pending_valid && compatible(pending, scratch)) {
+			pending.src_stages |= scratch.src_stages;
+			pending.dst_stages |= scratch.dst_stages;
+			append(pending.memory_barriers, scratch.memory_barriers);
+			append(pending.buffer_barriers, scratch.buffer_barriers);
+			append(pending.image_barriers, scratch.image_barriers);
+			return;
+		}
+		flush(record);
+		std::swap(pending, scratch);
+		pending_valid = true;
+	}
+
+	// Calls record(barrier_batch_type) with the pending barrier, if any.
+	template<typename RecordT>
+	void flush(RecordT record) {
+		if (pending_valid) {
+			pending_valid = false;
+			record(const_cast<const barrier_batch_type &>(pending));
+		}
+	}
+
+private:
+	static bool no_op(const barrier_batch_type &barrier) {
+		return barrier.memory_barriers.empty()
+			&& barrier.buffer_barriers.empty()
+			&& barrier.image_barriers.empty()
+			&& (barrier.src_stages == VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
+				|| barrier.dst_stages == VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+	}
+
+	static bool compatible(const barrier_batch_type &a,
+			const barrier_batch_type &b) {
+		if (a.dependency_flags != b.dependency_flags
+				|| (a.src_stages != b.src_stages
+					&& a.dst_stages != b.dst_stages)) {
+			return false;
+		}
+		if (barrier_coalescer::shares(a.buffer_barriers, b.buffer_barriers,
+					&VkBufferMemoryBarrier::buffer)
+				|| barrier_coalescer::shares(a.image_barriers,
+					b.image_barriers, &VkImageMemoryBarrier::image)) {
+			return false;
+		}
+		return (a.memory_barriers.empty() && b.memory_barriers.empty())
+			|| !barrier_coalescer::stages_overlap(b.src_stages, a.dst_stages);
+	}
+
+	template<typename BarrierT>
+	static void append(std::vector<BarrierT> &to,
+			const std::vector<BarrierT> &from) {
+		to.insert(to.end(), from.begin(), from.end());
+	}
+
+	bool pending_valid;
+	barrier_batch_type pending, scratch;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_BARRIER_COALESCER_H_
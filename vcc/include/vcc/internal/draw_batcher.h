@@ -0,0 +1,151 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_DRAW_BATCHER_H_
+#define _VCC_INTERNAL_DRAW_BATCHER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Collects runs of indexed draws recorded without any other command in
+ * between, and turns every run into one indirect draw of the commands
+ * written for it.
+ * The written commands are copied into the indirect buffer by the caller,
+ * see draw_batch::batch. Batches of a recording into the same buffer
+ * append to it, the draws of the earlier ones still read their commands.
+ */
+class draw_batcher_type {
+public:
+	draw_batcher_type() : active(false), indirect(false),
+		first_instance(false), target(nullptr), capacity(0), max_run(0),
+		first(0) {}
+
+	// Starts batching into at most capacity indirect commands of target,
+	// following those written to it by earlier batches, runs longer than
+	// max_run are split. Without indirect, the draws are recorded one by
+	// one, for devices without multiDrawIndirect. Without first_instance,
+	// for devices without drawIndirectFirstInstance, draws with a
+	// firstInstance are recorded on their own.
+	void begin(const void *target, std::size_t capacity, bool indirect,
+			std::size_t max_run, bool first_instance) {
+		active = true;
+		this->indirect = indirect;
+		this->first_instance = first_instance;
+		this->target = target;
+		this->capacity = capacity;
+		this->max_run = std::max<std::size_t>(max_run, 1);
+		first = 0;
+		for (const std::pair<const void *, std::size_t> &used : targets) {
+			if (used.first == target) {
+				first = used.second;
+			}
+		}
+		pending.clear();
+		commands.clear();
+	}
+
+	// Stops batching, pending draws must have been flushed.
+	void end() {
+		active = false;
+		if (commands.empty()) {
+			return;
+		}
+		for (std::pair<const void *, std::size_t> &used : targets) {
+			if (used.first == target) {
+				used.second = first + commands.size();
+				return;
+			}
+		}
+		targets.push_back(std::make_pair(target, first + commands.size()));
+	}
+
+	bool batching() const {
+		return active;
+	}
+
+	bool empty() const {
+		return pending.empty();
+	}
+
+	void add(const VkDrawIndexedIndirectCommand &draw) {
+		pending.push_back(draw);
+	}
+
+	// Records the pending draws, calling direct(draw) for each draw recorded
+	// on its own and indirect(first, count) for runs written to
+	// [first, first + count) of the target, see base. Single draws, and
+	// draws not fitting in the capacity, are recorded directly.
+	// The pending draws are taken first, direct and indirect may record
+	// other commands flushing this batcher again.
+	template<typename DirectT, typename IndirectT>
+	void flush(DirectT direct, IndirectT indirect_run) {
+		std::vector<VkDrawIndexedIndirectCommand> run;
+		run.swap(pending);
+		std::size_t i(0);
+		while (i < run.size()) {
+			const std::size_t written(first + commands.size());
+			const std::size_t limit(std::min(run.size() - i,
+				std::min(max_run, capacity - std::min(capacity, written))));
+			std::size_t count(0);
+			while (count < limit && (first_instance
+					|| !run[i + count].firstInstance)) {
+				++count;
+			}
+			if (!indirect || count < 2) {
+				direct(run[i]);
+				++i;
+				continue;
+			}
+			commands.insert(commands.end(), run.begin() + i,
+				run.begin() + i + count);
+			indirect_run(written, count);
+			i += count;
+		}
+		// Keeps the memory for the next run.
+		run.clear();
+		if (pending.empty()) {
+			pending.swap(run);
+		}
+	}
+
+	// Indirect commands written since begin, from base on in the target.
+	const std::vector<VkDrawIndexedIndirectCommand> &written() const {
+		return commands;
+	}
+
+	std::size_t base() const {
+		return first;
+	}
+
+private:
+	bool active, indirect, first_instance;
+	const void *target;
+	std::size_t capacity, max_run, first;
+	std::vector<VkDrawIndexedIndirectCommand> pending, commands;
+	// The commands written to each target by the batches ended so far.
+	std::vector<std::pair<const void *, std::size_t>> targets;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_DRAW_BATCHER_H_
@@ -0,0 +1,157 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_FLUSH_BATCH_H_
+#define _VCC_INTERNAL_FLUSH_BATCH_H_
+
+#include <deque>
+#include <future>
+#include <thread>
+#include <unordered_map>
+#include <vcc/command.h>
+#include <vcc/command_pool.h>
+#include <vcc/fence.h>
+#include <vcc/internal/recycler.h>
+
+namespace vcc {
+
+namespace queue {
+
+struct queue_type;
+
+}  // namespace queue
+
+namespace internal {
+
+/*
+ * Commands recorded by pre-execute hooks, such as input_buffer uploads,
+ * are collected into one command buffer per queue::submit which is
+ * prepended to the submitted command buffers.
+ * Command buffers and fences are recycled once their fence is signaled,
+ * the CPU never waits for a flush unless a resource runs out of space.
+ */
+struct flush_batch_type {
+	typedef uint64_t tag_type;
+
+	struct submission_type {
+		fence::fence_type fence;
+		command_buffer::command_buffer_type command_buffer;
+		reference_container_type references;
+		tag_type tag;
+		// Result of the submit when made by the submit thread.
+		std::shared_future<VkResult> submitted;
+	};
+
+	// Command buffers of one thread for the submits of one tag, the pool
+	// is reset in bulk once the tag completed.
+	struct transient_pool_type {
+		std::shared_ptr<command_pool::command_pool_type> command_pool;
+		std::vector<command_buffer::command_buffer_type> command_buffers;
+		std::size_t used;
+	};
+
+	flush_batch_type() : barrier_src_stage_mask(0), tag(1), completed(0),
+		waits(0), transient_pools_created(0) {}
+	flush_batch_type(const flush_batch_type &) = delete;
+	flush_batch_type(flush_batch_type &&) = delete;
+	flush_batch_type &operator=(const flush_batch_type &) = delete;
+	flush_batch_type &operator=(flush_batch_type &&) = delete;
+	VCC_LIBRARY ~flush_batch_type();
+
+	// Held from the pre-execute hooks until vkQueueSubmit returns.
+	std::recursive_mutex mutex;
+	command_pool::command_pool_type command_pool;
+	// Fences of retired submissions, reset in batches.
+	fence::pool_type fences;
+	// The submission currently being recorded, if any.
+	submission_type current;
+	std::unique_ptr<command_buffer::begin_type> recording;
+	std::unique_ptr<command::internal::cmd_args> args;
+	VkPipelineStageFlags barrier_src_stage_mask;
+	std::vector<command::buffer_memory_barrier_type> barriers;
+	// In flight, oldest first.
+	std::deque<submission_type> submissions;
+	std::vector<submission_type> recycled;
+	// Tag of the submission being recorded and the last completed tag.
+	tag_type tag, completed;
+	uint64_t waits;
+	std::unordered_map<std::thread::id, recycler_type<transient_pool_type>>
+		transient_pools;
+	uint64_t transient_pools_created;
+};
+
+// Locks the flush batch of the queue. Must be held while using the functions
+// below outside queue::submit.
+VCC_LIBRARY std::unique_lock<std::recursive_mutex> lock_flush(
+	queue::queue_type &queue);
+
+// Returns the arguments used to record into the flush command buffer of the
+// next submit on the queue, the command buffer is begun on first use.
+VCC_LIBRARY command::internal::cmd_args &flush_commands(
+	queue::queue_type &queue);
+
+// Adds a buffer memory barrier to the single barrier recorded at the end of
+// the flush command buffer.
+VCC_LIBRARY void flush_barrier(queue::queue_type &queue,
+	VkPipelineStageFlags src_stage_mask,
+	const command::buffer_memory_barrier_type &barrier);
+
+// Makes the next submit on the queue signal a flush fence even if nothing
+// is recorded, and returns its tag.
+VCC_LIBRARY flush_batch_type::tag_type flush_track(queue::queue_type &queue);
+
+// Tag of the flush that will be submitted next and of the last flush known
+// to have finished executing. Tags are increasing.
+VCC_LIBRARY flush_batch_type::tag_type flush_tag(queue::queue_type &queue);
+VCC_LIBRARY flush_batch_type::tag_type completed_flush_tag(
+	queue::queue_type &queue);
+
+// Blocks until the oldest flush in flight has finished.
+// Returns false if there is nothing in flight.
+VCC_LIBRARY bool wait_flush(queue::queue_type &queue);
+
+// Recycles finished flushes, without blocking.
+VCC_LIBRARY void retire_flush(queue::queue_type &queue);
+
+// Ends recording and returns the flush command buffer to be prepended to
+// the submit, or VK_NULL_HANDLE if nothing was recorded.
+VCC_LIBRARY VkCommandBuffer end_flush(queue::queue_type &queue);
+
+// Fence to be signaled by the submit containing the flush command buffer.
+VCC_LIBRARY const fence::fence_type &get_flush_fence(queue::queue_type &queue);
+
+// Returns a primary command buffer from the calling thread's transient
+// pools, to be recorded with VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT and
+// submitted with the next submit on the queue. The lock_flush must be held
+// until then, see queue::execute.
+VCC_LIBRARY command_buffer::command_buffer_type &acquire_transient(
+	queue::queue_type &queue);
+
+// Marks the flush command buffer as submitted and in flight.
+VCC_LIBRARY void commit_flush(queue::queue_type &queue);
+
+// Marks the flush command buffer as handed to the submit thread. If
+// submitted turns out to fail the flush is retired without waiting for its
+// fence, which is never signaled.
+VCC_LIBRARY void commit_flush(queue::queue_type &queue,
+	const std::shared_future<VkResult> &submitted);
+
+// Drops the flush command buffer ended for a submit that failed.
+VCC_LIBRARY void abandon_flush(queue::queue_type &queue);
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_FLUSH_BATCH_H_
@@ -0,0 +1,104 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_FRAME_PACER_H_
+#define _VCC_INTERNAL_FRAME_PACER_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Hands out the slots of the frames in flight in turn. A slot is waited on
+ * before it is reused, and so is the slot of another frame still rendering
+ * into the swapchain image just acquired, the CPU never waits otherwise.
+ * Waiting is done by the caller, typically on the fence of the slot.
+ */
+class frame_pacer_type {
+public:
+	static const uint32_t no_slot = ~0u;
+
+	frame_pacer_type() : next(0) {}
+	explicit frame_pacer_type(uint32_t frames)
+		: submitted(frames, false), next(0) {}
+
+	uint32_t frames() const {
+		return uint32_t(submitted.size());
+	}
+
+	// Returns the slot of the next frame, calling wait(slot) first if its
+	// previous frame was submitted.
+	template<typename WaitT>
+	uint32_t begin(WaitT wait) {
+		const uint32_t slot(next);
+		next = (next + 1) % frames();
+		complete(slot, wait);
+		return slot;
+	}
+
+	// The frame of slot acquired image, calls wait(other_slot) if the frame
+	// of another slot rendering into the image may not have completed.
+	template<typename WaitT>
+	void acquired(uint32_t slot, uint32_t image, WaitT wait) {
+		if (image >= images.size()) {
+			images.resize(image + 1, uint32_t(no_slot));
+		}
+		if (images[image] != no_slot) {
+			complete(images[image], wait);
+		}
+		images[image] = slot;
+	}
+
+	// The last submit of the frame of slot was made.
+	void submit(uint32_t slot) {
+		submitted[slot] = true;
+	}
+
+	// Waits on all submitted slots, such as before recreating the swapchain.
+	template<typename WaitT>
+	void idle(WaitT wait) {
+		for (uint32_t slot = 0; slot < frames(); ++slot) {
+			complete(slot, wait);
+		}
+		images.clear();
+	}
+
+private:
+	template<typename WaitT>
+	void complete(uint32_t slot, WaitT &wait) {
+		if (submitted[slot]) {
+			wait(slot);
+			submitted[slot] = false;
+		}
+		// The images of the frame are no longer rendered to.
+		for (uint32_t &image_slot : images) {
+			if (image_slot == slot) {
+				image_slot = no_slot;
+			}
+		}
+	}
+
+	std::vector<bool> submitted;
+	// The slot of the last frame rendering into each image.
+	std::vector<uint32_t> images;
+	uint32_t next;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_FRAME_PACER_H_
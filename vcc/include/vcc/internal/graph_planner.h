@@ -0,0 +1,316 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_GRAPH_PLANNER_H_
+#define _VCC_INTERNAL_GRAPH_PLANNER_H_
+
+#include <cstdint>
+#include <vector>
+#include <vcc/util.h>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+// Access bits writing memory, any other access only reads.
+const VkAccessFlags graph_write_access = VK_ACCESS_SHADER_WRITE_BIT
+	| VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+	| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+	| VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT
+	| VK_ACCESS_MEMORY_WRITE_BIT;
+
+struct graph_resource_type {
+	bool image;
+	// Layout the image is in before the graph executes.
+	VkImageLayout initial_layout;
+	// Layout the image is left in, VK_IMAGE_LAYOUT_UNDEFINED leaves it in
+	// the layout of its last use.
+	VkImageLayout final_layout;
+	// Used after the graph executes, the passes writing it are kept.
+	bool output;
+	// Resources whose memory this one reuses, see plan_aliasing. Their
+	// contents are discarded by its first use.
+	std::vector<std::size_t> aliased;
+};
+
+// The use of a resource by a pass, layout is ignored for buffers.
+struct graph_usage_type {
+	std::size_t resource;
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+	VkImageLayout layout;
+};
+
+struct graph_pass_type {
+	std::vector<graph_usage_type> usages;
+};
+
+// A buffer barrier, or an image barrier when the resource is an image.
+struct graph_memory_barrier_type {
+	std::size_t resource;
+	VkAccessFlags src_access, dst_access;
+	VkImageLayout old_layout, new_layout;
+};
+
+// All dependencies of one pass, recorded as a single vkCmdPipelineBarrier.
+// Execution dependencies without memory barriers are only stage masks.
+struct graph_barrier_type {
+	graph_barrier_type() : src_stages(0), dst_stages(0) {}
+
+	bool empty() const {
+		return !dst_stages;
+	}
+
+	VkPipelineStageFlags src_stages, dst_stages;
+	std::vector<graph_memory_barrier_type> barriers;
+};
+
+struct graph_step_type {
+	std::size_t pass;
+	// Recorded before the pass.
+	graph_barrier_type barrier;
+};
+
+// The steps using a resource, first and last are indices into steps.
+struct graph_lifetime_type {
+	bool used;
+	std::size_t first, last;
+};
+
+struct graph_plan_type {
+	// The passes kept, in the order they were added.
+	std::vector<graph_step_type> steps;
+	// Indexed by resource.
+	std::vector<graph_lifetime_type> lifetimes;
+	// Transitions to the final layouts, after the last step.
+	graph_barrier_type final_barrier;
+};
+
+namespace graph_planner {
+
+struct state_type {
+	VkImageLayout layout;
+	// The last write, or layout transition, and the reads since.
+	VkPipelineStageFlags write_stages, read_stages;
+	VkAccessFlags write_access;
+	// Stages and access the last write is already visible to.
+	VkPipelineStageFlags visible_stages;
+	VkAccessFlags visible_access;
+};
+
+inline void add(graph_barrier_type &barrier, VkPipelineStageFlags src_stages,
+		VkPipelineStageFlags dst_stages) {
+	barrier.src_stages |= src_stages ? src_stages
+		: VkPipelineStageFlags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	barrier.dst_stages |= dst_stages;
+}
+
+// Combines the uses of the same resource within a pass, they are
+// synchronized by the pass itself.
+inline std::vector<graph_usage_type> merge_usages(
+		const std::vector<graph_usage_type> &usages,
+		const std::vector<graph_resource_type> &resources) {
+	std::vector<graph_usage_type> merged;
+	merged.reserve(usages.size());
+	for (const graph_usage_type &usage : usages) {
+		if (usage.resource >= resources.size()) {
+			throw vcc_exception("pass uses an unknown resource");
+		}
+		std::vector<graph_usage_type>::iterator it(merged.begin());
+		while (it != merged.end() && it->resource != usage.resource) {
+			++it;
+		}
+		if (it == merged.end()) {
+			merged.push_back(usage);
+		} else if (resources[usage.resource].image
+				&& it->layout != usage.layout) {
+			throw vcc_exception("pass uses an image in two layouts");
+		} else {
+			it->stages |= usage.stages;
+			it->access |= usage.access;
+		}
+	}
+	return merged;
+}
+
+inline void use(const graph_resource_type &resource,
+		const graph_usage_type &usage, state_type &state,
+		graph_barrier_type &barrier) {
+	const bool layout_change(resource.image && usage.layout != state.layout);
+	const VkImageLayout layout(resource.image
+		? usage.layout : VK_IMAGE_LAYOUT_UNDEFINED);
+	if (usage.access & graph_write_access) {
+		// Write after write or read, a memory dependency only if there are
+		// writes not yet made available. Once read through a barrier, the
+		// dependency chains through the stages reading it.
+		const bool available(state.visible_stages != 0);
+		const VkAccessFlags src_access(available ? 0 : state.write_access);
+		const VkPipelineStageFlags src_stages(state.read_stages
+			| (available ? 0 : state.write_stages));
+		if (layout_change || src_access) {
+			barrier.barriers.push_back(graph_memory_barrier_type{
+				usage.resource, src_access, usage.access, state.layout,
+				layout });
+			add(barrier, src_stages, usage.stages);
+		} else if (src_stages) {
+			add(barrier, src_stages, usage.stages);
+		}
+		state = state_type{ layout, usage.stages, 0,
+			usage.access & graph_write_access, 0, 0 };
+	} else if (layout_change) {
+		// The transition is a write, later readers depend on it through
+		// the stages of this use.
+		barrier.barriers.push_back(graph_memory_barrier_type{
+			usage.resource, state.write_access, usage.access, state.layout,
+			layout });
+		add(barrier, state.write_stages | state.read_stages, usage.stages);
+		state = state_type{ layout, usage.stages, usage.stages, 0,
+			usage.stages, usage.access };
+	} else {
+		const bool visible(
+			(state.visible_stages & usage.stages) == usage.stages
+			&& (state.visible_access & usage.access) == usage.access);
+		if (state.write_stages && !visible) {
+			barrier.barriers.push_back(graph_memory_barrier_type{
+				usage.resource, state.write_access, usage.access, state.layout,
+				layout });
+			add(barrier, state.write_stages, usage.stages);
+			state.visible_stages |= usage.stages;
+			state.visible_access |= usage.access;
+		}
+		state.read_stages |= usage.stages;
+	}
+}
+
+// The first use of a resource reusing the memory of others depends on
+// their last uses, as if it was written by them in an undefined layout.
+inline void alias(const std::vector<std::size_t> &aliased,
+		const std::vector<state_type> &states, state_type &state) {
+	state = state_type{ VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, 0, 0 };
+	for (std::size_t index : aliased) {
+		const state_type &other(states[index]);
+		state.write_stages |= other.write_stages | other.read_stages;
+		if (!other.visible_stages) {
+			state.write_access |= other.write_access;
+		}
+	}
+}
+
+}  // namespace graph_planner
+
+/*
+ * Orders the passes as added and computes the barriers between them from
+ * the resources they use.
+ *
+ * Passes not contributing to an output resource are culled. A pass
+ * writing a resource without reading it is assumed to overwrite all of it,
+ * making earlier writers unnecessary; declare the read as well for
+ * partial writes. Passes writing no resource are always kept.
+ *
+ * Each kept pass gets one batched barrier holding:
+ * - Layout transitions, from the last layout the image was used in.
+ * - Memory barriers for reads of earlier writes, once per set of stages
+ *   and access reading the same write.
+ * - Memory barriers for writes after writes.
+ * - Execution dependencies only for writes after reads.
+ * Resources are assumed to be available and visible when the graph
+ * begins, waiting for earlier submissions is up to the caller.
+ * The first use of a resource aliasing others also waits for their last
+ * uses, and transitions from VK_IMAGE_LAYOUT_UNDEFINED.
+ */
+inline graph_plan_type plan_graph(
+		const std::vector<graph_resource_type> &resources,
+		const std::vector<graph_pass_type> &passes) {
+	std::vector<std::vector<graph_usage_type>> usages;
+	usages.reserve(passes.size());
+	for (const graph_pass_type &pass : passes) {
+		usages.push_back(graph_planner::merge_usages(pass.usages, resources));
+	}
+
+	std::vector<bool> needed(resources.size()), kept(passes.size());
+	for (std::size_t i = 0; i < resources.size(); ++i) {
+		needed[i] = resources[i].output;
+	}
+	for (std::size_t i = passes.size(); i-- > 0;) {
+		bool writes(false), keep(false);
+		for (const graph_usage_type &usage : usages[i]) {
+			if (usage.access & graph_write_access) {
+				writes = true;
+				keep = keep || needed[usage.resource];
+			}
+		}
+		kept[i] = !writes || keep;
+		if (!kept[i]) {
+			continue;
+		}
+		for (const graph_usage_type &usage : usages[i]) {
+			if (usage.access & ~graph_write_access) {
+				needed[usage.resource] = true;
+			} else if (usage.access & graph_write_access) {
+				needed[usage.resource] = false;
+			}
+		}
+	}
+
+	std::vector<graph_planner::state_type> states;
+	states.reserve(resources.size());
+	for (const graph_resource_type &resource : resources) {
+		states.push_back(graph_planner::state_type{ resource.image
+			? resource.initial_layout : VK_IMAGE_LAYOUT_UNDEFINED,
+			0, 0, 0, 0, 0 });
+	}
+	graph_plan_type plan;
+	plan.lifetimes.resize(resources.size(), graph_lifetime_type{ false, 0, 0 });
+	for (std::size_t i = 0; i < passes.size(); ++i) {
+		if (!kept[i]) {
+			continue;
+		}
+		graph_step_type step;
+		step.pass = i;
+		for (const graph_usage_type &usage : usages[i]) {
+			graph_lifetime_type &lifetime(plan.lifetimes[usage.resource]);
+			if (!lifetime.used) {
+				lifetime = graph_lifetime_type{ true, plan.steps.size(), 0 };
+				if (!resources[usage.resource].aliased.empty()) {
+					graph_planner::alias(resources[usage.resource].aliased,
+						states, states[usage.resource]);
+				}
+			}
+			lifetime.last = plan.steps.size();
+			graph_planner::use(resources[usage.resource], usage,
+				states[usage.resource], step.barrier);
+		}
+		plan.steps.push_back(std::move(step));
+	}
+	for (std::size_t i = 0; i < resources.size(); ++i) {
+		const graph_resource_type &resource(resources[i]);
+		const graph_planner::state_type &state(states[i]);
+		if (resource.image && resource.final_layout != VK_IMAGE_LAYOUT_UNDEFINED
+				&& resource.final_layout != state.layout) {
+			plan.final_barrier.barriers.push_back(graph_memory_barrier_type{
+				i, state.write_access, 0, state.layout,
+				resource.final_layout });
+			graph_planner::add(plan.final_barrier,
+				state.write_stages | state.read_stages,
+				VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+		}
+	}
+	return plan;
+}
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_GRAPH_PLANNER_H_
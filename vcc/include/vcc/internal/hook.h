@@ -18,12 +18,19 @@
 
 #include <functional>
 #include <memory>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
+#include <vcc/internal/arena.h>
 #include <vector>
 
 namespace vcc {
 namespace internal {
 
+/*
+ * The callbacks are stored in an arena, adding one to a container reused
+ * through clear does not allocate.
+ */
 template<typename... T>
 class hook_container_type {
 public:
@@ -34,20 +41,42 @@ public:
 	hook_container_type &operator=(const hook_container_type&) = delete;
 	hook_container_type &operator=(hook_container_type&&) = default;
 
-	void add(const callback_type &callback) {
-		callbacks.push_back(callback);
-	}
-	void add(callback_type &&callback) {
-		callbacks.push_back(std::forward<callback_type>(callback));
+	template<typename CallbackT>
+	void add(CallbackT &&callback) {
+		callbacks.push_back(arena.template create<
+			callable_type<typename std::decay<CallbackT>::type>>(
+				std::forward<CallbackT>(callback)));
 	}
 
 	void operator() (T... value) const {
-		for (const callback_type &callback : callbacks) {
-			callback(value...);
+		for (const callable_base_type *callback : callbacks) {
+			(*callback)(value...);
 		}
 	}
+
+	// Destroys the callbacks, keeping the memory for reuse.
+	void clear() {
+		callbacks.clear();
+		arena.clear();
+	}
 private:
-	std::vector<callback_type> callbacks;
+	struct callable_base_type {
+		virtual ~callable_base_type() {}
+		virtual void operator()(T... value) const = 0;
+	};
+	template<typename CallbackT>
+	struct callable_type : public callable_base_type {
+		template<typename ArgT>
+		explicit callable_type(ArgT &&callback)
+			: callback(std::forward<ArgT>(callback)) {}
+		void operator()(T... value) const {
+			callback(value...);
+		}
+		CallbackT callback;
+	};
+
+	arena_type arena;
+	std::vector<const callable_base_type *> callbacks;
 };
 
 template<typename KeyT, typename Hash, typename... T>
@@ -75,17 +104,11 @@ private:
 	callbacks_container_type callbacks;
 };
 
+/*
+ * Keeps objects alive, in an arena freed in bulk when the container is
+ * cleared, destroyed or replaced.
+ */
 class reference_container_type {
-private:
-	struct instance {
-		virtual ~instance() {}
-	};
-	template<typename... T>
-	struct template_instance : public instance {
-		template_instance(T... value) : value(std::forward<T>(value)...) {}
-		template_instance(const std::tuple<T...> &value) : value(value) {}
-		std::tuple<T...> value;
-	};
 public:
 	reference_container_type() = default;
 	reference_container_type(const reference_container_type &) = delete;
@@ -95,10 +118,15 @@ public:
 
 	template<typename... T>
 	void add(T... value) {
-		instances.emplace_back(new template_instance<T...>(std::forward<T>(value)...));
+		arena.create<std::tuple<T...>>(std::forward<T>(value)...);
+	}
+
+	// Releases the references, keeping the memory for reuse.
+	void clear() {
+		arena.clear();
 	}
 private:
-	std::vector<std::shared_ptr<instance>> instances;
+	arena_type arena;
 };
 
 template<typename KeyT, typename HashT = std::hash<KeyT>>
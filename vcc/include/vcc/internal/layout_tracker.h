@@ -0,0 +1,178 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_LAYOUT_TRACKER_H_
+#define _VCC_INTERNAL_LAYOUT_TRACKER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <vcc/internal/graph_planner.h>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+// The layout a subresource is used in and the stages and access using it.
+struct subresource_state_type {
+	VkImageLayout layout;
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+};
+
+// A rectangle of levels and layers sharing the barrier they need.
+struct layout_transition_type {
+	uint32_t base_level, level_count, base_layer, layer_count;
+	VkImageLayout old_layout;
+	VkPipelineStageFlags src_stages;
+	VkAccessFlags src_access;
+};
+
+/*
+ * The state of every level and layer of an image, tracked as the render
+ * graph does: the last write, the reads since and the stages the write is
+ * visible to. Aspects are not tracked separately, a range applies to all
+ * of them.
+ */
+class layout_tracker_type {
+public:
+	layout_tracker_type(uint32_t levels, uint32_t layers, VkImageLayout layout)
+		: levels(levels), layers(layers),
+		  states(std::size_t(levels) * layers,
+			graph_planner::state_type{ layout, 0, 0, 0, 0, 0 }) {}
+
+	const graph_planner::state_type &get(uint32_t level, uint32_t layer) const {
+		return states[std::size_t(level) * layers + layer];
+	}
+
+	// The range was written as state, or made visible to it by a barrier.
+	void set(uint32_t base_level, uint32_t level_count, uint32_t base_layer,
+			uint32_t layer_count, const subresource_state_type &state) {
+		fill(base_level, level_count, base_layer, layer_count,
+			state.access & graph_write_access
+				? graph_planner::state_type{ state.layout, state.stages, 0,
+					state.access & graph_write_access, 0, 0 }
+				: graph_planner::state_type{ state.layout, state.stages,
+					state.stages, 0, state.stages, state.access });
+	}
+
+	/*
+	 * Calls emit(layout_transition_type) for the subresources of the range
+	 * needing a barrier before being used as target, and then adds the use
+	 * to their state. A barrier is needed for another layout, before a
+	 * write, and before a read at stages the last write is not yet visible
+	 * to. Reads in the same layout accumulate, a later write waits for all
+	 * of them.
+	 * Runs of adjacent layers with the same state are merged, and so are
+	 * runs covering the same layers of adjacent levels.
+	 * VK_REMAINING_MIP_LEVELS and VK_REMAINING_ARRAY_LAYERS are accepted.
+	 */
+	template<typename EmitT>
+	void transition(uint32_t base_level, uint32_t level_count,
+			uint32_t base_layer, uint32_t layer_count,
+			const subresource_state_type &target, EmitT emit) {
+		clamp(base_level, level_count, base_layer, layer_count);
+		const graph_resource_type resource{ true, VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_UNDEFINED, false, {} };
+		const graph_usage_type usage{ 0, target.stages, target.access,
+			target.layout };
+		// Rectangles that may continue on the next level.
+		std::vector<layout_transition_type> open, next;
+		for (uint32_t level = base_level; level < base_level + level_count;
+				++level) {
+			next.clear();
+			uint32_t layer(base_layer);
+			while (layer < base_layer + layer_count) {
+				const graph_planner::state_type state(get(level, layer));
+				uint32_t end(layer + 1);
+				while (end < base_layer + layer_count
+						&& same(get(level, end), state)) {
+					++end;
+				}
+				graph_planner::state_type new_state(state);
+				graph_barrier_type barrier;
+				graph_planner::use(resource, usage, new_state, barrier);
+				fill(level, 1, layer, end - layer, new_state);
+				if (barrier.empty()) {
+					layer = end;
+					continue;
+				}
+				layout_transition_type run{ level, 1, layer, end - layer,
+					state.layout, barrier.src_stages, barrier.barriers.empty()
+						? 0 : barrier.barriers.front().src_access };
+				for (layout_transition_type &rectangle : open) {
+					if (rectangle.level_count && rectangle.base_layer == layer
+							&& rectangle.layer_count == run.layer_count
+							&& rectangle.old_layout == run.old_layout
+							&& rectangle.src_stages == run.src_stages
+							&& rectangle.src_access == run.src_access) {
+						run.base_level = rectangle.base_level;
+						run.level_count = rectangle.level_count + 1;
+						// Continued, not emitted below.
+						rectangle.level_count = 0;
+						break;
+					}
+				}
+				next.push_back(run);
+				layer = end;
+			}
+			for (const layout_transition_type &rectangle : open) {
+				if (rectangle.level_count) {
+					emit(rectangle);
+				}
+			}
+			open.swap(next);
+		}
+		for (const layout_transition_type &rectangle : open) {
+			emit(rectangle);
+		}
+	}
+
+private:
+	static bool same(const graph_planner::state_type &a,
+			const graph_planner::state_type &b) {
+		return a.layout == b.layout && a.write_stages == b.write_stages
+			&& a.read_stages == b.read_stages
+			&& a.write_access == b.write_access
+			&& a.visible_stages == b.visible_stages
+			&& a.visible_access == b.visible_access;
+	}
+
+	void fill(uint32_t base_level, uint32_t level_count, uint32_t base_layer,
+			uint32_t layer_count, const graph_planner::state_type &state) {
+		clamp(base_level, level_count, base_layer, layer_count);
+		for (uint32_t level = base_level; level < base_level + level_count;
+				++level) {
+			std::fill_n(states.begin() + std::size_t(level) * layers
+				+ base_layer, layer_count, state);
+		}
+	}
+
+	void clamp(uint32_t &base_level, uint32_t &level_count,
+			uint32_t &base_layer, uint32_t &layer_count) const {
+		base_level = std::min(base_level, levels);
+		base_layer = std::min(base_layer, layers);
+		level_count = std::min(level_count, levels - base_level);
+		layer_count = std::min(layer_count, layers - base_layer);
+	}
+
+	uint32_t levels, layers;
+	std::vector<graph_planner::state_type> states;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_LAYOUT_TRACKER_H_
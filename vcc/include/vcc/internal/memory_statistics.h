@@ -0,0 +1,151 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_MEMORY_STATISTICS_H_
+#define _VCC_INTERNAL_MEMORY_STATISTICS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace vcc {
+namespace internal {
+
+struct memory_counters_type {
+	uint64_t live_bytes, peak_bytes;
+	uint64_t live_allocations, peak_allocations;
+	// Allocations made over the lifetime of the device.
+	uint64_t total_allocations;
+};
+
+struct memory_snapshot_type {
+	std::vector<memory_counters_type> heaps, types;
+	// Entry i counts the allocations made of a size in [2^i, 2^(i+1)).
+	std::vector<uint64_t> size_histogram;
+};
+
+// Called with the heap index, its live bytes and its size.
+typedef std::function<void(uint32_t, uint64_t, uint64_t)>
+	memory_budget_callback_type;
+
+/*
+ * Accounts the device memory allocated per heap and memory type.
+ * The budget callback is invoked when the live bytes of a heap grow above
+ * the budget fraction of its size, and again only after they dropped back
+ * below it.
+ */
+class memory_statistics_type {
+public:
+	static const std::size_t histogram_size = 64;
+
+	memory_statistics_type(const std::vector<uint64_t> &heap_sizes,
+			const std::vector<uint32_t> &type_heaps)
+		: heap_sizes(heap_sizes), type_heaps(type_heaps),
+		  over_budget(heap_sizes.size(), false), budget_fraction(0) {
+		snapshot.heaps.resize(heap_sizes.size(), memory_counters_type());
+		snapshot.types.resize(type_heaps.size(), memory_counters_type());
+		snapshot.size_histogram.resize(histogram_size, 0);
+	}
+	memory_statistics_type(const memory_statistics_type &) = delete;
+	memory_statistics_type &operator=(const memory_statistics_type &) = delete;
+
+	void allocated(uint32_t memory_type_index, uint64_t size) {
+		const uint32_t heap(type_heaps[memory_type_index]);
+		memory_budget_callback_type callback;
+		uint64_t live_bytes;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			add(snapshot.types[memory_type_index], size);
+			add(snapshot.heaps[heap], size);
+			++snapshot.size_histogram[bucket(size)];
+			live_bytes = snapshot.heaps[heap].live_bytes;
+			if (budget_callback && !over_budget[heap]
+					&& live_bytes > budget(heap)) {
+				over_budget[heap] = true;
+				callback = budget_callback;
+			}
+		}
+		if (callback) {
+			callback(heap, live_bytes, heap_sizes[heap]);
+		}
+	}
+
+	void freed(uint32_t memory_type_index, uint64_t size) {
+		const uint32_t heap(type_heaps[memory_type_index]);
+		std::lock_guard<std::mutex> lock(mutex);
+		remove(snapshot.types[memory_type_index], size);
+		remove(snapshot.heaps[heap], size);
+		if (over_budget[heap] && snapshot.heaps[heap].live_bytes <= budget(heap)) {
+			over_budget[heap] = false;
+		}
+	}
+
+	memory_snapshot_type get() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return snapshot;
+	}
+
+	// A fraction of 0 or an empty callback disables the budget.
+	void set_budget(double fraction, const memory_budget_callback_type &callback) {
+		std::lock_guard<std::mutex> lock(mutex);
+		budget_fraction = fraction;
+		budget_callback = fraction > 0 ? callback : memory_budget_callback_type();
+		for (std::size_t heap = 0; heap < heap_sizes.size(); ++heap) {
+			over_budget[heap] = snapshot.heaps[heap].live_bytes > budget(uint32_t(heap));
+		}
+	}
+
+private:
+	static void add(memory_counters_type &counters, uint64_t size) {
+		counters.live_bytes += size;
+		counters.peak_bytes = std::max(counters.peak_bytes, counters.live_bytes);
+		++counters.live_allocations;
+		counters.peak_allocations = std::max(counters.peak_allocations,
+			counters.live_allocations);
+		++counters.total_allocations;
+	}
+
+	static void remove(memory_counters_type &counters, uint64_t size) {
+		counters.live_bytes -= size;
+		--counters.live_allocations;
+	}
+
+	static std::size_t bucket(uint64_t size) {
+		std::size_t index(0);
+		while (size >>= 1) {
+			++index;
+		}
+		return index;
+	}
+
+	uint64_t budget(uint32_t heap) const {
+		return uint64_t(double(heap_sizes[heap]) * budget_fraction);
+	}
+
+	const std::vector<uint64_t> heap_sizes;
+	const std::vector<uint32_t> type_heaps;
+	std::vector<bool> over_budget;
+	double budget_fraction;
+	memory_budget_callback_type budget_callback;
+	memory_snapshot_type snapshot;
+	mutable std::mutex mutex;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_MEMORY_STATISTICS_H_
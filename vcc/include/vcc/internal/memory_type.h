@@ -0,0 +1,54 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_MEMORY_TYPE_H_
+#define _VCC_INTERNAL_MEMORY_TYPE_H_
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+// Finds the first memory type allowed by type_bits that has all of the
+// required property flags, preferring the first one that also has all of
+// the preferred flags. Returns false if no memory type qualifies.
+inline bool find_memory_type(
+		const VkPhysicalDeviceMemoryProperties &memory_properties,
+		uint32_t type_bits, VkMemoryPropertyFlags required,
+		VkMemoryPropertyFlags preferred, uint32_t &index) {
+	bool found(false);
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+		const VkMemoryPropertyFlags flags(
+			memory_properties.memoryTypes[i].propertyFlags);
+		if (!(type_bits & (1u << i)) || (flags & required) != required) {
+			continue;
+		}
+		if ((flags & preferred) == preferred) {
+			index = i;
+			return true;
+		}
+		if (!found) {
+			index = i;
+			found = true;
+		}
+	}
+	return found;
+}
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_MEMORY_TYPE_H_
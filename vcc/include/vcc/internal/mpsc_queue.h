@@ -0,0 +1,90 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_MPSC_QUEUE_H_
+#define _VCC_INTERNAL_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <utility>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Unbounded queue of many producers and a single consumer. push never
+ * blocks and takes one atomic exchange, values pushed by one thread are
+ * popped in the order they were pushed.
+ * A value is visible to pop once its push has returned. T must be default
+ * constructible and movable.
+ */
+template<typename T>
+class mpsc_queue_type {
+public:
+	mpsc_queue_type() : head(new node_type), tail(head.load()) {}
+	mpsc_queue_type(const mpsc_queue_type &) = delete;
+	mpsc_queue_type(mpsc_queue_type &&) = delete;
+	mpsc_queue_type &operator=(const mpsc_queue_type &) = delete;
+	mpsc_queue_type &operator=(mpsc_queue_type &&) = delete;
+
+	~mpsc_queue_type() {
+		while (tail) {
+			node_type *const next(tail->next.load(std::memory_order_relaxed));
+			delete tail;
+			tail = next;
+		}
+	}
+
+	// May be called from any thread.
+	void push(T &&value) {
+		node_type *const node(new node_type(std::move(value)));
+		node_type *const previous(head.exchange(node));
+		previous->next.store(node);
+	}
+
+	// Consumer only. Returns false if nothing was pushed since the last pop.
+	bool pop(T &value) {
+		node_type *const next(tail->next.load());
+		if (!next) {
+			return false;
+		}
+		value = std::move(next->value);
+		delete tail;
+		tail = next;
+		return true;
+	}
+
+	// Consumer only.
+	bool empty() const {
+		return !tail->next.load();
+	}
+
+private:
+	// The node at the tail holds no value, its value was popped.
+	struct node_type {
+		node_type() : next(nullptr) {}
+		explicit node_type(T &&value) : next(nullptr), value(std::move(value)) {}
+
+		std::atomic<node_type *> next;
+		T value;
+	};
+
+	std::atomic<node_type *> head;
+	node_type *tail;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_MPSC_QUEUE_H_
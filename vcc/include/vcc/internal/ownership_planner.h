@@ -0,0 +1,153 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_OWNERSHIP_PLANNER_H_
+#define _VCC_INTERNAL_OWNERSHIP_PLANNER_H_
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+// The stages a queue waits for the semaphore of the other at.
+const VkPipelineStageFlags ownership_wait_stages =
+	VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+/*
+ * One vkCmdPipelineBarrier of a transfer. Its buffer and image barriers take
+ * the access of each resource on the source queue as source access for a
+ * release, and that on the destination queue as destination access for an
+ * acquire. The global memory barrier makes the writes made available by
+ * the semaphore signal visible to the batches after the wait.
+ */
+struct ownership_barrier_type {
+	bool record;
+	bool release;
+	VkPipelineStageFlags src_stages, dst_stages;
+	uint32_t src_family, dst_family;
+	VkAccessFlags memory_src_access, memory_dst_access;
+};
+
+template<typename KeyT>
+struct ownership_transfer_type {
+	bool to_compute;
+	// The resources changing family, none between queues of one family.
+	std::vector<KeyT> keys;
+	// Recorded before signaling the semaphore, if there are keys, and in
+	// the batch waiting for it, always: a semaphore wait only orders its
+	// own batch, the acquire chains the batches submitted after it.
+	ownership_barrier_type release, acquire;
+};
+
+/*
+ * Plans the queue family ownership transfers of exclusive resources shared
+ * between a graphics and a compute family. Resources are owned by the
+ * graphics family, except from the first dispatch using them until the
+ * next join, which returns all of them at once.
+ * Each transfer is a release barrier recorded on a queue of the family
+ * giving up the resource followed by the matching acquire barrier on a
+ * queue of the other, ordered by a semaphore.
+ */
+template<typename KeyT>
+class ownership_planner_type {
+public:
+	ownership_planner_type() : graphics_family(0), compute_family(0) {}
+	ownership_planner_type(uint32_t graphics_family, uint32_t compute_family)
+		: graphics_family(graphics_family), compute_family(compute_family) {}
+
+	// Resources of the same family need no barriers.
+	bool transfers() const {
+		return graphics_family != compute_family;
+	}
+
+	// A dispatch uses keys, plans the transfer to the compute family of
+	// those not dispatched since the last join.
+	ownership_transfer_type<KeyT> dispatch(const std::vector<KeyT> &keys) {
+		ownership_transfer_type<KeyT> transfer(plan(true));
+		for (const KeyT &key : keys) {
+			if (dispatched.insert(key).second) {
+				order.push_back(key);
+				if (transfers()) {
+					transfer.keys.push_back(key);
+				}
+			}
+		}
+		transfer.release.record = !transfer.keys.empty();
+		return transfer;
+	}
+
+	// Plans the transfer back to the graphics family of everything
+	// dispatched since the last join. Returns false if there was nothing.
+	bool join(ownership_transfer_type<KeyT> &transfer) {
+		if (!pending) {
+			return false;
+		}
+		transfer = plan(false);
+		if (transfers()) {
+			transfer.keys = order;
+		}
+		transfer.release.record = !transfer.keys.empty();
+		dispatched.clear();
+		order.clear();
+		pending = false;
+		return true;
+	}
+
+	// A dispatch was submitted, the graphics queue must wait for it.
+	void submitted() {
+		pending = true;
+	}
+
+	uint32_t get_graphics_family() const {
+		return graphics_family;
+	}
+
+	uint32_t get_compute_family() const {
+		return compute_family;
+	}
+
+private:
+	ownership_transfer_type<KeyT> plan(bool to_compute) const {
+		ownership_transfer_type<KeyT> transfer;
+		transfer.to_compute = to_compute;
+		const uint32_t src_family(to_compute ? graphics_family
+			: compute_family);
+		const uint32_t dst_family(to_compute ? compute_family
+			: graphics_family);
+		transfer.release = ownership_barrier_type{ false, true,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, src_family, dst_family, 0,
+			0 };
+		transfer.acquire = ownership_barrier_type{ true, false,
+			ownership_wait_stages, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			src_family, dst_family, VK_ACCESS_MEMORY_WRITE_BIT,
+			VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT };
+		return transfer;
+	}
+
+	uint32_t graphics_family, compute_family;
+	std::unordered_set<KeyT> dispatched;
+	// dispatched in the order first used.
+	std::vector<KeyT> order;
+	bool pending = false;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_OWNERSHIP_PLANNER_H_
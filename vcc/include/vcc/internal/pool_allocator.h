@@ -0,0 +1,281 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_POOL_ALLOCATOR_H_
+#define _VCC_INTERNAL_POOL_ALLOCATOR_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Sub-allocates ranges of equally sized blocks with a first fit free list
+ * per block, and plans the moves that compact sparse blocks into denser
+ * ones.
+ * Blocks are identified by index and their memory is owned by the caller,
+ * see add_block and remove_block.
+ * Does not touch any memory itself.
+ */
+class pool_allocator_type {
+public:
+	typedef uint64_t size_type;
+	typedef uint64_t id_type;
+	typedef uint64_t tag_type;
+
+	struct allocation_type {
+		std::size_t block;
+		size_type offset, size;
+	};
+
+	struct move_type {
+		id_type id;
+		allocation_type src, dst;
+	};
+
+	explicit pool_allocator_type(size_type block_size)
+		: block_size(block_size), next_id(0) {}
+	pool_allocator_type(const pool_allocator_type &) = delete;
+	pool_allocator_type(pool_allocator_type &&) = default;
+	pool_allocator_type &operator=(const pool_allocator_type &) = delete;
+	pool_allocator_type &operator=(pool_allocator_type &&) = default;
+
+	// Returns the index of a new empty block, reusing removed indices.
+	std::size_t add_block() {
+		for (std::size_t i = 0; i < blocks.size(); ++i) {
+			if (!blocks[i].live) {
+				blocks[i] = block_type(block_size);
+				return i;
+			}
+		}
+		blocks.push_back(block_type(block_size));
+		return blocks.size() - 1;
+	}
+
+	// Forgets the block, including any ranges still pending release.
+	// The block must not have any allocations.
+	void remove_block(std::size_t block) {
+		blocks[block] = block_type();
+	}
+
+	// Returns false if no block has room for size bytes, in which case the
+	// caller is expected to add a block and try again.
+	// alignment must be a power of two.
+	bool allocate(size_type size, size_type alignment, id_type &id) {
+		for (std::size_t i = 0; i < blocks.size(); ++i) {
+			size_type offset;
+			if (blocks[i].live && take(blocks[i], size, alignment, offset)) {
+				id = next_id++;
+				allocations.emplace(id, record_type{
+					allocation_type{ i, offset, size }, alignment });
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void free(id_type id) {
+		const auto it(allocations.find(id));
+		const allocation_type &allocation(it->second.allocation);
+		give(blocks[allocation.block], allocation.offset, allocation.size);
+		allocations.erase(it);
+	}
+
+	const allocation_type &get(id_type id) const {
+		return allocations.at(id).allocation;
+	}
+
+	// True if the block has no allocations.
+	bool empty(std::size_t block) const {
+		return blocks[block].live && !blocks[block].allocations;
+	}
+
+	std::size_t block_count() const {
+		return blocks.size();
+	}
+
+	// Bytes allocated in the block.
+	size_type used(std::size_t block) const {
+		return blocks[block].used;
+	}
+
+	// Relocates allocations out of the sparsest blocks, those less than
+	// half full, into denser blocks until at most max_bytes have been moved.
+	// Blocks never receive allocations from denser blocks, and an
+	// allocation only moves if it fits in a denser block. An allocation
+	// moves at most once: the copies of a pass are not ordered, a second
+	// copy could read the destination of the first before it is written.
+	// The source ranges stay reserved until release(tag) because the copies
+	// read them, the destinations are reserved immediately.
+	std::vector<move_type> defragment(size_type max_bytes, tag_type tag) {
+		std::vector<std::size_t> order;
+		for (std::size_t i = 0; i < blocks.size(); ++i) {
+			if (blocks[i].live && blocks[i].allocations) {
+				order.push_back(i);
+			}
+		}
+		std::stable_sort(order.begin(), order.end(),
+			[this](std::size_t a, std::size_t b) {
+			return blocks[a].used < blocks[b].used;
+		});
+		std::vector<move_type> moves;
+		std::unordered_set<id_type> moved_ids;
+		size_type moved(0);
+		for (std::size_t i = 0; i < order.size(); ++i) {
+			block_type &source(blocks[order[i]]);
+			if (source.used * 2 >= block_size) {
+				continue;
+			}
+			std::vector<id_type> ids;
+			for (const auto &allocation : allocations) {
+				if (allocation.second.allocation.block == order[i]
+						&& !moved_ids.count(allocation.first)) {
+					ids.push_back(allocation.first);
+				}
+			}
+			std::sort(ids.begin(), ids.end(), [this](id_type a, id_type b) {
+				return allocations.at(a).allocation.offset
+					< allocations.at(b).allocation.offset;
+			});
+			for (id_type id : ids) {
+				record_type &record(allocations.at(id));
+				if (moved + record.allocation.size > max_bytes) {
+					return moves;
+				}
+				// Densest destination first.
+				for (std::size_t j = order.size() - 1; j > i; --j) {
+					size_type offset;
+					if (take(blocks[order[j]], record.allocation.size,
+							record.alignment, offset)) {
+						const allocation_type dst{ order[j], offset,
+							record.allocation.size };
+						moves.push_back(move_type{ id, record.allocation, dst });
+						moved_ids.insert(id);
+						source.pending.push_back(pending_type{
+							record.allocation.offset, record.allocation.size,
+							tag });
+						--source.allocations;
+						source.used -= record.allocation.size;
+						record.allocation = dst;
+						moved += dst.size;
+						break;
+					}
+				}
+			}
+		}
+		return moves;
+	}
+
+	// Returns the source ranges of moves tagged with tag or lower to the
+	// free lists.
+	void release(tag_type tag) {
+		for (block_type &block : blocks) {
+			while (!block.pending.empty() && block.pending.front().tag <= tag) {
+				insert(block, block.pending.front().offset,
+					block.pending.front().size);
+				block.pending.pop_front();
+			}
+		}
+	}
+
+private:
+	struct record_type {
+		allocation_type allocation;
+		size_type alignment;
+	};
+
+	struct pending_type {
+		size_type offset, size;
+		tag_type tag;
+	};
+
+	struct block_type {
+		block_type() : live(false), used(0), allocations(0) {}
+		explicit block_type(size_type size) : live(true), used(0),
+				allocations(0) {
+			free_ranges.emplace(0, size);
+		}
+
+		bool live;
+		size_type used;
+		std::size_t allocations;
+		// Offset to size, adjacent ranges are merged.
+		std::map<size_type, size_type> free_ranges;
+		std::deque<pending_type> pending;
+	};
+
+	static bool take(block_type &block, size_type size, size_type alignment,
+			size_type &offset) {
+		for (auto it = block.free_ranges.begin(); it != block.free_ranges.end();
+				++it) {
+			const size_type begin(it->first), end(it->first + it->second);
+			const size_type aligned((begin + alignment - 1) & ~(alignment - 1));
+			if (aligned + size > end) {
+				continue;
+			}
+			block.free_ranges.erase(it);
+			if (aligned > begin) {
+				block.free_ranges.emplace(begin, aligned - begin);
+			}
+			if (aligned + size < end) {
+				block.free_ranges.emplace(aligned + size, end - aligned - size);
+			}
+			offset = aligned;
+			block.used += size;
+			++block.allocations;
+			return true;
+		}
+		return false;
+	}
+
+	static void give(block_type &block, size_type offset, size_type size) {
+		block.used -= size;
+		--block.allocations;
+		insert(block, offset, size);
+	}
+
+	static void insert(block_type &block, size_type offset, size_type size) {
+		auto next(block.free_ranges.lower_bound(offset));
+		if (next != block.free_ranges.end() && offset + size == next->first) {
+			size += next->second;
+			next = block.free_ranges.erase(next);
+		}
+		if (next != block.free_ranges.begin()) {
+			auto previous(std::prev(next));
+			if (previous->first + previous->second == offset) {
+				previous->second += size;
+				return;
+			}
+		}
+		block.free_ranges.emplace(offset, size);
+	}
+
+	size_type block_size;
+	id_type next_id;
+	std::vector<block_type> blocks;
+	std::unordered_map<id_type, record_type> allocations;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_POOL_ALLOCATOR_H_
@@ -0,0 +1,92 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_QUEUE_FAMILIES_H_
+#define _VCC_INTERNAL_QUEUE_FAMILIES_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+const uint32_t no_queue_family = ~0u;
+
+/*
+ * The families to create the queues of a device from. compute and transfer
+ * are families of their own when the device has dedicated ones, letting
+ * their work overlap with graphics, and fall back to the graphics family
+ * otherwise.
+ */
+struct queue_families_type {
+	uint32_t graphics, compute, transfer;
+};
+
+inline queue_families_type select_queue_families(
+		const std::vector<VkQueueFamilyProperties> &properties) {
+	// The first family with all of flags and none of excluded.
+	const auto find([&properties](VkQueueFlags flags, VkQueueFlags excluded) {
+		for (std::size_t i = 0; i < properties.size(); ++i) {
+			const VkQueueFlags family_flags(properties[i].queueFlags);
+			if (properties[i].queueCount && (family_flags & flags) == flags
+					&& !(family_flags & excluded)) {
+				return uint32_t(i);
+			}
+		}
+		return no_queue_family;
+	});
+	queue_families_type families;
+	families.graphics = find(VK_QUEUE_GRAPHICS_BIT, 0);
+
+	families.compute = find(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+	if (families.compute == no_queue_family) {
+		families.compute = find(VK_QUEUE_COMPUTE_BIT, 0);
+	}
+
+	// Graphics and compute families support transfers whether or not they
+	// report VK_QUEUE_TRANSFER_BIT.
+	families.transfer = find(VK_QUEUE_TRANSFER_BIT,
+		VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+	if (families.transfer == no_queue_family) {
+		families.transfer = families.compute != families.graphics
+			&& families.compute != no_queue_family
+			? families.compute : families.graphics;
+	}
+	if (families.transfer == no_queue_family) {
+		families.transfer = find(VK_QUEUE_TRANSFER_BIT, 0);
+	}
+	return families;
+}
+
+// The families of families, each once, as needed to create the device.
+inline std::vector<uint32_t> distinct_families(
+		const queue_families_type &families) {
+	std::vector<uint32_t> distinct;
+	for (uint32_t family : { families.graphics, families.compute,
+			families.transfer }) {
+		if (family != no_queue_family && std::find(distinct.begin(),
+				distinct.end(), family) == distinct.end()) {
+			distinct.push_back(family);
+		}
+	}
+	return distinct;
+}
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_QUEUE_FAMILIES_H_
@@ -0,0 +1,74 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_QUEUE_POOL_H_
+#define _VCC_INTERNAL_QUEUE_POOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Hands out the queues of a family to submitting threads. Each queue keeps
+ * its own lock, threads given different queues never wait on each other.
+ */
+template<typename QueueT>
+class queue_pool_type {
+public:
+	explicit queue_pool_type(std::vector<QueueT> &&queues)
+		: queues(std::move(queues)), next(0) {}
+
+	queue_pool_type(const queue_pool_type &) = delete;
+	queue_pool_type &operator=(const queue_pool_type &) = delete;
+
+	std::size_t size() const {
+		return queues.size();
+	}
+
+	// The queues in turn, spreading the submits of all threads.
+	QueueT &round_robin() {
+		return queues[next.fetch_add(1, std::memory_order_relaxed)
+			% queues.size()];
+	}
+
+	// The same queue for the same affinity, such as the index of a worker.
+	QueueT &affinity(std::size_t affinity) {
+		return queues[affinity % queues.size()];
+	}
+
+	// The same queue for every call of a thread.
+	QueueT &thread_affinity() {
+		return affinity(std::hash<std::thread::id>()(
+			std::this_thread::get_id()));
+	}
+
+	QueueT &at(std::size_t index) {
+		return queues[index];
+	}
+
+private:
+	std::vector<QueueT> queues;
+	std::atomic<std::size_t> next;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_QUEUE_POOL_H_
@@ -0,0 +1,110 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_RADIX_SORT_H_
+#define _VCC_INTERNAL_RADIX_SORT_H_
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vcc/internal/thread_pool.h>
+#include <vector>
+
+namespace vcc {
+namespace internal {
+
+struct sort_item_type {
+	uint64_t key;
+	uint32_t index;
+};
+
+/*
+ * Stable least significant digit radix sort of items by key, one byte per
+ * pass. Passes where all keys share the byte are skipped, keys built from a
+ * few small ids sort in a couple of passes.
+ * With a thread pool, every pass splits the items in one range per thread,
+ * counting the digits of each range and then scattering them in parallel.
+ * scratch is reused between calls to avoid allocating.
+ */
+inline void radix_sort(std::vector<sort_item_type> &items,
+		std::vector<sort_item_type> &scratch,
+		thread_pool_type *thread_pool = nullptr) {
+	typedef std::array<std::size_t, 256> histogram_type;
+	// Below this, splitting costs more than it saves.
+	const std::size_t min_parallel_count(16384);
+	const std::size_t count(items.size());
+	scratch.resize(count);
+	const std::size_t parts(thread_pool && count >= min_parallel_count
+		? thread_pool->size() : 1);
+	std::vector<histogram_type> histograms(parts);
+	const auto run = [thread_pool, parts](
+			const std::function<void(std::size_t)> &function) {
+		if (parts == 1) {
+			function(0);
+		} else {
+			thread_pool->parallel_for(parts, function);
+		}
+	};
+
+	sort_item_type *source(items.data()), *destination(scratch.data());
+	for (unsigned int shift = 0; shift < 64; shift += 8) {
+		run([&](std::size_t part) {
+			const std::pair<std::size_t, std::size_t> range(
+				partition_range(count, parts, part));
+			histogram_type &histogram(histograms[part]);
+			histogram.fill(0);
+			for (std::size_t i = range.first; i < range.second; ++i) {
+				++histogram[(source[i].key >> shift) & 0xff];
+			}
+		});
+		// Turn the counts into the first destination of every digit and
+		// part, parts of a digit are placed in order to keep it stable.
+		std::size_t offset(0);
+		bool skip(false);
+		for (std::size_t digit = 0; digit < 256; ++digit) {
+			const std::size_t begin(offset);
+			for (histogram_type &histogram : histograms) {
+				const std::size_t digit_count(histogram[digit]);
+				histogram[digit] = offset;
+				offset += digit_count;
+			}
+			if (offset - begin == count) {
+				skip = true;
+				break;
+			}
+		}
+		if (skip) {
+			continue;
+		}
+		run([&](std::size_t part) {
+			const std::pair<std::size_t, std::size_t> range(
+				partition_range(count, parts, part));
+			histogram_type &histogram(histograms[part]);
+			for (std::size_t i = range.first; i < range.second; ++i) {
+				destination[histogram[(source[i].key >> shift) & 0xff]++] =
+					source[i];
+			}
+		});
+		std::swap(source, destination);
+	}
+	if (source != items.data()) {
+		items.swap(scratch);
+	}
+}
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_RADIX_SORT_H_
@@ -0,0 +1,81 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_RECYCLER_H_
+#define _VCC_INTERNAL_RECYCLER_H_
+
+#include <cstdint>
+#include <deque>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Items, such as command pools, used by submissions identified by
+ * increasing tags. The item of the tag being recorded is shared by all
+ * users of that tag, items are handed out again once their tag completed.
+ */
+template<typename T>
+class recycler_type {
+public:
+	typedef uint64_t tag_type;
+
+	recycler_type() = default;
+	recycler_type(const recycler_type &) = delete;
+	recycler_type(recycler_type &&) = default;
+	recycler_type &operator=(const recycler_type &) = delete;
+	recycler_type &operator=(recycler_type &&) = default;
+
+	// Returns the item of tag, or the oldest item whose tag is completed
+	// or lower in which case recycled is set and the caller is expected to
+	// reset it. Returns nullptr if the caller has to add a new item.
+	T *get(tag_type tag, tag_type completed, bool &recycled) {
+		recycled = false;
+		if (!entries.empty() && entries.back().tag == tag) {
+			return &entries.back().item;
+		}
+		if (!entries.empty() && entries.front().tag <= completed) {
+			entries.push_back(std::move(entries.front()));
+			entries.pop_front();
+			entries.back().tag = tag;
+			recycled = true;
+			return &entries.back().item;
+		}
+		return nullptr;
+	}
+
+	T &add(T &&item, tag_type tag) {
+		entries.push_back(entry_type{ std::forward<T>(item), tag });
+		return entries.back().item;
+	}
+
+	std::size_t size() const {
+		return entries.size();
+	}
+
+private:
+	struct entry_type {
+		T item;
+		tag_type tag;
+	};
+
+	// Ordered by tag.
+	std::deque<entry_type> entries;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_RECYCLER_H_
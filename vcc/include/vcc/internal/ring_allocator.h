@@ -0,0 +1,149 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_RING_ALLOCATOR_H_
+#define _VCC_INTERNAL_RING_ALLOCATOR_H_
+
+#include <cstdint>
+#include <deque>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Sub-allocates ranges of a fixed size region in FIFO order.
+ * Allocations are grouped by commit() under a tag, typically the index of
+ * the submission that consumes them, and are returned by release() once
+ * that submission is known to be finished.
+ * Does not touch any memory itself, offsets are relative to the region.
+ */
+class ring_allocator_type {
+public:
+	typedef uint64_t size_type;
+	typedef uint64_t tag_type;
+
+	ring_allocator_type() : capacity(0), head(0), tail(0), wrapped(false),
+		uncommitted(0) {}
+	explicit ring_allocator_type(size_type capacity) : capacity(capacity),
+		head(0), tail(0), wrapped(false), uncommitted(0) {}
+	ring_allocator_type(const ring_allocator_type &) = delete;
+	ring_allocator_type(ring_allocator_type &&) = default;
+	ring_allocator_type &operator=(const ring_allocator_type &) = delete;
+	ring_allocator_type &operator=(ring_allocator_type &&) = default;
+
+	// Returns false if there is no room for size bytes until older
+	// allocations are released. alignment must be a power of two.
+	bool allocate(size_type size, size_type alignment, size_type &offset) {
+		if (!size) {
+			offset = head;
+			return true;
+		}
+		if (size > capacity) {
+			return false;
+		}
+		if (allocations.empty()) {
+			head = tail = 0;
+			wrapped = false;
+		}
+		const size_type aligned((head + alignment - 1) & ~(alignment - 1));
+		bool wraps(false);
+		if (allocations.empty()) {
+			offset = 0;
+		} else if (!wrapped) {
+			if (aligned + size <= capacity) {
+				offset = aligned;
+			} else if (size <= tail) {
+				offset = 0;
+				wraps = true;
+			} else {
+				return false;
+			}
+		} else if (aligned + size <= tail) {
+			offset = aligned;
+		} else {
+			return false;
+		}
+		wrapped = wrapped || wraps;
+		head = offset + size;
+		allocations.push_back(allocation_type{ head, 0, wraps });
+		++uncommitted;
+		return true;
+	}
+
+	// Tags all allocations made since the last commit.
+	void commit(tag_type tag) {
+		for (std::size_t i = allocations.size() - uncommitted;
+				i < allocations.size(); ++i) {
+			allocations[i].tag = tag;
+		}
+		uncommitted = 0;
+	}
+
+	// Returns the space of all committed allocations tagged with tag or
+	// lower. Tags are expected to be increasing.
+	void release(tag_type tag) {
+		while (allocations.size() > uncommitted
+				&& allocations.front().tag <= tag) {
+			tail = allocations.front().end;
+			allocations.pop_front();
+			// The skipped end of the region is free once the oldest live
+			// allocation is the one that restarted at the beginning.
+			if (!allocations.empty() && allocations.front().wraps) {
+				allocations.front().wraps = false;
+				wrapped = false;
+				tail = 0;
+			}
+		}
+		if (allocations.empty()) {
+			head = tail = 0;
+			wrapped = false;
+		}
+	}
+
+	bool empty() const {
+		return allocations.empty();
+	}
+
+	size_type size() const {
+		return capacity;
+	}
+
+	// Bytes unavailable for allocation, including padding and the unused
+	// tail skipped when wrapping.
+	size_type used() const {
+		if (allocations.empty()) {
+			return 0;
+		}
+		return wrapped ? capacity - tail + head : head - tail;
+	}
+
+private:
+	struct allocation_type {
+		size_type end;
+		tag_type tag;
+		// The allocation restarted at the beginning of the region.
+		bool wraps;
+	};
+
+	size_type capacity, head, tail;
+	bool wrapped;
+	std::size_t uncommitted;
+	std::deque<allocation_type> allocations;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_RING_ALLOCATOR_H_
@@ -0,0 +1,322 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_STATE_TRACKER_H_
+#define _VCC_INTERNAL_STATE_TRACKER_H_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+// Identifies a handle, dispatchable or not, by value.
+template<typename T>
+uint64_t handle_key(T *handle) {
+	return uint64_t(reinterpret_cast<uintptr_t>(handle));
+}
+
+inline uint64_t handle_key(uint64_t handle) {
+	return handle;
+}
+
+/*
+ * Remembers the state bound in a command buffer while recording, each
+ * function returns false if the given state is already bound, in which
+ * case the command does not need to be recorded.
+ * Handles are compared by handle_key.
+ *
+ * Conservative where the state is not known:
+ * - Binding another graphics pipeline forgets the dynamic state, the
+ *   pipeline may have made it static.
+ * - Binding descriptor sets with another pipeline layout forgets all sets
+ *   of that bind point, layout compatibility is not known.
+ * - invalidate forgets everything, for commands leaving the state
+ *   undefined such as vkCmdExecuteCommands.
+ * Push constants are known by the revision of the content of their layout,
+ * forget_push_constants is for pushes of other values.
+ */
+class state_tracker_type {
+public:
+	template<typename HandleT>
+	bool bind_pipeline(VkPipelineBindPoint bind_point, HandleT pipeline) {
+		bind_point_type &point(get(bind_point));
+		if (!point.pipeline.update(handle_key(pipeline))) {
+			return false;
+		}
+		if (bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS) {
+			dynamic = dynamic_type();
+		}
+		return true;
+	}
+
+	template<typename LayoutT, typename SetT>
+	bool bind_descriptor_sets(VkPipelineBindPoint bind_point, LayoutT layout,
+			uint32_t first_set, const std::vector<SetT> &sets,
+			const std::vector<uint32_t> &dynamic_offsets) {
+		bind_point_type &point(get(bind_point));
+		if (!point.layout.update(handle_key(layout))) {
+			bool bound(point.sets.size() >= first_set + sets.size());
+			for (std::size_t i = 0; bound && i < sets.size(); ++i) {
+				const set_type &set(point.sets[first_set + i]);
+				// Dynamic offsets are matched per call, which set they
+				// belong to is not known.
+				bound = set.valid && set.set == handle_key(sets[i])
+					&& ((set.dynamic_offsets.empty() && dynamic_offsets.empty())
+						|| (set.first_set == first_set
+							&& set.count == sets.size()
+							&& set.dynamic_offsets == dynamic_offsets));
+			}
+			if (bound) {
+				return false;
+			}
+		} else {
+			point.sets.clear();
+		}
+		if (point.sets.size() < first_set + sets.size()) {
+			point.sets.resize(first_set + sets.size());
+		}
+		for (std::size_t i = 0; i < sets.size(); ++i) {
+			set_type &set(point.sets[first_set + i]);
+			set.valid = true;
+			set.set = handle_key(sets[i]);
+			set.first_set = first_set;
+			set.count = sets.size();
+			set.dynamic_offsets = dynamic_offsets;
+		}
+		return true;
+	}
+
+	template<typename HandleT>
+	bool bind_index_buffer(HandleT buffer, VkDeviceSize offset,
+			VkIndexType index_type) {
+		return index_buffer.update(index_buffer_type{ handle_key(buffer),
+			offset, index_type });
+	}
+
+	template<typename HandleT>
+	bool bind_vertex_buffers(uint32_t first_binding,
+			const std::vector<HandleT> &buffers,
+			const std::vector<VkDeviceSize> &offsets) {
+		if (vertex_buffers.size() < first_binding + buffers.size()) {
+			vertex_buffers.resize(first_binding + buffers.size());
+		}
+		bool changed(false);
+		for (std::size_t i = 0; i < buffers.size(); ++i) {
+			changed |= vertex_buffers[first_binding + i].update(
+				vertex_buffer_type{ handle_key(buffers[i]), offsets[i] });
+		}
+		return changed;
+	}
+
+	// Returns false if this revision of the push constants of layout is the
+	// last one pushed.
+	template<typename HandleT>
+	bool push_constants(HandleT layout, uint64_t revision) {
+		return constants.update(std::make_pair(handle_key(layout), revision));
+	}
+
+	void forget_push_constants() {
+		constants = cached_type<std::pair<uint64_t, uint64_t>>();
+	}
+
+	bool set_viewport(uint32_t first_viewport,
+			const std::vector<VkViewport> &viewports) {
+		return update_range(dynamic.viewports, first_viewport, viewports);
+	}
+
+	bool set_scissor(uint32_t first_scissor,
+			const std::vector<VkRect2D> &scissors) {
+		return update_range(dynamic.scissors, first_scissor, scissors);
+	}
+
+	bool set_line_width(float line_width) {
+		return dynamic.line_width.update(line_width);
+	}
+
+	bool set_depth_bias(float constant_factor, float clamp,
+			float slope_factor) {
+		return dynamic.depth_bias.update(std::array<float, 3>{ {
+			constant_factor, clamp, slope_factor } });
+	}
+
+	bool set_blend_constants(const std::array<float, 4> &blend_constants) {
+		return dynamic.blend_constants.update(blend_constants);
+	}
+
+	bool set_depth_bounds(float min_depth_bounds, float max_depth_bounds) {
+		return dynamic.depth_bounds.update(std::array<float, 2>{ {
+			min_depth_bounds, max_depth_bounds } });
+	}
+
+	bool set_stencil_compare_mask(VkStencilFaceFlags face_mask,
+			uint32_t compare_mask) {
+		return update_faces(dynamic.stencil_compare_mask, face_mask,
+			compare_mask);
+	}
+
+	bool set_stencil_write_mask(VkStencilFaceFlags face_mask,
+			uint32_t write_mask) {
+		return update_faces(dynamic.stencil_write_mask, face_mask, write_mask);
+	}
+
+	bool set_stencil_reference(VkStencilFaceFlags face_mask,
+			uint32_t reference) {
+		return update_faces(dynamic.stencil_reference, face_mask, reference);
+	}
+
+	void invalidate() {
+		bind_points.clear();
+		index_buffer = cached_type<index_buffer_type>();
+		vertex_buffers.clear();
+		constants = cached_type<std::pair<uint64_t, uint64_t>>();
+		dynamic = dynamic_type();
+	}
+
+private:
+	template<typename T>
+	static bool same(const T &a, const T &b) {
+		return a == b;
+	}
+
+	// Compared bytewise, the structures have no padding.
+	static bool same(const VkViewport &a, const VkViewport &b) {
+		return !std::memcmp(&a, &b, sizeof(a));
+	}
+
+	static bool same(const VkRect2D &a, const VkRect2D &b) {
+		return !std::memcmp(&a, &b, sizeof(a));
+	}
+
+	template<typename T>
+	struct cached_type {
+		cached_type() : valid(false) {}
+
+		// Returns false if value is already the cached one.
+		bool update(const T &value) {
+			if (valid && same(this->value, value)) {
+				return false;
+			}
+			this->value = value;
+			valid = true;
+			return true;
+		}
+
+		bool valid;
+		T value;
+	};
+
+	template<typename T>
+	static bool update_range(std::vector<cached_type<T>> &cache,
+			uint32_t first, const std::vector<T> &values) {
+		if (cache.size() < first + values.size()) {
+			cache.resize(first + values.size());
+		}
+		bool changed(false);
+		for (std::size_t i = 0; i < values.size(); ++i) {
+			changed |= cache[first + i].update(values[i]);
+		}
+		return changed;
+	}
+
+	// Front and back face.
+	static bool update_faces(std::array<cached_type<uint32_t>, 2> &cache,
+			VkStencilFaceFlags face_mask, uint32_t value) {
+		bool changed(false);
+		if (face_mask & VK_STENCIL_FACE_FRONT_BIT) {
+			changed |= cache[0].update(value);
+		}
+		if (face_mask & VK_STENCIL_FACE_BACK_BIT) {
+			changed |= cache[1].update(value);
+		}
+		return changed;
+	}
+
+	struct set_type {
+		set_type() : valid(false) {}
+
+		bool valid;
+		uint64_t set;
+		// The call binding the set.
+		uint32_t first_set;
+		std::size_t count;
+		std::vector<uint32_t> dynamic_offsets;
+	};
+
+	struct bind_point_type {
+		VkPipelineBindPoint bind_point;
+		cached_type<uint64_t> pipeline, layout;
+		std::vector<set_type> sets;
+	};
+
+	struct index_buffer_type {
+		uint64_t buffer;
+		VkDeviceSize offset;
+		VkIndexType index_type;
+
+		bool operator==(const index_buffer_type &value) const {
+			return buffer == value.buffer && offset == value.offset
+				&& index_type == value.index_type;
+		}
+	};
+
+	struct vertex_buffer_type {
+		uint64_t buffer;
+		VkDeviceSize offset;
+
+		bool operator==(const vertex_buffer_type &value) const {
+			return buffer == value.buffer && offset == value.offset;
+		}
+	};
+
+	struct dynamic_type {
+		std::vector<cached_type<VkViewport>> viewports;
+		std::vector<cached_type<VkRect2D>> scissors;
+		cached_type<float> line_width;
+		cached_type<std::array<float, 3>> depth_bias;
+		cached_type<std::array<float, 4>> blend_constants;
+		cached_type<std::array<float, 2>> depth_bounds;
+		std::array<cached_type<uint32_t>, 2> stencil_compare_mask,
+			stencil_write_mask, stencil_reference;
+	};
+
+	bind_point_type &get(VkPipelineBindPoint bind_point) {
+		for (bind_point_type &point : bind_points) {
+			if (point.bind_point == bind_point) {
+				return point;
+			}
+		}
+		bind_points.push_back(bind_point_type());
+		bind_points.back().bind_point = bind_point;
+		return bind_points.back();
+	}
+
+	// Graphics and compute, searched linearly.
+	std::vector<bind_point_type> bind_points;
+	cached_type<index_buffer_type> index_buffer;
+	std::vector<cached_type<vertex_buffer_type>> vertex_buffers;
+	// Layout and revision of the last push constants.
+	cached_type<std::pair<uint64_t, uint64_t>> constants;
+	dynamic_type dynamic;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_STATE_TRACKER_H_
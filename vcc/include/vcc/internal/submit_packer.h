@@ -0,0 +1,108 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_SUBMIT_PACKER_H_
+#define _VCC_INTERNAL_SUBMIT_PACKER_H_
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Flattens the semaphores and command buffers of several submits into the
+ * arrays of a single vkQueueSubmit. The storage is kept by clear, a packer
+ * reused every frame stops allocating once it has seen its largest batch.
+ */
+class submit_packer_type {
+public:
+	// Starts the next submit, the calls below add to it.
+	void begin() {
+		entries.push_back(entry_type{ wait_semaphores.size(),
+			command_buffers.size(), signal_semaphores.size() });
+	}
+
+	void wait(VkSemaphore semaphore, VkPipelineStageFlags stage_mask) {
+		wait_semaphores.push_back(semaphore);
+		wait_stage_masks.push_back(stage_mask);
+	}
+
+	void command_buffer(VkCommandBuffer command_buffer) {
+		command_buffers.push_back(command_buffer);
+	}
+
+	void signal(VkSemaphore semaphore) {
+		signal_semaphores.push_back(semaphore);
+	}
+
+	bool empty() const {
+		return entries.empty();
+	}
+
+	// Returns one VkSubmitInfo per submit, pointing into the packer and valid
+	// until it is changed.
+	const std::vector<VkSubmitInfo> &pack() {
+		infos.clear();
+		for (std::size_t i = 0; i < entries.size(); ++i) {
+			const entry_type &entry(entries[i]);
+			const entry_type end(i + 1 < entries.size() ? entries[i + 1]
+				: entry_type{ wait_semaphores.size(), command_buffers.size(),
+					signal_semaphores.size() });
+			VkSubmitInfo info = { VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL };
+			info.waitSemaphoreCount = uint32_t(end.wait - entry.wait);
+			info.pWaitSemaphores = info.waitSemaphoreCount
+				? &wait_semaphores[entry.wait] : NULL;
+			info.pWaitDstStageMask = info.waitSemaphoreCount
+				? &wait_stage_masks[entry.wait] : NULL;
+			info.commandBufferCount = uint32_t(end.command_buffer
+				- entry.command_buffer);
+			info.pCommandBuffers = info.commandBufferCount
+				? &command_buffers[entry.command_buffer] : NULL;
+			info.signalSemaphoreCount = uint32_t(end.signal - entry.signal);
+			info.pSignalSemaphores = info.signalSemaphoreCount
+				? &signal_semaphores[entry.signal] : NULL;
+			infos.push_back(info);
+		}
+		return infos;
+	}
+
+	void clear() {
+		entries.clear();
+		wait_semaphores.clear();
+		wait_stage_masks.clear();
+		command_buffers.clear();
+		signal_semaphores.clear();
+		infos.clear();
+	}
+
+private:
+	// Offsets of the first semaphores and command buffer of a submit.
+	struct entry_type {
+		std::size_t wait, command_buffer, signal;
+	};
+
+	std::vector<entry_type> entries;
+	std::vector<VkSemaphore> wait_semaphores;
+	std::vector<VkPipelineStageFlags> wait_stage_masks;
+	std::vector<VkCommandBuffer> command_buffers;
+	std::vector<VkSemaphore> signal_semaphores;
+	std::vector<VkSubmitInfo> infos;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_SUBMIT_PACKER_H_
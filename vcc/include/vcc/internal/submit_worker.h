@@ -0,0 +1,102 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_SUBMIT_WORKER_H_
+#define _VCC_INTERNAL_SUBMIT_WORKER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vcc/internal/mpsc_queue.h>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * A thread running the calls into the driver of one queue, such as
+ * vkQueueSubmit and vkQueuePresentKHR, one at a time in the order they were
+ * enqueued. Producers only push onto a lock-free queue, the mutex is taken
+ * to wake the thread when it ran out of work.
+ * Tasks still enqueued when destroyed are run first.
+ */
+class submit_worker_type {
+public:
+	typedef std::packaged_task<VkResult()> task_type;
+
+	submit_worker_type() : running(true), sleeping(false),
+		thread([this]() { run(); }) {}
+	submit_worker_type(const submit_worker_type &) = delete;
+	submit_worker_type(submit_worker_type &&) = delete;
+	submit_worker_type &operator=(const submit_worker_type &) = delete;
+	submit_worker_type &operator=(submit_worker_type &&) = delete;
+
+	~submit_worker_type() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		wake.notify_one();
+		thread.join();
+	}
+
+	// Returns the result of function once run by the thread, or the
+	// exception it threw.
+	template<typename FunctionT>
+	std::future<VkResult> enqueue(FunctionT &&function) {
+		task_type task(std::forward<FunctionT>(function));
+		std::future<VkResult> future(task.get_future());
+		tasks.push(std::move(task));
+		if (sleeping.load()) {
+			std::lock_guard<std::mutex> lock(mutex);
+			wake.notify_one();
+		}
+		return future;
+	}
+
+private:
+	void run() {
+		task_type task;
+		for (;;) {
+			while (tasks.pop(task)) {
+				task();
+			}
+			std::unique_lock<std::mutex> lock(mutex);
+			// Set before looking at the queue, a producer either sees it or
+			// pushed before the wait below looks.
+			sleeping.store(true);
+			wake.wait(lock, [this]() { return !running || !tasks.empty(); });
+			sleeping.store(false);
+			if (!running && tasks.empty()) {
+				return;
+			}
+		}
+	}
+
+	mpsc_queue_type<task_type> tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool running;
+	std::atomic<bool> sleeping;
+	std::thread thread;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_SUBMIT_WORKER_H_
@@ -0,0 +1,96 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_SYNC_POOL_H_
+#define _VCC_INTERNAL_SYNC_POOL_H_
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Synchronization objects, such as fences and semaphores, handed out again
+ * once the GPU is done with them instead of being destroyed.
+ * Items released with a tag are in use until the tag is completed, tags
+ * being increasing like those of the flush batch. Items no longer in use
+ * are reset all at once when the pool runs out of ready items.
+ */
+template<typename T>
+class sync_pool_type {
+public:
+	typedef uint64_t tag_type;
+
+	sync_pool_type() = default;
+	sync_pool_type(const sync_pool_type &) = delete;
+	sync_pool_type(sync_pool_type &&) = default;
+	sync_pool_type &operator=(const sync_pool_type &) = delete;
+	sync_pool_type &operator=(sync_pool_type &&) = default;
+
+	// Moves an item into item and returns true, or returns false if the
+	// caller has to create one. Calls reset(std::vector<T> &) with the
+	// items to reset before they are handed out, if any.
+	template<typename ResetT>
+	bool acquire(tag_type completed, T &item, ResetT reset) {
+		while (!pending.empty() && pending.front().tag <= completed) {
+			unused.push_back(std::move(pending.front().item));
+			pending.pop_front();
+		}
+		if (ready.empty() && !unused.empty()) {
+			reset(unused);
+			ready.swap(unused);
+		}
+		if (ready.empty()) {
+			return false;
+		}
+		item = std::move(ready.back());
+		ready.pop_back();
+		return true;
+	}
+
+	// The item may be used by the GPU until tag is completed. Tags must not
+	// decrease between calls.
+	void release(T &&item, tag_type tag) {
+		pending.push_back(entry_type{ std::move(item), tag });
+	}
+
+	// The item is no longer used by the GPU, such as a signaled fence.
+	void release(T &&item) {
+		unused.push_back(std::move(item));
+	}
+
+	// Items owned by the pool.
+	std::size_t size() const {
+		return ready.size() + unused.size() + pending.size();
+	}
+
+private:
+	struct entry_type {
+		T item;
+		tag_type tag;
+	};
+
+	std::vector<T> ready, unused;
+	// Ordered by tag.
+	std::deque<entry_type> pending;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_SYNC_POOL_H_
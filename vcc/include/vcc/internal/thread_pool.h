@@ -0,0 +1,157 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_THREAD_POOL_H_
+#define _VCC_INTERNAL_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace vcc {
+namespace internal {
+
+// Returns the range [begin, end) of the given part when count items are
+// split into parts of sizes differing by at most one.
+inline std::pair<std::size_t, std::size_t> partition_range(std::size_t count,
+		std::size_t parts, std::size_t part) {
+	const std::size_t size(count / parts), remainder(count % parts);
+	const std::size_t begin(part * size + (part < remainder ? part : remainder));
+	return std::make_pair(begin, begin + size + (part < remainder ? 1 : 0));
+}
+
+/*
+ * Fixed set of worker threads running the iterations of parallel_for.
+ * The calling thread takes part, so a pool of N - 1 workers keeps N
+ * threads busy.
+ */
+class thread_pool_type {
+public:
+	typedef std::function<void(std::size_t)> function_type;
+
+	explicit thread_pool_type(std::size_t workers) : running(true),
+			generation(0), function(nullptr), count(0), next(0), pending(0),
+			active(0) {
+		threads.reserve(workers);
+		for (std::size_t i = 0; i < workers; ++i) {
+			threads.emplace_back([this]() { run(); });
+		}
+	}
+	thread_pool_type(const thread_pool_type &) = delete;
+	thread_pool_type(thread_pool_type &&) = delete;
+	thread_pool_type &operator=(const thread_pool_type &) = delete;
+	thread_pool_type &operator=(thread_pool_type &&) = delete;
+
+	~thread_pool_type() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		work.notify_all();
+		for (std::thread &thread : threads) {
+			thread.join();
+		}
+	}
+
+	std::size_t size() const {
+		return threads.size() + 1;
+	}
+
+	// Calls function with every index in [0, count) and returns once all
+	// calls returned. The first exception thrown is rethrown.
+	// Must not be called concurrently.
+	void parallel_for(std::size_t count, const function_type &function) {
+		{
+			// Workers late for the previous call must be done with it.
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this]() { return !active; });
+			this->function = &function;
+			this->count = count;
+			next = 0;
+			pending = count;
+			exception = nullptr;
+			++generation;
+		}
+		work.notify_all();
+		iterate();
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this]() { return !pending && !active; });
+		this->function = nullptr;
+		if (exception) {
+			std::rethrow_exception(exception);
+		}
+	}
+
+private:
+	void run() {
+		uint64_t seen(0);
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				work.wait(lock, [this, seen]() {
+					return !running || generation != seen;
+				});
+				if (!running) {
+					return;
+				}
+				seen = generation;
+				++active;
+			}
+			iterate();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!--active) {
+				done.notify_all();
+			}
+		}
+	}
+
+	void iterate() {
+		for (std::size_t i = next++; i < count; i = next++) {
+			try {
+				(*function)(i);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!exception) {
+					exception = std::current_exception();
+				}
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!--pending) {
+				done.notify_all();
+			}
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable work, done;
+	bool running;
+	uint64_t generation;
+	const function_type *function;
+	std::size_t count;
+	std::atomic<std::size_t> next;
+	std::size_t pending, active;
+	std::exception_ptr exception;
+	std::vector<std::thread> threads;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_THREAD_POOL_H_
@@ -0,0 +1,108 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_UNIFORM_BLOCKS_H_
+#define _VCC_INTERNAL_UNIFORM_BLOCKS_H_
+
+#include <string>
+#include <vcc/internal/version_tracker.h>
+#include <vcc/util.h>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * The layout of the blocks of a uniform arena and their latest content,
+ * with one copy per frame in flight written through a callback.
+ * The queue is anything with:
+ *   tag_type completed(), the last submit known to have finished,
+ *   bool wait(), blocking for the oldest submit in flight, false if none,
+ *   tag_type track(), the tag of the submit that will read the copy.
+ */
+class uniform_blocks_type {
+public:
+	typedef version_tracker_type::tag_type tag_type;
+
+	uniform_blocks_type() : size(0), range(0), alignment(1) {}
+	uniform_blocks_type(VkDeviceSize size, VkDeviceSize range,
+		VkDeviceSize alignment, std::size_t frames)
+		: versions(frames), size(size), range(range), alignment(alignment) {}
+
+	// Returns the offset of a new block of block_size bytes, aligned and
+	// leaving room for the descriptor range after it.
+	VkDeviceSize add(VkDeviceSize block_size) {
+		if (block_size > range) {
+			throw vcc_exception("Uniform block is larger than the arena range");
+		}
+		const VkDeviceSize offset((shadow.size() + alignment - 1) / alignment
+			* alignment);
+		// The descriptor reads range bytes from every block offset.
+		if (offset + range > size) {
+			throw vcc_exception("Uniform arena is full");
+		}
+		shadow.resize(std::size_t(offset + block_size), '\0');
+		versions.update();
+		return offset;
+	}
+
+	// The latest content, blocks are serialized at their offset.
+	char *content() {
+		return &shadow[0];
+	}
+
+	std::size_t frames() const {
+		return versions.size();
+	}
+
+	/*
+	 * Brings the copy of frame up to date once the submit that last read it
+	 * has finished, calling write(version, content, size), and tags it with
+	 * the submit that reads it next. changed is true if any block was
+	 * serialized since the last flush. Returns true if the copy was
+	 * written.
+	 */
+	template<typename QueueT, typename WriteT>
+	bool flush(QueueT &queue, uint32_t frame, bool changed, WriteT write) {
+		const std::size_t version(frame % versions.size());
+		if (changed) {
+			versions.update();
+		}
+		const bool stale(versions.stale(version));
+		if (stale) {
+			// Never write a frame the GPU may still be reading.
+			while (versions.busy(version, queue.completed())
+				&& queue.wait()) {}
+			write(version, shadow.data(), shadow.size());
+			versions.write(version);
+		}
+		versions.use(version, queue.track());
+		return stale;
+	}
+
+private:
+	version_tracker_type versions;
+	std::string shadow;
+	// Bytes available per frame.
+	VkDeviceSize size;
+	// The descriptor range, no block is larger.
+	VkDeviceSize range;
+	VkDeviceSize alignment;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_UNIFORM_BLOCKS_H_
@@ -0,0 +1,76 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_UPDATE_PLAN_H_
+#define _VCC_INTERNAL_UPDATE_PLAN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+// vkCmdUpdateBuffer is limited to 65536 bytes, at offsets and sizes that
+// are multiples of 4.
+const uint64_t max_update_size(65536);
+
+struct update_plan_type {
+	// Record the range inline with vkCmdUpdateBuffer instead of writing it
+	// through memory.
+	bool inline_update;
+	uint64_t offset, size;
+};
+
+// Decides how the dirty range [begin, end) of a buffer of the given size is
+// flushed. Inline updates are widened to 4 byte boundaries and chosen if
+// the widened range is no larger than threshold.
+inline update_plan_type plan_update(uint64_t begin, uint64_t end,
+		uint64_t buffer_size, uint64_t threshold) {
+	const uint64_t offset(begin & ~uint64_t(3));
+	const uint64_t last((end + 3) & ~uint64_t(3));
+	if (last <= buffer_size && last - offset <= threshold
+			&& last - offset <= max_update_size) {
+		return update_plan_type{ true, offset, last - offset };
+	}
+	return update_plan_type{ false, begin, end - begin };
+}
+
+/*
+ * Records the inline update of plan into the flush command buffer through
+ * recorder, which records for the buffer being updated:
+ *   barrier(src_stages, dst_stages, src_access, dst_access, offset, size)
+ *   update(offset, size, data)
+ * and adds to the barrier at the end of the flush:
+ *   flush_barrier(src_stages, src_access, dst_access)
+ * Earlier submits may still use the range, the update waits for them as
+ * staging_buffer::upload does. content holds the whole buffer.
+ */
+template<typename RecorderT>
+void record_update(RecorderT &recorder, const update_plan_type &plan,
+		const char *content) {
+	recorder.barrier(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_MEMORY_WRITE_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT, plan.offset, plan.size);
+	recorder.update(plan.offset, plan.size,
+		content + std::size_t(plan.offset));
+	recorder.flush_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT);
+}
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_UPDATE_PLAN_H_
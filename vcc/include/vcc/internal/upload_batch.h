@@ -0,0 +1,133 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_UPLOAD_BATCH_H_
+#define _VCC_INTERNAL_UPLOAD_BATCH_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vcc {
+namespace internal {
+
+// The fields of a buffer or image memory barrier and of the
+// vkCmdPipelineBarrier recording it.
+struct barrier_half_type {
+	VkPipelineStageFlags src_stages, dst_stages;
+	VkAccessFlags src_access, dst_access;
+	uint32_t src_family, dst_family;
+	VkImageLayout old_layout, new_layout;
+};
+
+struct upload_barriers_type {
+	// Recorded on the transfer queue after the copy.
+	barrier_half_type release;
+	// Recorded on the graphics queue, in the batch waiting for the transfer
+	// queue at the source stages of the acquire.
+	barrier_half_type acquire;
+	bool acquire_needed;
+};
+
+enum upload_queues_type {
+	// Copies are recorded on the graphics queue itself.
+	upload_same_queue,
+	// A transfer queue of the graphics family, a semaphore is enough.
+	upload_same_family,
+	// A queue of another family, ownership is transferred.
+	upload_other_family
+};
+
+/*
+ * The barriers making a copy written by the transfer queue in
+ * transfer_layout available to the graphics queue in layout, for the
+ * accesses dst_access at dst_stages. Layouts are ignored for buffers.
+ * The layout transition is done by the release, and repeated by the
+ * acquire of an ownership transfer as the specification requires.
+ * The graphics queue waits for the semaphore at dst_stages, the acquire
+ * starts from there: a semaphore wait only orders its own batch, the
+ * acquire chains the work submitted after it. Between queues of the same
+ * family it makes the copy visible without transferring ownership.
+ */
+inline upload_barriers_type upload_barriers(upload_queues_type queues,
+		uint32_t transfer_family, uint32_t graphics_family,
+		VkImageLayout transfer_layout, VkImageLayout layout,
+		VkPipelineStageFlags dst_stages, VkAccessFlags dst_access) {
+	upload_barriers_type barriers;
+	barrier_half_type &release(barriers.release);
+	release.src_stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	release.src_access = VK_ACCESS_TRANSFER_WRITE_BIT;
+	release.old_layout = transfer_layout;
+	release.new_layout = layout;
+	release.src_family = release.dst_family = VK_QUEUE_FAMILY_IGNORED;
+	if (queues == upload_same_queue) {
+		release.dst_stages = dst_stages;
+		release.dst_access = dst_access;
+	} else {
+		release.dst_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		release.dst_access = 0;
+	}
+	if (queues == upload_other_family) {
+		release.src_family = transfer_family;
+		release.dst_family = graphics_family;
+	}
+	barriers.acquire_needed = queues != upload_same_queue;
+	barrier_half_type &acquire(barriers.acquire);
+	acquire = release;
+	acquire.src_stages = dst_stages;
+	acquire.dst_stages = dst_stages;
+	acquire.src_access = 0;
+	acquire.dst_access = dst_access;
+	if (queues == upload_same_family) {
+		// Already transitioned by the release.
+		acquire.old_layout = layout;
+	}
+	return barriers;
+}
+
+/*
+ * The acquire halves of the uploads recorded on the transfer queue since
+ * the last submit. Not synchronized: add is called after recording the
+ * release into the flush command buffer of the transfer queue, and take
+ * before submitting it, both under lock_flush of the transfer queue, so
+ * that every acquire taken is for a release in that submit.
+ */
+template<typename T>
+class upload_batch_type {
+public:
+	void add(T &&acquire) {
+		acquires.push_back(std::move(acquire));
+	}
+
+	// Moves the acquires into taken, returns false if there was no upload.
+	bool take(std::vector<T> &taken) {
+		taken.clear();
+		taken.swap(acquires);
+		return !taken.empty();
+	}
+
+	bool empty() const {
+		return acquires.empty();
+	}
+
+private:
+	std::vector<T> acquires;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_UPLOAD_BATCH_H_
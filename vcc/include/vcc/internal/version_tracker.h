@@ -0,0 +1,80 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef _VCC_INTERNAL_VERSION_TRACKER_H_
+#define _VCC_INTERNAL_VERSION_TRACKER_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace vcc {
+namespace internal {
+
+/*
+ * Tracks N copies of the same content, one per frame in flight.
+ * A version is stale when it was written before the last update() and
+ * busy while the submission tagged by its last use() has not completed.
+ * Tags are increasing, a version used by tag t is free once the completed
+ * tag is t or higher.
+ */
+class version_tracker_type {
+public:
+	typedef uint64_t tag_type;
+
+	version_tracker_type() : revision(1) {}
+	explicit version_tracker_type(std::size_t count) : revision(1),
+		versions(count, version_type{ 0, 0 }) {}
+
+	std::size_t size() const {
+		return versions.size();
+	}
+
+	// The content changed, every version must be written again.
+	void update() {
+		++revision;
+	}
+
+	bool stale(std::size_t version) const {
+		return versions[version].revision != revision;
+	}
+
+	bool busy(std::size_t version, tag_type completed) const {
+		return versions[version].tag > completed;
+	}
+
+	// The version now holds the latest content.
+	void write(std::size_t version) {
+		versions[version].revision = revision;
+	}
+
+	// The version is read by the submission with the given tag.
+	void use(std::size_t version, tag_type tag) {
+		versions[version].tag = tag;
+	}
+
+private:
+	struct version_type {
+		uint64_t revision;
+		tag_type tag;
+	};
+
+	uint64_t revision;
+	std::vector<version_type> versions;
+};
+
+}  // namespace internal
+}  // namespace vcc
+
+#endif // _VCC_INTERNAL_VERSION_TRACKER_H_
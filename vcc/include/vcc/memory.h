@@ -20,6 +20,7 @@
 #include <numeric>
 #include <vcc/buffer.h>
 #include <vcc/input_buffer.h>
+#include <vcc/internal/memory_type.h>
 #include <vcc/device.h>
 #include <vcc/image.h>
 #include <vcc/physical_device.h>
@@ -34,21 +35,48 @@ struct memory_type : vcc::internal::movable_destructible_with_parent<
 		VkDeviceSize allocationSize, uint32_t memoryTypeIndex);
 	memory_type() = default;
 	memory_type(memory_type &&instance) = default;
+	~memory_type() {
+		if (statistics) {
+			statistics->freed(memory_type_index, size);
+		}
+	}
 
 private:
 	memory_type(VkDeviceMemory instance,
-		const type::supplier<device::device_type> &parent, VkDeviceSize size)
+		const type::supplier<device::device_type> &parent, VkDeviceSize size,
+		uint32_t memory_type_index)
 		: vcc::internal::movable_destructible_with_parent<VkDeviceMemory,
 			device::device_type, vkFreeMemory>(instance, parent),
-		  size(size) {}
+		  size(size), memory_type_index(memory_type_index),
+		  statistics(device::get_memory_statistics(*parent)) {
+		if (statistics) {
+			statistics->allocated(memory_type_index, size);
+		}
+	}
 
 	VkDeviceSize size;
+	uint32_t memory_type_index;
+	std::shared_ptr<vcc::internal::memory_statistics_type> statistics;
 };
 
 VCC_LIBRARY memory_type allocate(
 	const type::supplier<device::device_type> &device,
 	VkDeviceSize allocationSize, uint32_t memoryTypeIndex);
 
+typedef vcc::internal::memory_counters_type counters_type;
+typedef vcc::internal::memory_snapshot_type statistics_type;
+typedef vcc::internal::memory_budget_callback_type budget_callback_type;
+
+// Returns the live and peak bytes and allocation counts per heap and per
+// memory type of the device, and a histogram of the allocation sizes.
+VCC_LIBRARY statistics_type get_statistics(const device::device_type &device);
+
+// Invokes the callback when the allocated bytes of a heap exceed the given
+// fraction of its size, for example 0.9. Invoked again only once the usage
+// dropped below the budget. A fraction of 0 removes the callback.
+VCC_LIBRARY void set_budget_callback(const device::device_type &device,
+	double fraction, const budget_callback_type &callback);
+
 namespace internal {
 
 VCC_LIBRARY VkMemoryRequirements get_memory_requirements(
@@ -95,6 +123,9 @@ type::supplier<memory_type> bind(
 	VkDeviceSize offsets[num_args];
 	offsets[0] = 0;
 	uint32_t memoryTypeBits(UINT_MAX);
+	for (std::size_t i = 0; i < num_args; ++i) {
+		memoryTypeBits &= memory_requirements[i].memoryTypeBits;
+	}
 	for (int i = 1; i < num_args; ++i) {
 		offsets[i] = offsets[i - 1] + memory_requirements[i - 1].size;
 		VkDeviceSize alignment(offsets[i] % memory_requirements[i].alignment);
@@ -107,16 +138,10 @@ type::supplier<memory_type> bind(
 		throw vcc_exception("No memoryTypeBits for all given storage.");
 	}
 	uint32_t memoryTypeIndex;
-	const VkPhysicalDeviceMemoryProperties memory_properties(
-		vcc::physical_device::memory_properties(device::get_physical_device(*device)));
-	for (memoryTypeIndex = 0; memoryTypeIndex < memory_properties.memoryTypeCount; ++memoryTypeIndex) {
-		if ((memoryTypeBits & 1) == 1
-			&& (memory_properties.memoryTypes[memoryTypeIndex].propertyFlags & propertyFlags) == propertyFlags) {
-			break;
-		}
-		memoryTypeBits >>= 1;
-	}
-	if (memoryTypeIndex == memory_properties.memoryTypeCount) {
+	if (!vcc::internal::find_memory_type(
+			vcc::physical_device::memory_properties(
+				device::get_physical_device(*device)),
+			memoryTypeBits, propertyFlags, propertyFlags, memoryTypeIndex)) {
 		throw vcc_exception("Failed to find valid memoryTypeBits that fits the propertyFlags");
 	}
 	std::shared_ptr<memory_type> memory(std::make_shared<memory_type>(
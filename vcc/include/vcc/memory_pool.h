@@ -0,0 +1,135 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef MEMORY_POOL_H_
+#define MEMORY_POOL_H_
+
+#include <unordered_map>
+#include <vcc/buffer.h>
+#include <vcc/internal/pool_allocator.h>
+#include <vcc/memory.h>
+
+namespace vcc {
+
+namespace queue {
+
+struct queue_type;
+
+}  // namespace queue
+
+namespace memory_pool {
+
+/*
+ * Places buffers in large blocks of device memory of a single memory type
+ * instead of one allocation per buffer.
+ * Loading and unloading content over a long session leaves blocks sparsely
+ * used, defragment compacts them by moving buffers into denser blocks and
+ * frees the blocks left empty.
+ *
+ * Moving a buffer replaces its VkBuffer, the buffer_type returned by
+ * create_buffer stays the same object. Descriptor sets referencing it are
+ * rewritten by descriptor_set::refresh, and command buffers recording it
+ * must be recorded again.
+ */
+struct memory_pool_type {
+	friend VCC_LIBRARY memory_pool_type create(
+		const type::supplier<device::device_type> &device,
+		VkMemoryPropertyFlags property_flags, VkDeviceSize block_size);
+	friend VCC_LIBRARY type::supplier<buffer::buffer_type> create_buffer(
+		memory_pool_type &pool, VkBufferCreateFlags flags, VkDeviceSize size,
+		VkBufferUsageFlags usage, VkSharingMode sharingMode,
+		const std::vector<uint32_t> &queueFamilyIndices);
+	friend VCC_LIBRARY VkDeviceSize defragment(queue::queue_type &queue,
+		memory_pool_type &pool, VkDeviceSize max_bytes);
+	friend VCC_LIBRARY std::size_t block_count(const memory_pool_type &pool);
+
+	memory_pool_type() = default;
+	memory_pool_type(const memory_pool_type &) = delete;
+	memory_pool_type(memory_pool_type &&) = default;
+	memory_pool_type &operator=(const memory_pool_type &) = delete;
+	memory_pool_type &operator=(memory_pool_type &&) = default;
+
+private:
+	struct entry_type {
+		std::weak_ptr<buffer::buffer_type> buffer;
+		VkBufferCreateFlags flags;
+		VkDeviceSize size;
+		VkBufferUsageFlags usage;
+		VkSharingMode sharing_mode;
+		std::vector<uint32_t> queue_family_indices;
+	};
+
+	// Shared with the deleters of the buffers, which may outlive the pool.
+	struct state_type {
+		state_type(const type::supplier<device::device_type> &device,
+			VkMemoryPropertyFlags property_flags, VkDeviceSize block_size)
+			: device(device), property_flags(property_flags),
+			  memory_type_index(0), memory_type_chosen(false),
+			  block_size(block_size), allocator(block_size) {}
+
+		type::supplier<device::device_type> device;
+		VkMemoryPropertyFlags property_flags;
+		// Chosen from the memoryTypeBits of the first buffer.
+		uint32_t memory_type_index;
+		bool memory_type_chosen;
+		VkDeviceSize block_size;
+		vcc::internal::pool_allocator_type allocator;
+		// Indexed by the block indices of the allocator.
+		std::vector<std::shared_ptr<memory::memory_type>> blocks;
+		std::unordered_map<vcc::internal::pool_allocator_type::id_type,
+			entry_type> entries;
+		std::mutex mutex;
+	};
+
+	explicit memory_pool_type(std::shared_ptr<state_type> &&state)
+		: state(std::forward<std::shared_ptr<state_type>>(state)) {}
+
+	std::shared_ptr<state_type> state;
+};
+
+// Creates a pool allocating blocks of block_size bytes of the first memory
+// type matching property_flags and the first buffer, usually
+// VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT. Buffers of a pool share the memory of
+// a block and must not be mapped, host visible property flags throw, fill
+// them with staged input_buffers or the staging buffer of a queue.
+VCC_LIBRARY memory_pool_type create(
+	const type::supplier<device::device_type> &device,
+	VkMemoryPropertyFlags property_flags, VkDeviceSize block_size);
+
+// Creates a buffer bound to memory of the pool. Its range is returned to
+// the pool when the last reference to the buffer is released.
+// Buffers larger than the block size throw.
+// The usage should include VK_BUFFER_USAGE_TRANSFER_SRC_BIT and
+// VK_BUFFER_USAGE_TRANSFER_DST_BIT for the buffer to be movable.
+VCC_LIBRARY type::supplier<buffer::buffer_type> create_buffer(
+	memory_pool_type &pool, VkBufferCreateFlags flags, VkDeviceSize size,
+	VkBufferUsageFlags usage, VkSharingMode sharingMode,
+	const std::vector<uint32_t> &queueFamilyIndices);
+
+// Moves at most max_bytes of buffers out of the sparsest blocks, recording
+// the copies in the flush command buffer of the next submit on the queue.
+// Meant to be called once per frame with a small budget, before submitting.
+// Returns the number of bytes moved, zero once the pool is compact.
+// Buffers must not be in use by the host or another queue while moved.
+VCC_LIBRARY VkDeviceSize defragment(queue::queue_type &queue,
+	memory_pool_type &pool, VkDeviceSize max_bytes);
+
+// Number of blocks of device memory currently allocated by the pool.
+VCC_LIBRARY std::size_t block_count(const memory_pool_type &pool);
+
+}  // namespace memory_pool
+}  // namespace vcc
+
+#endif /* MEMORY_POOL_H_ */
@@ -0,0 +1,101 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef PARALLEL_RECORDER_H_
+#define PARALLEL_RECORDER_H_
+
+#include <vcc/command.h>
+#include <vcc/internal/thread_pool.h>
+
+namespace vcc {
+namespace parallel_recorder {
+
+// Passed to the function given to record, records commands into the
+// secondary command buffer of one partition.
+typedef command::recording_type recording_type;
+
+typedef std::function<void(recording_type &recording, std::size_t begin,
+	std::size_t end)> record_function_type;
+
+/*
+ * Records a long list of draws into secondary command buffers on several
+ * threads, to be executed by a render pass begun with
+ * VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+ *
+ * Every partition has its own command pool so the partitions are recorded
+ * concurrently without locking. The command buffers of a frame are
+ * recorded again by the next call to record for that frame, the previous
+ * submit using them must have finished by then.
+ */
+struct parallel_recorder_type {
+	friend VCC_LIBRARY parallel_recorder_type create(
+		const type::supplier<device::device_type> &device,
+		uint32_t queue_family_index, uint32_t threads, uint32_t frames);
+	friend VCC_LIBRARY command::execute_commands record(
+		parallel_recorder_type &recorder, uint32_t frame,
+		const type::supplier<render_pass::render_pass_type> &render_pass,
+		uint32_t subpass,
+		const type::supplier<framebuffer::framebuffer_type> &framebuffer,
+		std::size_t count, const record_function_type &function);
+
+	parallel_recorder_type() = default;
+	parallel_recorder_type(const parallel_recorder_type &) = delete;
+	parallel_recorder_type(parallel_recorder_type &&) = default;
+	parallel_recorder_type &operator=(const parallel_recorder_type &) = delete;
+	parallel_recorder_type &operator=(parallel_recorder_type &&) = default;
+
+private:
+	struct partition_type {
+		std::shared_ptr<command_pool::command_pool_type> command_pool;
+		// One per frame.
+		std::vector<std::shared_ptr<command_buffer::command_buffer_type>>
+			command_buffers;
+	};
+
+	parallel_recorder_type(std::vector<partition_type> &&partitions,
+		std::unique_ptr<vcc::internal::thread_pool_type> &&thread_pool)
+		: partitions(std::forward<std::vector<partition_type>>(partitions)),
+		  thread_pool(std::forward<std::unique_ptr<
+			vcc::internal::thread_pool_type>>(thread_pool)) {}
+
+	std::vector<partition_type> partitions;
+	std::unique_ptr<vcc::internal::thread_pool_type> thread_pool;
+};
+
+// Creates a recorder using the calling thread and threads - 1 workers,
+// with a partition per thread and one set of secondary command buffers
+// per frame in flight.
+VCC_LIBRARY parallel_recorder_type create(
+	const type::supplier<device::device_type> &device,
+	uint32_t queue_family_index, uint32_t threads, uint32_t frames);
+
+// Splits [0, count) into one contiguous range per partition and calls
+// function on the recorder's threads with the recording of each range.
+// The secondary command buffers continue the given subpass and framebuffer,
+// the returned execute_commands must be recorded in that subpass.
+// Pre-execute hooks and references of the secondary command buffers are
+// taken over by the primary command buffer executing them. Throws if frame
+// is not below the frames given to create.
+VCC_LIBRARY command::execute_commands record(
+	parallel_recorder_type &recorder, uint32_t frame,
+	const type::supplier<render_pass::render_pass_type> &render_pass,
+	uint32_t subpass,
+	const type::supplier<framebuffer::framebuffer_type> &framebuffer,
+	std::size_t count, const record_function_type &function);
+
+}  // namespace parallel_recorder
+}  // namespace vcc
+
+#endif /* PARALLEL_RECORDER_H_ */
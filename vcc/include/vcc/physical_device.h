@@ -19,6 +19,7 @@
 #include <type/supplier.h>
 #include <vcc/util.h>
 #include <vcc/instance.h>
+#include <vcc/internal/queue_families.h>
 
 namespace vcc {
 namespace physical_device {
@@ -58,6 +59,12 @@ VCC_LIBRARY uint32_t get_queue_family_properties_with_flag(
 	const std::vector<VkQueueFamilyProperties> &properties,
 	VkQueueFlags flags);
 
+// The graphics family and the dedicated compute and transfer families, if
+// the device has any. Create the device with a queue of each of
+// internal::distinct_families to use them.
+VCC_LIBRARY internal::queue_families_type get_queue_families(
+	VkPhysicalDevice physical_device);
+
 }  // namespace physical_device
 }  // namespace vcc
 
@@ -16,26 +16,37 @@
 #ifndef PIPELINE_LAYOUT_H_
 #define PIPELINE_LAYOUT_H_
 
+#include <memory>
+#include <mutex>
+#include <string>
 #include <type/serialize.h>
 #include <vcc/device.h>
 #include <vcc/descriptor_set_layout.h>
-#include <vcc/internal/hook.h>
 
 namespace vcc {
-namespace queue {
-
-struct queue_type;
-
-}  // namespace queue
-
 namespace pipeline_layout {
 
 namespace internal {
 
+/*
+ * The push constants of a layout created with storages. type::flush only
+ * writes the views changed since its previous call, the content is kept
+ * here for every command buffer to push from.
+ */
+struct push_constants_state_type {
+	type::supplier<type::serialize_type> constants;
+	std::vector<VkPushConstantRange> ranges;
+	std::string content;
+	// Bumped whenever the content changes, see
+	// state_tracker_type::push_constants.
+	uint64_t revision;
+	std::mutex mutex;
+};
+
 template<typename PipelineLayoutT>
-auto get_pre_execute_callbacks(PipelineLayoutT &layout)
-		->decltype(layout.pre_execute_callbacks)& {
-	return layout.pre_execute_callbacks;
+auto get_push_constants(PipelineLayoutT &layout)
+		->decltype(layout.push_constants)& {
+	return layout.push_constants;
 }
 
 template<typename PipelineLayoutT>
@@ -50,8 +61,8 @@ struct pipeline_layout_type
 	: vcc::internal::movable_destructible_with_parent<VkPipelineLayout,
 		device::device_type, vkDestroyPipelineLayout> {
 	template<typename PipelineLayoutT>
-	friend auto internal::get_pre_execute_callbacks(PipelineLayoutT &layout)
-		->decltype(layout.pre_execute_callbacks)&;
+	friend auto internal::get_push_constants(PipelineLayoutT &layout)
+		->decltype(layout.push_constants)&;
 	friend VCC_LIBRARY pipeline_layout_type create(
 		const type::supplier<device::device_type> &device,
 		const std::vector<type::supplier<vcc::descriptor_set_layout::descriptor_set_layout_type>> &set_layouts,
@@ -75,7 +86,9 @@ private:
 			instance, type::supplier<device::device_type>(parent)),
 			set_layouts(set_layouts) {}
 	std::vector<type::supplier<vcc::descriptor_set_layout::descriptor_set_layout_type>> set_layouts;
-	vcc::internal::hook_container_type<queue::queue_type &> pre_execute_callbacks;
+	// Pushed by the command buffers binding the layout, null without
+	// storages.
+	std::unique_ptr<internal::push_constants_state_type> push_constants;
 };
 
 VCC_LIBRARY pipeline_layout_type create(const type::supplier<device::device_type> &device,
@@ -84,10 +97,9 @@ VCC_LIBRARY pipeline_layout_type create(const type::supplier<device::device_type
 
 namespace internal {
 
-VCC_LIBRARY void flush(const type::supplier<type::serialize_type> &constants,
-	VkPipelineLayout pipeline_layout,
-	const std::vector<VkPushConstantRange> &push_constant_ranges,
-	queue::queue_type &queue);
+// Flushes the changed constants into the content and returns its
+// revision, the mutex of the state must be held.
+VCC_LIBRARY uint64_t update(push_constants_state_type &state);
 
 }  // namespace internal
 
@@ -96,9 +108,13 @@ pipeline_layout_type create(const type::supplier<device::device_type> &device,
 	const std::vector<type::supplier<descriptor_set_layout::descriptor_set_layout_type>> &set_layouts,
 	const std::vector<VkPushConstantRange> &push_constant_ranges, type::memory_layout layout, StorageType... storages) {
 	pipeline_layout_type pipeline_layout(create(type::supplier<device::device_type>(device), set_layouts, push_constant_ranges));
-	pipeline_layout::internal::get_pre_execute_callbacks(pipeline_layout).add(std::bind(&internal::flush,
-		type::supplier<type::serialize_type>(type::make_serialize(layout, std::forward<StorageType>(storages)...)),
-		vcc::internal::get_instance(pipeline_layout), push_constant_ranges, std::placeholders::_1));
+	std::unique_ptr<internal::push_constants_state_type> &state(
+		internal::get_push_constants(pipeline_layout));
+	state.reset(new internal::push_constants_state_type);
+	state->constants = type::supplier<type::serialize_type>(type::make_serialize(layout, std::forward<StorageType>(storages)...));
+	state->ranges = push_constant_ranges;
+	state->content.assign(type::size(*state->constants), '\0');
+	state->revision = 0;
 	return std::move(pipeline_layout);
 }
 
@@ -17,14 +17,42 @@
 #define QUEUE_H_
 
 #include <climits>
+#include <future>
+#include <vcc/command.h>
 #include <vcc/command_buffer.h>
 #include <vcc/device.h>
 #include <vcc/fence.h>
+#include <vcc/internal/submit_packer.h>
+#include <vcc/internal/submit_worker.h>
 #include <vcc/semaphore.h>
 #include <vcc/surface.h>
 #include <vcc/swapchain.h>
 
 namespace vcc {
+
+namespace queue {
+
+struct queue_type;
+
+}  // namespace queue
+
+namespace internal {
+
+struct flush_batch_type;
+
+VCC_LIBRARY std::unique_lock<std::recursive_mutex> lock_flush(
+	queue::queue_type &queue);
+VCC_LIBRARY command_buffer::command_buffer_type &acquire_transient(
+	queue::queue_type &queue);
+
+}  // namespace internal
+
+namespace staging_buffer {
+
+struct staging_buffer_type;
+
+}  // namespace staging_buffer
+
 namespace queue {
 
 struct queue_type : public internal::movable_with_parent<VkQueue, device::device_type> {
@@ -32,6 +60,14 @@ struct queue_type : public internal::movable_with_parent<VkQueue, device::device
 		const type::supplier<device::device_type> &device,
 		uint32_t queue_family_index, uint32_t queue_index);
 	friend uint32_t get_family_index(queue_type &queue);
+	friend type::supplier<staging_buffer::staging_buffer_type> &get_staging_buffer(
+		queue_type &queue);
+	friend VCC_LIBRARY internal::flush_batch_type &get_flush_batch(
+		queue_type &queue);
+	friend VCC_LIBRARY void start_submit_thread(queue_type &queue);
+	friend VCC_LIBRARY void stop_submit_thread(queue_type &queue);
+	friend VCC_LIBRARY internal::submit_worker_type *get_submit_worker(
+		queue_type &queue);
 
 	queue_type() = default;
 	queue_type(queue_type &&queue) = default;
@@ -44,6 +80,9 @@ private:
 		: movable_with_parent(instance, parent),
 		  family_index(family_index) {}
 	uint32_t family_index;
+	type::supplier<staging_buffer::staging_buffer_type> staging_buffer;
+	std::shared_ptr<internal::flush_batch_type> flush_batch;
+	std::shared_ptr<internal::submit_worker_type> submit_worker;
 };
 
 VCC_LIBRARY queue_type get_device_queue(
@@ -71,7 +110,6 @@ struct wait_semaphore {
 	VkPipelineStageFlags wait_dst_stage_mask;
 };
 
-// TODO(gardell): Support multiple submits
 VCC_LIBRARY void submit(queue_type &queue,
 	const std::vector<wait_semaphore> &wait_semaphores,
 	const std::vector<type::supplier<command_buffer::command_buffer_type>> &command_buffers,
@@ -83,17 +121,141 @@ VCC_LIBRARY void submit(queue_type &queue,
 	const std::vector<type::supplier<command_buffer::command_buffer_type>> &command_buffers,
 	const std::vector<type::supplier<semaphore::semaphore_type>> &signal_semaphores);
 
+/*
+ * Several submits to be sent with a single vkQueueSubmit, under one lock of
+ * the queue. Each has its own semaphores, a submit may wait on a semaphore
+ * signaled by a previous one of the same batch.
+ * A batch reused every frame keeps its storage:
+ *   queue::add(batch, {}, { std::ref(pre_draw) }, {});
+ *   queue::add(batch, { wait }, { std::ref(draw) }, { std::ref(done) });
+ *   queue::submit(queue, batch);
+ */
+struct submit_batch_type {
+	friend VCC_LIBRARY void add(submit_batch_type &batch,
+		const std::vector<wait_semaphore> &wait_semaphores,
+		const std::vector<type::supplier<command_buffer::command_buffer_type>> &command_buffers,
+		const std::vector<type::supplier<semaphore::semaphore_type>> &signal_semaphores);
+	friend VCC_LIBRARY bool empty(const submit_batch_type &batch);
+	friend VkResult submit(queue_type &queue, submit_batch_type &batch,
+		const fence::fence_type *fence, std::future<VkResult> *future);
+
+	submit_batch_type() = default;
+	submit_batch_type(const submit_batch_type &) = delete;
+	submit_batch_type(submit_batch_type &&) = default;
+	submit_batch_type &operator=(const submit_batch_type &) = delete;
+	submit_batch_type &operator=(submit_batch_type &&) = default;
+
+private:
+	// End offsets of a submit in the vectors below.
+	struct entry_type {
+		std::size_t wait_semaphores, command_buffers, signal_semaphores;
+	};
+
+	std::vector<entry_type> entries;
+	std::vector<wait_semaphore> wait_semaphores;
+	std::vector<type::supplier<command_buffer::command_buffer_type>> command_buffers;
+	std::vector<type::supplier<semaphore::semaphore_type>> signal_semaphores;
+	internal::submit_packer_type packer;
+	std::vector<std::mutex *> mutexes;
+};
+
+// Appends a submit to the batch, nothing is sent to the queue.
+VCC_LIBRARY void add(submit_batch_type &batch,
+	const std::vector<wait_semaphore> &wait_semaphores,
+	const std::vector<type::supplier<command_buffer::command_buffer_type>> &command_buffers,
+	const std::vector<type::supplier<semaphore::semaphore_type>> &signal_semaphores);
+
+VCC_LIBRARY bool empty(const submit_batch_type &batch);
+
+// Runs the pre-execute hooks of all command buffers of the batch, in order,
+// and submits them all at once. The fence, if any, is signaled when the
+// whole batch has completed. The batch is empty afterwards.
+VCC_LIBRARY void submit(queue_type &queue, submit_batch_type &batch,
+	const fence::fence_type &fence);
+VCC_LIBRARY void submit(queue_type &queue, submit_batch_type &batch);
+
+/*
+ * Moves the calls to vkQueueSubmit, vkQueuePresentKHR and vkQueueWaitIdle of
+ * the queue to a thread of its own, drivers may block in them for
+ * milliseconds. The pre-execute hooks and the packing of a submit still run
+ * on the calling thread, the submit thread only calls the driver in the
+ * order the submits and presents were made.
+ * Once started, the synchronous submit, present and wait_idle wait for the
+ * thread, use submit_async and present_async to continue meanwhile.
+ */
+VCC_LIBRARY void start_submit_thread(queue_type &queue);
+// Waits for the submits and presents already made and joins the thread.
+VCC_LIBRARY void stop_submit_thread(queue_type &queue);
+VCC_LIBRARY internal::submit_worker_type *get_submit_worker(
+	queue_type &queue);
+
+// As submit, but returns the result of vkQueueSubmit as a future when the
+// queue has a submit thread. Semaphores, the fence and the command buffers
+// are kept referenced until then, the fence must not be waited on or reset
+// before the future is ready.
+VCC_LIBRARY std::future<VkResult> submit_async(queue_type &queue,
+	submit_batch_type &batch, const fence::fence_type &fence);
+VCC_LIBRARY std::future<VkResult> submit_async(queue_type &queue,
+	submit_batch_type &batch);
+
 VCC_LIBRARY void wait_idle(queue_type &queue);
 
+// Commands recorded by pre-execute hooks during submit are kept in a batch
+// per queue, see internal::flush_batch_type.
+VCC_LIBRARY internal::flush_batch_type &get_flush_batch(queue_type &queue);
+
+// Number of times the CPU had to wait for the GPU to finish a flush, for
+// example to reclaim space in a full staging buffer.
+VCC_LIBRARY uint64_t get_flush_wait_count(queue_type &queue);
+
+// Number of command pools created for queue::execute. Stays constant once
+// the pools of all recording threads are recycled.
+VCC_LIBRARY uint64_t get_transient_pool_count(queue_type &queue);
+
+// Records the commands into a one time command buffer and submits it.
+// Command buffers come from pools kept per recording thread, which are
+// reset in bulk once their submits have finished instead of creating and
+// destroying a command pool per operation.
+template<typename... CommandsT>
+void execute(queue_type &queue, CommandsT&&... commands) {
+	std::unique_lock<std::recursive_mutex> lock(
+		vcc::internal::lock_flush(queue));
+	command_buffer::command_buffer_type &command_buffer(
+		vcc::internal::acquire_transient(queue));
+	command_buffer::compile(command_buffer,
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, VK_FALSE, 0, 0,
+		std::forward<CommandsT>(commands)...);
+	submit(queue, {}, { std::ref(command_buffer) }, {});
+}
+
 VCC_LIBRARY VkResult present(queue_type &queue,
 	const std::vector<type::supplier<semaphore::semaphore_type>> &semaphores,
 	const std::vector<type::supplier<swapchain::swapchain_type>> &swapchains,
 	const std::vector<uint32_t> &image_indices);
 
+// As present, returning the result of vkQueuePresentKHR as a future when the
+// queue has a submit thread.
+VCC_LIBRARY std::future<VkResult> present_async(queue_type &queue,
+	const std::vector<type::supplier<semaphore::semaphore_type>> &semaphores,
+	const std::vector<type::supplier<swapchain::swapchain_type>> &swapchains,
+	const std::vector<uint32_t> &image_indices);
+
 inline uint32_t get_family_index(queue_type &queue) {
 	return queue.family_index;
 }
 
+inline type::supplier<staging_buffer::staging_buffer_type> &get_staging_buffer(
+		queue_type &queue) {
+	return queue.staging_buffer;
+}
+
+// Staged input_buffers flushed on this queue upload their content through the
+// given staging buffer, which must not be shared with other queues.
+inline void set_staging_buffer(queue_type &queue,
+		const type::supplier<staging_buffer::staging_buffer_type> &staging_buffer) {
+	get_staging_buffer(queue) = staging_buffer;
+}
+
 }  // namespace queue
 }  // namespace vcc
 
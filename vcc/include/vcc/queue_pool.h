@@ -0,0 +1,88 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef QUEUE_POOL_H_
+#define QUEUE_POOL_H_
+
+#include <memory>
+#include <vcc/internal/queue_pool.h>
+#include <vcc/queue.h>
+
+namespace vcc {
+namespace queue_pool {
+
+/*
+ * All the queues of a family, for threads submitting concurrently. Each
+ * queue_type has its own mutex, flush batch and staging buffer, so threads
+ * submitting to different queues do not contend. Work submitted to
+ * different queues is not ordered, use semaphores between them.
+ */
+struct queue_pool_type {
+	friend VCC_LIBRARY queue_pool_type create(
+		const type::supplier<device::device_type> &device,
+		uint32_t family_index, uint32_t queue_count);
+	friend VCC_LIBRARY queue_pool_type create(
+		const type::supplier<device::device_type> &device,
+		uint32_t family_index);
+	friend queue::queue_type &get(queue_pool_type &pool);
+	friend queue::queue_type &get(queue_pool_type &pool, std::size_t affinity);
+	friend queue::queue_type &get_for_thread(queue_pool_type &pool);
+	friend std::size_t size(const queue_pool_type &pool);
+
+	queue_pool_type() = default;
+	queue_pool_type(queue_pool_type &&) = default;
+	queue_pool_type(const queue_pool_type &) = delete;
+	queue_pool_type &operator=(queue_pool_type &&) = default;
+	queue_pool_type &operator=(const queue_pool_type &) = delete;
+
+private:
+	std::unique_ptr<internal::queue_pool_type<queue::queue_type>> queues;
+};
+
+// The first queue_count queues of the family, the device must have been
+// created with at least as many.
+VCC_LIBRARY queue_pool_type create(
+	const type::supplier<device::device_type> &device,
+	uint32_t family_index, uint32_t queue_count);
+
+// All the queues the family advertises, see
+// physical_device::queue_famility_properties.
+VCC_LIBRARY queue_pool_type create(
+	const type::supplier<device::device_type> &device,
+	uint32_t family_index);
+
+// The queues in turn.
+inline queue::queue_type &get(queue_pool_type &pool) {
+	return pool.queues->round_robin();
+}
+
+// The same queue for the same affinity, such as the index of a worker.
+inline queue::queue_type &get(queue_pool_type &pool, std::size_t affinity) {
+	return pool.queues->affinity(affinity);
+}
+
+// The same queue for every call of the calling thread.
+inline queue::queue_type &get_for_thread(queue_pool_type &pool) {
+	return pool.queues->thread_affinity();
+}
+
+inline std::size_t size(const queue_pool_type &pool) {
+	return pool.queues->size();
+}
+
+}  // namespace queue_pool
+}  // namespace vcc
+
+#endif /* QUEUE_POOL_H_ */
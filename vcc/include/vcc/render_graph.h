@@ -0,0 +1,252 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef RENDER_GRAPH_H_
+#define RENDER_GRAPH_H_
+
+#include <functional>
+#include <vcc/command.h>
+#include <vcc/internal/graph_planner.h>
+#include <vcc/memory.h>
+
+namespace vcc {
+namespace render_graph {
+
+typedef std::size_t resource_type;
+typedef vcc::internal::graph_usage_type usage_type;
+typedef std::function<void(command::recording_type &recording)>
+	pass_function_type;
+
+/*
+ * A frame graph, passes declare the resources they use and the barriers
+ * and layout transitions between them are computed when recorded, see
+ * internal::plan_graph.
+ *
+ * Build the graph, then record it into a command buffer:
+ *   command_buffer::compile(command_buffer, 0, VK_FALSE, 0, 0,
+ *     render_graph::record(graph));
+ *
+ * Transient resources, such as G-buffers and bloom chains, are created by
+ * the graph and share memory with the transient resources they are never
+ * used at the same time as, see allocate.
+ */
+struct render_graph_type {
+	friend VCC_LIBRARY resource_type import_image(render_graph_type &graph,
+		const type::supplier<image::image_type> &image,
+		const VkImageSubresourceRange &range, VkImageLayout initial_layout,
+		VkImageLayout final_layout);
+	friend VCC_LIBRARY resource_type import_buffer(render_graph_type &graph,
+		const type::supplier<buffer::buffer_type> &buffer);
+	friend VCC_LIBRARY resource_type create_image(render_graph_type &graph,
+		const type::supplier<device::device_type> &device,
+		VkImageCreateFlags flags, VkImageType imageType, VkFormat format,
+		const VkExtent3D &extent, uint32_t mipLevels, uint32_t arrayLayers,
+		VkSampleCountFlagBits samples, VkImageUsageFlags usage,
+		VkImageAspectFlags aspect);
+	friend VCC_LIBRARY resource_type create_buffer(render_graph_type &graph,
+		const type::supplier<device::device_type> &device, VkDeviceSize size,
+		VkBufferUsageFlags usage);
+	friend VCC_LIBRARY void allocate(render_graph_type &graph,
+		const type::supplier<device::device_type> &device);
+	friend VCC_LIBRARY type::supplier<image::image_type> get_image(
+		const render_graph_type &graph, resource_type resource);
+	friend VCC_LIBRARY type::supplier<buffer::buffer_type> get_buffer(
+		const render_graph_type &graph, resource_type resource);
+	friend VCC_LIBRARY VkDeviceSize get_transient_memory_size(
+		const render_graph_type &graph);
+	friend VCC_LIBRARY void set_output(render_graph_type &graph,
+		resource_type resource);
+	friend VCC_LIBRARY void add_pass(render_graph_type &graph,
+		const std::vector<usage_type> &usages,
+		const pass_function_type &function);
+	friend VCC_LIBRARY void clear(render_graph_type &graph);
+	friend VCC_LIBRARY std::size_t culled(const render_graph_type &graph);
+	friend VCC_LIBRARY command::record_type record(render_graph_type &graph);
+
+	render_graph_type() = default;
+	render_graph_type(const render_graph_type &) = delete;
+	render_graph_type(render_graph_type &&) = default;
+	render_graph_type &operator=(const render_graph_type &) = delete;
+	render_graph_type &operator=(render_graph_type &&) = default;
+
+private:
+	struct binding_type {
+		type::supplier<image::image_type> image;
+		VkImageSubresourceRange range;
+		type::supplier<buffer::buffer_type> buffer;
+		// Set for transient resources, bound by allocate.
+		std::shared_ptr<image::image_type> transient_image;
+		std::shared_ptr<buffer::buffer_type> transient_buffer;
+		// A transient resource only used by culled passes, left unbound.
+		bool culled;
+	};
+
+	std::vector<vcc::internal::graph_resource_type> resources;
+	std::vector<binding_type> bindings;
+	std::vector<vcc::internal::graph_pass_type> passes;
+	std::vector<pass_function_type> functions;
+	vcc::internal::graph_plan_type plan;
+	// One per memory type used by transient resources.
+	std::vector<std::shared_ptr<memory::memory_type>> memories;
+	VkDeviceSize transient_memory_size = 0;
+};
+
+// Adds an image in initial_layout when the graph begins, and transitioned to
+// final_layout when it ends unless VK_IMAGE_LAYOUT_UNDEFINED.
+VCC_LIBRARY resource_type import_image(render_graph_type &graph,
+	const type::supplier<image::image_type> &image,
+	const VkImageSubresourceRange &range, VkImageLayout initial_layout,
+	VkImageLayout final_layout = VK_IMAGE_LAYOUT_UNDEFINED);
+VCC_LIBRARY resource_type import_buffer(render_graph_type &graph,
+	const type::supplier<buffer::buffer_type> &buffer);
+
+// Adds an image or buffer only used by the passes of the graph, its
+// contents are undefined before its first use and after its last use.
+// An image is optimally tiled and exclusive to one queue family, its
+// subresource range is all of its levels and layers of the given aspect.
+VCC_LIBRARY resource_type create_image(render_graph_type &graph,
+	const type::supplier<device::device_type> &device,
+	VkImageCreateFlags flags, VkImageType imageType, VkFormat format,
+	const VkExtent3D &extent, uint32_t mipLevels, uint32_t arrayLayers,
+	VkSampleCountFlagBits samples, VkImageUsageFlags usage,
+	VkImageAspectFlags aspect);
+VCC_LIBRARY resource_type create_buffer(render_graph_type &graph,
+	const type::supplier<device::device_type> &device, VkDeviceSize size,
+	VkBufferUsageFlags usage);
+
+// Binds the transient resources to device local memory, once all passes
+// are added. Resources used by passes not overlapping in the order of the
+// passes that are not culled share memory; the first use of a resource
+// waits for the last uses of those it aliases.
+// The passes must not change afterwards, views and framebuffers of the
+// transient resources can be created once allocated. Transient resources
+// only used by culled passes get no memory.
+VCC_LIBRARY void allocate(render_graph_type &graph,
+	const type::supplier<device::device_type> &device);
+
+// Throw for transient resources left without memory by allocate.
+VCC_LIBRARY type::supplier<image::image_type> get_image(
+	const render_graph_type &graph, resource_type resource);
+VCC_LIBRARY type::supplier<buffer::buffer_type> get_buffer(
+	const render_graph_type &graph, resource_type resource);
+
+// Bytes of memory allocated for all transient resources.
+VCC_LIBRARY VkDeviceSize get_transient_memory_size(
+	const render_graph_type &graph);
+
+// Marks a resource as used after the graph, such as a swapchain image.
+// Passes not contributing to any output are culled.
+VCC_LIBRARY void set_output(render_graph_type &graph, resource_type resource);
+
+// Adds a pass recording its commands with function, after the passes added
+// before it.
+VCC_LIBRARY void add_pass(render_graph_type &graph,
+	const std::vector<usage_type> &usages, const pass_function_type &function);
+
+// Removes all resources and passes, to build the graph of the next frame.
+// Transient resources and their memory are released once no longer
+// referenced.
+VCC_LIBRARY void clear(render_graph_type &graph);
+
+// Number of passes culled by the last call to record.
+VCC_LIBRARY std::size_t culled(const render_graph_type &graph);
+
+// Returns a command recording the passes that are not culled with their
+// barriers. The graph must not change until the command is recorded.
+VCC_LIBRARY command::record_type record(render_graph_type &graph);
+
+inline usage_type usage(resource_type resource, VkPipelineStageFlags stages,
+		VkAccessFlags access, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED) {
+	return usage_type{ resource, stages, access, layout };
+}
+
+// Attachments written by a render pass, load is true for
+// VK_ATTACHMENT_LOAD_OP_LOAD.
+inline usage_type color_attachment(resource_type resource, bool load = false) {
+	return usage(resource, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+			| (load ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0),
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+}
+
+inline usage_type depth_stencil_attachment(resource_type resource,
+		bool load = false) {
+	return usage(resource, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+			| VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+			| (load ? VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT : 0),
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+}
+
+inline usage_type depth_stencil_read(resource_type resource) {
+	return usage(resource, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+			| VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+}
+
+inline usage_type sampled(resource_type resource,
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT) {
+	return usage(resource, stages, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+// Storage images and buffers.
+inline usage_type storage_read(resource_type resource,
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) {
+	return usage(resource, stages, VK_ACCESS_SHADER_READ_BIT,
+		VK_IMAGE_LAYOUT_GENERAL);
+}
+
+inline usage_type storage_write(resource_type resource,
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) {
+	return usage(resource, stages, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_GENERAL);
+}
+
+inline usage_type transfer_read(resource_type resource) {
+	return usage(resource, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+}
+
+inline usage_type transfer_write(resource_type resource) {
+	return usage(resource, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+}
+
+inline usage_type uniform_read(resource_type resource,
+		VkPipelineStageFlags stages) {
+	return usage(resource, stages, VK_ACCESS_UNIFORM_READ_BIT);
+}
+
+inline usage_type vertex_read(resource_type resource) {
+	return usage(resource, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+}
+
+inline usage_type index_read(resource_type resource) {
+	return usage(resource, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VK_ACCESS_INDEX_READ_BIT);
+}
+
+inline usage_type indirect_read(resource_type resource) {
+	return usage(resource, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+}
+
+}  // namespace render_graph
+}  // namespace vcc
+
+#endif /* RENDER_GRAPH_H_ */
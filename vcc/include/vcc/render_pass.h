@@ -37,6 +37,8 @@ struct render_pass_type
 		const std::vector<VkAttachmentDescription> &attachment_descriptions,
 		const std::vector<subpass_description_type> &subpass_descriptions,
 		const std::vector<VkSubpassDependency> &subpass_dependency);
+	friend const std::vector<VkImageLayout> &get_final_layouts(
+		const render_pass_type &render_pass);
 
 	render_pass_type() = default;
 	render_pass_type(render_pass_type &&) = default;
@@ -46,17 +48,39 @@ struct render_pass_type
 
 private:
 	render_pass_type(VkRenderPass instance,
-		const type::supplier<device::device_type> &parent)
+		const type::supplier<device::device_type> &parent,
+		std::vector<VkImageLayout> &&final_layouts)
 		: internal::movable_destructible_with_parent<VkRenderPass,
-		device::device_type, vkDestroyRenderPass>(instance, parent) {}
+		device::device_type, vkDestroyRenderPass>(instance, parent),
+		final_layouts(std::forward<std::vector<VkImageLayout>>(final_layouts)) {}
+
+	std::vector<VkImageLayout> final_layouts;
 };
 
+// The layout each attachment is left in by the render pass.
+inline const std::vector<VkImageLayout> &get_final_layouts(
+		const render_pass_type &render_pass) {
+	return render_pass.final_layouts;
+}
+
 VCC_LIBRARY render_pass_type create(
 	const type::supplier<device::device_type> &device,
 	const std::vector<VkAttachmentDescription> &attachment_descriptions,
 	const std::vector<subpass_description_type> &subpass_descriptions,
 	const std::vector<VkSubpassDependency> &subpass_dependency);
 
+// Describes an attachment whose content is discarded at the end of the
+// render pass, see image::create_transient_attachment. The attachment is
+// cleared, or left undefined with VK_ATTACHMENT_LOAD_OP_DONT_CARE, and
+// never stored.
+inline VkAttachmentDescription transient_attachment_description(
+		VkFormat format, VkSampleCountFlagBits samples, VkImageLayout layout,
+		VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR) {
+	return VkAttachmentDescription{ 0, format, samples, load_op,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE, load_op,
+		VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_UNDEFINED, layout };
+}
+
 VCC_LIBRARY VkExtent2D get_render_area_granularity(const render_pass_type &render_pass);
 
 }  // namespace render_pass
@@ -16,7 +16,9 @@
 #ifndef SEMAPHORE_H_
 #define SEMAPHORE_H_
 
+#include <memory>
 #include <vcc/device.h>
+#include <vcc/internal/sync_pool.h>
 
 namespace vcc {
 namespace semaphore {
@@ -43,6 +45,63 @@ private:
 VCC_LIBRARY semaphore_type create(
 	const type::supplier<device::device_type> &device);
 
+/*
+ * Semaphores of a device handed out again once the submits waiting on them
+ * have completed, instead of being destroyed every frame. Completion is
+ * told by increasing tags, such as the flush tags of the queue the waiting
+ * submits were made on, see internal::flush_track.
+ */
+struct pool_type {
+	typedef internal::sync_pool_type<semaphore_type>::tag_type tag_type;
+
+	friend VCC_LIBRARY pool_type create_pool(
+		const type::supplier<device::device_type> &device);
+	friend VCC_LIBRARY semaphore_type acquire(pool_type &pool,
+		tag_type completed);
+	friend VCC_LIBRARY void release(pool_type &pool,
+		semaphore_type &&semaphore, tag_type tag);
+	friend VCC_LIBRARY void release(pool_type &pool,
+		semaphore_type &&semaphore);
+	friend VCC_LIBRARY uint64_t get_created_count(const pool_type &pool);
+
+	pool_type() = default;
+	pool_type(pool_type &&) = default;
+	pool_type(const pool_type &) = delete;
+	pool_type &operator=(pool_type &&) = default;
+	pool_type &operator=(const pool_type &) = delete;
+
+	explicit operator bool() const {
+		return !!data;
+	}
+
+private:
+	struct data_type {
+		type::supplier<device::device_type> device;
+		std::mutex mutex;
+		internal::sync_pool_type<semaphore_type> semaphores;
+		uint64_t created;
+	};
+
+	std::unique_ptr<data_type> data;
+};
+
+VCC_LIBRARY pool_type create_pool(
+	const type::supplier<device::device_type> &device);
+
+// Returns a semaphore no longer waited on given the last completed tag,
+// created if the pool has none.
+VCC_LIBRARY semaphore_type acquire(pool_type &pool,
+	pool_type::tag_type completed);
+
+// The semaphore is waited on by submits completing with tag.
+VCC_LIBRARY void release(pool_type &pool, semaphore_type &&semaphore,
+	pool_type::tag_type tag);
+// The semaphore was never signaled, or its wait has completed.
+VCC_LIBRARY void release(pool_type &pool, semaphore_type &&semaphore);
+
+// Number of semaphores created by acquire.
+VCC_LIBRARY uint64_t get_created_count(const pool_type &pool);
+
 }  // namespace semaphore
 }  // namespace vcc
 
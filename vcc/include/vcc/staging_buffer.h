@@ -0,0 +1,124 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef STAGING_BUFFER_H_
+#define STAGING_BUFFER_H_
+
+#include <vcc/buffer.h>
+#include <vcc/internal/ring_allocator.h>
+#include <vcc/memory.h>
+
+namespace vcc {
+
+namespace queue {
+
+struct queue_type;
+
+}  // namespace queue
+
+namespace staging_buffer {
+
+/*
+ * A persistently mapped, host visible ring buffer used to upload content
+ * into device local buffers.
+ * Each upload is serialized into the ring and copied into its destination
+ * by the flush command buffer of the next submit on the queue.
+ * Ring space is recycled once that submit has finished, and an upload
+ * blocks on the oldest submit only when the ring is full.
+ *
+ * A staging_buffer_type must only be used with a single queue,
+ * see queue::set_staging_buffer.
+ */
+struct staging_buffer_type {
+	friend VCC_LIBRARY staging_buffer_type create(
+		const type::supplier<device::device_type> &device,
+		VkDeviceSize size);
+	friend VCC_LIBRARY void upload(queue::queue_type &queue,
+		staging_buffer_type &staging_buffer, const void *data,
+		VkDeviceSize size, buffer::buffer_type &buffer, VkDeviceSize offset);
+	friend VCC_LIBRARY VkDeviceSize write(queue::queue_type &queue,
+		staging_buffer_type &staging_buffer, const void *data,
+		VkDeviceSize size);
+	friend buffer::buffer_type &get_buffer(
+		staging_buffer_type &staging_buffer);
+
+	staging_buffer_type() = default;
+	staging_buffer_type(const staging_buffer_type &) = delete;
+	staging_buffer_type(staging_buffer_type &&copy) {
+		std::unique_lock<std::mutex> lock(copy.mutex);
+		buffer = std::move(copy.buffer);
+		map = std::move(copy.map);
+		ring = std::move(copy.ring);
+		alignment = copy.alignment;
+	}
+	staging_buffer_type &operator=(const staging_buffer_type &) = delete;
+	staging_buffer_type &operator=(staging_buffer_type &&copy) {
+		std::lock(mutex, copy.mutex);
+		std::unique_lock<std::mutex> lock(mutex, std::adopt_lock);
+		std::unique_lock<std::mutex> copy_lock(copy.mutex, std::adopt_lock);
+		buffer = std::move(copy.buffer);
+		map = std::move(copy.map);
+		ring = std::move(copy.ring);
+		alignment = copy.alignment;
+		return *this;
+	}
+
+private:
+	staging_buffer_type(buffer::buffer_type &&buffer,
+		std::unique_ptr<memory::map_type> &&map,
+		VkDeviceSize size, VkDeviceSize alignment)
+		: buffer(std::forward<buffer::buffer_type>(buffer)),
+		  map(std::forward<std::unique_ptr<memory::map_type>>(map)),
+		  ring(size), alignment(alignment) {}
+
+	buffer::buffer_type buffer;
+	std::unique_ptr<memory::map_type> map;
+	// Allocations are tagged with the flush tag of the queue.
+	vcc::internal::ring_allocator_type ring;
+	VkDeviceSize alignment;
+	mutable std::mutex mutex;
+};
+
+// Creates a ring of the given size in host visible and coherent memory.
+// The ring is mapped for the lifetime of the staging_buffer_type.
+VCC_LIBRARY staging_buffer_type create(
+	const type::supplier<device::device_type> &device, VkDeviceSize size);
+
+// Writes size bytes of data into the ring and records a copy to offset in
+// the given buffer, between memory barriers ordering it after earlier uses
+// of the range and before later ones, in the flush command buffer of the
+// next submit on the queue.
+// Blocks only if the ring has no room until an older submit has finished.
+// Throws if the content is larger than the ring.
+VCC_LIBRARY void upload(queue::queue_type &queue,
+	staging_buffer_type &staging_buffer, const void *data,
+	VkDeviceSize size, buffer::buffer_type &buffer, VkDeviceSize offset);
+
+// Writes size bytes of data into the ring for commands recorded by the
+// caller in the flush command buffer of the next submit on the queue, and
+// returns their offset in get_buffer. lock_flush(queue) must be held until
+// the commands are recorded.
+VCC_LIBRARY VkDeviceSize write(queue::queue_type &queue,
+	staging_buffer_type &staging_buffer, const void *data,
+	VkDeviceSize size);
+
+inline buffer::buffer_type &get_buffer(staging_buffer_type &staging_buffer) {
+	return staging_buffer.buffer;
+}
+
+}  // namespace staging_buffer
+}  // namespace vcc
+
+#endif /* STAGING_BUFFER_H_ */
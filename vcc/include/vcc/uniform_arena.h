@@ -0,0 +1,159 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef UNIFORM_ARENA_H_
+#define UNIFORM_ARENA_H_
+
+#include <string>
+#include <type/serialize.h>
+#include <vcc/buffer.h>
+#include <vcc/command.h>
+#include <vcc/descriptor_set.h>
+#include <vcc/internal/uniform_blocks.h>
+#include <vcc/memory.h>
+
+namespace vcc {
+
+namespace queue {
+
+struct queue_type;
+
+}  // namespace queue
+
+namespace uniform_arena {
+
+/*
+ * Packs many small uniform blocks into a single uniform buffer, instead of
+ * one input_buffer, buffer and descriptor set per object.
+ * The arena is bound once through a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+ * descriptor, see buffer_info, and each draw selects its block with an
+ * entry of bind_descriptor_sets::dynamic_offsets, see dynamic_offset.
+ *
+ * The buffer holds one copy of all blocks per frame in flight, rewritten
+ * in a single pass when any block changed, before the submit of a command
+ * buffer recording use.
+ */
+struct uniform_arena_type {
+	friend VCC_LIBRARY uniform_arena_type create(
+		const type::supplier<device::device_type> &device,
+		VkDeviceSize size, VkDeviceSize range, uint32_t frames);
+	friend VCC_LIBRARY uint32_t add(uniform_arena_type &arena,
+		type::serialize_type &&serialize);
+	friend VCC_LIBRARY bool flush(queue::queue_type &queue,
+		uniform_arena_type &arena, uint32_t frame);
+	friend VCC_LIBRARY uint32_t dynamic_offset(const uniform_arena_type &arena,
+		uint32_t block, uint32_t frame);
+	friend VCC_LIBRARY descriptor_set::buffer_info_type buffer_info(
+		uniform_arena_type &arena);
+
+	uniform_arena_type() = default;
+	uniform_arena_type(const uniform_arena_type &) = delete;
+	uniform_arena_type(uniform_arena_type &&copy) {
+		std::unique_lock<std::mutex> lock(copy.mutex);
+		buffer = std::move(copy.buffer);
+		map = std::move(copy.map);
+		blocks = std::move(copy.blocks);
+		content = std::move(copy.content);
+		range = copy.range;
+		stride = copy.stride;
+	}
+	uniform_arena_type &operator=(const uniform_arena_type &) = delete;
+	uniform_arena_type &operator=(uniform_arena_type &&copy) {
+		std::lock(mutex, copy.mutex);
+		std::unique_lock<std::mutex> lock(mutex, std::adopt_lock);
+		std::unique_lock<std::mutex> copy_lock(copy.mutex, std::adopt_lock);
+		buffer = std::move(copy.buffer);
+		map = std::move(copy.map);
+		blocks = std::move(copy.blocks);
+		content = std::move(copy.content);
+		range = copy.range;
+		stride = copy.stride;
+		return *this;
+	}
+
+private:
+	struct block_type {
+		type::serialize_type serialize;
+		VkDeviceSize offset;
+	};
+
+	uniform_arena_type(buffer::buffer_type &&buffer,
+		std::unique_ptr<memory::map_type> &&map, VkDeviceSize size,
+		VkDeviceSize range, VkDeviceSize alignment, VkDeviceSize stride,
+		uint32_t frames)
+		: buffer(std::forward<buffer::buffer_type>(buffer)),
+		  map(std::forward<std::unique_ptr<memory::map_type>>(map)),
+		  content(size, range, alignment, frames), range(range),
+		  stride(stride) {}
+
+	buffer::buffer_type buffer;
+	std::unique_ptr<memory::map_type> map;
+	std::vector<block_type> blocks;
+	// The latest content of all blocks as laid out in each frame.
+	vcc::internal::uniform_blocks_type content;
+	// The descriptor range, no block is larger.
+	VkDeviceSize range;
+	// Distance between the frames in the buffer.
+	VkDeviceSize stride;
+	mutable std::mutex mutex;
+};
+
+// Creates an arena of size bytes per frame in host visible and coherent
+// memory, mapped for its lifetime. range is the size of the largest block.
+VCC_LIBRARY uniform_arena_type create(
+	const type::supplier<device::device_type> &device,
+	VkDeviceSize size, VkDeviceSize range, uint32_t frames);
+
+// Appends a block aligned to minUniformBufferOffsetAlignment and returns
+// its index. Throws if the block is larger than the range or the arena is
+// full.
+VCC_LIBRARY uint32_t add(uniform_arena_type &arena,
+	type::serialize_type &&serialize);
+
+template<typename... StorageType>
+uint32_t add(uniform_arena_type &arena, type::memory_layout layout,
+		StorageType... storages) {
+	return add(arena, type::make_serialize(layout,
+		std::forward<StorageType>(storages)...));
+}
+
+// Serializes the changed blocks and writes all of them into the copy of
+// the given frame, once the submit that last read that copy on the queue
+// has finished. Called by the pre-execute hook of use, the copy is then
+// known to be read by the submit that follows on the queue.
+VCC_LIBRARY bool flush(queue::queue_type &queue, uniform_arena_type &arena,
+	uint32_t frame);
+
+// Returns a command flushing the copy of the frame for the submit of the
+// command buffer it is recorded into, which must be the one reading it:
+//   command_buffer::compile(command_buffer, ...,
+//     uniform_arena::use(arena, frame),
+//     command::bind_descriptor_sets{ ..., dynamic_offsets }, ...);
+VCC_LIBRARY command::record_type use(
+	const type::supplier<uniform_arena_type> &arena, uint32_t frame);
+
+// The dynamic offset selecting the block in the copy of the given frame.
+VCC_LIBRARY uint32_t dynamic_offset(const uniform_arena_type &arena,
+	uint32_t block, uint32_t frame);
+
+// Describes the arena for a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+// descriptor write.
+VCC_LIBRARY descriptor_set::buffer_info_type buffer_info(
+	uniform_arena_type &arena);
+
+}  // namespace uniform_arena
+}  // namespace vcc
+
+#endif /* UNIFORM_ARENA_H_ */
@@ -0,0 +1,140 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#ifndef UPLOADER_H_
+#define UPLOADER_H_
+
+#include <mutex>
+#include <vcc/buffer.h>
+#include <vcc/command.h>
+#include <vcc/image.h>
+#include <vcc/input_buffer.h>
+#include <vcc/internal/upload_batch.h>
+#include <vcc/queue.h>
+
+namespace vcc {
+namespace uploader {
+
+/*
+ * Uploads content on a transfer queue, overlapping with the frames of the
+ * graphics queue:
+ *   uploader::upload(uploader, pixels, size, texture, range, regions,
+ *     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+ *     VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+ *   // Frames not using the texture.
+ *   uploader::submit(uploader);
+ *   // Frames sampling the texture.
+ * Copies are recorded through the staging buffer of the transfer queue,
+ * followed by the release half of an ownership transfer to the graphics
+ * family. submit sends them to the transfer queue, signaling a semaphore
+ * that a submit on the graphics queue recording the acquire half waits on.
+ * The graphics queue never waits for the CPU and the CPU only waits when
+ * the staging buffer is full.
+ * Meant for content not in use by the graphics queue, such as new
+ * textures and meshes: images are transitioned from
+ * VK_IMAGE_LAYOUT_UNDEFINED and everything outside the uploaded regions
+ * is discarded.
+ * Both queues may be the same, or of the same family, the barriers are
+ * then reduced to what is needed.
+ */
+struct uploader_type {
+	friend VCC_LIBRARY uploader_type create(
+		const type::supplier<queue::queue_type> &transfer_queue,
+		const type::supplier<queue::queue_type> &graphics_queue,
+		VkDeviceSize staging_size);
+	friend VCC_LIBRARY void upload(uploader_type &uploader, const void *data,
+		VkDeviceSize size, const type::supplier<buffer::buffer_type> &buffer,
+		VkDeviceSize offset, VkPipelineStageFlags dst_stages,
+		VkAccessFlags dst_access);
+	friend VCC_LIBRARY void upload(uploader_type &uploader, const void *data,
+		VkDeviceSize size, const type::supplier<image::image_type> &image,
+		const VkImageSubresourceRange &range,
+		const std::vector<VkBufferImageCopy> &regions, VkImageLayout layout,
+		VkPipelineStageFlags dst_stages, VkAccessFlags dst_access);
+	friend VCC_LIBRARY void upload(uploader_type &uploader,
+		input_buffer::input_buffer_type &buffer,
+		VkPipelineStageFlags dst_stages, VkAccessFlags dst_access);
+	friend VCC_LIBRARY void submit(uploader_type &uploader);
+
+	uploader_type() = default;
+	uploader_type(uploader_type &&) = default;
+	uploader_type(const uploader_type &) = delete;
+	uploader_type &operator=(uploader_type &&) = default;
+	uploader_type &operator=(const uploader_type &) = delete;
+
+private:
+	// The acquire half of an upload, of either a buffer or an image.
+	struct acquire_type {
+		type::supplier<buffer::buffer_type> buffer;
+		VkDeviceSize offset, size;
+		type::supplier<image::image_type> image;
+		VkImageSubresourceRange range;
+		internal::upload_barriers_type barriers;
+	};
+
+	struct data_type {
+		type::supplier<queue::queue_type> transfer_queue, graphics_queue;
+		internal::upload_queues_type queues;
+		// Waited on by the graphics queue, recycled with its flush tags.
+		semaphore::pool_type semaphores;
+		// Guarded by lock_flush of the transfer queue.
+		internal::upload_batch_type<acquire_type> batch;
+		// Serializes submits, keeping the semaphores in order.
+		std::mutex mutex;
+	};
+
+	std::unique_ptr<data_type> data;
+};
+
+// Both queues must be of the same device. get_queue_families of
+// physical_device finds a transfer only family, if any. A staging buffer
+// of staging_size is given to the transfer queue unless it has one.
+VCC_LIBRARY uploader_type create(
+	const type::supplier<queue::queue_type> &transfer_queue,
+	const type::supplier<queue::queue_type> &graphics_queue,
+	VkDeviceSize staging_size);
+
+// Copies size bytes of data to offset in the buffer, made visible to the
+// dst_access of the graphics queue at dst_stages once submitted.
+VCC_LIBRARY void upload(uploader_type &uploader, const void *data,
+	VkDeviceSize size, const type::supplier<buffer::buffer_type> &buffer,
+	VkDeviceSize offset, VkPipelineStageFlags dst_stages,
+	VkAccessFlags dst_access);
+
+// Copies the regions of data, their bufferOffset relative to data, to the
+// image, whose range ends up in layout for the graphics queue.
+VCC_LIBRARY void upload(uploader_type &uploader, const void *data,
+	VkDeviceSize size, const type::supplier<image::image_type> &image,
+	const VkImageSubresourceRange &range,
+	const std::vector<VkBufferImageCopy> &regions, VkImageLayout layout,
+	VkPipelineStageFlags dst_stages, VkAccessFlags dst_access);
+
+// Copies the dirty content of a staged input_buffer, which is then no
+// longer dirty and is not uploaded again by the graphics queue. Buffered
+// input_buffers are not supported.
+VCC_LIBRARY void upload(uploader_type &uploader,
+	input_buffer::input_buffer_type &buffer,
+	VkPipelineStageFlags dst_stages, VkAccessFlags dst_access);
+
+// Submits the uploads since the last submit to the transfer queue, and the
+// acquire barriers to the graphics queue waiting for them, so that work
+// submitted to the graphics queue afterwards sees the content. Does
+// nothing if there was no upload.
+VCC_LIBRARY void submit(uploader_type &uploader);
+
+}  // namespace uploader
+}  // namespace vcc
+
+#endif /* UPLOADER_H_ */
@@ -22,12 +22,15 @@
 #include <condition_variable>
 #include <thread>
 #include <vector>
+#include <vcc/buffer.h>
 #include <vcc/command_pool.h>
 #include <vcc/device.h>
 #include <vcc/image.h>
 #include <vcc/image_view.h>
 #include <vcc/instance.h>
+#include <vcc/internal/frame_pacer.h>
 #include <vcc/keycode.h>
+#include <vcc/memory.h>
 #include <vcc/queue.h>
 #include <vcc/surface.h>
 #ifdef _WIN32
@@ -155,9 +158,70 @@ inline command_buffer::command_buffer_type &get_post_draw_command(
 	return swapchain.post_draw_command;
 }
 
+/*
+ * The resources of one of the frames in flight, reused every frames in
+ * flight frames once the GPU is done with the previous frame of the slot.
+ * Command buffers and uploads are only valid until then.
+ */
+struct frame_type {
+	friend struct internal::window_data_type;
+	friend uint32_t get_image_index(const frame_type &frame);
+	friend uint32_t get_slot(const frame_type &frame);
+	friend VCC_LIBRARY command_buffer::command_buffer_type &
+		acquire_command_buffer(frame_type &frame);
+	friend VCC_LIBRARY VkDeviceSize upload(frame_type &frame, const void *data,
+		VkDeviceSize size, VkDeviceSize alignment);
+	friend buffer::buffer_type &get_upload_buffer(frame_type &frame);
+
+	frame_type() = default;
+	frame_type(const frame_type&) = delete;
+	frame_type(frame_type&&) = default;
+	frame_type &operator=(const frame_type&) = delete;
+	frame_type &operator=(frame_type&&) = default;
+
+private:
+	uint32_t slot, image_index;
+	fence::fence_type fence;
+	// Signaled by acquire_next_image and by the last submit of the frame.
+	semaphore::semaphore_type acquire_semaphore, render_semaphore;
+	command_pool::command_pool_type command_pool;
+	std::vector<command_buffer::command_buffer_type> command_buffers;
+	std::size_t used_command_buffers;
+	buffer::buffer_type upload_buffer;
+	std::unique_ptr<memory::map_type> upload_map;
+	VkDeviceSize upload_size, upload_offset;
+};
+
+// The index of the swapchain image rendered to by the frame.
+inline uint32_t get_image_index(const frame_type &frame) {
+	return frame.image_index;
+}
+
+// The slot of the frame, in [0, frames in flight).
+inline uint32_t get_slot(const frame_type &frame) {
+	return frame.slot;
+}
+
+// Returns a primary command buffer of the frame in the initial state,
+// allocated from a transient pool reset when the slot is reused.
+VCC_LIBRARY command_buffer::command_buffer_type &acquire_command_buffer(
+	frame_type &frame);
+
+// Copies size bytes into the host visible upload buffer of the frame and
+// returns their offset, a multiple of alignment. Throws if the buffer is
+// full. The buffer may be used as a vertex, index, uniform or transfer
+// source buffer by the submits of the frame.
+VCC_LIBRARY VkDeviceSize upload(frame_type &frame, const void *data,
+	VkDeviceSize size, VkDeviceSize alignment = 1);
+
+inline buffer::buffer_type &get_upload_buffer(frame_type &frame) {
+	return frame.upload_buffer;
+}
+
 typedef std::function<void(VkFormat)> initialize_callback_type;
 typedef std::function<void(VkExtent2D, VkFormat, std::vector<swapchain_type> &)> resize_callback_type;
 typedef std::function<void(uint32_t)> draw_callback_type;
+typedef std::function<void(frame_type &)> frame_callback_type;
 
 enum mouse_button_type {
 	mouse_button_left = 0,
@@ -245,12 +309,23 @@ struct window_data_type {
 				extent(extent),
 				resize_callback(resize_callback),
 				draw_callback(draw_callback),
+				frames_in_flight(0),
+				upload_size(0),
 				device(device),
 				input_callbacks(input_callbacks),
 				graphics_queue(graphics_queue),
-				render_thread([this]() {draw(); }) {}
+				render_thread([this]() {
+					if (frame_callback) {
+						draw_frame();
+					} else {
+						draw();
+					}
+				}) {}
 
 	void draw();
+	void draw_frame();
+	// Waits on the fence of the frame of slot and resets it.
+	void wait_frame(uint32_t slot);
 
 	type::supplier<instance::instance_type> instance;
 	surface::surface_type surface;
@@ -262,6 +337,9 @@ struct window_data_type {
 
 	resize_callback_type resize_callback;
 	draw_callback_type draw_callback;
+	frame_callback_type frame_callback;
+	uint32_t frames_in_flight;
+	VkDeviceSize upload_size;
 
 	type::supplier<device::device_type> device;
 	input_callbacks_type input_callbacks;
@@ -272,7 +350,12 @@ struct window_data_type {
 	swapchain::swapchain_type swapchain;
 	std::vector<swapchain_type> swapchain_images;
 	command_pool::command_pool_type cmd_pool;
-	vcc::semaphore::semaphore_type present_complete_semaphore;
+	// Semaphores signaled by acquire_next_image, recycled once the
+	// post-draw submit waiting on them has completed.
+	vcc::semaphore::pool_type semaphore_pool;
+	// Created by the first draw_frame.
+	std::vector<frame_type> frames;
+	vcc::internal::frame_pacer_type pacer;
 };
 
 }  // namespace internal
@@ -308,6 +391,17 @@ VCC_LIBRARY int run(window_type &window,
 	const draw_callback_type &draw_callback,
 	const input_callbacks_type &input_callbacks = input_callbacks_type());
 
+// As run, with frames_in_flight frames recorded ahead of the GPU. The frame
+// callback submits its commands to the graphics queue, the CPU only waits
+// for the GPU when the slot of the frame, or the swapchain image, is still
+// used by an earlier frame. Submits to other queues are not waited on.
+VCC_LIBRARY int run(window_type &window,
+	const resize_callback_type &resize_callback,
+	const frame_callback_type &frame_callback,
+	uint32_t frames_in_flight = 2,
+	VkDeviceSize upload_size = 1024 * 1024,
+	const input_callbacks_type &input_callbacks = input_callbacks_type());
+
 }  // namespace window
 }  // namespace vcc
 
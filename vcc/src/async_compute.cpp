@@ -0,0 +1,207 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <algorithm>
+#include <vcc/async_compute.h>
+#include <vcc/internal/flush_batch.h>
+
+namespace vcc {
+namespace async_compute {
+
+namespace {
+
+typedef std::vector<type::supplier<command_buffer::command_buffer_type>>
+	command_buffers_type;
+
+// Moves the resources whose key is in keys to buffers and images.
+void select(const shared_resources_type &resources,
+		std::vector<const void *> &keys,
+		std::vector<shared_buffer_type> &buffers,
+		std::vector<shared_image_type> &images) {
+	const auto take([&keys](const void *key) {
+		const auto it(std::find(keys.begin(), keys.end(), key));
+		if (it == keys.end()) {
+			return false;
+		}
+		keys.erase(it);
+		return true;
+	});
+	for (const shared_buffer_type &buffer : resources.buffers) {
+		if (take(&*buffer.buffer)) {
+			buffers.push_back(buffer);
+		}
+	}
+	for (const shared_image_type &image : resources.images) {
+		if (take(&*image.image)) {
+			images.push_back(image);
+		}
+	}
+}
+
+typedef vcc::internal::ownership_transfer_type<const void *> transfer_type;
+
+// Records a barrier of a transfer into a transient command buffer of
+// queue. lock_flush(queue) must be held until it is submitted.
+command_buffer::command_buffer_type &record_transfer(queue::queue_type &queue,
+		const vcc::internal::ownership_barrier_type &barrier, bool to_compute,
+		const std::vector<shared_buffer_type> &buffers,
+		const std::vector<shared_image_type> &images) {
+	// Release barriers make the writes of the source family available,
+	// acquire barriers visible to the accesses of the destination.
+	const auto src_access([to_compute, &barrier](
+			VkAccessFlags graphics_access, VkAccessFlags compute_access) {
+		return barrier.release
+			? (to_compute ? graphics_access : compute_access)
+			: VkAccessFlags(0);
+	});
+	const auto dst_access([to_compute, &barrier](
+			VkAccessFlags graphics_access, VkAccessFlags compute_access) {
+		return barrier.release ? VkAccessFlags(0)
+			: (to_compute ? compute_access : graphics_access);
+	});
+	std::vector<command::memory_barrier> memory_barriers;
+	if (barrier.memory_src_access || barrier.memory_dst_access) {
+		memory_barriers.push_back(command::memory_barrier{
+			barrier.memory_src_access, barrier.memory_dst_access });
+	}
+	std::vector<command::buffer_memory_barrier_type> buffer_barriers;
+	buffer_barriers.reserve(buffers.size());
+	for (const shared_buffer_type &buffer : buffers) {
+		buffer_barriers.push_back(command::buffer_memory_barrier(
+			src_access(buffer.graphics_access, buffer.compute_access),
+			dst_access(buffer.graphics_access, buffer.compute_access),
+			barrier.src_family, barrier.dst_family, buffer.buffer));
+	}
+	std::vector<command::image_memory_barrier> image_barriers;
+	image_barriers.reserve(images.size());
+	for (const shared_image_type &image : images) {
+		image_barriers.push_back(command::image_memory_barrier{
+			src_access(image.graphics_access, image.compute_access),
+			dst_access(image.graphics_access, image.compute_access),
+			image.layout, image.layout, barrier.src_family,
+			barrier.dst_family, image.image, image.range });
+	}
+	command_buffer::command_buffer_type &command_buffer(
+		vcc::internal::acquire_transient(queue));
+	command_buffer::compile(command_buffer,
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, VK_FALSE, 0, 0,
+		command::pipeline_barrier(barrier.src_stages, barrier.dst_stages, 0,
+			memory_barriers, buffer_barriers, image_barriers));
+	return command_buffer;
+}
+
+// Submits the release half of the transfer to from and the acquire half
+// with commands to to, to waiting for from.
+void submit_transfer(queue::queue_type &from, queue::queue_type &to,
+		semaphore::pool_type &semaphores, const transfer_type &transfer,
+		const std::vector<shared_buffer_type> &buffers,
+		const std::vector<shared_image_type> &images,
+		const command_buffers_type &commands) {
+	semaphore::semaphore_type semaphore(semaphore::acquire(semaphores,
+		vcc::internal::completed_flush_tag(to)));
+	{
+		std::unique_lock<std::recursive_mutex> flush_lock(
+			vcc::internal::lock_flush(from));
+		command_buffers_type release;
+		if (transfer.release.record) {
+			release.push_back(std::ref(record_transfer(from, transfer.release,
+				transfer.to_compute, buffers, images)));
+		}
+		queue::submit(from, {}, release, { std::ref(semaphore) });
+	}
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(to));
+	command_buffers_type acquire;
+	acquire.reserve(commands.size() + 1);
+	acquire.push_back(std::ref(record_transfer(to, transfer.acquire,
+		transfer.to_compute, buffers, images)));
+	acquire.insert(acquire.end(), commands.begin(), commands.end());
+	const vcc::internal::flush_batch_type::tag_type tag(
+		vcc::internal::flush_track(to));
+	queue::submit(to, { queue::wait_semaphore{ std::ref(semaphore),
+		vcc::internal::ownership_wait_stages } }, acquire, {});
+	semaphore::release(semaphores, std::move(semaphore), tag);
+}
+
+}  // anonymous namespace
+
+scheduler_type create(
+		const type::supplier<queue::queue_type> &graphics_queue,
+		const type::supplier<queue::queue_type> &compute_queue) {
+	const type::supplier<device::device_type> &device(
+		vcc::internal::get_parent(*graphics_queue));
+	if (&*device != &*vcc::internal::get_parent(*compute_queue)) {
+		throw vcc_exception("The queues are of different devices");
+	}
+	scheduler_type scheduler;
+	scheduler.data.reset(new scheduler_type::data_type);
+	scheduler.data->graphics_queue = graphics_queue;
+	scheduler.data->compute_queue = compute_queue;
+	scheduler.data->compute_semaphores = semaphore::create_pool(device);
+	scheduler.data->graphics_semaphores = semaphore::create_pool(device);
+	scheduler.data->planner = vcc::internal::ownership_planner_type<
+		const void *>(queue::get_family_index(*graphics_queue),
+			queue::get_family_index(*compute_queue));
+	return scheduler;
+}
+
+void dispatch(scheduler_type &scheduler,
+		const shared_resources_type &resources,
+		const command_buffers_type &command_buffers) {
+	scheduler_type::data_type &data(*scheduler.data);
+	std::lock_guard<std::mutex> lock(data.mutex);
+	queue::queue_type &graphics_queue(*data.graphics_queue);
+	queue::queue_type &compute_queue(*data.compute_queue);
+	if (vcc::internal::get_instance(graphics_queue)
+			== vcc::internal::get_instance(compute_queue)) {
+		queue::submit(compute_queue, {}, command_buffers, {});
+		return;
+	}
+	std::vector<const void *> keys;
+	keys.reserve(resources.buffers.size() + resources.images.size());
+	for (const shared_buffer_type &buffer : resources.buffers) {
+		keys.push_back(&*buffer.buffer);
+	}
+	for (const shared_image_type &image : resources.images) {
+		keys.push_back(&*image.image);
+	}
+	transfer_type transfer(data.planner.dispatch(keys));
+	std::vector<const void *> acquired(transfer.keys);
+	std::vector<shared_buffer_type> buffers;
+	std::vector<shared_image_type> images;
+	select(resources, acquired, buffers, images);
+	submit_transfer(graphics_queue, compute_queue, data.compute_semaphores,
+		transfer, buffers, images, command_buffers);
+	data.planner.submitted();
+	// Kept to transfer them back on join.
+	data.buffers.insert(data.buffers.end(), buffers.begin(), buffers.end());
+	data.images.insert(data.images.end(), images.begin(), images.end());
+}
+
+void join(scheduler_type &scheduler) {
+	scheduler_type::data_type &data(*scheduler.data);
+	std::lock_guard<std::mutex> lock(data.mutex);
+	transfer_type transfer;
+	if (!data.planner.join(transfer)) {
+		return;
+	}
+	submit_transfer(*data.compute_queue, *data.graphics_queue,
+		data.graphics_semaphores, transfer, data.buffers, data.images, {});
+	data.buffers.clear();
+	data.images.clear();
+}
+
+}  // namespace async_compute
+}  // namespace vcc
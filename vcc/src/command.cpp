@@ -32,59 +32,143 @@ VkClearValue clear_depth_stencil(const VkClearDepthStencilValue &depth_stencil)
 
 namespace internal {
 
+namespace {
+
+void record_barrier(VkCommandBuffer command_buffer,
+		const vcc::internal::barrier_batch_type &barrier) {
+	VKTRACE(vkCmdPipelineBarrier(command_buffer, barrier.src_stages,
+		barrier.dst_stages, barrier.dependency_flags,
+		(uint32_t)barrier.memory_barriers.size(),
+		barrier.memory_barriers.data(),
+		(uint32_t)barrier.buffer_barriers.size(),
+		barrier.buffer_barriers.data(),
+		(uint32_t)barrier.image_barriers.size(),
+		barrier.image_barriers.data()));
+}
+
+// Adds the barrier filled in args.barriers.next(), after recording the
+// draws pending in the batcher which precede it.
+void add_barrier(cmd_args &args) {
+	if (!args.batcher.empty()) {
+		get_command_buffer(args);
+	}
+	const VkCommandBuffer command_buffer(
+		vcc::internal::get_instance(args.buffer.get()));
+	args.barriers.add([command_buffer](
+			const vcc::internal::barrier_batch_type &barrier) {
+		record_barrier(command_buffer, barrier);
+	});
+}
+
+}  // anonymous namespace
+
+VkCommandBuffer get_command_buffer(cmd_args &args) {
+	const VkCommandBuffer command_buffer(
+		vcc::internal::get_instance(args.buffer.get()));
+	// A pending barrier precedes any pending draws, draws flush the barrier
+	// through here before being added to the batcher.
+	args.barriers.flush([command_buffer](
+			const vcc::internal::barrier_batch_type &barrier) {
+		record_barrier(command_buffer, barrier);
+	});
+	if (!args.batcher.empty()) {
+		const VkDeviceSize stride(sizeof(VkDrawIndexedIndirectCommand));
+		args.batcher.flush([command_buffer](
+				const VkDrawIndexedIndirectCommand &draw) {
+			VKTRACE(vkCmdDrawIndexed(command_buffer, draw.indexCount,
+				draw.instanceCount, draw.firstIndex, draw.vertexOffset,
+				draw.firstInstance));
+		}, [&args, stride](std::size_t first, std::size_t count) {
+			cmd(args, draw_indexed_indirect_data_type{ args.batch_buffer,
+				first * stride, uint32_t(count), uint32_t(stride) });
+		});
+	}
+	return command_buffer;
+}
+
 void cmd(cmd_args &args, const bind_pipeline &bp) {
-	VKTRACE(vkCmdBindPipeline(vcc::internal::get_instance(args.buffer.get()),
-		bp.pipelineBindPoint, vcc::internal::get_instance(*bp.pipeline)));
+	const VkPipeline pipeline(vcc::internal::get_instance(*bp.pipeline));
+	if (args.state.bind_pipeline(bp.pipelineBindPoint, pipeline)) {
+		VKTRACE(vkCmdBindPipeline(
+			get_command_buffer(args),
+			bp.pipelineBindPoint, pipeline));
+	}
 	args.references.add(bp.pipeline);
 }
 
 void cmd(cmd_args &args, const set_viewport &sv) {
-	VKTRACE(vkCmdSetViewport(vcc::internal::get_instance(args.buffer.get()),
-		sv.first_viewport, (uint32_t)sv.viewports.size(),
-		sv.viewports.data()));
+	if (args.state.set_viewport(sv.first_viewport, sv.viewports)) {
+		VKTRACE(vkCmdSetViewport(
+			get_command_buffer(args),
+			sv.first_viewport, (uint32_t)sv.viewports.size(),
+			sv.viewports.data()));
+	}
 }
 
 void cmd(cmd_args &args, const set_scissor &ss) {
-	VKTRACE(vkCmdSetScissor(vcc::internal::get_instance(args.buffer.get()),
-		ss.first_scissor, (uint32_t)ss.scissors.size(), ss.scissors.data()));
+	if (args.state.set_scissor(ss.first_scissor, ss.scissors)) {
+		VKTRACE(vkCmdSetScissor(
+			get_command_buffer(args),
+			ss.first_scissor, (uint32_t)ss.scissors.size(),
+			ss.scissors.data()));
+	}
 }
 
 void cmd(cmd_args &args, const set_line_width &slw) {
-	VKTRACE(vkCmdSetLineWidth(vcc::internal::get_instance(args.buffer.get()),
-		slw.lineWidth));
+	if (args.state.set_line_width(slw.lineWidth)) {
+		VKTRACE(vkCmdSetLineWidth(
+			get_command_buffer(args), slw.lineWidth));
+	}
 }
 
 void cmd(cmd_args &args, const set_depth_bias &sdb) {
-	VKTRACE(vkCmdSetDepthBias(vcc::internal::get_instance(args.buffer.get()),
-		sdb.depthBiasConstantFactor, sdb.depthBiasClamp, sdb.depthBiasSlopeFactor));
+	if (args.state.set_depth_bias(sdb.depthBiasConstantFactor,
+			sdb.depthBiasClamp, sdb.depthBiasSlopeFactor)) {
+		VKTRACE(vkCmdSetDepthBias(
+			get_command_buffer(args),
+			sdb.depthBiasConstantFactor, sdb.depthBiasClamp,
+			sdb.depthBiasSlopeFactor));
+	}
 }
 
 void cmd(cmd_args &args, const set_blend_constants &sbc) {
-	VKTRACE(vkCmdSetBlendConstants(vcc::internal::get_instance(args.buffer.get()),
-		sbc.blendConstants.data()));
+	if (args.state.set_blend_constants(sbc.blendConstants)) {
+		VKTRACE(vkCmdSetBlendConstants(
+			get_command_buffer(args),
+			sbc.blendConstants.data()));
+	}
 }
 
 void cmd(cmd_args &args, const set_depth_bounds &sdb) {
-	VKTRACE(vkCmdSetDepthBounds(vcc::internal::get_instance(args.buffer.get()),
-		sdb.minDepthBounds, sdb.maxDepthBounds));
+	if (args.state.set_depth_bounds(sdb.minDepthBounds, sdb.maxDepthBounds)) {
+		VKTRACE(vkCmdSetDepthBounds(
+			get_command_buffer(args),
+			sdb.minDepthBounds, sdb.maxDepthBounds));
+	}
 }
 
 void cmd(cmd_args &args, const set_stencil_compare_mask &sscm) {
-	VKTRACE(vkCmdSetStencilCompareMask(
-		vcc::internal::get_instance(args.buffer.get()),
-		sscm.faceMask, sscm.compareMask));
+	if (args.state.set_stencil_compare_mask(sscm.faceMask, sscm.compareMask)) {
+		VKTRACE(vkCmdSetStencilCompareMask(
+			get_command_buffer(args),
+			sscm.faceMask, sscm.compareMask));
+	}
 }
 
 void cmd(cmd_args &args, const set_stencil_write_mask &sswm) {
-	VKTRACE(vkCmdSetStencilWriteMask(
-		vcc::internal::get_instance(args.buffer.get()),
-		sswm.faceMask, sswm.writeMask));
+	if (args.state.set_stencil_write_mask(sswm.faceMask, sswm.writeMask)) {
+		VKTRACE(vkCmdSetStencilWriteMask(
+			get_command_buffer(args),
+			sswm.faceMask, sswm.writeMask));
+	}
 }
 
 void cmd(cmd_args &args, const set_stencil_reference &ssr) {
-	VKTRACE(vkCmdSetStencilReference(
-		vcc::internal::get_instance(args.buffer.get()),
-		ssr.faceMask, ssr.reference));
+	if (args.state.set_stencil_reference(ssr.faceMask, ssr.reference)) {
+		VKTRACE(vkCmdSetStencilReference(
+			get_command_buffer(args),
+			ssr.faceMask, ssr.reference));
+	}
 }
 
 void cmd(cmd_args &args, const bind_descriptor_sets &bds) {
@@ -92,9 +176,6 @@ void cmd(cmd_args &args, const bind_descriptor_sets &bds) {
 	descriptor_sets.reserve(bds.descriptor_sets.size());
 	type::supplier<pipeline_layout::pipeline_layout_type> layout(bds.layout);
 	args.references.add(layout);
-	args.pre_execute_callbacks.add([layout](queue::queue_type &queue) {
-		pipeline_layout::internal::get_pre_execute_callbacks(*layout)(queue);
-	});
 	for (const type::supplier<descriptor_set::descriptor_set_type> &descriptor_set : bds.descriptor_sets) {
 		descriptor_sets.push_back(vcc::internal::get_instance(*descriptor_set));
 		args.references.add(descriptor_set);
@@ -102,17 +183,41 @@ void cmd(cmd_args &args, const bind_descriptor_sets &bds) {
 			descriptor_set->pre_execute_callbacks(queue);
 		});
 	}
-	VKTRACE(vkCmdBindDescriptorSets(
-		vcc::internal::get_instance(args.buffer.get()), bds.pipelineBindPoint,
-		vcc::internal::get_instance(*layout), bds.firstSet,
-		(uint32_t)bds.descriptor_sets.size(), descriptor_sets.data(),
-		(uint32_t)bds.dynamic_offsets.size(), bds.dynamic_offsets.data()));
+	const VkPipelineLayout pipeline_layout(vcc::internal::get_instance(*layout));
+	if (args.state.bind_descriptor_sets(bds.pipelineBindPoint, pipeline_layout,
+			bds.firstSet, descriptor_sets, bds.dynamic_offsets)) {
+		VKTRACE(vkCmdBindDescriptorSets(
+			get_command_buffer(args),
+			bds.pipelineBindPoint, pipeline_layout, bds.firstSet,
+			(uint32_t)bds.descriptor_sets.size(), descriptor_sets.data(),
+			(uint32_t)bds.dynamic_offsets.size(), bds.dynamic_offsets.data()));
+	}
+	// Push constants are state of the command buffer, pushed again only
+	// when their values changed since the last push in this one, so skipped
+	// binds do not break a run of batched draws.
+	const std::unique_ptr<pipeline_layout::internal::push_constants_state_type>
+		&constants(pipeline_layout::internal::get_push_constants(*layout));
+	if (constants && !constants->ranges.empty()) {
+		std::lock_guard<std::mutex> lock(constants->mutex);
+		if (args.state.push_constants(pipeline_layout,
+				pipeline_layout::internal::update(*constants))) {
+			const VkCommandBuffer command_buffer(get_command_buffer(args));
+			for (const VkPushConstantRange &range : constants->ranges) {
+				VKTRACE(vkCmdPushConstants(command_buffer, pipeline_layout,
+					range.stageFlags, range.offset, range.size,
+					&constants->content[range.offset]));
+			}
+		}
+	}
 }
 
 void cmd(cmd_args &args, const bind_index_buffer_type &bib) {
-	VKTRACE(vkCmdBindIndexBuffer(
-		vcc::internal::get_instance(args.buffer.get()),
-		vcc::internal::get_instance(*bib.buffer), bib.offset, bib.indexType));
+	const VkBuffer buffer(vcc::internal::get_instance(*bib.buffer));
+	if (args.state.bind_index_buffer(buffer, bib.offset, bib.indexType)) {
+		VKTRACE(vkCmdBindIndexBuffer(
+			get_command_buffer(args), buffer,
+			bib.offset, bib.indexType));
+	}
 	args.references.add(bib.buffer);
 }
 
@@ -131,50 +236,58 @@ void cmd(cmd_args &args, const bind_vertex_buffers_type &bvb) {
 		offsets.push_back(bvb.offsets[i]);
 		//offsets.push_back(bvb.buffers[i]->offset + bvb.offsets[i]);
 	}
-	VKTRACE(vkCmdBindVertexBuffers(
-		vcc::internal::get_instance(args.buffer.get()), bvb.first_binding,
-		(uint32_t)bvb.buffers.size(), buffers.data(), offsets.data()));
+	if (args.state.bind_vertex_buffers(bvb.first_binding, buffers, offsets)) {
+		VKTRACE(vkCmdBindVertexBuffers(
+			get_command_buffer(args), bvb.first_binding,
+			(uint32_t)bvb.buffers.size(), buffers.data(), offsets.data()));
+	}
 }
 
 void cmd(cmd_args &args, const draw &d) {
-	VKTRACE(vkCmdDraw(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdDraw(get_command_buffer(args),
 		d.vertexCount, d.instanceCount, d.firstVertex, d.firstInstance));
 }
 
 void cmd(cmd_args &args, const draw_indexed &di) {
-	VKTRACE(vkCmdDrawIndexed(vcc::internal::get_instance(args.buffer.get()),
+	if (args.batcher.batching()) {
+		args.batcher.add(VkDrawIndexedIndirectCommand{ di.indexCount,
+			di.instanceCount, di.firstIndex, int32_t(di.vertexOffset),
+			di.firstInstance });
+		return;
+	}
+	VKTRACE(vkCmdDrawIndexed(get_command_buffer(args),
 		di.indexCount, di.instanceCount, di.firstIndex, di.vertexOffset,
 		di.firstInstance));
 }
 
 void cmd(cmd_args &args, const draw_indirect_type &di) {
-	VKTRACE(vkCmdDrawIndirect(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdDrawIndirect(get_command_buffer(args),
 		vcc::internal::get_instance(*di.buffer), di.offset, di.drawCount,
 		di.stride));
 }
 
 void cmd(cmd_args &args, const draw_indexed_indirect_type &dii) {
 	VKTRACE(vkCmdDrawIndexedIndirect(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*dii.buffer), dii.offset, dii.drawCount,
 		dii.stride));
 }
 
 void cmd(cmd_args &args, const dispatch &d) {
-	VKTRACE(vkCmdDispatch(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdDispatch(get_command_buffer(args),
 		d.x, d.y, d.z));
 }
 
 void cmd(cmd_args &args, const dispatch_indirect_type &di) {
 	VKTRACE(vkCmdDispatchIndirect(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*di.buffer), di.offset));
 	args.references.add(di.buffer);
 }
 
 void cmd(cmd_args &args, const copy_buffer_type &cb) {
 	VKTRACE(vkCmdCopyBuffer(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*cb.srcBuffer),
 		vcc::internal::get_instance(*cb.dstBuffer),
 		(uint32_t)cb.regions.size(), cb.regions.data()));
@@ -183,7 +296,7 @@ void cmd(cmd_args &args, const copy_buffer_type &cb) {
 }
 
 void cmd(cmd_args &args, const copy_image &ci) {
-	VKTRACE(vkCmdCopyImage(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdCopyImage(get_command_buffer(args),
 		vcc::internal::get_instance(*ci.srcImage), ci.srcImageLayout,
 		vcc::internal::get_instance(*ci.dstImage), ci.dstImageLayout,
 		(uint32_t)ci.regions.size(), ci.regions.data()));
@@ -192,7 +305,7 @@ void cmd(cmd_args &args, const copy_image &ci) {
 }
 
 void cmd(cmd_args &args, const blit_image &bi) {
-	VKTRACE(vkCmdBlitImage(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdBlitImage(get_command_buffer(args),
 		vcc::internal::get_instance(*bi.srcImage), bi.srcImageLayout,
 		vcc::internal::get_instance(*bi.dstImage), bi.dstImageLayout,
 		(uint32_t)bi.regions.size(), bi.regions.data(), bi.filter));
@@ -202,7 +315,7 @@ void cmd(cmd_args &args, const blit_image &bi) {
 
 void cmd(cmd_args &args, const copy_buffer_to_image_type &bti) {
 	VKTRACE(vkCmdCopyBufferToImage(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*bti.srcBuffer),
 		vcc::internal::get_instance(*bti.dstImage), bti.dstImageLayout,
 		(uint32_t)bti.regions.size(), bti.regions.data()));
@@ -212,7 +325,7 @@ void cmd(cmd_args &args, const copy_buffer_to_image_type &bti) {
 
 void cmd(cmd_args &args, const copy_image_to_buffer &cib) {
 	VKTRACE(vkCmdCopyImageToBuffer(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*cib.srcImage), cib.srcImageLayout,
 		vcc::internal::get_instance(*cib.dstBuffer),
 		(uint32_t)cib.regions.size(), cib.regions.data()));
@@ -222,7 +335,7 @@ void cmd(cmd_args &args, const copy_image_to_buffer &cib) {
 
 void cmd(cmd_args &args, const update_buffer &ub) {
 	VKTRACE(vkCmdUpdateBuffer(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*ub.dstBuffer), ub.dstOffset, ub.dataSize,
 		ub.pData));
 	args.references.add(ub.dstBuffer);
@@ -230,7 +343,7 @@ void cmd(cmd_args &args, const update_buffer &ub) {
 
 void cmd(cmd_args &args, const fill_buffer &fb) {
 	VKTRACE(vkCmdFillBuffer(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*fb.dstBuffer), fb.dstOffset, fb.size,
 		fb.data));
 	args.references.add(fb.dstBuffer);
@@ -238,7 +351,7 @@ void cmd(cmd_args &args, const fill_buffer &fb) {
 
 void cmd(cmd_args &args, const clear_color_image &cci) {
 	VKTRACE(vkCmdClearColorImage(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*cci.image), cci.imageLayout, &cci.color,
 		(uint32_t)cci.ranges.size(), cci.ranges.data()));
 	args.references.add(cci.image);
@@ -246,7 +359,7 @@ void cmd(cmd_args &args, const clear_color_image &cci) {
 
 void cmd(cmd_args &args, const clear_depth_stencil_image &cdsi) {
 	VKTRACE(vkCmdClearDepthStencilImage(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*cdsi.image), cdsi.imageLayout,
 		&cdsi.pDepthStencil, (uint32_t)cdsi.ranges.size(),
 		cdsi.ranges.data()));
@@ -255,14 +368,14 @@ void cmd(cmd_args &args, const clear_depth_stencil_image &cdsi) {
 
 void cmd(cmd_args &args, const clear_attachments &ca) {
 	VKTRACE(vkCmdClearAttachments(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		(uint32_t)ca.attachments.size(), ca.attachments.data(),
 		(uint32_t)ca.rects.size(), ca.rects.data()));
 }
 
 void cmd(cmd_args &args, const resolve_image &ri) {
 	VKTRACE(vkCmdResolveImage(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*ri.srcImage), ri.srcImageLayout,
 		vcc::internal::get_instance(*ri.dstImage), ri.dstImageLayout,
 		(uint32_t)ri.regions.size(), ri.regions.data()));
@@ -272,14 +385,14 @@ void cmd(cmd_args &args, const resolve_image &ri) {
 
 void cmd(cmd_args &args, const set_event &se) {
 	VKTRACE(vkCmdSetEvent(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*se.event), se.stageMask));
 	args.references.add(se.event);
 }
 
 void cmd(cmd_args &args, const reset_event &re) {
 	VKTRACE(vkCmdResetEvent(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*re.event), re.stageMask));
 	args.references.add(re.event);
 }
@@ -291,7 +404,7 @@ void cmd(cmd_args &args, const wait_events &we) {
 		events.push_back(vcc::internal::get_instance(*event));
 		args.references.add(event);
 	}
-	VKTRACE(vkCmdWaitEvents(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdWaitEvents(get_command_buffer(args),
 		(uint32_t)we.events.size(), events.data(), we.srcStageMask,
 		we.dstStageMask, (uint32_t)we.memoryBarriers.size(),
 		we.memoryBarriers.data(), (uint32_t)we.bufferMemoryBarriers.size(),
@@ -301,27 +414,25 @@ void cmd(cmd_args &args, const wait_events &we) {
 }
 
 void cmd(cmd_args &args, const pipeline_barrier &pb) {
-	std::vector<VkMemoryBarrier> memory_barriers;
-	memory_barriers.reserve(pb.memory_barriers.size());
+	vcc::internal::barrier_batch_type &barrier_batch(args.barriers.next());
+	barrier_batch.src_stages = pb.srcStageMask;
+	barrier_batch.dst_stages = pb.dstStageMask;
+	barrier_batch.dependency_flags = pb.dependencyFlags;
 	for (const memory_barrier &barrier : pb.memory_barriers) {
-		memory_barriers.push_back(VkMemoryBarrier{
+		barrier_batch.memory_barriers.push_back(VkMemoryBarrier{
 			VK_STRUCTURE_TYPE_MEMORY_BARRIER, NULL, barrier.srcAccessMask,
 			barrier.dstAccessMask });
 	}
-	std::vector<VkBufferMemoryBarrier> buffer_memory_barriers;
 	for (const buffer_memory_barrier_type &barrier : pb.buffer_memory_barriers) {
-		buffer_memory_barriers.push_back(VkBufferMemoryBarrier{
+		barrier_batch.buffer_barriers.push_back(VkBufferMemoryBarrier{
 			VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER, NULL,
 			barrier.srcAccessMask, barrier.dstAccessMask,
 			barrier.srcQueueFamilyIndex, barrier.dstQueueFamilyIndex,
 			vcc::internal::get_instance(*barrier.buffer), barrier.offset,
 			barrier.size });
 	}
-	buffer_memory_barriers.reserve(pb.buffer_memory_barriers.size());
-	std::vector<VkImageMemoryBarrier> image_memory_barriers;
-	image_memory_barriers.reserve(pb.image_memory_barriers.size());
 	for (const image_memory_barrier &barrier : pb.image_memory_barriers) {
-		image_memory_barriers.push_back(VkImageMemoryBarrier{
+		barrier_batch.image_barriers.push_back(VkImageMemoryBarrier{
 			VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, NULL,
 			barrier.srcAccessMask, barrier.dstAccessMask, barrier.oldLayout,
 			barrier.newLayout, barrier.srcQueueFamilyIndex,
@@ -329,35 +440,86 @@ void cmd(cmd_args &args, const pipeline_barrier &pb) {
 			vcc::internal::get_instance(*barrier.image),
 			barrier.subresourceRange });
 	}
-	VKTRACE(vkCmdPipelineBarrier(
-		vcc::internal::get_instance(args.buffer.get()), pb.srcStageMask,
-		pb.dstStageMask, pb.dependencyFlags, (uint32_t)memory_barriers.size(),
-		memory_barriers.data(), (uint32_t)buffer_memory_barriers.size(),
-		buffer_memory_barriers.data(), (uint32_t)image_memory_barriers.size(),
-		image_memory_barriers.data()));
+	add_barrier(args);
+	for (const image_memory_barrier &barrier : pb.image_memory_barriers) {
+		image::set_layout(*barrier.image, barrier.subresourceRange,
+			barrier.newLayout, pb.dstStageMask, barrier.dstAccessMask);
+	}
+}
+
+void cmd(cmd_args &args, const transition_layout &tl) {
+	// Resubmitting would reuse barriers built from the layouts at recording.
+	if (!(args.usage & VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT)) {
+		throw vcc_exception("transition_layout needs a one time submit command buffer");
+	}
+	const std::vector<vcc::internal::layout_transition_type> transitions(
+		image::transition_layout(*tl.image, tl.subresourceRange, tl.layout,
+			tl.stageMask, tl.accessMask));
+	if (transitions.empty()) {
+		return;
+	}
+	vcc::internal::barrier_batch_type &barrier_batch(args.barriers.next());
+	for (const vcc::internal::layout_transition_type &transition
+			: transitions) {
+		barrier_batch.src_stages |= transition.src_stages;
+		barrier_batch.image_barriers.push_back(VkImageMemoryBarrier{
+			VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER, NULL,
+			transition.src_access, tl.accessMask, transition.old_layout,
+			tl.layout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			vcc::internal::get_instance(*tl.image),
+			VkImageSubresourceRange{ tl.subresourceRange.aspectMask,
+				transition.base_level, transition.level_count,
+				transition.base_layer, transition.layer_count } });
+	}
+	if (!barrier_batch.src_stages) {
+		barrier_batch.src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+	barrier_batch.dst_stages = tl.stageMask;
+	add_barrier(args);
+	args.references.add(tl.image);
+}
+
+void end_attachment_layouts(const render_pass::render_pass_type &render_pass,
+		const framebuffer::framebuffer_type &framebuffer) {
+	const std::vector<VkImageLayout> &final_layouts(
+		render_pass::get_final_layouts(render_pass));
+	const std::vector<type::supplier<image_view::image_view_type>>
+		&image_views(framebuffer::get_image_views(framebuffer));
+	for (std::size_t i = 0; i < final_layouts.size() && i < image_views.size();
+			++i) {
+		const image_view::image_view_type &image_view(*image_views[i]);
+		// Any attachment may have been written by the last subpass using it.
+		image::set_layout(*image_view::get_image(image_view),
+			image_view::get_subresource_range(image_view), final_layouts[i],
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+				| VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+				| VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+				| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+	}
 }
 
 void cmd(cmd_args &args, const begin_query &bq) {
-	VKTRACE(vkCmdBeginQuery(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdBeginQuery(get_command_buffer(args),
 		vcc::internal::get_instance(*bq.queryPool), bq.entry, bq.flags));
 	args.references.add(bq.queryPool);
 }
 
 void cmd(cmd_args &args, const end_query &eq) {
-	VKTRACE(vkCmdEndQuery(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdEndQuery(get_command_buffer(args),
 		vcc::internal::get_instance(*eq.queryPool), eq.entry));
 	args.references.add(eq.queryPool);
 }
 
 void cmd(cmd_args &args, const reset_query_pool &rqp) {
-	VKTRACE(vkCmdResetQueryPool(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdResetQueryPool(get_command_buffer(args),
 		vcc::internal::get_instance(*rqp.queryPool), rqp.firstQuery,
 		rqp.queryCount));
 	args.references.add(rqp.queryPool);
 }
 
 void cmd(cmd_args &args, const write_timestamp &wt) {
-	VKTRACE(vkCmdWriteTimestamp(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdWriteTimestamp(get_command_buffer(args),
 		wt.pipelineStage, vcc::internal::get_instance(*wt.queryPool),
 		wt.entry));
 	args.references.add(wt.queryPool);
@@ -365,7 +527,7 @@ void cmd(cmd_args &args, const write_timestamp &wt) {
 
 void cmd(cmd_args &args, const copy_query_pool_results &cqpr) {
 	VKTRACE(vkCmdCopyQueryPoolResults(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		vcc::internal::get_instance(*cqpr.queryPool), cqpr.firstQuery,
 		cqpr.queryCount, vcc::internal::get_instance(*cqpr.dstBuffer),
 		cqpr.dstOffset, cqpr.stride, cqpr.flags));
@@ -374,14 +536,15 @@ void cmd(cmd_args &args, const copy_query_pool_results &cqpr) {
 }
 
 void cmd(cmd_args &args, const push_constants_type &pc) {
-	VKTRACE(vkCmdPushConstants(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdPushConstants(get_command_buffer(args),
 		vcc::internal::get_instance(*pc.layout), pc.stageFlags, pc.offset,
 		pc.size, pc.pValues));
+	args.state.forget_push_constants();
 	args.references.add(pc.layout);
 }
 
 void cmd(cmd_args &args, const next_subpass &ns) {
-	VKTRACE(vkCmdNextSubpass(vcc::internal::get_instance(args.buffer.get()),
+	VKTRACE(vkCmdNextSubpass(get_command_buffer(args),
 		ns.contents));
 }
 
@@ -396,25 +559,39 @@ void cmd(cmd_args &args, const execute_commands &ec) {
 		});
 	}
 	VKTRACE(vkCmdExecuteCommands(
-		vcc::internal::get_instance(args.buffer.get()),
+		get_command_buffer(args),
 		(uint32_t)command_buffers.size(), command_buffers.data()));
+	// The state bound in the primary command buffer is undefined after.
+	args.state.invalidate();
+}
+
+void cmd(cmd_args &args, const record_type &r) {
+	r.function(args);
 }
 
 void cmd(cmd_args &args, const bind_index_data_buffer_type&bidb) {
 	const type::supplier<input_buffer::input_buffer_type> &buffer(bidb.buffer);
-	args.pre_execute_callbacks.add([buffer](queue::queue_type &queue) {input_buffer::flush(queue, *buffer); });
-	cmd(args, bind_index_buffer_type{ std::ref(input_buffer::internal::get_buffer(*buffer)), bidb.offset, bidb.indexType });
+	const uint32_t frame(bidb.frame);
+	args.pre_execute_callbacks.add([buffer, frame](queue::queue_type &queue) {input_buffer::flush(queue, *buffer, frame); });
+	cmd(args, bind_index_buffer_type{ std::ref(input_buffer::internal::get_buffer(*buffer)),
+		bidb.offset + input_buffer::frame_offset(*buffer, frame), bidb.indexType });
 }
 
 void cmd(cmd_args &args, const bind_vertex_data_buffers_type&bvdb) {
 	std::vector<type::supplier<buffer::buffer_type>> buffers;
 	buffers.reserve(bvdb.buffers.size());
-	for (const type::supplier<input_buffer::input_buffer_type> &buffer : bvdb.buffers) {
-		args.pre_execute_callbacks.add([buffer](queue::queue_type &queue) {input_buffer::flush(queue, *buffer); });
+	std::vector<VkDeviceSize> offsets(bvdb.offsets);
+	const uint32_t frame(bvdb.frame);
+	for (std::size_t i = 0; i < bvdb.buffers.size(); ++i) {
+		const type::supplier<input_buffer::input_buffer_type> &buffer(bvdb.buffers[i]);
+		args.pre_execute_callbacks.add([buffer, frame](queue::queue_type &queue) {input_buffer::flush(queue, *buffer, frame); });
 		buffers.push_back(std::ref(input_buffer::internal::get_buffer(*buffer)));
+		if (i < offsets.size()) {
+			offsets[i] += input_buffer::frame_offset(*buffer, frame);
+		}
 	}
 	cmd(args, bind_vertex_buffers_type{ bvdb.first_binding, std::move(buffers),
-		bvdb.offsets });
+		std::move(offsets) });
 }
 
 void cmd(cmd_args &args, const draw_indirect_data_type&did) {
@@ -30,5 +30,12 @@ command_pool_type create(const type::supplier<device::device_type> &device,
 	return command_pool_type(pool, device);
 }
 
+void reset(command_pool_type &command_pool, VkCommandPoolResetFlags flags) {
+	std::lock_guard<std::mutex> lock(internal::get_mutex(command_pool));
+	VKCHECK(vkResetCommandPool(
+		internal::get_instance(*internal::get_parent(command_pool)),
+		internal::get_instance(command_pool), flags));
+}
+
 }  // namespace command_pool
 }  // namespace vcc
@@ -69,6 +69,12 @@ void add(update_storage &storage, const copy &c) {
 	storage.copy_sets.push_back(set);
 	for (uint32_t i = 0; i < c.descriptor_count; ++i) {
 		c.dst_set.references.clone(std::pair<uint32_t, uint32_t>{ c.dst_binding, uint32_t(c.dst_array_element + i) }, c.src_set.references);
+		const auto buffer_write(c.src_set.buffer_writes.find(
+			std::make_pair(c.src_binding, uint32_t(c.src_array_element + i))));
+		if (buffer_write != c.src_set.buffer_writes.end()) {
+			c.dst_set.buffer_writes[std::make_pair(c.dst_binding,
+				uint32_t(c.dst_array_element + i))] = buffer_write->second;
+		}
 	}
 }
 
@@ -115,9 +121,13 @@ void add(update_storage &storage, const write_buffer_type &write) {
 	storage.buffer_infos.push_back(std::move(buffer_infos));
 	storage.write_sets.push_back(set);
 	for (uint32_t i = 0; i < write.buffers.size(); ++i) {
-		write.dst_set.references.put(
-			std::make_pair(write.dst_binding, uint32_t(write.dst_array_element + i)),
-			write.buffers[i].buffer);
+		const std::pair<uint32_t, uint32_t> key(write.dst_binding,
+			uint32_t(write.dst_array_element + i));
+		write.dst_set.references.put(key, write.buffers[i].buffer);
+		write.dst_set.buffer_writes[key] =
+			descriptor_set_type::buffer_write_type{ write.descriptor_type,
+				write.buffers[i].buffer, storage.buffer_infos.back()[i].buffer,
+				write.buffers[i].offset, write.buffers[i].range };
 	}
 }
 
@@ -128,11 +138,13 @@ void add(update_storage &storage, const write_buffer_data_type &wbdt) {
 		const buffer_info_data_type &buffer(wbdt.buffers[i]);
 		buffer_infos.push_back(buffer_info_type{
 			std::ref(input_buffer::internal::get_buffer(*buffer.buffer)),
-			buffer.offset, buffer.range });
+			buffer.offset + input_buffer::frame_offset(*buffer.buffer, buffer.frame),
+			buffer.range });
 		const type::supplier<input_buffer::input_buffer_type> &buf(buffer.buffer);
+		const uint32_t frame(buffer.frame);
 		wbdt.dst_set.pre_execute_callbacks.put(
 			std::make_pair(wbdt.dst_binding, uint32_t(wbdt.dst_array_element + i)),
-			[buf](queue::queue_type &queue) {input_buffer::flush(queue, *buf); });
+			[buf, frame](queue::queue_type &queue) {input_buffer::flush(queue, *buf, frame); });
 	}
 	add(storage, write_buffer_type{ wbdt.dst_set, wbdt.dst_binding,
 		wbdt.dst_array_element, wbdt.descriptor_type,
@@ -190,15 +202,53 @@ void update_storage::reserve() {
 
 }  // namespace internal
 
+bool refresh(device::device_type &device, descriptor_set_type &set) {
+	std::lock_guard<std::mutex> lock(vcc::internal::get_mutex(set));
+	std::vector<VkWriteDescriptorSet> write_sets;
+	std::vector<VkDescriptorBufferInfo> buffer_infos;
+	buffer_infos.reserve(set.buffer_writes.size());
+	for (auto &buffer_write : set.buffer_writes) {
+		descriptor_set_type::buffer_write_type &write(buffer_write.second);
+		const VkBuffer instance(vcc::internal::get_instance(*write.buffer));
+		if (instance == write.instance) {
+			continue;
+		}
+		write.instance = instance;
+		buffer_infos.push_back(VkDescriptorBufferInfo{ instance, write.offset,
+			write.range });
+		VkWriteDescriptorSet write_set = {
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, NULL };
+		write_set.dstSet = vcc::internal::get_instance(set);
+		write_set.dstBinding = buffer_write.first.first;
+		write_set.dstArrayElement = buffer_write.first.second;
+		write_set.descriptorCount = 1;
+		write_set.descriptorType = write.descriptor_type;
+		write_set.pBufferInfo = &buffer_infos.back();
+		write_sets.push_back(write_set);
+	}
+	if (write_sets.empty()) {
+		return false;
+	}
+	VKTRACE(vkUpdateDescriptorSets(vcc::internal::get_instance(device),
+		(uint32_t)write_sets.size(), write_sets.data(), 0, NULL));
+	return true;
+}
+
 buffer_info_data_type buffer_info(
 	const type::supplier<input_buffer::input_buffer_type> &buffer, VkDeviceSize offset,
-	VkDeviceSize range) {
-	return buffer_info_data_type{ buffer, offset, range };
+	VkDeviceSize range, uint32_t frame) {
+	return buffer_info_data_type{ buffer, offset, range, frame };
 }
 
 buffer_info_data_type buffer_info(const type::supplier<input_buffer::input_buffer_type> &buffer) {
+	return buffer_info(buffer, 0);
+}
+
+buffer_info_data_type buffer_info(
+	const type::supplier<input_buffer::input_buffer_type> &buffer,
+	uint32_t frame) {
 	const std::size_t size(type::size(input_buffer::internal::get_serialize(*buffer)));
-	return buffer_info_data_type{ buffer, 0, size };
+	return buffer_info_data_type{ buffer, 0, size, frame };
 }
 
 }  // namespace descriptor_set
@@ -50,7 +50,19 @@ device_type create(VkPhysicalDevice physical_device, const std::vector<queue_cre
 	create_info.pEnabledFeatures = &features;
 	VkDevice device;
 	VKCHECK(vkCreateDevice(physical_device, &create_info, NULL, &device));
-	return device_type(device, physical_device);
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+	std::vector<uint64_t> heap_sizes(memory_properties.memoryHeapCount);
+	for (uint32_t i = 0; i < memory_properties.memoryHeapCount; ++i) {
+		heap_sizes[i] = memory_properties.memoryHeaps[i].size;
+	}
+	std::vector<uint32_t> type_heaps(memory_properties.memoryTypeCount);
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i) {
+		type_heaps[i] = memory_properties.memoryTypes[i].heapIndex;
+	}
+	return device_type(device, physical_device,
+		std::make_shared<internal::memory_statistics_type>(heap_sizes,
+			type_heaps), features);
 }
 
 void wait_idle(const device_type &device) {
@@ -0,0 +1,94 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <algorithm>
+#include <vcc/draw_batch.h>
+#include <vcc/memory.h>
+#include <vcc/physical_device.h>
+
+namespace vcc {
+namespace draw_batch {
+
+namespace internal {
+
+void begin(command::internal::cmd_args &args, draw_batch_type &batch,
+		uint32_t frame) {
+	if (args.batcher.batching()) {
+		throw vcc_exception("draw_batch::batch can not be nested");
+	}
+	const bool indirect(!batch.frames.empty());
+	if (indirect && frame >= batch.frames.size()) {
+		throw vcc_exception("frame is out of range of the draw batch");
+	}
+	const void *target(nullptr);
+	if (indirect) {
+		args.batch_buffer = batch.frames[frame].buffer;
+		target = batch.frames[frame].buffer.get();
+	}
+	args.batcher.begin(target, batch.max_draws, indirect,
+		batch.max_draw_indirect_count, batch.first_instance);
+}
+
+void end(command::internal::cmd_args &args, draw_batch_type &batch,
+		uint32_t frame) {
+	// Records the draws still pending.
+	command::internal::get_command_buffer(args);
+	const std::vector<VkDrawIndexedIndirectCommand> &written(
+		args.batcher.written());
+	if (!written.empty()) {
+		auto commands(type::write(*batch.frames[frame].commands));
+		std::copy(written.begin(), written.end(),
+			commands.begin() + args.batcher.base());
+	}
+	args.batcher.end();
+	args.batch_buffer = type::supplier<input_buffer::input_buffer_type>();
+}
+
+}  // namespace internal
+
+draw_batch_type create(const type::supplier<device::device_type> &device,
+		uint32_t max_draws, uint32_t frames) {
+	if (!max_draws || !frames) {
+		throw vcc_exception("A draw batch needs at least one draw and frame");
+	}
+	const VkPhysicalDevice physical_device(
+		device::get_physical_device(*device));
+	const uint32_t max_draw_indirect_count(physical_device::properties(
+		physical_device).limits.maxDrawIndirectCount);
+	const VkPhysicalDeviceFeatures &features(
+		device::get_enabled_features(*device));
+	std::vector<draw_batch_type::frame_type> batch_frames;
+	if (features.multiDrawIndirect) {
+		batch_frames.reserve(frames);
+		for (uint32_t i = 0; i < frames; ++i) {
+			draw_batch_type::frame_type frame;
+			frame.commands = std::make_shared<draw_batch_type::commands_type>(
+				max_draws);
+			frame.buffer = std::make_shared<input_buffer::input_buffer_type>(
+				input_buffer::create(type::linear, device, 0,
+					VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+					VK_SHARING_MODE_EXCLUSIVE, {}, frame.commands));
+			memory::bind(device, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+				*frame.buffer);
+			batch_frames.push_back(std::move(frame));
+		}
+	}
+	return draw_batch_type(max_draws, max_draw_indirect_count,
+		features.drawIndirectFirstInstance == VK_TRUE,
+		std::move(batch_frames));
+}
+
+}  // namespace draw_batch
+}  // namespace vcc
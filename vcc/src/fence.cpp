@@ -62,5 +62,41 @@ void reset(device::device_type &device,
 		converted_fences.data()));
 }
 
+pool_type create_pool(const type::supplier<device::device_type> &device) {
+	pool_type pool;
+	pool.data.reset(new pool_type::data_type);
+	pool.data->device = device;
+	pool.data->created = 0;
+	return pool;
+}
+
+fence_type acquire(pool_type &pool) {
+	std::lock_guard<std::mutex> lock(pool.data->mutex);
+	fence_type fence;
+	if (!pool.data->fences.acquire(0, fence,
+			[&pool](std::vector<fence_type> &fences) {
+		std::vector<type::supplier<fence_type>> references;
+		references.reserve(fences.size());
+		for (fence_type &fence : fences) {
+			references.push_back(std::ref(fence));
+		}
+		reset(*pool.data->device, references);
+	})) {
+		fence = create(pool.data->device);
+		++pool.data->created;
+	}
+	return fence;
+}
+
+void release(pool_type &pool, fence_type &&fence) {
+	std::lock_guard<std::mutex> lock(pool.data->mutex);
+	pool.data->fences.release(std::forward<fence_type>(fence));
+}
+
+uint64_t get_created_count(const pool_type &pool) {
+	std::lock_guard<std::mutex> lock(pool.data->mutex);
+	return pool.data->created;
+}
+
 }  // namespace fence
 }  // namespace vcc
@@ -0,0 +1,243 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <vcc/internal/flush_batch.h>
+#include <vcc/queue.h>
+
+namespace vcc {
+namespace internal {
+
+namespace {
+
+// True if the submit thread failed to submit the flush. Waits for the
+// submit to be attempted if wait is set, otherwise a pending submit has not
+// failed yet.
+bool failed(const flush_batch_type::submission_type &submission,
+		bool wait) {
+	if (!submission.submitted.valid() || (!wait
+			&& submission.submitted.wait_for(std::chrono::seconds(0))
+				!= std::future_status::ready)) {
+		return false;
+	}
+	try {
+		return submission.submitted.get() != VK_SUCCESS;
+	} catch (...) {
+		// The submit task threw, or was dropped with the submit thread.
+		return true;
+	}
+}
+
+void retire_front(flush_batch_type &batch) {
+	batch.completed = batch.submissions.front().tag;
+	batch.submissions.front().references = reference_container_type();
+	batch.submissions.front().submitted = std::shared_future<VkResult>();
+	fence::release(batch.fences,
+		std::move(batch.submissions.front().fence));
+	batch.recycled.push_back(std::move(batch.submissions.front()));
+	batch.submissions.pop_front();
+}
+
+}  // anonymous namespace
+
+flush_batch_type::~flush_batch_type() {
+	// Command buffers and referenced resources must outlive their execution.
+	recording.reset();
+	for (submission_type &submission : submissions) {
+		if (failed(submission, true)) {
+			continue;
+		}
+		fence::wait(*get_parent(submission.fence),
+			{ std::ref(submission.fence) }, true,
+			std::chrono::nanoseconds::max());
+	}
+}
+
+std::unique_lock<std::recursive_mutex> lock_flush(queue::queue_type &queue) {
+	return std::unique_lock<std::recursive_mutex>(
+		queue::get_flush_batch(queue).mutex);
+}
+
+command::internal::cmd_args &flush_commands(queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	if (!batch.recording) {
+		if (!batch.command_pool) {
+			batch.command_pool = command_pool::create(get_parent(queue),
+				VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+					| VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+				queue::get_family_index(queue));
+		}
+		if (!batch.fences) {
+			batch.fences = fence::create_pool(get_parent(queue));
+		}
+		if (batch.recycled.empty()) {
+			batch.current.command_buffer = std::move(command_buffer::allocate(
+				get_parent(queue), std::ref(batch.command_pool),
+				VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1).front());
+		} else {
+			batch.current = std::move(batch.recycled.back());
+			batch.recycled.pop_back();
+		}
+		batch.current.fence = fence::acquire(batch.fences);
+		batch.current.tag = batch.tag;
+		batch.recording.reset(new command_buffer::begin_type(
+			command_buffer::begin(std::ref(batch.current.command_buffer),
+				VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, VK_FALSE, 0, 0)));
+		batch.args.reset(new command::internal::cmd_args{
+			batch.current.command_buffer });
+		batch.args->usage = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	}
+	return *batch.args;
+}
+
+void flush_barrier(queue::queue_type &queue,
+		VkPipelineStageFlags src_stage_mask,
+		const command::buffer_memory_barrier_type &barrier) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	batch.barrier_src_stage_mask |= src_stage_mask;
+	batch.barriers.push_back(barrier);
+}
+
+flush_batch_type::tag_type flush_track(queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	// An empty flush command buffer is enough to get a fence.
+	flush_commands(queue);
+	return batch.tag;
+}
+
+flush_batch_type::tag_type flush_tag(queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	return batch.tag;
+}
+
+flush_batch_type::tag_type completed_flush_tag(queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	return batch.completed;
+}
+
+bool wait_flush(queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	if (batch.submissions.empty()) {
+		return false;
+	}
+	if (!failed(batch.submissions.front(), true)) {
+		fence::wait(*get_parent(queue),
+			{ std::ref(batch.submissions.front().fence) }, true,
+			std::chrono::nanoseconds::max());
+	}
+	++batch.waits;
+	retire_front(batch);
+	return true;
+}
+
+void retire_flush(queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	while (!batch.submissions.empty()
+			&& (failed(batch.submissions.front(), false)
+				|| fence::wait(*get_parent(queue),
+					{ std::ref(batch.submissions.front().fence) }, true,
+					std::chrono::nanoseconds(0)) == VK_SUCCESS)) {
+		retire_front(batch);
+	}
+}
+
+VkCommandBuffer end_flush(queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	if (!batch.recording) {
+		return VK_NULL_HANDLE;
+	}
+	if (!batch.barriers.empty()) {
+		command::internal::cmd(*batch.args, command::pipeline_barrier(
+			batch.barrier_src_stage_mask, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, {}, batch.barriers, {}));
+		batch.barriers.clear();
+		batch.barrier_src_stage_mask = 0;
+	}
+	// Records the barrier still pending in the coalescer, as compile does.
+	command::internal::get_command_buffer(*batch.args);
+	batch.recording.reset();
+	batch.current.references = std::move(batch.args->references);
+	batch.args.reset();
+	return get_instance(batch.current.command_buffer);
+}
+
+const fence::fence_type &get_flush_fence(queue::queue_type &queue) {
+	return queue::get_flush_batch(queue).current.fence;
+}
+
+command_buffer::command_buffer_type &acquire_transient(
+		queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	// The fence of the flush tells when the pool can be reset.
+	const flush_batch_type::tag_type tag(flush_track(queue));
+	retire_flush(queue);
+	recycler_type<flush_batch_type::transient_pool_type> &pools(
+		batch.transient_pools[std::this_thread::get_id()]);
+	bool recycled;
+	flush_batch_type::transient_pool_type *pool(
+		pools.get(tag, batch.completed, recycled));
+	if (!pool) {
+		pool = &pools.add(flush_batch_type::transient_pool_type{
+			std::make_shared<command_pool::command_pool_type>(
+				command_pool::create(get_parent(queue),
+					VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+					queue::get_family_index(queue))), {}, 0 }, tag);
+		++batch.transient_pools_created;
+	} else if (recycled) {
+		command_pool::reset(*pool->command_pool, 0);
+		pool->used = 0;
+	}
+	if (pool->used == pool->command_buffers.size()) {
+		pool->command_buffers.push_back(std::move(command_buffer::allocate(
+			get_parent(queue), pool->command_pool,
+			VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1).front()));
+	}
+	return pool->command_buffers[pool->used++];
+}
+
+void commit_flush(queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	batch.submissions.push_back(std::move(batch.current));
+	++batch.tag;
+}
+
+void commit_flush(queue::queue_type &queue,
+		const std::shared_future<VkResult> &submitted) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	batch.current.submitted = submitted;
+	commit_flush(queue);
+}
+
+void abandon_flush(queue::queue_type &queue) {
+	flush_batch_type &batch(queue::get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	// The tag is kept, the next flush takes over what was tracked with it.
+	batch.current.references = reference_container_type();
+	fence::release(batch.fences, std::move(batch.current.fence));
+	batch.recycled.push_back(std::move(batch.current));
+}
+
+}  // namespace internal
+}  // namespace vcc
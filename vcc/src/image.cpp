@@ -14,7 +14,9 @@
 * limitations under the License.
 */
 #include <vcc/image.h>
+#include <vcc/internal/memory_type.h>
 #include <vcc/memory.h>
+#include <vcc/physical_device.h>
 
 namespace vcc {
 namespace image {
@@ -50,7 +52,73 @@ image_type create(const type::supplier<device::device_type> &device,
 	VKCHECK(vkCreateImage(internal::get_instance(*device), &create, NULL, &image));
 	const VkDevice device_instance(internal::get_instance(*device));
 	return image_type(image, device, true, imageType, format, mipLevels,
-		arrayLayers);
+		arrayLayers, initialLayout);
+}
+
+image_type create_transient_attachment(
+		const type::supplier<device::device_type> &device, VkFormat format,
+		const VkExtent2D &extent, VkSampleCountFlagBits samples,
+		VkImageUsageFlags usage) {
+	image_type image(create(device, 0, VK_IMAGE_TYPE_2D, format,
+		{ extent.width, extent.height, 1 }, 1, 1, samples,
+		VK_IMAGE_TILING_OPTIMAL, usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+		VK_SHARING_MODE_EXCLUSIVE, {}, VK_IMAGE_LAYOUT_UNDEFINED));
+	const VkMemoryRequirements requirements(
+		memory::internal::get_memory_requirements(image));
+	uint32_t memory_type_index;
+	if (!internal::find_memory_type(physical_device::memory_properties(
+			device::get_physical_device(*device)),
+			requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+				| VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+			memory_type_index)) {
+		throw vcc_exception("Failed to find a device local memory type for the attachment");
+	}
+	memory::internal::bind(std::make_shared<memory::memory_type>(
+		memory::allocate(device, requirements.size, memory_type_index)), 0,
+		image);
+	return image;
+}
+
+void set_layout(image_type &image, const VkImageSubresourceRange &range,
+		VkImageLayout layout, VkPipelineStageFlags stages,
+		VkAccessFlags access) {
+	if (!image.layouts) {
+		throw vcc_exception("image has no layouts");
+	}
+	std::lock_guard<std::mutex> lock(image.layouts->mutex);
+	image.layouts->tracker.set(range.baseMipLevel, range.levelCount,
+		range.baseArrayLayer, range.layerCount,
+		vcc::internal::subresource_state_type{ layout, stages, access });
+}
+
+VkImageLayout get_layout(const image_type &image, uint32_t level,
+		uint32_t layer) {
+	if (!image.layouts || level >= image.mipLevels
+			|| layer >= image.arrayLayers) {
+		throw vcc_exception("no such subresource");
+	}
+	std::lock_guard<std::mutex> lock(image.layouts->mutex);
+	return image.layouts->tracker.get(level, layer).layout;
+}
+
+std::vector<vcc::internal::layout_transition_type> transition_layout(
+		image_type &image, const VkImageSubresourceRange &range,
+		VkImageLayout layout, VkPipelineStageFlags stages,
+		VkAccessFlags access) {
+	if (!image.layouts) {
+		throw vcc_exception("image has no layouts");
+	}
+	std::vector<vcc::internal::layout_transition_type> transitions;
+	std::lock_guard<std::mutex> lock(image.layouts->mutex);
+	image.layouts->tracker.transition(range.baseMipLevel, range.levelCount,
+		range.baseArrayLayer, range.layerCount,
+		vcc::internal::subresource_state_type{ layout, stages, access },
+		[&transitions](const vcc::internal::layout_transition_type
+				&transition) {
+			transitions.push_back(transition);
+		});
+	return transitions;
 }
 
 VkSubresourceLayout get_subresource_layout(image_type &image,
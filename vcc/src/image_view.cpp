@@ -32,7 +32,8 @@ image_view_type create(const type::supplier<image::image_type> &image,
 	VkImageView image_view;
 	VKCHECK(vkCreateImageView(internal::get_instance(*internal::get_parent(*image)), &create, NULL,
 		&image_view));
-	return image_view_type(image_view, internal::get_parent(*image), image);
+	return image_view_type(image_view, internal::get_parent(*image), image,
+		subresourceRange);
 }
 
 VkImageViewType view_type_from_image_type(VkImageType image_type) {
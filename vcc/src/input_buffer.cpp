@@ -14,16 +14,83 @@
 * limitations under the License.
 */
 #define NOMINMAX
+#include <algorithm>
+#include <cstring>
 #include <vcc/command.h>
-#include <vcc/command_buffer.h>
 #include <vcc/input_buffer.h>
+#include <vcc/internal/flush_batch.h>
+#include <vcc/internal/update_plan.h>
 #include <vcc/memory.h>
+#include <vcc/physical_device.h>
 #include <vcc/queue.h>
+#include <vcc/staging_buffer.h>
 
 namespace vcc {
 namespace input_buffer {
+namespace internal {
+
+VkDeviceSize frame_stride(const type::supplier<device::device_type> &device,
+		VkBufferUsageFlags usage, VkDeviceSize size) {
+	const VkPhysicalDeviceLimits limits(physical_device::properties(
+		device::get_physical_device(*device)).limits);
+	// Versions are mapped separately, keep them apart by a non-coherent atom.
+	VkDeviceSize alignment(std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 4));
+	if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+		alignment = std::max(alignment, limits.minUniformBufferOffsetAlignment);
+	}
+	if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+		alignment = std::max(alignment, limits.minStorageBufferOffsetAlignment);
+	}
+	if (usage & (VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT
+			| VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT)) {
+		alignment = std::max(alignment, limits.minTexelBufferOffsetAlignment);
+	}
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace internal
+
+namespace {
+
+// Records the commands of internal::record_update for buffer into the
+// flush command buffer of queue.
+struct update_recorder_type {
+	void barrier(VkPipelineStageFlags src_stages,
+			VkPipelineStageFlags dst_stages, VkAccessFlags src_access,
+			VkAccessFlags dst_access, VkDeviceSize offset, VkDeviceSize size) {
+		command::internal::cmd(commands, command::pipeline_barrier(src_stages,
+			dst_stages, 0, {}, { command::buffer_memory_barrier(src_access,
+				dst_access, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+				std::ref(buffer), offset, size) }, {}));
+	}
+
+	void update(VkDeviceSize offset, VkDeviceSize size, const char *data) {
+		command::internal::cmd(commands, command::update_buffer{
+			std::ref(buffer), offset, size, (const uint32_t *) data });
+	}
+
+	void flush_barrier(VkPipelineStageFlags src_stages,
+			VkAccessFlags src_access, VkAccessFlags dst_access) {
+		vcc::internal::flush_barrier(queue, src_stages,
+			command::buffer_memory_barrier(src_access, dst_access,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+				std::ref(buffer)));
+	}
+
+	queue::queue_type &queue;
+	command::internal::cmd_args &commands;
+	buffer::buffer_type &buffer;
+};
+
+}  // anonymous namespace
 
 bool flush(input_buffer_type &buffer) {
+	if (buffer.staged) {
+		throw vcc_exception("Staged input_buffer must be flushed on a queue");
+	}
+	if (buffer.versions.size() > 1) {
+		throw vcc_exception("Buffered input_buffer must be flushed on a queue");
+	}
 	if (type::dirty(buffer.serialize)) {
 		std::unique_lock<std::mutex> lock(buffer.mutex);
 		if (type::dirty(buffer.serialize)) {
@@ -31,8 +98,8 @@ bool flush(input_buffer_type &buffer) {
 				vcc::internal::get_memory(buffer.buffer),
 				vcc::internal::get_offset(buffer.buffer),
 				type::size(buffer.serialize)));
-			type::flush(buffer.serialize,
-				(uint8_t *)map.data + vcc::internal::get_offset(buffer.buffer));
+			// Mapped at the offset of the buffer.
+			type::flush(buffer.serialize, map.data);
 		}
 		return true;
 	} else {
@@ -40,37 +107,93 @@ bool flush(input_buffer_type &buffer) {
 	}
 }
 
-bool flush(queue::queue_type &queue, input_buffer_type &buffer) {
-	if (flush(buffer)) {
-		command_pool::command_pool_type command_pool(command_pool::create(
-			vcc::internal::get_parent(queue), VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, queue::get_family_index(queue)));
-		command_buffer::command_buffer_type cmd(std::move(
-			command_buffer::allocate(vcc::internal::get_parent(queue),
-				std::ref(command_pool), VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1)
-			.front()));
-
-		command_buffer::compile(cmd, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-			VK_FALSE, 0, 0,
-			command::pipeline_barrier{ VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
-				{},
-				{
-					command::buffer_memory_barrier_type{
-						VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT,
-						VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
-						std::ref(buffer.buffer)}
-				},
-				{}
-		});
-		// Must block until our command finish executing.
-		fence::fence_type fence(vcc::fence::create(vcc::internal::get_parent(queue)));
-		queue::submit(queue, {}, { std::move(cmd) }, {}, fence);
-		fence::wait(*vcc::internal::get_parent(queue), { std::ref(fence) }, true,
-			std::chrono::nanoseconds::max());
-		return true;
-	} else {
+bool flush(queue::queue_type &queue, input_buffer_type &buffer,
+		uint32_t frame) {
+	if (buffer.versions.size() > 1) {
+		const std::size_t version(frame % buffer.versions.size());
+		std::unique_lock<std::recursive_mutex> flush_lock(
+			vcc::internal::lock_flush(queue));
+		std::unique_lock<std::mutex> lock(buffer.mutex);
+		if (type::dirty(buffer.serialize)) {
+			type::flush(buffer.serialize, &buffer.shadow[0]);
+			buffer.versions.update();
+		}
+		const bool stale(buffer.versions.stale(version));
+		if (stale) {
+			// Never write a version the GPU may still be reading.
+			while (buffer.versions.busy(version,
+					vcc::internal::completed_flush_tag(queue))
+				&& vcc::internal::wait_flush(queue)) {}
+			const memory::map_type map(memory::map(
+				vcc::internal::get_memory(buffer.buffer),
+				vcc::internal::get_offset(buffer.buffer)
+					+ version * buffer.stride,
+				buffer.shadow.size()));
+			std::memcpy(map.data, buffer.shadow.data(), buffer.shadow.size());
+			buffer.versions.write(version);
+		}
+		buffer.versions.use(version, vcc::internal::flush_track(queue));
+		return stale;
+	}
+	if (!type::dirty(buffer.serialize)) {
+		return false;
+	}
+	if (!buffer.staged && !buffer.update_threshold) {
+		// Host writes are made visible to the device by vkQueueSubmit,
+		// no barrier or wait is needed before the submit that follows.
+		return flush(buffer);
+	}
+	// The flush batch is always locked before the input_buffer.
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(queue));
+	std::unique_lock<std::mutex> lock(buffer.mutex);
+	const std::pair<std::size_t, std::size_t> range(
+		type::dirty_range(buffer.serialize));
+	if (range.first == range.second) {
 		return false;
 	}
+	// The dirty range may span content that is not dirty, keep a copy of
+	// all of it.
+	if (buffer.shadow.size() != type::size(buffer.serialize)) {
+		buffer.shadow.resize(type::size(buffer.serialize), '\0');
+	}
+	type::flush(buffer.serialize, &buffer.shadow[0]);
+	const vcc::internal::update_plan_type plan(vcc::internal::plan_update(
+		range.first, range.second, buffer.shadow.size(),
+		buffer.update_threshold));
+	if (plan.inline_update) {
+		update_recorder_type recorder{ queue,
+			vcc::internal::flush_commands(queue), buffer.buffer };
+		vcc::internal::record_update(recorder, plan, buffer.shadow.data());
+	} else if (buffer.staged) {
+		const type::supplier<staging_buffer::staging_buffer_type> &staging_buffer(
+			queue::get_staging_buffer(queue));
+		if (!staging_buffer) {
+			throw vcc_exception("Queue has no staging buffer for staged input_buffer");
+		}
+		staging_buffer::upload(queue, *staging_buffer,
+			&buffer.shadow[range.first], range.second - range.first,
+			buffer.buffer, range.first);
+	} else {
+		const memory::map_type map(memory::map(
+			vcc::internal::get_memory(buffer.buffer),
+			vcc::internal::get_offset(buffer.buffer) + range.first,
+			range.second - range.first));
+		std::memcpy(map.data, &buffer.shadow[range.first],
+			range.second - range.first);
+	}
+	return true;
+}
+
+void set_update_threshold(input_buffer_type &buffer, VkDeviceSize threshold) {
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.update_threshold = std::min<VkDeviceSize>(threshold,
+		vcc::internal::max_update_size);
+}
+
+VkDeviceSize frame_offset(const input_buffer_type &buffer, uint32_t frame) {
+	return buffer.versions.size() > 1
+		? (frame % buffer.versions.size()) * buffer.stride : 0;
 }
 
 }  // namespace input_buffer
@@ -27,7 +27,16 @@ memory_type allocate(const type::supplier<device::device_type> &device,
 	VkDeviceMemory memory;
 	VKCHECK(vkAllocateMemory(vcc::internal::get_instance(*device), &allocate, NULL,
 		&memory));
-	return memory_type(memory, device, allocationSize);
+	return memory_type(memory, device, allocationSize, memoryTypeIndex);
+}
+
+statistics_type get_statistics(const device::device_type &device) {
+	return device::get_memory_statistics(device)->get();
+}
+
+void set_budget_callback(const device::device_type &device, double fraction,
+		const budget_callback_type &callback) {
+	device::get_memory_statistics(device)->set_budget(fraction, callback);
 }
 
 namespace internal {
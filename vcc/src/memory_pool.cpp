@@ -0,0 +1,194 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <vcc/command.h>
+#include <vcc/internal/flush_batch.h>
+#include <vcc/internal/memory_type.h>
+#include <vcc/memory_pool.h>
+#include <vcc/physical_device.h>
+#include <vcc/queue.h>
+
+namespace vcc {
+namespace memory_pool {
+
+namespace {
+
+typedef vcc::internal::pool_allocator_type::id_type id_type;
+
+// Blocks left without allocations are freed. Buffers moved out of them keep
+// the memory alive until their copies have executed.
+template<typename StateT>
+void remove_empty_blocks(StateT &state) {
+	for (std::size_t i = 0; i < state.blocks.size(); ++i) {
+		if (state.blocks[i] && state.allocator.empty(i)) {
+			state.allocator.remove_block(i);
+			state.blocks[i].reset();
+		}
+	}
+}
+
+}  // anonymous namespace
+
+memory_pool_type create(const type::supplier<device::device_type> &device,
+		VkMemoryPropertyFlags property_flags, VkDeviceSize block_size) {
+	// Buffers share the VkDeviceMemory of a block, mapping them one by one
+	// would map it several times.
+	if (property_flags & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			| VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+			| VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) {
+		throw vcc_exception("Memory pools do not support host visible memory");
+	}
+	uint32_t memory_type_index;
+	if (!vcc::internal::find_memory_type(physical_device::memory_properties(
+			device::get_physical_device(*device)), ~0u, property_flags,
+			property_flags, memory_type_index)) {
+		throw vcc_exception("Failed to find a memory type that fits the propertyFlags");
+	}
+	return memory_pool_type(std::make_shared<memory_pool_type::state_type>(
+		device, property_flags, block_size));
+}
+
+type::supplier<buffer::buffer_type> create_buffer(memory_pool_type &pool,
+		VkBufferCreateFlags flags, VkDeviceSize size, VkBufferUsageFlags usage,
+		VkSharingMode sharingMode,
+		const std::vector<uint32_t> &queueFamilyIndices) {
+	memory_pool_type::state_type &state(*pool.state);
+	buffer::buffer_type buffer(buffer::create(state.device, flags, size, usage,
+		sharingMode, queueFamilyIndices));
+	const VkMemoryRequirements requirements(
+		memory::internal::get_memory_requirements(buffer));
+	if (requirements.size > state.block_size) {
+		throw vcc_exception("Buffer is larger than the blocks of the pool");
+	}
+
+	std::lock_guard<std::mutex> lock(state.mutex);
+	// All blocks are of the memory type chosen for the first buffer.
+	if (!state.memory_type_chosen) {
+		if (!vcc::internal::find_memory_type(
+				physical_device::memory_properties(
+					device::get_physical_device(*state.device)),
+				requirements.memoryTypeBits, state.property_flags,
+				state.property_flags, state.memory_type_index)) {
+			throw vcc_exception("Failed to find valid memoryTypeBits that fits the propertyFlags");
+		}
+		state.memory_type_chosen = true;
+	} else if (!(requirements.memoryTypeBits
+			& (1u << state.memory_type_index))) {
+		throw vcc_exception("The memory type of the pool does not fit the buffer");
+	}
+	id_type id;
+	if (!state.allocator.allocate(requirements.size, requirements.alignment,
+			id)) {
+		const std::size_t block(state.allocator.add_block());
+		if (state.blocks.size() <= block) {
+			state.blocks.resize(block + 1);
+		}
+		state.blocks[block] = std::make_shared<memory::memory_type>(
+			memory::allocate(state.device, state.block_size,
+				state.memory_type_index));
+		state.allocator.allocate(requirements.size, requirements.alignment, id);
+	}
+	const vcc::internal::pool_allocator_type::allocation_type &allocation(
+		state.allocator.get(id));
+	memory::internal::bind(state.blocks[allocation.block], allocation.offset,
+		buffer);
+
+	const std::weak_ptr<memory_pool_type::state_type> weak_state(pool.state);
+	const std::shared_ptr<buffer::buffer_type> shared(
+		new buffer::buffer_type(std::move(buffer)),
+		[weak_state, id](buffer::buffer_type *buffer) {
+		delete buffer;
+		const std::shared_ptr<memory_pool_type::state_type> state(
+			weak_state.lock());
+		if (state) {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->allocator.free(id);
+			state->entries.erase(id);
+			remove_empty_blocks(*state);
+		}
+	});
+	state.entries.emplace(id, memory_pool_type::entry_type{ shared, flags,
+		size, usage, sharingMode, queueFamilyIndices });
+	return shared;
+}
+
+VkDeviceSize defragment(queue::queue_type &queue, memory_pool_type &pool,
+		VkDeviceSize max_bytes) {
+	memory_pool_type::state_type &state(*pool.state);
+	// The flush batch is always locked before the pool. Buffers released
+	// while moving are only destroyed once the pool is unlocked.
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(queue));
+	vcc::internal::retire_flush(queue);
+	std::vector<std::shared_ptr<buffer::buffer_type>> buffers;
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	// Source ranges of earlier passes are free once their copies executed.
+	state.allocator.release(vcc::internal::completed_flush_tag(queue));
+	const std::vector<vcc::internal::pool_allocator_type::move_type> moves(
+		state.allocator.defragment(max_bytes, vcc::internal::flush_tag(queue)));
+	if (moves.empty()) {
+		return 0;
+	}
+
+	command::internal::cmd_args &args(vcc::internal::flush_commands(queue));
+	// Writes of earlier submits must be visible to the copies.
+	command::internal::cmd(args, command::pipeline_barrier(
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		{ command::memory_barrier{ VK_ACCESS_MEMORY_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT } }, {}, {}));
+	VkDeviceSize moved(0);
+	for (const vcc::internal::pool_allocator_type::move_type &move : moves) {
+		const memory_pool_type::entry_type &entry(state.entries.at(move.id));
+		std::shared_ptr<buffer::buffer_type> buffer(entry.buffer.lock());
+		if (!buffer) {
+			// Being released, the deleter returns the new range.
+			continue;
+		}
+		buffers.push_back(buffer);
+		buffer::buffer_type replacement(buffer::create(state.device,
+			entry.flags, entry.size, entry.usage, entry.sharing_mode,
+			entry.queue_family_indices));
+		memory::internal::bind(state.blocks[move.dst.block], move.dst.offset,
+			replacement);
+		// The previous VkBuffer is kept alive by the copy until executed.
+		const std::shared_ptr<buffer::buffer_type> previous(
+			std::make_shared<buffer::buffer_type>(std::move(*buffer)));
+		*buffer = std::move(replacement);
+		command::internal::cmd(args, command::copy_buffer_type{ previous,
+			buffer, { VkBufferCopy{ 0, 0, entry.size } } });
+		vcc::internal::flush_barrier(queue, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			command::buffer_memory_barrier(VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_ACCESS_MEMORY_READ_BIT, VK_QUEUE_FAMILY_IGNORED,
+				VK_QUEUE_FAMILY_IGNORED, buffer));
+		moved += move.src.size;
+	}
+	remove_empty_blocks(state);
+	return moved;
+}
+
+std::size_t block_count(const memory_pool_type &pool) {
+	std::lock_guard<std::mutex> lock(pool.state->mutex);
+	std::size_t count(0);
+	for (const std::shared_ptr<memory::memory_type> &block : pool.state->blocks) {
+		if (block) {
+			++count;
+		}
+	}
+	return count;
+}
+
+}  // namespace memory_pool
+}  // namespace vcc
@@ -0,0 +1,85 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <vcc/parallel_recorder.h>
+
+namespace vcc {
+namespace parallel_recorder {
+
+parallel_recorder_type create(
+		const type::supplier<device::device_type> &device,
+		uint32_t queue_family_index, uint32_t threads, uint32_t frames) {
+	if (!threads || !frames) {
+		throw vcc_exception("A parallel recorder needs at least one thread and frame");
+	}
+	std::vector<parallel_recorder_type::partition_type> partitions(threads);
+	for (parallel_recorder_type::partition_type &partition : partitions) {
+		partition.command_pool = std::make_shared<
+			command_pool::command_pool_type>(command_pool::create(device,
+				VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+				queue_family_index));
+		std::vector<command_buffer::command_buffer_type> command_buffers(
+			command_buffer::allocate(device, partition.command_pool,
+				VK_COMMAND_BUFFER_LEVEL_SECONDARY, frames));
+		partition.command_buffers.reserve(frames);
+		for (command_buffer::command_buffer_type &command_buffer
+				: command_buffers) {
+			partition.command_buffers.push_back(
+				std::make_shared<command_buffer::command_buffer_type>(
+					std::move(command_buffer)));
+		}
+	}
+	return parallel_recorder_type(std::move(partitions),
+		std::unique_ptr<vcc::internal::thread_pool_type>(
+			new vcc::internal::thread_pool_type(threads - 1)));
+}
+
+command::execute_commands record(parallel_recorder_type &recorder,
+		uint32_t frame,
+		const type::supplier<render_pass::render_pass_type> &render_pass,
+		uint32_t subpass,
+		const type::supplier<framebuffer::framebuffer_type> &framebuffer,
+		std::size_t count, const record_function_type &function) {
+	const std::size_t partitions(recorder.partitions.size());
+	if (recorder.partitions.empty()
+			|| frame >= recorder.partitions.front().command_buffers.size()) {
+		throw vcc_exception("frame is out of range of the parallel recorder");
+	}
+	recorder.thread_pool->parallel_for(partitions,
+		[&](std::size_t partition) {
+		const std::pair<std::size_t, std::size_t> range(
+			vcc::internal::partition_range(count, partitions, partition));
+		// The suppliers convert to VkBool32, naming the commands rules out
+		// the overload without a render pass.
+		command_buffer::compile<command::record_type>(
+			*recorder.partitions[partition].command_buffers[frame],
+			VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, render_pass,
+			subpass, framebuffer, VK_FALSE, 0, 0,
+			command::record_type{ [&](command::internal::cmd_args &args) {
+				recording_type recording{ args };
+				function(recording, range.first, range.second);
+			} });
+	});
+	command::execute_commands execute;
+	execute.commandBuffers.reserve(partitions);
+	for (const parallel_recorder_type::partition_type &partition
+			: recorder.partitions) {
+		execute.commandBuffers.push_back(partition.command_buffers[frame]);
+	}
+	return execute;
+}
+
+}  // namespace parallel_recorder
+}  // namespace vcc
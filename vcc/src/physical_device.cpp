@@ -51,5 +51,16 @@ uint32_t get_queue_family_properties_with_flag(const std::vector<VkQueueFamilyPr
 	throw vcc_exception("No queue family found with the given properties.");
 }
 
+internal::queue_families_type get_queue_families(
+		VkPhysicalDevice physical_device) {
+	const internal::queue_families_type families(
+		internal::select_queue_families(
+			queue_famility_properties(physical_device)));
+	if (families.graphics == internal::no_queue_family) {
+		throw vcc_exception("No graphics queue family found.");
+	}
+	return families;
+}
+
 }  // namespace physical_device
 }  // namespace vcc
@@ -15,10 +15,7 @@
 */
 #define NOMINMAX
 #include <algorithm>
-#include <cassert>
 #include <iterator>
-#include <vcc/command_buffer.h>
-#include <vcc/queue.h>
 #include <vcc/pipeline_layout.h>
 
 namespace vcc {
@@ -45,37 +42,12 @@ pipeline_layout_type create(const type::supplier<device::device_type> &device,
 
 namespace internal {
 
-void flush(const type::supplier<type::serialize_type> &constants,
-	VkPipelineLayout pipeline_layout,
-	const std::vector<VkPushConstantRange> &push_constant_ranges,
-	queue::queue_type &queue) {
-	if (type::dirty(*constants)) {
-		const type::supplier<device::device_type> device(
-			vcc::internal::get_parent(queue));
-		std::string buffer(type::size(*constants), '\0');
-		type::flush(*constants, &buffer[0]);
-		command_pool::command_pool_type command_pool(command_pool::create(
-			device, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, queue::get_family_index(queue)));
-		command_buffer::command_buffer_type cmd(std::move(
-			command_buffer::allocate(device, std::ref(command_pool),
-				VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1).front()));
-		{
-			command_buffer::begin_type begin(command_buffer::begin(
-				std::ref(cmd), VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-				VK_FALSE, 0, 0));
-			for (const VkPushConstantRange &range : push_constant_ranges) {
-				assert(range.offset + range.size <= buffer.size());
-				vkCmdPushConstants(vcc::internal::get_instance(cmd), pipeline_layout,
-					range.stageFlags, range.offset, range.size,
-					&buffer[range.offset]);
-			}
-		}
-		// Must block until our command finish executing.
-		fence::fence_type fence(fence::create(device));
-		queue::submit(queue, {}, { std::ref(cmd) }, {}, fence);
-		fence::wait(*device, { std::ref(fence) }, true,
-			std::chrono::nanoseconds::max());
+uint64_t update(push_constants_state_type &state) {
+	if (type::dirty(*state.constants)) {
+		type::flush(*state.constants, &state.content[0]);
+		++state.revision;
 	}
+	return state.revision;
 }
 
 }  // namespace internal
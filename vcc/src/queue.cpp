@@ -14,7 +14,10 @@
 * limitations under the License.
 */
 #define NOMINMAX
+#include <algorithm>
+#include <future>
 #include <limits>
+#include <vcc/internal/flush_batch.h>
 #include <vcc/physical_device.h>
 #include <vcc/queue.h>
 
@@ -26,7 +29,9 @@ queue_type get_device_queue(const type::supplier<device::device_type> &device,
 	VkQueue queue;
 	vkGetDeviceQueue(internal::get_instance(*device), queue_family_index,
 		queue_index, &queue);
-	return queue_type(queue, device, queue_family_index);
+	queue_type instance(queue, device, queue_family_index);
+	instance.flush_batch = std::make_shared<internal::flush_batch_type>();
+	return std::move(instance);
 }
 
 queue_type get_queue(const type::supplier<device::device_type> &device, VkQueueFlags flags) {
@@ -84,57 +89,258 @@ std::pair<queue_type, queue_type> get_graphics_and_present_queues(
 		get_device_queue(device, (uint32_t) present_index, 0));
 }
 
-void submit(queue_type &queue,
+namespace {
+
+// Locks each mutex once, in address order. A semaphore signaled by one
+// submit of a batch may be waited on by the next.
+struct ordered_lock_type {
+	explicit ordered_lock_type(std::vector<std::mutex *> &mutexes)
+			: mutexes(mutexes) {
+		std::sort(mutexes.begin(), mutexes.end());
+		mutexes.erase(std::unique(mutexes.begin(), mutexes.end()),
+			mutexes.end());
+		for (std::mutex *mutex : mutexes) {
+			mutex->lock();
+		}
+	}
+
+	~ordered_lock_type() {
+		for (std::mutex *mutex : mutexes) {
+			mutex->unlock();
+		}
+		mutexes.clear();
+	}
+
+	std::vector<std::mutex *> &mutexes;
+};
+
+}  // anonymous namespace
+
+void add(submit_batch_type &batch,
 		const std::vector<wait_semaphore> &wait_semaphores,
 		const std::vector<type::supplier<command_buffer::command_buffer_type>> &command_buffers,
-		const std::vector<type::supplier<semaphore::semaphore_type>> &signal_semaphores,
-		const fence::fence_type *fence) {
-	std::vector<VkCommandBuffer> converted_command_buffers;
-	converted_command_buffers.reserve(command_buffers.size());
-	for (const type::supplier<command_buffer::command_buffer_type> &command_buffer : command_buffers) {
-		converted_command_buffers.push_back(internal::get_instance(*command_buffer));
+		const std::vector<type::supplier<semaphore::semaphore_type>> &signal_semaphores) {
+	batch.wait_semaphores.insert(batch.wait_semaphores.end(),
+		wait_semaphores.begin(), wait_semaphores.end());
+	batch.command_buffers.insert(batch.command_buffers.end(),
+		command_buffers.begin(), command_buffers.end());
+	batch.signal_semaphores.insert(batch.signal_semaphores.end(),
+		signal_semaphores.begin(), signal_semaphores.end());
+	batch.entries.push_back(submit_batch_type::entry_type{
+		batch.wait_semaphores.size(), batch.command_buffers.size(),
+		batch.signal_semaphores.size() });
+}
+
+bool empty(const submit_batch_type &batch) {
+	return batch.entries.empty();
+}
+
+VkResult submit(queue_type &queue, submit_batch_type &batch,
+		const fence::fence_type *fence, std::future<VkResult> *future) {
+	// Held until vkQueueSubmit returns, or is enqueued on the submit
+	// thread, so the flush recorded by the pre-execute hooks is submitted
+	// together with the command buffers.
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		internal::lock_flush(queue));
+	// Empties the batch when the submit returns or throws, keeping the
+	// capacity of its vectors for the next one.
+	struct batch_clear_type {
+		~batch_clear_type() {
+			batch.packer.clear();
+			batch.mutexes.clear();
+			batch.entries.clear();
+			batch.wait_semaphores.clear();
+			batch.command_buffers.clear();
+			batch.signal_semaphores.clear();
+		}
+
+		submit_batch_type &batch;
+	} const batch_clear{ batch };
+	internal::retire_flush(queue);
+	for (const type::supplier<command_buffer::command_buffer_type> &command_buffer
+			: batch.command_buffers) {
 		command_buffer::internal::get_pre_execute_hook(*command_buffer)(queue);
 	}
-	std::vector<VkSemaphore> converted_wait_semaphores;
-	converted_wait_semaphores.reserve(wait_semaphores.size());
-	std::vector<VkPipelineStageFlags> wait_mask;
-	wait_mask.reserve(wait_semaphores.size());
-	for (const wait_semaphore &semaphore : wait_semaphores) {
-		converted_wait_semaphores.push_back(internal::get_instance(*semaphore.semaphore));
-		wait_mask.push_back(semaphore.wait_dst_stage_mask);
-	}
-	std::vector<VkSemaphore> converted_signal_semaphores;
-	converted_signal_semaphores.reserve(signal_semaphores.size());
-	for (const type::supplier<semaphore::semaphore_type> &semaphore : signal_semaphores) {
-		converted_signal_semaphores.push_back(internal::get_instance(*semaphore));
-	}
-	VkSubmitInfo submit = { VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL };
-	submit.waitSemaphoreCount = (uint32_t)converted_wait_semaphores.size();
-	submit.pWaitSemaphores = converted_wait_semaphores.empty() ? NULL : &converted_wait_semaphores.front();
-	submit.pWaitDstStageMask = wait_mask.empty() ? NULL : wait_mask.data();
-	submit.commandBufferCount = (uint32_t)converted_command_buffers.size();
-	submit.pCommandBuffers = converted_command_buffers.data();
-	submit.signalSemaphoreCount = (uint32_t)converted_signal_semaphores.size();
-	submit.pSignalSemaphores = converted_signal_semaphores.empty() ? NULL : &converted_signal_semaphores.front();
-	std::vector<std::unique_lock<std::mutex>> locks;
-	locks.reserve(wait_semaphores.size() + signal_semaphores.size());
-	for (const wait_semaphore &semaphore : wait_semaphores) {
-		locks.emplace_back(internal::get_mutex(*semaphore.semaphore), std::defer_lock);
-	}
-	for (const type::supplier<semaphore::semaphore_type> &semaphore : signal_semaphores) {
-		locks.emplace_back(internal::get_mutex(*semaphore), std::defer_lock);
-	}
-	util::lock(locks);
-	if (fence) {
-		std::lock(internal::get_mutex(queue), internal::get_mutex(*fence));
-		std::lock_guard<std::mutex> queue_lock(internal::get_mutex(queue), std::adopt_lock);
-		std::lock_guard<std::mutex> fence_lock(internal::get_mutex(*fence), std::adopt_lock);
-		VKCHECK(vkQueueSubmit(internal::get_instance(queue), 1, &submit,
-			internal::get_instance(*fence)));
-	} else {
-		std::lock_guard<std::mutex> queue_lock(internal::get_mutex(queue));
-		VKCHECK(vkQueueSubmit(internal::get_instance(queue), 1, &submit, VK_NULL_HANDLE));
+	internal::submit_packer_type &packer(batch.packer);
+	packer.clear();
+	// The flush is a submit of its own ahead of the batch so it does not
+	// wait on the semaphores of the first submit, its barrier still orders
+	// it before the later submits.
+	const VkCommandBuffer flush_command_buffer(internal::end_flush(queue));
+	if (flush_command_buffer != VK_NULL_HANDLE) {
+		packer.begin();
+		packer.command_buffer(flush_command_buffer);
+	}
+	std::size_t wait(0), command_buffer(0), signal(0);
+	for (const submit_batch_type::entry_type &entry : batch.entries) {
+		packer.begin();
+		for (; wait < entry.wait_semaphores; ++wait) {
+			const wait_semaphore &semaphore(batch.wait_semaphores[wait]);
+			packer.wait(internal::get_instance(*semaphore.semaphore),
+				semaphore.wait_dst_stage_mask);
+			batch.mutexes.push_back(&internal::get_mutex(*semaphore.semaphore));
+		}
+		for (; command_buffer < entry.command_buffers; ++command_buffer) {
+			packer.command_buffer(internal::get_instance(
+				*batch.command_buffers[command_buffer]));
+		}
+		for (; signal < entry.signal_semaphores; ++signal) {
+			const semaphore::semaphore_type &semaphore(
+				*batch.signal_semaphores[signal]);
+			packer.signal(internal::get_instance(semaphore));
+			batch.mutexes.push_back(&internal::get_mutex(semaphore));
+		}
 	}
+	if (flush_command_buffer != VK_NULL_HANDLE && !fence) {
+		// The flush fence tracks the submit itself.
+		fence = &internal::get_flush_fence(queue);
+	}
+	// An empty submit signals its fence once all previously submitted work
+	// has completed.
+	const fence::fence_type *const flush_fence(
+		flush_command_buffer != VK_NULL_HANDLE
+			&& fence != &internal::get_flush_fence(queue)
+		? &internal::get_flush_fence(queue) : nullptr);
+
+	VkResult result(VK_SUCCESS);
+	if (internal::submit_worker_type *const worker = get_submit_worker(queue)) {
+		// Everything the submit refers to moves to the task, the fences
+		// are only known by handle as the flush fence moves on commit.
+		struct task_type {
+			VkQueue queue;
+			VkFence fence, flush_fence;
+			// The queue and fences are externally synchronized, the same
+			// VkQueue may be wrapped by other queue_types.
+			std::mutex *queue_mutex, *fence_mutex, *flush_fence_mutex;
+			internal::submit_packer_type packer;
+			std::vector<std::mutex *> mutexes;
+			std::vector<wait_semaphore> wait_semaphores;
+			std::vector<type::supplier<command_buffer::command_buffer_type>> command_buffers;
+			std::vector<type::supplier<semaphore::semaphore_type>> signal_semaphores;
+			// Tells the flush batch whether the flush fence will be signaled.
+			std::promise<VkResult> flushed;
+		};
+		const std::shared_ptr<task_type> task(std::make_shared<task_type>());
+		task->queue = internal::get_instance(queue);
+		task->fence = fence ? VkFence(internal::get_instance(*fence))
+			: VkFence(VK_NULL_HANDLE);
+		task->flush_fence = flush_fence
+			? VkFence(internal::get_instance(*flush_fence))
+			: VkFence(VK_NULL_HANDLE);
+		task->queue_mutex = &internal::get_mutex(queue);
+		task->fence_mutex = fence ? &internal::get_mutex(*fence) : nullptr;
+		task->flush_fence_mutex = flush_fence
+			? &internal::get_mutex(*flush_fence) : nullptr;
+		std::swap(task->packer, batch.packer);
+		task->mutexes.swap(batch.mutexes);
+		task->wait_semaphores.swap(batch.wait_semaphores);
+		task->command_buffers.swap(batch.command_buffers);
+		task->signal_semaphores.swap(batch.signal_semaphores);
+		const std::shared_future<VkResult> flushed(
+			task->flushed.get_future().share());
+		std::future<VkResult> task_future(worker->enqueue([task]() {
+			const std::vector<VkSubmitInfo> &infos(task->packer.pack());
+			ordered_lock_type semaphore_lock(task->mutexes);
+			// Locked in the order of the direct path below.
+			std::unique_lock<std::mutex> queue_lock(*task->queue_mutex,
+				std::defer_lock);
+			std::unique_lock<std::mutex> fence_lock;
+			if (task->fence_mutex) {
+				fence_lock = std::unique_lock<std::mutex>(*task->fence_mutex,
+					std::defer_lock);
+				std::lock(queue_lock, fence_lock);
+			} else {
+				queue_lock.lock();
+			}
+			VkResult result(vkQueueSubmit(task->queue,
+				(uint32_t) infos.size(), infos.data(), task->fence));
+			if (result == VK_SUCCESS && task->flush_fence != VK_NULL_HANDLE) {
+				std::lock_guard<std::mutex> flush_fence_lock(
+					*task->flush_fence_mutex);
+				result = vkQueueSubmit(task->queue, 0, NULL, task->flush_fence);
+			}
+			task->flushed.set_value(result);
+			return result;
+		}));
+		if (flush_command_buffer != VK_NULL_HANDLE) {
+			// Committed before the result is known so the next flush can be
+			// recorded, a failed submit retires it instead of hanging
+			// wait_flush on its fence.
+			internal::commit_flush(queue, flushed);
+		}
+		flush_lock.unlock();
+		if (future) {
+			*future = std::move(task_future);
+		} else {
+			result = task_future.get();
+		}
+		return result;
+	}
+
+	const std::vector<VkSubmitInfo> &infos(packer.pack());
+	{
+		ordered_lock_type semaphore_lock(batch.mutexes);
+		if (fence) {
+			std::lock(internal::get_mutex(queue), internal::get_mutex(*fence));
+			std::lock_guard<std::mutex> queue_lock(internal::get_mutex(queue), std::adopt_lock);
+			std::lock_guard<std::mutex> fence_lock(internal::get_mutex(*fence), std::adopt_lock);
+			result = vkQueueSubmit(internal::get_instance(queue),
+				(uint32_t) infos.size(), infos.data(),
+				internal::get_instance(*fence));
+			if (result == VK_SUCCESS && flush_fence) {
+				std::lock_guard<std::mutex> flush_fence_lock(
+					internal::get_mutex(*flush_fence));
+				result = vkQueueSubmit(internal::get_instance(queue), 0, NULL,
+					internal::get_instance(*flush_fence));
+			}
+		} else {
+			std::lock_guard<std::mutex> queue_lock(internal::get_mutex(queue));
+			result = vkQueueSubmit(internal::get_instance(queue),
+				(uint32_t) infos.size(), infos.data(), VK_NULL_HANDLE);
+		}
+	}
+	if (flush_command_buffer != VK_NULL_HANDLE) {
+		if (result == VK_SUCCESS) {
+			internal::commit_flush(queue);
+		} else {
+			internal::abandon_flush(queue);
+		}
+	}
+	return result;
+}
+
+namespace {
+
+// A future holding result, for queues without a submit thread.
+std::future<VkResult> ready(VkResult result) {
+	std::promise<VkResult> promise;
+	promise.set_value(result);
+	return promise.get_future();
+}
+
+}  // anonymous namespace
+
+void submit(queue_type &queue, submit_batch_type &batch,
+		const fence::fence_type &fence) {
+	VKCHECK(submit(queue, batch, &fence, nullptr));
+}
+
+void submit(queue_type &queue, submit_batch_type &batch) {
+	VKCHECK(submit(queue, batch, nullptr, nullptr));
+}
+
+std::future<VkResult> submit_async(queue_type &queue,
+		submit_batch_type &batch, const fence::fence_type &fence) {
+	std::future<VkResult> future;
+	const VkResult result(submit(queue, batch, &fence, &future));
+	return future.valid() ? std::move(future) : ready(result);
+}
+
+std::future<VkResult> submit_async(queue_type &queue,
+		submit_batch_type &batch) {
+	std::future<VkResult> future;
+	const VkResult result(submit(queue, batch, nullptr, &future));
+	return future.valid() ? std::move(future) : ready(result);
 }
 
 void submit(queue_type &queue,
@@ -142,48 +348,144 @@ void submit(queue_type &queue,
 		const std::vector<type::supplier<command_buffer::command_buffer_type>> &command_buffers,
 		const std::vector<type::supplier<semaphore::semaphore_type>> &signal_semaphores,
 		const fence::fence_type &fence) {
-	submit(queue, wait_semaphores, command_buffers, signal_semaphores, &fence);
+	submit_batch_type batch;
+	add(batch, wait_semaphores, command_buffers, signal_semaphores);
+	submit(queue, batch, fence);
 }
 
 void submit(queue_type &queue,
 	const std::vector<wait_semaphore> &wait_semaphores,
 	const std::vector<type::supplier<command_buffer::command_buffer_type>> &command_buffers,
 	const std::vector<type::supplier<semaphore::semaphore_type>> &signal_semaphores) {
-	submit(queue, wait_semaphores, command_buffers, signal_semaphores, nullptr);
+	submit_batch_type batch;
+	add(batch, wait_semaphores, command_buffers, signal_semaphores);
+	submit(queue, batch);
+}
+
+void start_submit_thread(queue_type &queue) {
+	if (!queue.submit_worker) {
+		queue.submit_worker = std::make_shared<internal::submit_worker_type>();
+	}
+}
+
+void stop_submit_thread(queue_type &queue) {
+	queue.submit_worker.reset();
+}
+
+internal::submit_worker_type *get_submit_worker(queue_type &queue) {
+	return queue.submit_worker.get();
 }
 
 void wait_idle(queue_type &queue) {
-	VKCHECK(vkQueueWaitIdle(internal::get_instance(queue)));
+	if (internal::submit_worker_type *const worker = get_submit_worker(queue)) {
+		const VkQueue instance(internal::get_instance(queue));
+		std::mutex *const mutex(&internal::get_mutex(queue));
+		VKCHECK(worker->enqueue([instance, mutex]() {
+			std::lock_guard<std::mutex> queue_lock(*mutex);
+			return vkQueueWaitIdle(instance);
+		}).get());
+	} else {
+		std::lock_guard<std::mutex> queue_lock(internal::get_mutex(queue));
+		VKCHECK(vkQueueWaitIdle(internal::get_instance(queue)));
+	}
 }
 
-VkResult present(queue_type &queue,
+internal::flush_batch_type &get_flush_batch(queue_type &queue) {
+	return *queue.flush_batch;
+}
+
+uint64_t get_flush_wait_count(queue_type &queue) {
+	internal::flush_batch_type &batch(get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	return batch.waits;
+}
+
+uint64_t get_transient_pool_count(queue_type &queue) {
+	internal::flush_batch_type &batch(get_flush_batch(queue));
+	std::lock_guard<std::recursive_mutex> lock(batch.mutex);
+	return batch.transient_pools_created;
+}
+
+namespace {
+
+// The arguments of vkQueuePresentKHR, with the objects they belong to.
+struct present_type {
+	std::vector<type::supplier<semaphore::semaphore_type>> semaphores;
+	std::vector<type::supplier<swapchain::swapchain_type>> swapchains;
+	std::vector<VkSemaphore> converted_semaphores;
+	std::vector<VkSwapchainKHR> converted_swapchains;
+	std::vector<uint32_t> image_indices;
+	std::vector<std::mutex *> mutexes;
+};
+
+std::shared_ptr<present_type> prepare_present(
 		const std::vector<type::supplier<semaphore::semaphore_type>> &semaphores,
 		const std::vector<type::supplier<swapchain::swapchain_type>> &swapchains,
 		const std::vector<uint32_t> &image_indices) {
-	VkPresentInfoKHR info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR, NULL};
-	info.waitSemaphoreCount = (uint32_t) semaphores.size();
-	std::vector<std::unique_lock<std::mutex>> locks;
-	locks.reserve(1 + semaphores.size() + swapchains.size());
-	locks.emplace_back(internal::get_mutex(queue), std::defer_lock);
-	std::vector<VkSemaphore> converted_semaphores;
-	converted_semaphores.reserve(semaphores.size());
+	const std::shared_ptr<present_type> present(
+		std::make_shared<present_type>());
+	present->semaphores = semaphores;
+	present->swapchains = swapchains;
+	present->image_indices = image_indices;
+	present->converted_semaphores.reserve(semaphores.size());
+	present->converted_swapchains.reserve(swapchains.size());
+	present->mutexes.reserve(semaphores.size() + swapchains.size());
 	for (const type::supplier<semaphore::semaphore_type> &semaphore : semaphores) {
-		converted_semaphores.push_back(internal::get_instance(*semaphore));
-		locks.emplace_back(internal::get_mutex(*semaphore), std::defer_lock);
+		present->converted_semaphores.push_back(internal::get_instance(*semaphore));
+		present->mutexes.push_back(&internal::get_mutex(*semaphore));
 	}
-	info.pWaitSemaphores = semaphores.empty() ? NULL : &converted_semaphores.front();
-	info.swapchainCount = (uint32_t) swapchains.size();
-	std::vector<VkSwapchainKHR> converted_swapchains;
-	converted_swapchains.reserve(swapchains.size());
 	for (const type::supplier<swapchain::swapchain_type> &swapchain : swapchains) {
-		converted_swapchains.push_back(internal::get_instance(*swapchain));
-		locks.emplace_back(internal::get_mutex(*swapchain), std::defer_lock);
+		present->converted_swapchains.push_back(internal::get_instance(*swapchain));
+		present->mutexes.push_back(&internal::get_mutex(*swapchain));
 	}
-	info.pSwapchains = swapchains.empty() ? NULL : &converted_swapchains.front();
-	info.pImageIndices = image_indices.empty() ? NULL : &image_indices.front();
+	return present;
+}
+
+VkResult run_present(VkQueue queue, present_type &present) {
+	VkPresentInfoKHR info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR, NULL};
+	info.waitSemaphoreCount = (uint32_t) present.converted_semaphores.size();
+	info.pWaitSemaphores = present.converted_semaphores.empty() ? NULL
+		: &present.converted_semaphores.front();
+	info.swapchainCount = (uint32_t) present.converted_swapchains.size();
+	info.pSwapchains = present.converted_swapchains.empty() ? NULL
+		: &present.converted_swapchains.front();
+	info.pImageIndices = present.image_indices.empty() ? NULL
+		: &present.image_indices.front();
 	info.pResults = NULL;
-	util::lock(locks);
-	return vkQueuePresentKHR(internal::get_instance(queue), &info);
+	ordered_lock_type lock(present.mutexes);
+	return vkQueuePresentKHR(queue, &info);
+}
+
+}  // anonymous namespace
+
+VkResult present(queue_type &queue,
+		const std::vector<type::supplier<semaphore::semaphore_type>> &semaphores,
+		const std::vector<type::supplier<swapchain::swapchain_type>> &swapchains,
+		const std::vector<uint32_t> &image_indices) {
+	if (get_submit_worker(queue)) {
+		return present_async(queue, semaphores, swapchains, image_indices).get();
+	}
+	const std::shared_ptr<present_type> prepared(prepare_present(semaphores,
+		swapchains, image_indices));
+	prepared->mutexes.push_back(&internal::get_mutex(queue));
+	return run_present(internal::get_instance(queue), *prepared);
+}
+
+std::future<VkResult> present_async(queue_type &queue,
+		const std::vector<type::supplier<semaphore::semaphore_type>> &semaphores,
+		const std::vector<type::supplier<swapchain::swapchain_type>> &swapchains,
+		const std::vector<uint32_t> &image_indices) {
+	internal::submit_worker_type *const worker(get_submit_worker(queue));
+	if (!worker) {
+		return ready(present(queue, semaphores, swapchains, image_indices));
+	}
+	const std::shared_ptr<present_type> prepared(prepare_present(semaphores,
+		swapchains, image_indices));
+	prepared->mutexes.push_back(&internal::get_mutex(queue));
+	const VkQueue instance(internal::get_instance(queue));
+	return worker->enqueue([instance, prepared]() {
+		return run_present(instance, *prepared);
+	});
 }
 
 }  // namespace queue
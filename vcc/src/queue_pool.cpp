@@ -0,0 +1,51 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <vcc/command.h>
+#include <vcc/physical_device.h>
+#include <vcc/queue_pool.h>
+
+namespace vcc {
+namespace queue_pool {
+
+queue_pool_type create(const type::supplier<device::device_type> &device,
+		uint32_t family_index, uint32_t queue_count) {
+	if (!queue_count) {
+		throw vcc_exception("A queue pool needs at least one queue");
+	}
+	std::vector<queue::queue_type> queues;
+	queues.reserve(queue_count);
+	for (uint32_t i = 0; i < queue_count; ++i) {
+		queues.push_back(queue::get_device_queue(device, family_index, i));
+	}
+	queue_pool_type pool;
+	pool.queues.reset(new internal::queue_pool_type<queue::queue_type>(
+		std::move(queues)));
+	return pool;
+}
+
+queue_pool_type create(const type::supplier<device::device_type> &device,
+		uint32_t family_index) {
+	const std::vector<VkQueueFamilyProperties> properties(
+		physical_device::queue_famility_properties(
+			device::get_physical_device(*device)));
+	if (family_index >= properties.size()) {
+		throw vcc_exception("Invalid queue family index");
+	}
+	return create(device, family_index, properties[family_index].queueCount);
+}
+
+}  // namespace queue_pool
+}  // namespace vcc
@@ -0,0 +1,266 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <vcc/internal/alias_planner.h>
+#include <vcc/render_graph.h>
+
+namespace vcc {
+namespace render_graph {
+
+resource_type import_image(render_graph_type &graph,
+		const type::supplier<image::image_type> &image,
+		const VkImageSubresourceRange &range, VkImageLayout initial_layout,
+		VkImageLayout final_layout) {
+	graph.resources.push_back(vcc::internal::graph_resource_type{
+		true, initial_layout, final_layout, false });
+	graph.bindings.push_back(render_graph_type::binding_type{ image, range,
+		type::supplier<buffer::buffer_type>(),
+		std::shared_ptr<image::image_type>(),
+		std::shared_ptr<buffer::buffer_type>(), false });
+	return graph.resources.size() - 1;
+}
+
+resource_type import_buffer(render_graph_type &graph,
+		const type::supplier<buffer::buffer_type> &buffer) {
+	graph.resources.push_back(vcc::internal::graph_resource_type{
+		false, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, false });
+	graph.bindings.push_back(render_graph_type::binding_type{
+		type::supplier<image::image_type>(), VkImageSubresourceRange(),
+		buffer, std::shared_ptr<image::image_type>(),
+		std::shared_ptr<buffer::buffer_type>(), false });
+	return graph.resources.size() - 1;
+}
+
+resource_type create_image(render_graph_type &graph,
+		const type::supplier<device::device_type> &device,
+		VkImageCreateFlags flags, VkImageType imageType, VkFormat format,
+		const VkExtent3D &extent, uint32_t mipLevels, uint32_t arrayLayers,
+		VkSampleCountFlagBits samples, VkImageUsageFlags usage,
+		VkImageAspectFlags aspect) {
+	const std::shared_ptr<image::image_type> image(
+		std::make_shared<image::image_type>(image::create(device, flags,
+			imageType, format, extent, mipLevels, arrayLayers, samples,
+			VK_IMAGE_TILING_OPTIMAL, usage, VK_SHARING_MODE_EXCLUSIVE, {},
+			VK_IMAGE_LAYOUT_UNDEFINED)));
+	graph.resources.push_back(vcc::internal::graph_resource_type{
+		true, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, false });
+	graph.bindings.push_back(render_graph_type::binding_type{ image,
+		VkImageSubresourceRange{ aspect, 0, mipLevels, 0, arrayLayers },
+		type::supplier<buffer::buffer_type>(), image,
+		std::shared_ptr<buffer::buffer_type>(), false });
+	return graph.resources.size() - 1;
+}
+
+resource_type create_buffer(render_graph_type &graph,
+		const type::supplier<device::device_type> &device, VkDeviceSize size,
+		VkBufferUsageFlags usage) {
+	const std::shared_ptr<buffer::buffer_type> buffer(
+		std::make_shared<buffer::buffer_type>(buffer::create(device, 0, size,
+			usage, VK_SHARING_MODE_EXCLUSIVE, {})));
+	graph.resources.push_back(vcc::internal::graph_resource_type{
+		false, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, false });
+	graph.bindings.push_back(render_graph_type::binding_type{
+		type::supplier<image::image_type>(), VkImageSubresourceRange(),
+		buffer, std::shared_ptr<image::image_type>(), buffer, false });
+	return graph.resources.size() - 1;
+}
+
+void allocate(render_graph_type &graph,
+		const type::supplier<device::device_type> &device) {
+	if (!graph.memories.empty()) {
+		throw vcc_exception("render graph is already allocated");
+	}
+	const vcc::internal::graph_plan_type plan(
+		vcc::internal::plan_graph(graph.resources, graph.passes));
+	const VkPhysicalDevice physical_device(
+		device::get_physical_device(*device));
+	const VkPhysicalDeviceMemoryProperties memory_properties(
+		physical_device::memory_properties(physical_device));
+	// Keeps linear buffers and optimal images out of each other's pages.
+	const VkDeviceSize granularity(physical_device::properties(
+		physical_device).limits.bufferImageGranularity);
+
+	std::vector<std::size_t> transients;
+	std::vector<vcc::internal::alias_request_type> requests;
+	for (std::size_t i = 0; i < graph.bindings.size(); ++i) {
+		const render_graph_type::binding_type &binding(graph.bindings[i]);
+		if (!binding.transient_image && !binding.transient_buffer) {
+			continue;
+		}
+		const VkMemoryRequirements requirements(binding.transient_image
+			? memory::internal::get_memory_requirements(
+				*binding.transient_image)
+			: memory::internal::get_memory_requirements(
+				*binding.transient_buffer));
+		uint32_t memory_type_index;
+		if (!vcc::internal::find_memory_type(memory_properties,
+				requirements.memoryTypeBits,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory_type_index)) {
+			throw vcc_exception("no device local memory type for a transient "
+				"render graph resource");
+		}
+		const vcc::internal::graph_lifetime_type &lifetime(plan.lifetimes[i]);
+		const VkDeviceSize alignment(std::max(requirements.alignment,
+			granularity));
+		transients.push_back(i);
+		requests.push_back(vcc::internal::alias_request_type{
+			(requirements.size + alignment - 1) / alignment * alignment,
+			alignment, memory_type_index, lifetime.used, lifetime.first,
+			lifetime.last });
+	}
+	const vcc::internal::alias_plan_type aliasing(
+		vcc::internal::plan_aliasing(requests));
+
+	std::vector<std::shared_ptr<memory::memory_type>> memories(
+		aliasing.heap_sizes.size());
+	VkDeviceSize transient_memory_size(0);
+	for (uint32_t i = 0; i < aliasing.heap_sizes.size(); ++i) {
+		if (aliasing.heap_sizes[i]) {
+			memories[i] = std::make_shared<memory::memory_type>(
+				memory::allocate(device, aliasing.heap_sizes[i], i));
+			transient_memory_size += aliasing.heap_sizes[i];
+		}
+	}
+	for (std::size_t i = 0; i < transients.size(); ++i) {
+		render_graph_type::binding_type &binding(
+			graph.bindings[transients[i]]);
+		// Unused resources are not part of the heap sizes, they are never
+		// accessed and have no memory.
+		binding.culled = !requests[i].used;
+		if (binding.culled) {
+			continue;
+		}
+		const std::shared_ptr<memory::memory_type> &memory(
+			memories[requests[i].heap]);
+		if (binding.transient_image) {
+			memory::internal::bind(memory, aliasing.offsets[i],
+				*binding.transient_image);
+		} else {
+			memory::internal::bind(memory, aliasing.offsets[i],
+				*binding.transient_buffer);
+		}
+		std::vector<std::size_t> &aliased(
+			graph.resources[transients[i]].aliased);
+		aliased.clear();
+		for (std::size_t index : aliasing.aliased[i]) {
+			aliased.push_back(transients[index]);
+		}
+	}
+	graph.memories = std::move(memories);
+	graph.transient_memory_size = transient_memory_size;
+}
+
+type::supplier<image::image_type> get_image(const render_graph_type &graph,
+		resource_type resource) {
+	if (resource >= graph.bindings.size() || !graph.bindings[resource].image) {
+		throw vcc_exception("render graph resource is not an image");
+	}
+	if (graph.bindings[resource].culled) {
+		throw vcc_exception("render graph resource is only used by culled "
+			"passes");
+	}
+	return graph.bindings[resource].image;
+}
+
+type::supplier<buffer::buffer_type> get_buffer(
+		const render_graph_type &graph, resource_type resource) {
+	if (resource >= graph.bindings.size()
+			|| !graph.bindings[resource].buffer) {
+		throw vcc_exception("render graph resource is not a buffer");
+	}
+	if (graph.bindings[resource].culled) {
+		throw vcc_exception("render graph resource is only used by culled "
+			"passes");
+	}
+	return graph.bindings[resource].buffer;
+}
+
+VkDeviceSize get_transient_memory_size(const render_graph_type &graph) {
+	return graph.transient_memory_size;
+}
+
+void set_output(render_graph_type &graph, resource_type resource) {
+	if (resource >= graph.resources.size()) {
+		throw vcc_exception("unknown render graph resource");
+	}
+	graph.resources[resource].output = true;
+}
+
+void add_pass(render_graph_type &graph, const std::vector<usage_type> &usages,
+		const pass_function_type &function) {
+	graph.passes.push_back(vcc::internal::graph_pass_type{ usages });
+	graph.functions.push_back(function);
+}
+
+void clear(render_graph_type &graph) {
+	graph.resources.clear();
+	graph.bindings.clear();
+	graph.passes.clear();
+	graph.functions.clear();
+	graph.plan = vcc::internal::graph_plan_type();
+	graph.memories.clear();
+	graph.transient_memory_size = 0;
+}
+
+std::size_t culled(const render_graph_type &graph) {
+	return graph.passes.size() - graph.plan.steps.size();
+}
+
+command::record_type record(render_graph_type &graph) {
+	graph.plan = vcc::internal::plan_graph(graph.resources, graph.passes);
+	return command::record_type{
+		[&graph](command::internal::cmd_args &args) {
+			const auto make_barrier([&graph](
+					const vcc::internal::graph_barrier_type &barrier) {
+				std::vector<command::buffer_memory_barrier_type> buffer_barriers;
+				std::vector<command::image_memory_barrier> image_barriers;
+				for (const vcc::internal::graph_memory_barrier_type
+						&memory_barrier : barrier.barriers) {
+					const render_graph_type::binding_type &binding(
+						graph.bindings[memory_barrier.resource]);
+					if (graph.resources[memory_barrier.resource].image) {
+						image_barriers.push_back(command::image_memory_barrier{
+							memory_barrier.src_access, memory_barrier.dst_access,
+							memory_barrier.old_layout, memory_barrier.new_layout,
+							VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+							binding.image, binding.range });
+					} else {
+						buffer_barriers.push_back(command::buffer_memory_barrier(
+							memory_barrier.src_access, memory_barrier.dst_access,
+							VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+							binding.buffer));
+					}
+				}
+				return command::pipeline_barrier(barrier.src_stages,
+					barrier.dst_stages, 0, {}, buffer_barriers, image_barriers);
+			});
+			command::recording_type recording{ args };
+			for (const vcc::internal::graph_step_type &step
+					: graph.plan.steps) {
+				if (!step.barrier.empty()) {
+					command::internal::cmd(args, make_barrier(step.barrier));
+				}
+				graph.functions[step.pass](recording);
+			}
+			if (!graph.plan.final_barrier.empty()) {
+				command::internal::cmd(args,
+					make_barrier(graph.plan.final_barrier));
+			}
+		} };
+}
+
+}  // namespace render_graph
+}  // namespace vcc
@@ -58,7 +58,12 @@ render_pass_type create(const type::supplier<device::device_type> &device,
 	create.pDependencies = subpass_dependency.empty() ? NULL : &subpass_dependency.front();
 	VkRenderPass render_pass;
 	VKCHECK(vkCreateRenderPass(internal::get_instance(*device), &create, NULL, &render_pass));
-	return render_pass_type(render_pass, device);
+	std::vector<VkImageLayout> final_layouts;
+	final_layouts.reserve(attachment_descriptions.size());
+	for (const VkAttachmentDescription &description : attachment_descriptions) {
+		final_layouts.push_back(description.finalLayout);
+	}
+	return render_pass_type(render_pass, device, std::move(final_layouts));
 }
 
 VkExtent2D get_render_area_granularity(const render_pass_type &render_pass) {
@@ -26,5 +26,41 @@ semaphore_type create(const type::supplier<device::device_type> &device) {
 	return semaphore_type(semaphore, device);
 }
 
+pool_type create_pool(const type::supplier<device::device_type> &device) {
+	pool_type pool;
+	pool.data.reset(new pool_type::data_type);
+	pool.data->device = device;
+	pool.data->created = 0;
+	return pool;
+}
+
+semaphore_type acquire(pool_type &pool, pool_type::tag_type completed) {
+	std::lock_guard<std::mutex> lock(pool.data->mutex);
+	semaphore_type semaphore;
+	// A binary semaphore is unsignaled again once its wait completed.
+	if (!pool.data->semaphores.acquire(completed, semaphore,
+			[](std::vector<semaphore_type> &) {})) {
+		semaphore = create(pool.data->device);
+		++pool.data->created;
+	}
+	return semaphore;
+}
+
+void release(pool_type &pool, semaphore_type &&semaphore,
+		pool_type::tag_type tag) {
+	std::lock_guard<std::mutex> lock(pool.data->mutex);
+	pool.data->semaphores.release(std::forward<semaphore_type>(semaphore), tag);
+}
+
+void release(pool_type &pool, semaphore_type &&semaphore) {
+	std::lock_guard<std::mutex> lock(pool.data->mutex);
+	pool.data->semaphores.release(std::forward<semaphore_type>(semaphore));
+}
+
+uint64_t get_created_count(const pool_type &pool) {
+	std::lock_guard<std::mutex> lock(pool.data->mutex);
+	return pool.data->created;
+}
+
 }  // namespace semaphore
 }  // namespace vcc
@@ -0,0 +1,95 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define NOMINMAX
+#include <algorithm>
+#include <cstring>
+#include <vcc/command.h>
+#include <vcc/internal/flush_batch.h>
+#include <vcc/physical_device.h>
+#include <vcc/queue.h>
+#include <vcc/staging_buffer.h>
+
+namespace vcc {
+namespace staging_buffer {
+
+staging_buffer_type create(const type::supplier<device::device_type> &device,
+		VkDeviceSize size) {
+	buffer::buffer_type buffer(buffer::create(device, 0, size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE, {}));
+	const type::supplier<memory::memory_type> memory(memory::bind(device,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			| VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer));
+	std::unique_ptr<memory::map_type> map(new memory::map_type(
+		memory::map(memory, 0, size)));
+	const VkPhysicalDeviceLimits limits(physical_device::properties(
+		device::get_physical_device(*device)).limits);
+	const VkDeviceSize alignment(std::max<VkDeviceSize>(
+		std::max<VkDeviceSize>(limits.optimalBufferCopyOffsetAlignment,
+			limits.nonCoherentAtomSize), 4));
+	return staging_buffer_type(std::move(buffer), std::move(map), size,
+		alignment);
+}
+
+VkDeviceSize write(queue::queue_type &queue,
+		staging_buffer_type &staging_buffer, const void *data,
+		VkDeviceSize size) {
+	// The flush batch is always locked before the staging buffer.
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(queue));
+	std::lock_guard<std::mutex> lock(staging_buffer.mutex);
+
+	vcc::internal::retire_flush(queue);
+	staging_buffer.ring.release(vcc::internal::completed_flush_tag(queue));
+	VkDeviceSize ring_offset;
+	while (!staging_buffer.ring.allocate(size, staging_buffer.alignment,
+			ring_offset)) {
+		// The ring is full, wait for the oldest submit to finish.
+		if (!vcc::internal::wait_flush(queue)) {
+			throw vcc_exception("Staging buffer is too small for the upload");
+		}
+		staging_buffer.ring.release(vcc::internal::completed_flush_tag(queue));
+	}
+	std::memcpy((uint8_t *) staging_buffer.map->data + ring_offset, data,
+		std::size_t(size));
+	staging_buffer.ring.commit(vcc::internal::flush_tag(queue));
+	return ring_offset;
+}
+
+void upload(queue::queue_type &queue, staging_buffer_type &staging_buffer,
+		const void *data, VkDeviceSize size, buffer::buffer_type &buffer,
+		VkDeviceSize offset) {
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(queue));
+	const VkDeviceSize ring_offset(write(queue, staging_buffer, data, size));
+	command::internal::cmd_args &commands(vcc::internal::flush_commands(queue));
+	// Commands of earlier submits may still read or write the range, at
+	// stages not known here.
+	command::internal::cmd(commands, command::pipeline_barrier(
+		VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		{}, { command::buffer_memory_barrier(VK_ACCESS_MEMORY_WRITE_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED, std::ref(buffer), offset, size) }, {}));
+	command::internal::cmd(commands, command::copy_buffer_type{
+		std::ref(staging_buffer.buffer), std::ref(buffer),
+		{ VkBufferCopy{ ring_offset, offset, size } } });
+	vcc::internal::flush_barrier(queue, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		command::buffer_memory_barrier(VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_MEMORY_READ_BIT, VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED, std::ref(buffer)));
+}
+
+}  // namespace staging_buffer
+}  // namespace vcc
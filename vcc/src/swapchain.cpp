@@ -75,7 +75,8 @@ std::vector<image::image_type> get_images(swapchain_type &swapchain) {
 	std::vector<image::image_type> converted_images;
 	converted_images.reserve(images.size());
 	for (VkImage image : images) {
-		converted_images.push_back(image::image_type(image, internal::get_parent(swapchain), false, VK_IMAGE_TYPE_2D, get_format(swapchain), 1, 1));
+		converted_images.push_back(image::image_type(image, internal::get_parent(swapchain), false, VK_IMAGE_TYPE_2D, get_format(swapchain), 1, 1,
+			VK_IMAGE_LAYOUT_UNDEFINED));
 	}
 	return std::move(converted_images);
 }
@@ -0,0 +1,134 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#define NOMINMAX
+#include <algorithm>
+#include <cstring>
+#include <vcc/internal/flush_batch.h>
+#include <vcc/physical_device.h>
+#include <vcc/queue.h>
+#include <vcc/uniform_arena.h>
+
+namespace vcc {
+namespace uniform_arena {
+
+namespace {
+
+VkDeviceSize align(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// The flush batch of a queue as seen by uniform_blocks_type, lock_flush
+// must be held.
+struct flush_queue_type {
+	vcc::internal::uniform_blocks_type::tag_type completed() {
+		return vcc::internal::completed_flush_tag(queue);
+	}
+
+	bool wait() {
+		return vcc::internal::wait_flush(queue);
+	}
+
+	vcc::internal::uniform_blocks_type::tag_type track() {
+		return vcc::internal::flush_track(queue);
+	}
+
+	queue::queue_type &queue;
+};
+
+}  // anonymous namespace
+
+uniform_arena_type create(const type::supplier<device::device_type> &device,
+		VkDeviceSize size, VkDeviceSize range, uint32_t frames) {
+	if (!frames || range > size) {
+		throw vcc_exception("Invalid uniform arena size");
+	}
+	const VkPhysicalDeviceLimits limits(physical_device::properties(
+		device::get_physical_device(*device)).limits);
+	if (range > limits.maxUniformBufferRange) {
+		throw vcc_exception("Uniform arena range exceeds maxUniformBufferRange");
+	}
+	const VkDeviceSize alignment(std::max<VkDeviceSize>(
+		limits.minUniformBufferOffsetAlignment, limits.nonCoherentAtomSize));
+	const VkDeviceSize stride(align(size, alignment));
+	buffer::buffer_type buffer(buffer::create(device, 0, stride * frames,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, {}));
+	const type::supplier<memory::memory_type> memory(memory::bind(device,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+			| VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer));
+	std::unique_ptr<memory::map_type> map(new memory::map_type(
+		memory::map(memory, 0, stride * frames)));
+	return uniform_arena_type(std::move(buffer), std::move(map), size, range,
+		alignment, stride, frames);
+}
+
+uint32_t add(uniform_arena_type &arena, type::serialize_type &&serialize) {
+	std::lock_guard<std::mutex> lock(arena.mutex);
+	const VkDeviceSize offset(arena.content.add(type::size(serialize)));
+	arena.blocks.push_back(uniform_arena_type::block_type{
+		std::move(serialize), offset });
+	return uint32_t(arena.blocks.size() - 1);
+}
+
+bool flush(queue::queue_type &queue, uniform_arena_type &arena,
+		uint32_t frame) {
+	// The flush batch is always locked before the arena.
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(queue));
+	std::lock_guard<std::mutex> lock(arena.mutex);
+	bool changed(false);
+	for (uniform_arena_type::block_type &block : arena.blocks) {
+		if (type::dirty(block.serialize)) {
+			type::flush(block.serialize,
+				arena.content.content() + block.offset);
+			changed = true;
+		}
+	}
+	flush_queue_type flush_queue{ queue };
+	const VkDeviceSize stride(arena.stride);
+	uint8_t *const data((uint8_t *) arena.map->data);
+	return arena.content.flush(flush_queue, frame, changed,
+		[stride, data](std::size_t version, const char *content,
+				std::size_t size) {
+			std::memcpy(data + version * stride, content, size);
+		});
+}
+
+command::record_type use(const type::supplier<uniform_arena_type> &arena,
+		uint32_t frame) {
+	return command::record_type{
+		[arena, frame](command::internal::cmd_args &args) {
+			// Run by queue::submit with the flush batch locked until the
+			// command buffer is submitted, flush_track is that submit.
+			args.pre_execute_callbacks.add(
+				[arena, frame](queue::queue_type &queue) {
+					flush(queue, *arena, frame);
+				});
+		} };
+}
+
+uint32_t dynamic_offset(const uniform_arena_type &arena, uint32_t block,
+		uint32_t frame) {
+	std::lock_guard<std::mutex> lock(arena.mutex);
+	return uint32_t((frame % arena.content.frames()) * arena.stride
+		+ arena.blocks[block].offset);
+}
+
+descriptor_set::buffer_info_type buffer_info(uniform_arena_type &arena) {
+	return descriptor_set::buffer_info(std::ref(arena.buffer), 0, arena.range);
+}
+
+}  // namespace uniform_arena
+}  // namespace vcc
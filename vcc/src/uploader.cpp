@@ -0,0 +1,247 @@
+/*
+* Copyright 2016 Google Inc. All Rights Reserved.
+
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+
+* http://www.apache.org/licenses/LICENSE-2.0
+
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include <vcc/internal/flush_batch.h>
+#include <vcc/staging_buffer.h>
+#include <vcc/uploader.h>
+
+namespace vcc {
+namespace uploader {
+
+namespace {
+
+typedef vcc::internal::barrier_half_type barrier_half_type;
+
+command::buffer_memory_barrier_type buffer_barrier(
+		const barrier_half_type &half,
+		const type::supplier<buffer::buffer_type> &buffer,
+		VkDeviceSize offset, VkDeviceSize size) {
+	return command::buffer_memory_barrier(half.src_access, half.dst_access,
+		half.src_family, half.dst_family, buffer, offset, size);
+}
+
+command::image_memory_barrier image_barrier(const barrier_half_type &half,
+		const type::supplier<image::image_type> &image,
+		const VkImageSubresourceRange &range) {
+	return command::image_memory_barrier{ half.src_access, half.dst_access,
+		half.old_layout, half.new_layout, half.src_family, half.dst_family,
+		image, range };
+}
+
+// The staging buffer of the transfer queue, lock_flush must be held.
+staging_buffer::staging_buffer_type &transfer_staging_buffer(
+		queue::queue_type &queue) {
+	const type::supplier<staging_buffer::staging_buffer_type> &staging_buffer(
+		queue::get_staging_buffer(queue));
+	if (!staging_buffer) {
+		throw vcc_exception("Transfer queue has no staging buffer");
+	}
+	return *staging_buffer;
+}
+
+}  // anonymous namespace
+
+uploader_type create(
+		const type::supplier<queue::queue_type> &transfer_queue,
+		const type::supplier<queue::queue_type> &graphics_queue,
+		VkDeviceSize staging_size) {
+	const type::supplier<device::device_type> &device(
+		vcc::internal::get_parent(*graphics_queue));
+	if (&*device != &*vcc::internal::get_parent(*transfer_queue)) {
+		throw vcc_exception("The queues are of different devices");
+	}
+	if (!queue::get_staging_buffer(*transfer_queue)) {
+		queue::set_staging_buffer(*transfer_queue,
+			staging_buffer::create(device, staging_size));
+	}
+	uploader_type uploader;
+	uploader.data.reset(new uploader_type::data_type);
+	uploader.data->transfer_queue = transfer_queue;
+	uploader.data->graphics_queue = graphics_queue;
+	uploader.data->queues = vcc::internal::get_instance(*transfer_queue)
+			== vcc::internal::get_instance(*graphics_queue)
+		? vcc::internal::upload_same_queue
+		: queue::get_family_index(*transfer_queue)
+				== queue::get_family_index(*graphics_queue)
+			? vcc::internal::upload_same_family
+			: vcc::internal::upload_other_family;
+	uploader.data->semaphores = semaphore::create_pool(device);
+	return uploader;
+}
+
+void upload(uploader_type &uploader, const void *data, VkDeviceSize size,
+		const type::supplier<buffer::buffer_type> &buffer,
+		VkDeviceSize offset, VkPipelineStageFlags dst_stages,
+		VkAccessFlags dst_access) {
+	uploader_type::data_type &uploader_data(*uploader.data);
+	queue::queue_type &queue(*uploader_data.transfer_queue);
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(queue));
+	staging_buffer::staging_buffer_type &staging_buffer(
+		transfer_staging_buffer(queue));
+	const VkDeviceSize ring_offset(staging_buffer::write(queue,
+		staging_buffer, data, size));
+	const vcc::internal::upload_barriers_type barriers(
+		vcc::internal::upload_barriers(uploader_data.queues,
+			queue::get_family_index(queue),
+			queue::get_family_index(*uploader_data.graphics_queue),
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED, dst_stages,
+			dst_access));
+	command::internal::cmd_args &commands(
+		vcc::internal::flush_commands(queue));
+	command::internal::cmd(commands, command::copy_buffer_type{
+		std::ref(staging_buffer::get_buffer(staging_buffer)), buffer,
+		{ VkBufferCopy{ ring_offset, offset, size } } });
+	command::internal::cmd(commands, command::pipeline_barrier(
+		barriers.release.src_stages, barriers.release.dst_stages, 0, {},
+		{ buffer_barrier(barriers.release, buffer, offset, size) }, {}));
+	uploader_data.batch.add(uploader_type::acquire_type{ buffer, offset,
+		size, type::supplier<image::image_type>(), VkImageSubresourceRange(),
+		barriers });
+}
+
+void upload(uploader_type &uploader, const void *data, VkDeviceSize size,
+		const type::supplier<image::image_type> &image,
+		const VkImageSubresourceRange &range,
+		const std::vector<VkBufferImageCopy> &regions, VkImageLayout layout,
+		VkPipelineStageFlags dst_stages, VkAccessFlags dst_access) {
+	uploader_type::data_type &uploader_data(*uploader.data);
+	queue::queue_type &queue(*uploader_data.transfer_queue);
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(queue));
+	staging_buffer::staging_buffer_type &staging_buffer(
+		transfer_staging_buffer(queue));
+	const VkDeviceSize ring_offset(staging_buffer::write(queue,
+		staging_buffer, data, size));
+	std::vector<VkBufferImageCopy> ring_regions(regions);
+	for (VkBufferImageCopy &region : ring_regions) {
+		region.bufferOffset += ring_offset;
+	}
+	const vcc::internal::upload_barriers_type barriers(
+		vcc::internal::upload_barriers(uploader_data.queues,
+			queue::get_family_index(queue),
+			queue::get_family_index(*uploader_data.graphics_queue),
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout, dst_stages,
+			dst_access));
+	command::internal::cmd_args &commands(
+		vcc::internal::flush_commands(queue));
+	command::internal::cmd(commands, command::pipeline_barrier(
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		{}, {}, { command::image_memory_barrier{ 0,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_QUEUE_FAMILY_IGNORED,
+			VK_QUEUE_FAMILY_IGNORED, image, range } }));
+	command::internal::cmd(commands, command::copy_buffer_to_image(
+		std::ref(staging_buffer::get_buffer(staging_buffer)), image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ring_regions));
+	command::internal::cmd(commands, command::pipeline_barrier(
+		barriers.release.src_stages, barriers.release.dst_stages, 0, {}, {},
+		{ image_barrier(barriers.release, image, range) }));
+	uploader_data.batch.add(uploader_type::acquire_type{
+		type::supplier<buffer::buffer_type>(), 0, 0, image, range, barriers });
+}
+
+void upload(uploader_type &uploader, input_buffer::input_buffer_type &buffer,
+		VkPipelineStageFlags dst_stages, VkAccessFlags dst_access) {
+	// The flush batch is always locked before the input_buffer.
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(*uploader.data->transfer_queue));
+	std::unique_lock<std::mutex> lock(
+		input_buffer::internal::get_mutex(buffer));
+	if (input_buffer::internal::get_versions(buffer).size() > 1) {
+		throw vcc_exception("Buffered input_buffer can not be uploaded");
+	}
+	const type::serialize_type &serialize(
+		input_buffer::internal::get_serialize(buffer));
+	const std::pair<std::size_t, std::size_t> range(
+		type::dirty_range(serialize));
+	if (range.first == range.second) {
+		return;
+	}
+	// As input_buffer::flush on a queue, the shadow keeps the content that
+	// is not dirty for later flushes of the dirty range.
+	std::string &shadow(input_buffer::internal::get_shadow(buffer));
+	if (shadow.size() != type::size(serialize)) {
+		shadow.resize(type::size(serialize), '\0');
+	}
+	type::flush(serialize, &shadow[0]);
+	upload(uploader, &shadow[range.first], range.second - range.first,
+		std::ref(input_buffer::internal::get_buffer(buffer)), range.first,
+		dst_stages, dst_access);
+}
+
+void submit(uploader_type &uploader) {
+	uploader_type::data_type &data(*uploader.data);
+	std::lock_guard<std::mutex> lock(data.mutex);
+	queue::queue_type &transfer_queue(*data.transfer_queue);
+	queue::queue_type &graphics_queue(*data.graphics_queue);
+	std::vector<uploader_type::acquire_type> acquires;
+	if (data.queues == vcc::internal::upload_same_queue) {
+		// The releases made the copies visible, the graphics work
+		// submitted next is ordered after them.
+		std::unique_lock<std::recursive_mutex> flush_lock(
+			vcc::internal::lock_flush(transfer_queue));
+		if (data.batch.take(acquires)) {
+			queue::submit(transfer_queue, {}, {}, {});
+		}
+		return;
+	}
+	semaphore::semaphore_type semaphore;
+	{
+		std::unique_lock<std::recursive_mutex> flush_lock(
+			vcc::internal::lock_flush(transfer_queue));
+		// Taken with the flush batch locked, every release of the
+		// acquires is in this submit.
+		if (!data.batch.take(acquires)) {
+			return;
+		}
+		semaphore = semaphore::acquire(data.semaphores,
+			vcc::internal::completed_flush_tag(graphics_queue));
+		queue::submit(transfer_queue, {}, {}, { std::ref(semaphore) });
+	}
+	// The semaphore is waited for at the source stages of the acquires,
+	// which chain the graphics work submitted after this batch.
+	std::vector<command::buffer_memory_barrier_type> buffer_barriers;
+	std::vector<command::image_memory_barrier> image_barriers;
+	VkPipelineStageFlags wait_stages(0), dst_stages(0);
+	for (const uploader_type::acquire_type &acquire : acquires) {
+		wait_stages |= acquire.barriers.acquire.src_stages;
+		dst_stages |= acquire.barriers.acquire.dst_stages;
+		if (acquire.buffer) {
+			buffer_barriers.push_back(buffer_barrier(acquire.barriers.acquire,
+				acquire.buffer, acquire.offset, acquire.size));
+		} else {
+			image_barriers.push_back(image_barrier(acquire.barriers.acquire,
+				acquire.image, acquire.range));
+		}
+	}
+	std::unique_lock<std::recursive_mutex> flush_lock(
+		vcc::internal::lock_flush(graphics_queue));
+	command_buffer::command_buffer_type &command_buffer(
+		vcc::internal::acquire_transient(graphics_queue));
+	command_buffer::compile(command_buffer,
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, VK_FALSE, 0, 0,
+		command::pipeline_barrier(wait_stages, dst_stages, 0, {},
+			buffer_barriers, image_barriers));
+	const vcc::internal::flush_batch_type::tag_type tag(
+		vcc::internal::flush_track(graphics_queue));
+	queue::submit(graphics_queue, { queue::wait_semaphore{
+		std::ref(semaphore), wait_stages } }, { std::ref(command_buffer) },
+		{});
+	semaphore::release(data.semaphores, std::move(semaphore), tag);
+}
+
+}  // namespace uploader
+}  // namespace vcc
@@ -17,7 +17,9 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstring>
 #include <vcc/command.h>
+#include <vcc/internal/flush_batch.h>
 #include <vcc/physical_device.h>
 #include <vcc/surface.h>
 #include <vcc/window.h>
@@ -89,6 +91,29 @@ input_callbacks_type &input_callbacks_type::set_touch_move_callback(
 	return *this;
 }
 
+command_buffer::command_buffer_type &acquire_command_buffer(
+		frame_type &frame) {
+	if (frame.used_command_buffers == frame.command_buffers.size()) {
+		frame.command_buffers.push_back(std::move(
+			command_buffer::allocate(vcc::internal::get_parent(
+				frame.command_pool), std::ref(frame.command_pool),
+				VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1).front()));
+	}
+	return frame.command_buffers[frame.used_command_buffers++];
+}
+
+VkDeviceSize upload(frame_type &frame, const void *data, VkDeviceSize size,
+		VkDeviceSize alignment) {
+	const VkDeviceSize offset((frame.upload_offset + alignment - 1)
+		/ alignment * alignment);
+	if (offset + size > frame.upload_size) {
+		throw vcc_exception("Frame upload buffer is full");
+	}
+	memcpy((char *) frame.upload_map->data + offset, data, std::size_t(size));
+	frame.upload_offset = offset + size;
+	return offset;
+}
+
 #ifdef _WIN32
 const char *class_name = "vcc-vulkan";
 #endif // WIN32
@@ -97,6 +122,7 @@ namespace internal {
 
 window_data_type::~window_data_type() {
 	render_thread.join();
+	pacer.idle([this](uint32_t slot) { wait_frame(slot); });
 #ifdef _WIN32
 	DestroyWindow(window);
 #endif // _WIN32
@@ -105,6 +131,8 @@ window_data_type::~window_data_type() {
 } // namespace internal
 
 void resize(internal::window_data_type &data, VkExtent2D extent) {
+	// The old swapchain images may still be rendered to.
+	data.pacer.idle([&data](uint32_t slot) { data.wait_frame(slot); });
 	{
 		// Check the surface capabilities and formats
 		const VkPhysicalDevice physical_device(device::get_physical_device(*data.device));
@@ -153,8 +181,7 @@ void resize(internal::window_data_type &data, VkExtent2D extent) {
 				std::make_shared<vcc::image::image_type>(std::move(si)));
 			// Render loop will expect image to have been used before and in VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
 			// layout and will change to COLOR_ATTACHMENT_OPTIMAL, so init the image to that state
-			vcc::command_buffer::command_buffer_type command_buffer(std::move(vcc::command_buffer::allocate(type::supplier<device::device_type>(data.device), std::ref(data.cmd_pool), VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1).front()));
-			vcc::command_buffer::compile(command_buffer, 0, VK_FALSE, 0, 0,
+			vcc::queue::execute(data.present_queue,
 				vcc::command::pipeline_barrier(
 					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
 					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, {}, {},
@@ -168,7 +195,6 @@ void resize(internal::window_data_type &data, VkExtent2D extent) {
 							{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
 						}
 					}));
-			vcc::queue::submit(data.present_queue, {}, { std::reference_wrapper<vcc::command_buffer::command_buffer_type>(command_buffer) }, {});
 
 			vcc::image_view::image_view_type view(vcc::image_view::create(
 				swapchain_image, VK_IMAGE_VIEW_TYPE_2D, data.format,
@@ -230,11 +256,15 @@ void window_data_type::draw() {
 	uint32_t current_buffer;
 	vcc::semaphore::semaphore_type present_complete_semaphore;
 	do {
-		present_complete_semaphore = vcc::semaphore::create(device);
+		present_complete_semaphore = vcc::semaphore::acquire(semaphore_pool,
+			vcc::internal::completed_flush_tag(present_queue));
 		std::tie(err, current_buffer) = vcc::swapchain::acquire_next_image(
 			swapchain, present_complete_semaphore);
 		switch (err) {
 		case VK_ERROR_OUT_OF_DATE_KHR:
+			// The semaphore is left unsignaled.
+			vcc::semaphore::release(semaphore_pool,
+				std::move(present_complete_semaphore));
 			// swapchain is out of date (e.g. the window was resized) and
 			// must be recreated:
 			resize_callback(extent, format, swapchain_images);
@@ -259,10 +289,14 @@ void window_data_type::draw() {
 
 	draw_callback(current_buffer);
 
+	const vcc::internal::flush_batch_type::tag_type post_draw_tag(
+		vcc::internal::flush_track(present_queue));
 	vcc::queue::submit(present_queue,
 		{ vcc::queue::wait_semaphore{ std::ref(present_complete_semaphore) } },
 		{ std::ref(get_post_draw_command(swapchain_images[current_buffer])) },
 		{});
+	vcc::semaphore::release(semaphore_pool,
+		std::move(present_complete_semaphore), post_draw_tag);
 
 	err = vcc::queue::present(present_queue, {}, { std::ref(swapchain) },
 		{ current_buffer });
@@ -282,6 +316,103 @@ void window_data_type::draw() {
 	}
 }
 
+void window_data_type::wait_frame(uint32_t slot) {
+	frame_type &frame(frames[slot]);
+	vcc::fence::wait(*device, { std::ref(frame.fence) }, true,
+		std::chrono::nanoseconds::max());
+	vcc::fence::reset(*device, { std::ref(frame.fence) });
+}
+
+void window_data_type::draw_frame() {
+	if (frames.empty()) {
+		frames.resize(frames_in_flight);
+		for (uint32_t slot = 0; slot < frames_in_flight; ++slot) {
+			frame_type &frame(frames[slot]);
+			frame.slot = slot;
+			frame.fence = vcc::fence::create(device);
+			frame.acquire_semaphore = vcc::semaphore::create(device);
+			frame.render_semaphore = vcc::semaphore::create(device);
+			frame.command_pool = vcc::command_pool::create(device,
+				VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+				vcc::queue::get_family_index(*graphics_queue));
+			frame.used_command_buffers = 0;
+			frame.upload_buffer = vcc::buffer::create(device, 0, upload_size,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+					| VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+					| VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+					| VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_SHARING_MODE_EXCLUSIVE, {});
+			const type::supplier<vcc::memory::memory_type> memory(
+				vcc::memory::bind(device, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+					| VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.upload_buffer));
+			frame.upload_map.reset(new vcc::memory::map_type(
+				vcc::memory::map(memory, 0, upload_size)));
+			frame.upload_size = upload_size;
+			frame.upload_offset = 0;
+		}
+		pacer = vcc::internal::frame_pacer_type(frames_in_flight);
+	}
+	const auto wait([this](uint32_t slot) { wait_frame(slot); });
+
+	frame_type &frame(frames[pacer.begin(wait)]);
+	// Nothing of the previous frame of the slot is pending anymore.
+	vcc::command_pool::reset(frame.command_pool, 0);
+	frame.used_command_buffers = 0;
+	frame.upload_offset = 0;
+
+	VkResult err;
+	do {
+		std::tie(err, frame.image_index) = vcc::swapchain::acquire_next_image(
+			swapchain, frame.acquire_semaphore);
+		switch (err) {
+		case VK_ERROR_OUT_OF_DATE_KHR:
+			// swapchain is out of date (e.g. the window was resized) and
+			// must be recreated:
+			resize_callback(extent, format, swapchain_images);
+			break;
+		case VK_SUBOPTIMAL_KHR:
+			VCC_PRINT("VK_SUBOPTIMAL_KHR");
+			break;
+		default:
+			if (err) {
+				VCC_PRINT("vcc::swapchain::acquire_next_image resulted in %u", err);
+			}
+			assert(!err);
+			break;
+		}
+	} while (err == VK_ERROR_OUT_OF_DATE_KHR);
+	pacer.acquired(frame.slot, frame.image_index, wait);
+
+	swapchain_type &image(swapchain_images[frame.image_index]);
+	vcc::queue::submit(*graphics_queue,
+		{ vcc::queue::wait_semaphore{ std::ref(frame.acquire_semaphore),
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT } },
+		{ std::ref(get_pre_draw_command(image)) }, {});
+
+	frame_callback(frame);
+
+	// The fence of the last submit on the graphics queue covers the whole
+	// frame.
+	vcc::queue::submit(*graphics_queue, {},
+		{ std::ref(get_post_draw_command(image)) },
+		{ std::ref(frame.render_semaphore) }, frame.fence);
+	pacer.submit(frame.slot);
+
+	err = vcc::queue::present(present_queue,
+		{ std::ref(frame.render_semaphore) }, { std::ref(swapchain) },
+		{ frame.image_index });
+	switch (err) {
+	case VK_ERROR_OUT_OF_DATE_KHR:
+		resize_callback(extent, format, swapchain_images);
+		break;
+	case VK_SUBOPTIMAL_KHR:
+		VCC_PRINT("VK_SUBOPTIMAL_KHR");
+		break;
+	default:
+		assert(!err);
+	}
+}
+
 } // namespace internal
 
 void initialize(internal::window_data_type &data,
@@ -302,6 +433,7 @@ void initialize(internal::window_data_type &data,
 #endif // _WIN32
 
 	data.present_queue = queue::get_present_queue(data.device, data.surface);
+	data.semaphore_pool = semaphore::create_pool(data.device);
 
 	data.cmd_pool = vcc::command_pool::create(data.device, 0,
 		vcc::queue::get_family_index(data.present_queue));
@@ -540,11 +672,9 @@ window_type create(
 	return window_type{std::move(data)};
 }
 
-int run(window_type &window, const resize_callback_type &resize_callback,
-	const draw_callback_type &draw_callback,
-	const input_callbacks_type &input_callbacks) {
-	window.data->resize_callback = resize_callback;
-	window.data->draw_callback = draw_callback;
+namespace {
+
+int run(window_type &window, const input_callbacks_type &input_callbacks) {
 	window.data->input_callbacks = input_callbacks;
 	window.data->render_thread.start();
 #ifdef _WIN32
@@ -583,5 +713,28 @@ int run(window_type &window, const resize_callback_type &resize_callback,
 #endif // __ANDROID__
 }
 
+}  // anonymous namespace
+
+int run(window_type &window, const resize_callback_type &resize_callback,
+	const draw_callback_type &draw_callback,
+	const input_callbacks_type &input_callbacks) {
+	window.data->resize_callback = resize_callback;
+	window.data->draw_callback = draw_callback;
+	return run(window, input_callbacks);
+}
+
+int run(window_type &window, const resize_callback_type &resize_callback,
+	const frame_callback_type &frame_callback, uint32_t frames_in_flight,
+	VkDeviceSize upload_size, const input_callbacks_type &input_callbacks) {
+	if (!frames_in_flight) {
+		throw vcc_exception("At least one frame in flight is required");
+	}
+	window.data->resize_callback = resize_callback;
+	window.data->frame_callback = frame_callback;
+	window.data->frames_in_flight = frames_in_flight;
+	window.data->upload_size = upload_size;
+	return run(window, input_callbacks);
+}
+
 }  // namespace window
 }  // namespace vcc